@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+
+// Run the function repeatedly for at least minTime seconds, after a first run to warm up the caches
+// Returns the average time of a run, in milliseconds
+template<typename F>
+double MeasureTime(F&& function, double minTime = 0.25)
+{
+    using Clock = std::chrono::steady_clock;
+
+    function();
+
+    unsigned int runCount = 0;
+    Clock::time_point start = Clock::now();
+    std::chrono::duration<double> elapsed(0.0);
+    do
+    {
+        function();
+        ++runCount;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < minTime);
+
+    return elapsed.count() * 1000.0 / runCount;
+}
+
+// Keep the compiler from removing the computation of a value that is not used
+template<typename T>
+void DoNotOptimize(const T& value)
+{
+    static volatile const T* s_sink;
+    s_sink = &value;
+}
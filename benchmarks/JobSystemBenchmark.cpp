@@ -0,0 +1,104 @@
+#include "BenchmarkUtils.h"
+
+#include <ituGL/core/JobSystem.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Overhead of spawning and waiting for empty jobs, and scaling of ParallelFor from 1 thread to all the hardware threads
+// Each configuration creates its own system, with one worker less than the threads, as the main thread also runs jobs
+// Usage: JobSystemBenchmark [max threads]
+
+// Work for the scaling test, heavy enough per element to hide the cost of the chunks
+static float ComputeElement(unsigned int index)
+{
+    float value = static_cast<float>(index);
+    for (int i = 0; i < 64; ++i)
+    {
+        value = std::sqrt(value * 1.0001f + 1.0f);
+    }
+    return value;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int maxThreadCount = argc > 1 ? std::stoi(argv[1]) : std::max(std::thread::hardware_concurrency(), 1u);
+
+    const unsigned int jobCount = 10000;
+    const unsigned int elementCount = 1 << 20;
+    std::vector<float> results(elementCount);
+
+    double singleThreadTime = MeasureTime([&]()
+        {
+            for (unsigned int i = 0; i < elementCount; ++i)
+            {
+                results[i] = ComputeElement(i);
+            }
+            DoNotOptimize(results);
+        });
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << "Without jobs: " << std::fixed << std::setprecision(3) << singleThreadTime << " ms" << std::endl;
+    std::cout << std::setw(8) << "Threads" << std::setw(15) << "Spawn+run" << std::setw(15) << "Nested"
+        << std::setw(15) << "ParallelFor" << std::setw(10) << "Speedup" << std::endl;
+
+    for (unsigned int threadCount = 1; threadCount <= maxThreadCount; ++threadCount)
+    {
+        // No workers would mean one for each hardware thread, so a single thread has one worker that is never woken up
+        JobSystem jobSystem(std::max(threadCount - 1, 1u));
+
+        // Empty jobs spawned from the main thread, and run by the main thread and the workers
+        double spawnTime = MeasureTime([&]()
+            {
+                JobSystem::Counter counter;
+                for (unsigned int i = 0; i < jobCount; ++i)
+                {
+                    jobSystem.Spawn([]() {}, &counter);
+                }
+                jobSystem.Wait(counter);
+            });
+
+        // Jobs spawned from other jobs, that are queued in the workers and stolen by the rest
+        double nestedTime = MeasureTime([&]()
+            {
+                JobSystem::Counter counter;
+                for (unsigned int i = 0; i < 100; ++i)
+                {
+                    jobSystem.Spawn([&jobSystem, jobCount]()
+                        {
+                            JobSystem::Counter childCounter;
+                            for (unsigned int j = 0; j < jobCount / 100; ++j)
+                            {
+                                jobSystem.Spawn([]() {}, &childCounter);
+                            }
+                            jobSystem.Wait(childCounter);
+                        }, &counter);
+                }
+                jobSystem.Wait(counter);
+            });
+
+        double parallelForTime = MeasureTime([&]()
+            {
+                jobSystem.ParallelFor(0, elementCount, [&results](unsigned int begin, unsigned int end)
+                    {
+                        for (unsigned int i = begin; i < end; ++i)
+                        {
+                            results[i] = ComputeElement(i);
+                        }
+                    });
+                DoNotOptimize(results);
+            });
+
+        std::cout << std::setw(8) << threadCount << std::fixed << std::setprecision(1)
+            << std::setw(12) << spawnTime * 1.0e6 / jobCount << " ns"
+            << std::setw(12) << nestedTime * 1.0e6 / jobCount << " ns"
+            << std::setw(12) << std::setprecision(3) << parallelForTime << " ms"
+            << std::setw(9) << std::setprecision(2) << singleThreadTime / parallelForTime << "x" << std::endl;
+    }
+
+    return 0;
+}
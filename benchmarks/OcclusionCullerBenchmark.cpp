@@ -0,0 +1,120 @@
+#include "BenchmarkUtils.h"
+
+#include <ituGL/renderer/OcclusionCuller.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+// Speed of the software occlusion culling, rasterizing a city of box occluders and testing the boxes of the objects between them
+// Rasterization is timed from Begin to End, with the worker thread, and the tests for all the boxes after it
+// Usage: OcclusionCullerBenchmark [occluder count] [box count]
+
+// Unit cube centered at the origin, scaled by the world matrix of each occluder
+static void CreateCube(std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        positions.emplace_back((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+    }
+    indices = {
+        0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,
+        0, 1, 4, 1, 5, 4,   2, 6, 3, 3, 6, 7,
+        0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5,
+    };
+}
+
+struct Box
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+static void BenchmarkCuller(const std::string& name, OcclusionCuller& culler, const glm::mat4& viewProjMatrix,
+    std::span<const glm::vec3> positions, std::span<const unsigned int> indices, const std::vector<glm::mat4>& occluderMatrices,
+    const std::vector<Box>& boxes, float depthBias)
+{
+    double rasterizationTime = MeasureTime([&]()
+        {
+            culler.Begin(viewProjMatrix);
+            for (const glm::mat4& worldMatrix : occluderMatrices)
+            {
+                culler.AddOccluder(positions, indices, worldMatrix, depthBias);
+            }
+            culler.End();
+        });
+
+    unsigned int occludedCount = 0;
+    double testTime = MeasureTime([&]()
+        {
+            occludedCount = 0;
+            for (const Box& box : boxes)
+            {
+                occludedCount += culler.IsOccluded(box.min, box.max) ? 1 : 0;
+            }
+            DoNotOptimize(occludedCount);
+        });
+
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+        << std::setw(10) << culler.GetWidth() << "x" << std::left << std::setw(6) << culler.GetHeight() << std::right
+        << std::setw(10) << culler.GetTriangleCount()
+        << std::setw(12) << rasterizationTime << " ms"
+        << std::setw(12) << testTime * 1.0e6 / boxes.size() << " ns"
+        << std::setw(9) << std::setprecision(1) << 100.0 * occludedCount / boxes.size() << " %" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int occluderCount = argc > 1 ? std::stoi(argv[1]) : 1000;
+    int boxCount = argc > 2 ? std::stoi(argv[2]) : 100000;
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    CreateCube(positions, indices);
+
+    // Buildings in a grid in front of the camera, with random heights
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::mat4> occluderMatrices;
+    int gridSize = 1;
+    while (gridSize * gridSize < occluderCount)
+    {
+        ++gridSize;
+    }
+    for (int i = 0; i < occluderCount; ++i)
+    {
+        glm::vec3 position((i % gridSize - gridSize * 0.5f) * 4.0f, 0.0f, -4.0f - (i / gridSize) * 4.0f);
+        glm::vec3 size(2.0f + unit(random), 2.0f + 8.0f * unit(random), 2.0f + unit(random));
+        glm::mat4 worldMatrix = glm::translate(glm::mat4(1.0f), position + glm::vec3(0.0f, size.y * 0.5f, 0.0f));
+        occluderMatrices.push_back(glm::scale(worldMatrix, size));
+    }
+
+    // Small objects scattered in the streets and behind the buildings
+    std::vector<Box> boxes;
+    float extent = gridSize * 4.0f;
+    for (int i = 0; i < boxCount; ++i)
+    {
+        glm::vec3 center((unit(random) - 0.5f) * extent, unit(random) * 2.0f, -2.0f - unit(random) * extent);
+        glm::vec3 halfSize(0.1f + 0.4f * unit(random));
+        boxes.push_back(Box{ center - halfSize, center + halfSize });
+    }
+
+    glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.7f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projMatrix = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, extent * 2.0f);
+    glm::mat4 viewProjMatrix = projMatrix * viewMatrix;
+
+    std::cout << "Occluders: " << occluderCount << ", boxes: " << boxCount << std::endl;
+    std::cout << std::left << std::setw(24) << "Configuration" << std::right << std::setw(17) << "Size" << std::setw(10) << "Triangles"
+        << std::setw(15) << "Rasterize" << std::setw(15) << "Test/box" << std::setw(11) << "Occluded" << std::endl;
+
+    OcclusionCuller smallCuller(256, 128);
+    OcclusionCuller largeCuller(512, 256);
+    BenchmarkCuller("No bias", smallCuller, viewProjMatrix, positions, indices, occluderMatrices, boxes, 0.0f);
+    BenchmarkCuller("Depth bias 0.1", smallCuller, viewProjMatrix, positions, indices, occluderMatrices, boxes, 0.1f);
+    BenchmarkCuller("No bias", largeCuller, viewProjMatrix, positions, indices, occluderMatrices, boxes, 0.0f);
+    BenchmarkCuller("Depth bias 0.1", largeCuller, viewProjMatrix, positions, indices, occluderMatrices, boxes, 0.1f);
+
+    return 0;
+}
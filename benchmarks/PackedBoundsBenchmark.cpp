@@ -0,0 +1,82 @@
+#include "BenchmarkUtils.h"
+
+#include <ituGL/scene/PackedBounds.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+// Frustum culling of boxes stored as structure of arrays, against the same boxes tested one by one as AabbBounds
+// Boxes are scattered around the camera, so about a tenth of them are inside the frustum
+// Usage: PackedBoundsBenchmark [max count]
+
+static void BenchmarkCount(unsigned int count, const FrustumBounds& frustum, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    std::vector<AabbBounds> boxes;
+    PackedBounds packedBounds;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        AabbBounds box(glm::vec3(position(random), position(random), position(random)), glm::vec3(size(random), size(random), size(random)));
+        boxes.push_back(box);
+        packedBounds.Add(box);
+    }
+
+    std::vector<bool> visible(count);
+    unsigned int visibleCount = 0;
+    double boxTime = MeasureTime([&]()
+        {
+            visibleCount = 0;
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                visible[i] = Bounds::Intersects(frustum, boxes[i]);
+                visibleCount += visible[i] ? 1 : 0;
+            }
+            DoNotOptimize(visibleCount);
+        });
+
+    std::vector<uint8_t> visibilityMask;
+    double packedTime = MeasureTime([&]()
+        {
+            packedBounds.TestFrustum(frustum, visibilityMask);
+            DoNotOptimize(visibilityMask);
+        });
+
+    // Both tests must agree, they only differ in the layout
+    unsigned int mismatchCount = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        mismatchCount += PackedBounds::IsVisible(visibilityMask, i) != visible[i] ? 1 : 0;
+    }
+
+    std::cout << std::setw(10) << count << std::fixed << std::setprecision(2)
+        << std::setw(9) << 100.0 * visibleCount / count << " %"
+        << std::setw(12) << boxTime * 1.0e6 / count << " ns"
+        << std::setw(12) << packedTime * 1.0e6 / count << " ns"
+        << std::setw(9) << boxTime / packedTime << "x"
+        << std::setw(11) << mismatchCount << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int maxCount = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+    glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projMatrix = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    FrustumBounds frustum(projMatrix * viewMatrix);
+
+    std::cout << std::setw(10) << "Count" << std::setw(11) << "Visible" << std::setw(15) << "AabbBounds"
+        << std::setw(15) << "PackedBounds" << std::setw(10) << "Speedup" << std::setw(11) << "Mismatch" << std::endl;
+
+    std::mt19937 random(1234);
+    for (unsigned int count = 1000; count <= maxCount; count *= 10)
+    {
+        BenchmarkCount(count, frustum, random);
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "BenchmarkUtils.h"
+
+#include <ituGL/scene/Scene.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/Transform.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Iteration of the scene with the dense arrays of each node type, against the map keyed by name it used before
+// The map visits each node through the virtual AcceptVisitor, in the order of the hashes, like the old scene
+// Usage: SceneBenchmark [node count]
+
+// Reads the transform of each model, like the visitors that copy them to the renderer
+class TranslationVisitor : public SceneVisitor
+{
+public:
+    void VisitModel(SceneModel& sceneModel) override
+    {
+        m_sum += sceneModel.GetTransform()->GetTranslation();
+    }
+
+    glm::vec3 m_sum = glm::vec3(0.0f);
+};
+
+int main(int argc, char* argv[])
+{
+    unsigned int nodeCount = argc > 1 ? std::stoi(argv[1]) : 100000;
+
+    // Models, with a plain node every tenth node. The nodes are created in a random order, so they are scattered in memory
+    std::mt19937 random(1234);
+    std::vector<unsigned int> order(nodeCount);
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), random);
+
+    Scene scene;
+    std::unordered_map<std::string, std::shared_ptr<SceneNode>> nodeMap;
+    std::vector<std::string> names;
+    std::vector<Scene::Handle> handles;
+    for (unsigned int i : order)
+    {
+        std::string name = "node" + std::to_string(i);
+        std::shared_ptr<Transform> transform = std::make_shared<Transform>();
+        transform->SetTranslation(glm::vec3(static_cast<float>(i), 1.0f, 0.0f));
+        std::shared_ptr<SceneNode> node = i % 10 == 0 ? std::make_shared<SceneNode>(name, transform) : std::make_shared<SceneModel>(name, nullptr, transform);
+        nodeMap[name] = node;
+        handles.push_back(scene.AddSceneNode(node));
+        names.push_back(name);
+    }
+
+    TranslationVisitor mapVisitor;
+    double mapTime = MeasureTime([&]()
+        {
+            for (auto& pair : nodeMap)
+            {
+                pair.second->AcceptVisitor(mapVisitor);
+            }
+            DoNotOptimize(mapVisitor.m_sum);
+        });
+
+    TranslationVisitor sceneVisitor;
+    double sceneTime = MeasureTime([&]()
+        {
+            scene.AcceptVisitor(sceneVisitor);
+            DoNotOptimize(sceneVisitor.m_sum);
+        });
+
+    // Resolving every node, by name and by handle
+    unsigned int foundCount = 0;
+    double nameTime = MeasureTime([&]()
+        {
+            for (const std::string& name : names)
+            {
+                foundCount += scene.GetSceneNode(name) ? 1 : 0;
+            }
+            DoNotOptimize(foundCount);
+        });
+
+    double handleTime = MeasureTime([&]()
+        {
+            for (Scene::Handle handle : handles)
+            {
+                foundCount += scene.GetSceneNode(handle) ? 1 : 0;
+            }
+            DoNotOptimize(foundCount);
+        });
+
+    std::cout << "Nodes: " << nodeCount << std::endl;
+    std::cout << std::left << std::setw(24) << "Operation" << std::right << std::setw(15) << "Total" << std::setw(15) << "Per node" << std::endl;
+    auto printRow = [nodeCount](const char* name, double time)
+    {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setw(12) << std::setprecision(3) << time << " ms"
+            << std::setw(12) << std::setprecision(2) << time * 1.0e6 / nodeCount << " ns" << std::endl;
+    };
+    printRow("Visit map by name", mapTime);
+    printRow("Visit dense arrays", sceneTime);
+    printRow("Get by name", nameTime);
+    printRow("Get by handle", handleTime);
+    std::cout << "Speedup of the visit: " << std::setprecision(2) << mapTime / sceneTime << "x" << std::endl;
+
+    return 0;
+}
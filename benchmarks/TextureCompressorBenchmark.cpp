@@ -0,0 +1,269 @@
+#include "BenchmarkUtils.h"
+
+#include <ituGL/texture/TextureCompressor.h>
+#include <ituGL/asset/TextureLoader.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <thread>
+
+// Quality and speed of the BCn encoder over the textures of the models in the exercises
+// Quality is the PSNR of the decoded blocks against the source image, speed is measured with 1 thread and with all of them
+// Usage: TextureCompressorBenchmark [directory]
+
+// Expand a 565 color to 8 bits per channel, like the hardware decoders
+static void DecodeRGB565(unsigned short value, int color[3])
+{
+    int r = (value >> 11) & 0x1F, g = (value >> 5) & 0x3F, b = value & 0x1F;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Decode a BC1 block into the RGB channels of 16 RGBA pixels
+static void DecodeColorBlock(const unsigned char* block, unsigned char pixels[64])
+{
+    unsigned short value0 = block[0] | (block[1] << 8);
+    unsigned short value1 = block[2] | (block[3] << 8);
+    int palette[4][3];
+    DecodeRGB565(value0, palette[0]);
+    DecodeRGB565(value1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (value0 > value1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<unsigned int>(block[7]) << 24);
+    for (int i = 0; i < 16; ++i)
+    {
+        const int* color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 3; ++c)
+        {
+            pixels[i * 4 + c] = static_cast<unsigned char>(color[c]);
+        }
+    }
+}
+
+// Decode a BC4 block into one channel of 16 RGBA pixels
+static void DecodeChannelBlock(const unsigned char* block, int channel, unsigned char pixels[64])
+{
+    int palette[8] = { block[0], block[1] };
+    for (int i = 1; i < 7; ++i)
+    {
+        palette[i + 1] = block[0] > block[1] ? ((7 - i) * block[0] + i * block[1]) / 7 : ((5 - i) * block[0] + i * block[1]) / 5;
+    }
+    if (block[0] <= block[1])
+    {
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    unsigned long long indices = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        indices |= static_cast<unsigned long long>(block[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        pixels[i * 4 + channel] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+// PSNR in dB of the decoded image, over the channels of the source
+static double ComputePSNR(TextureObject::InternalFormat format, const std::vector<std::byte>& data, int width, int height, int componentCount,
+    const std::vector<std::byte>& compressedData)
+{
+    const unsigned char* source = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* block = reinterpret_cast<const unsigned char*>(compressedData.data());
+    unsigned int blockSize = TextureCompressor::GetBlockSize(format);
+    int blockCountX = (width + 3) / 4, blockCountY = (height + 3) / 4;
+
+    double squaredError = 0.0;
+    size_t sampleCount = 0;
+    unsigned char pixels[64];
+    for (int blockY = 0; blockY < blockCountY; ++blockY)
+    {
+        for (int blockX = 0; blockX < blockCountX; ++blockX, block += blockSize)
+        {
+            switch (format)
+            {
+            case TextureObject::InternalFormatRGBBC1:
+                DecodeColorBlock(block, pixels);
+                break;
+            case TextureObject::InternalFormatRGBABC3:
+                DecodeChannelBlock(block, 3, pixels);
+                DecodeColorBlock(block + 8, pixels);
+                break;
+            case TextureObject::InternalFormatRBC4:
+                DecodeChannelBlock(block, 0, pixels);
+                break;
+            case TextureObject::InternalFormatRGBC5:
+                DecodeChannelBlock(block, 0, pixels);
+                DecodeChannelBlock(block + 8, 1, pixels);
+                break;
+            default:
+                break;
+            }
+
+            for (int i = 0; i < 16; ++i)
+            {
+                int x = blockX * 4 + (i & 3), y = blockY * 4 + (i >> 2);
+                if (x >= width || y >= height)
+                {
+                    continue;
+                }
+                const unsigned char* pixel = source + (static_cast<size_t>(y) * width + x) * componentCount;
+                for (int c = 0; c < componentCount; ++c)
+                {
+                    double error = static_cast<double>(pixel[c]) - pixels[i * 4 + c];
+                    squaredError += error * error;
+                }
+                sampleCount += componentCount;
+            }
+        }
+    }
+
+    double meanSquaredError = squaredError / std::max<size_t>(sampleCount, 1);
+    return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+
+static const char* GetFormatName(TextureObject::InternalFormat format)
+{
+    switch (format)
+    {
+    case TextureObject::InternalFormatRGBBC1: return "BC1";
+    case TextureObject::InternalFormatRGBABC3: return "BC3";
+    case TextureObject::InternalFormatRBC4: return "BC4";
+    case TextureObject::InternalFormatRGBC5: return "BC5";
+    default: return "?";
+    }
+}
+
+struct Totals
+{
+    double psnr = 0.0;
+    double pixelCount = 0.0;
+    double singleThreadTime = 0.0;
+    double multiThreadTime = 0.0;
+    unsigned int imageCount = 0;
+};
+
+static void BenchmarkImage(const std::string& name, TextureObject::InternalFormat format, const std::vector<std::byte>& data,
+    int width, int height, int componentCount, Totals& totals)
+{
+    std::vector<std::byte> compressedData(TextureCompressor::GetCompressedSize(format, width, height));
+
+    double singleThreadTime = MeasureTime([&]() { TextureCompressor::Compress(format, data, width, height, componentCount, compressedData, 1); });
+    double multiThreadTime = MeasureTime([&]() { TextureCompressor::Compress(format, data, width, height, componentCount, compressedData, 0); });
+    double psnr = ComputePSNR(format, data, width, height, componentCount, compressedData);
+
+    double megapixels = static_cast<double>(width) * height / 1.0e6;
+    std::cout << std::left << std::setw(36) << name << std::setw(5) << GetFormatName(format)
+        << std::right << std::setw(6) << width << "x" << std::left << std::setw(6) << height
+        << std::right << std::fixed << std::setprecision(2)
+        << std::setw(9) << psnr << " dB"
+        << std::setw(10) << megapixels / (singleThreadTime / 1000.0) << " MP/s"
+        << std::setw(10) << megapixels / (multiThreadTime / 1000.0) << " MP/s" << std::endl;
+
+    totals.psnr += psnr;
+    totals.pixelCount += megapixels;
+    totals.singleThreadTime += singleThreadTime;
+    totals.multiThreadTime += multiThreadTime;
+    ++totals.imageCount;
+}
+
+int main(int argc, char* argv[])
+{
+    std::filesystem::path directory = argc > 1 ? argv[1] : EXERCISES_DIRECTORY;
+
+    std::vector<std::filesystem::path> paths;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (entry.is_regular_file() && (entry.path().extension() == ".png" || entry.path().extension() == ".jpg"))
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::left << std::setw(36) << "Texture" << std::setw(5) << "Fmt" << std::setw(13) << "  Size"
+        << std::right << std::setw(12) << "PSNR" << std::setw(15) << "1 thread" << std::setw(15) << "All threads" << std::endl;
+
+    Totals totals[4];
+    const TextureObject::InternalFormat formats[4] = { TextureObject::InternalFormatRGBBC1, TextureObject::InternalFormatRGBABC3,
+        TextureObject::InternalFormatRBC4, TextureObject::InternalFormatRGBC5 };
+
+    for (const std::filesystem::path& path : paths)
+    {
+        int width, height;
+        Data::Type dataType;
+        std::span<const std::byte> data = TextureLoaderUtils::LoadTexture2DData(path.string().c_str(), width, height, dataType,
+            TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA8, false);
+        if (data.empty())
+        {
+            std::cout << "ERROR::BENCHMARK::TEXTURE_NOT_LOADED " << path << std::endl;
+            continue;
+        }
+
+        // Pick the formats like the importer would: normal maps in BC5, single channel maps in BC4, the rest in BC1 and BC3
+        std::string name = path.stem().string();
+        std::vector<int> formatIndices;
+        if (name.find("_nrm") != std::string::npos)
+        {
+            formatIndices = { 3 };
+        }
+        else if (name.find("_rgh") != std::string::npos || name.find("_mtl") != std::string::npos || name.find("_mask") != std::string::npos)
+        {
+            formatIndices = { 2 };
+        }
+        else
+        {
+            formatIndices = { 0, 1 };
+        }
+
+        for (int formatIndex : formatIndices)
+        {
+            // Keep only the channels of the format
+            int componentCount = formatIndex == 0 ? 3 : formatIndex == 1 ? 4 : formatIndex == 2 ? 1 : 2;
+            std::vector<std::byte> channels(static_cast<size_t>(width) * height * componentCount);
+            for (size_t i = 0, count = static_cast<size_t>(width) * height; i < count; ++i)
+            {
+                for (int c = 0; c < componentCount; ++c)
+                {
+                    channels[i * componentCount + c] = data[i * 4 + c];
+                }
+            }
+            BenchmarkImage(name, formats[formatIndex], channels, width, height, componentCount, totals[formatIndex]);
+        }
+
+        TextureLoaderUtils::FreeTexture2DData(data);
+    }
+
+    std::cout << std::endl << "Average PSNR and throughput per format" << std::endl;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (totals[i].imageCount > 0)
+        {
+            std::cout << std::left << std::setw(5) << GetFormatName(formats[i]) << std::right << std::fixed << std::setprecision(2)
+                << std::setw(9) << totals[i].psnr / totals[i].imageCount << " dB"
+                << std::setw(10) << totals[i].pixelCount / (totals[i].singleThreadTime / 1000.0) << " MP/s"
+                << std::setw(10) << totals[i].pixelCount / (totals[i].multiThreadTime / 1000.0) << " MP/s" << std::endl;
+        }
+    }
+
+    return 0;
+}
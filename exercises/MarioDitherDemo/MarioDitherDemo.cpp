@@ -2,8 +2,11 @@
 
 #include <ituGL/asset/TextureCubemapLoader.h>
 #include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/asset/ShaderProgramCache.h>
 #include <ituGL/asset/ModelLoader.h>
 
+#include <ituGL/core/AllocationTracker.h>
+
 #include <ituGL/camera/Camera.h>
 #include <ituGL/scene/SceneCamera.h>
 
@@ -19,20 +22,40 @@
 
 #include <ituGL/renderer/SkyboxRenderPass.h>
 #include <ituGL/renderer/ForwardRenderPass.h>
+#include <ituGL/renderer/OcclusionCuller.h>
+#include <ituGL/renderer/PostFXStack.h>
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/FramebufferObject.h>
 #include "MarioDitherRenderPass.h"
-#include <ituGL/scene/RendererSceneVisitor.h>
 
 #include <ituGL/scene/ImGuiSceneVisitor.h>
 #include <imgui.h>
 #include <GLFW/glfw3.h>
 
+#include <array>
 #include <map>
 #include <string>
+#include <iostream>
+
+// Frames until the caches, pools and containers reach their steady size
+static constexpr unsigned int WarmUpFrameCount = 300;
 
 MarioDitherDemo::MarioDitherDemo()
     : Application(1024, 1024, "Mario Dithering Demo")
     , m_renderer(GetDevice())
+    , m_rendererSceneVisitor(m_renderer, true)
+    , m_shaderProgramCache("shader_cache")
+    , m_defaultShaderVariants(m_shaderProgramCache,
+        { { Shader::FragmentShader, { "shaders/version330.glsl", "shaders/default_pbr.frag" } } },
+        { "NORMAL_MAP", Renderer::LightDirectionalKeyword, Renderer::LightPointKeyword, Renderer::LightSpotKeyword, Renderer::LightIndirectKeyword, Renderer::LodFadeKeyword })
+    , m_flagDitherShaderVariants(m_shaderProgramCache,
+        { { Shader::FragmentShader, { "shaders/version330.glsl", "shaders/dithered_pbr.frag" } } },
+        { "NORMAL_MAP", Renderer::LightDirectionalKeyword, Renderer::LightPointKeyword, Renderer::LightSpotKeyword, Renderer::LightIndirectKeyword, Renderer::LodFadeKeyword })
 {
+#ifdef SPIRV_DIRECTORY
+    // Skip the GLSL compilation with the SPIR-V modules built with the project, if the driver supports them
+    m_shaderProgramCache.SetSpirvDirectory(SPIRV_DIRECTORY);
+#endif
 }
 
 void MarioDitherDemo::Initialize()
@@ -47,42 +70,113 @@ void MarioDitherDemo::Initialize()
 
     InitializeCamera();
     InitializeLights();
+    InitializeShaderPrograms();
+    // The uniforms can't be queried until the programs are linked
+    m_shaderProgramCache.Wait();
     InitializeDefaultMaterial();
     InitializeFlagDitherMaterial();
     InitializeMarioDitherMaterial();
     InitializeMarioPbrMaterial();
     InitializeModels();
+    InitializeFramebuffers();
     InitializeRenderer();
+
+    // Update the next frame in a worker thread while this one renders, simulating at a fixed rate
+    SetFixedTimeStep(1.0f / 60.0f);
+    SetPipelined(true);
+    m_renderer.SetPipelined(true);
 }
 
-void MarioDitherDemo::Update()
+void MarioDitherDemo::ProcessInput()
 {
-    Application::Update();
+    Application::ProcessInput();
+
+    // Count the allocations of the last frame, in all the threads
+    AllocationTracker::NextFrame();
+    if (++m_frameIndex > WarmUpFrameCount && AllocationTracker::GetFrameAllocationCount() > 0)
+    {
+        if (m_allocatingFrameCount++ == 0)
+        {
+            std::cout << "WARNING::ALLOCATIONS::STEADY_STATE_FRAME " << AllocationTracker::GetFrameAllocationCount() << " allocations, "
+                << AllocationTracker::GetFrameAllocatedBytes() << " bytes" << std::endl;
+        }
+    }
 
-    // Update camera controller
+    // Update camera controller. It reads the input, so it can't run in the worker
     m_cameraController.Update(GetMainWindow(), GetDeltaTime());
 
+    // The widgets modify the scene, so they are built here and drawn after the scene
+    UpdateGUI();
+}
+
+void MarioDitherDemo::Update()
+{
+    Application::Update();
+
     // Update camera to flag distance
-    glm::vec3 camPos = m_scene.GetSceneNode("camera")->GetTransform()->GetTranslation();
-    glm::vec3 flagPos = m_scene.GetSceneNode("Flag")->GetTransform()->GetTranslation();
+    glm::vec3 camPos = m_scene.GetSceneNode(m_cameraNode)->GetTransform()->GetTranslation();
+    glm::vec3 flagPos = m_scene.GetSceneNode(m_flagNode)->GetTransform()->GetTranslation();
     m_cameraFlagDistance = glm::distance(camPos, flagPos);
+}
 
-    // Add the scene nodes to the renderer
-    RendererSceneVisitor rendererSceneVisitor(m_renderer);
-    m_scene.AcceptVisitor(rendererSceneVisitor);
+void MarioDitherDemo::ExtractFrame()
+{
+    Application::ExtractFrame();
+
+    // Update the proxies of the scene nodes that changed, and record all of them
+    m_scene.AcceptVisitor(m_rendererSceneVisitor);
+    m_renderer.AddProxies();
+
+    // Cull the occluded drawcalls here, in the worker if pipelined
+    m_renderer.EndRecording();
+}
+
+void MarioDitherDemo::Synchronize()
+{
+    Application::Synchronize();
+
+    m_renderCameraFlagDistance = m_cameraFlagDistance;
+    m_renderer.SwapFrames();
 }
 
 void MarioDitherDemo::Render()
 {
     Application::Render();
 
+    // Adapt the resolution with the time of the frames already finished in the GPU
+    m_gpuTimer.Begin();
+    if (m_gpuTimer.HasNewTime())
+    {
+        m_dynamicResolution.Update(m_gpuTimer.GetTime());
+    }
+
+    // The scene passes draw to part of the scene framebuffer, and the post-processing stretches it to the window
+    int width, height;
+    GetMainWindow().GetDimensions(width, height);
+    int sceneWidth, sceneHeight;
+    m_dynamicResolution.GetScaledSize(width, height, sceneWidth, sceneHeight);
+    m_postFXStack->SetSourceScale(glm::vec2(static_cast<float>(sceneWidth) / width, static_cast<float>(sceneHeight) / height));
+
+    m_renderer.SetCurrentFramebuffer(m_sceneFramebuffer);
+    GetDevice().SetViewport(0, 0, sceneWidth, sceneHeight);
     GetDevice().Clear(true, Color(0.0f, 0.0f, 0.0f, 1.0f), true, 1.0f, true, 0.0f);
 
+    // Finish the programs built in the background since the last frame, without waiting for the rest
+    m_shaderProgramCache.Poll();
+
     // Render the scene
     m_renderer.Render();
 
+    m_gpuTimer.End();
+
+    // Capture the frame after the post-processing, without the user interface
+    m_frameCapture.Capture(*FramebufferObject::GetDefault(), 0, 0, width, height);
+
+    // The user interface is drawn at full resolution
+    GetDevice().SetViewport(0, 0, width, height);
+
     // Render the debug user interface
-    RenderGUI();
+    m_imGui.DrawFrame();
 }
 
 void MarioDitherDemo::Cleanup()
@@ -104,7 +198,7 @@ void MarioDitherDemo::InitializeCamera()
     std::shared_ptr<SceneCamera> sceneCamera = std::make_shared<SceneCamera>("camera", camera);
 
     // Add the camera node to the scene
-    m_scene.AddSceneNode(sceneCamera);
+    m_cameraNode = m_scene.AddSceneNode(sceneCamera);
 
     // Set the camera scene node to be controlled by the camera controller
     m_cameraController.SetCamera(sceneCamera);
@@ -119,90 +213,111 @@ void MarioDitherDemo::InitializeLights()
     m_scene.AddSceneNode(std::make_shared<SceneLight>("directional light", directionalLight));
 }
 
-void MarioDitherDemo::InitializeDefaultMaterial()
+void MarioDitherDemo::InitializeShaderPrograms()
 {
-    // Load and build shader
-    std::vector<const char*> vertexShaderPaths;
-    vertexShaderPaths.push_back("shaders/version330.glsl");
-    vertexShaderPaths.push_back("shaders/default.vert");
-    Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-    std::vector<const char*> fragmentShaderPaths;
-    fragmentShaderPaths.push_back("shaders/version330.glsl");
-    fragmentShaderPaths.push_back("shaders/utils.glsl");
-    fragmentShaderPaths.push_back("shaders/lambert-ggx.glsl");
-    fragmentShaderPaths.push_back("shaders/lighting.glsl");
-    fragmentShaderPaths.push_back("shaders/default_pbr.frag");
-    Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-    std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-    shaderProgramPtr->Build(vertexShader, fragmentShader);
-
-    // Get transform related uniform locations
-    ShaderProgram::Location cameraPositionLocation = shaderProgramPtr->GetUniformLocation("CameraPosition");
-    ShaderProgram::Location worldMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldMatrix");
-    ShaderProgram::Location viewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("ViewProjMatrix");
+    // Submit all the programs before using any of them, so the driver can compile them in parallel
+
+    // All the materials share the default vertex stage. It is built once as a separable program,
+    // and combined in a pipeline with the fragment stage of each program, instead of being linked again in each one
+    std::vector<const char*> defaultVertexShaderPaths;
+    defaultVertexShaderPaths.push_back("shaders/version330.glsl");
+    defaultVertexShaderPaths.push_back("shaders/default.vert");
+    // The models are loaded with compact vertices (see PrepareLoaderAttributes)
+    std::array<const char*, 1> defaultVertexDefines = { ModelLoader::CompactVerticesDefine };
+    m_defaultVertexStage = m_shaderProgramCache.BuildStage(Shader::VertexShader, defaultVertexShaderPaths, defaultVertexDefines);
+    m_defaultShaderVariants.SetVertexStage(m_defaultVertexStage);
+    m_flagDitherShaderVariants.SetVertexStage(m_defaultVertexStage);
+
+    // PBR shaders, with normal mapping. Start with the variant for the first directional light, the most common in the scene
+    // Variants for other lights are built in the background when the renderer needs them, and registered like the first one
+    ShaderProgramVariants::KeywordMask defaultKeywords = m_defaultShaderVariants.GetKeywordMask("NORMAL_MAP")
+        | m_defaultShaderVariants.GetKeywordMask(Renderer::LightDirectionalKeyword) | m_defaultShaderVariants.GetKeywordMask(Renderer::LightIndirectKeyword);
+    m_defaultShaderProgram = m_defaultShaderVariants.GetVariantAsync(defaultKeywords);
+    m_defaultShaderVariants.SetVariantBuiltFunction([this](std::shared_ptr<ShaderProgram> shaderProgramPtr) { RegisterDefaultShaderProgram(shaderProgramPtr); });
+    // Variant without light keywords, used by the renderer for any light while the specific one is built in the background
+    m_defaultShaderVariants.FindVariant(m_defaultShaderVariants.GetKeywordMask("NORMAL_MAP"));
+
+    // Dithered PBR shader, for the flag
+    ShaderProgramVariants::KeywordMask flagDitherKeywords = m_flagDitherShaderVariants.GetKeywordMask("NORMAL_MAP")
+        | m_flagDitherShaderVariants.GetKeywordMask(Renderer::LightDirectionalKeyword) | m_flagDitherShaderVariants.GetKeywordMask(Renderer::LightIndirectKeyword);
+    m_flagDitherShaderProgram = m_flagDitherShaderVariants.GetVariantAsync(flagDitherKeywords);
+    m_flagDitherShaderVariants.SetVariantBuiltFunction([this](std::shared_ptr<ShaderProgram> shaderProgramPtr) { RegisterFlagDitherShaderProgram(shaderProgramPtr); });
+    m_flagDitherShaderVariants.FindVariant(m_flagDitherShaderVariants.GetKeywordMask("NORMAL_MAP"));
+
+    // Dithered shader, for Mario behind the flag, with the shared vertex stage too
+    std::vector<const char*> marioDitherFragmentShaderPaths;
+    marioDitherFragmentShaderPaths.push_back("shaders/version330.glsl");
+    marioDitherFragmentShaderPaths.push_back("shaders/mario_dithered.frag");
+    m_marioDitherShaderProgram = m_shaderProgramCache.BuildStage(Shader::FragmentShader, marioDitherFragmentShaderPaths);
+
+    m_marioDitherPipeline = m_shaderProgramCache.GetPipeline(m_defaultVertexStage, m_marioDitherShaderProgram);
+}
+
+void MarioDitherDemo::RegisterDefaultShaderProgram(std::shared_ptr<ShaderProgram> shaderProgramPtr)
+{
+    std::shared_ptr<const ShaderProgram> vertexStagePtr = m_defaultVertexStage;
+
+    // Get transform related uniform locations. The matrices are in the shared vertex stage
+    ShaderProgram::Location cameraPositionLocation = shaderProgramPtr->GetUniformLocation("CameraPosition"_u);
+    ShaderProgram::Location worldMatrixLocation = vertexStagePtr->GetUniformLocation("WorldMatrix"_u);
+    ShaderProgram::Location viewProjMatrixLocation = vertexStagePtr->GetUniformLocation("ViewProjMatrix"_u);
 
     // Register shader with renderer
     m_renderer.RegisterShaderProgram(shaderProgramPtr,
         [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
         {
+            // The camera only changes at the start of a pass, where it is set in the shared stage by the first pipeline drawn
             if (cameraChanged)
             {
                 shaderProgram.SetUniform(cameraPositionLocation, camera.ExtractTranslation());
-                shaderProgram.SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
+                if (m_renderer.NeedsSharedStageCamera(*vertexStagePtr))
+                {
+                    vertexStagePtr->SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
+                }
             }
-            shaderProgram.SetUniform(worldMatrixLocation, worldMatrix);
+            vertexStagePtr->SetUniform(worldMatrixLocation, worldMatrix);
         },
         m_renderer.GetDefaultUpdateLightsFunction(*shaderProgramPtr)
     );
+}
+
+void MarioDitherDemo::InitializeDefaultMaterial()
+{
+    std::shared_ptr<ShaderProgram> shaderProgramPtr = m_defaultShaderProgram;
+
+    // Register shader and its variants with renderer
+    RegisterDefaultShaderProgram(shaderProgramPtr);
+    m_renderer.RegisterShaderVariants(shaderProgramPtr, m_defaultShaderVariants);
 
     // Filter out uniforms that are not material properties
     ShaderUniformCollection::NameSet filteredUniforms;
     filteredUniforms.insert("CameraPosition");
     filteredUniforms.insert("WorldMatrix");
     filteredUniforms.insert("ViewProjMatrix");
-    filteredUniforms.insert("LightIndirect");
-    filteredUniforms.insert("LightColor");
-    filteredUniforms.insert("LightPosition");
-    filteredUniforms.insert("LightDirection");
-    filteredUniforms.insert("LightAttenuation");
+    filteredUniforms.insert("LodFade");
 
     // Create reference material
     assert(shaderProgramPtr);
     m_defaultMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+    ShaderProgramVariants::KeywordMask keywordMask = 0;
+    m_defaultShaderVariants.GetVariantMask(*shaderProgramPtr, keywordMask);
+    m_defaultMaterial->SetProgramPipeline(m_defaultShaderVariants.GetPipeline(keywordMask));
     m_defaultMaterial->SetStencilTestFunction(Material::TestFunction::Always, 1, 0xFF);
 }
 
-void MarioDitherDemo::InitializeFlagDitherMaterial() {
-    // Load and build shader
-    std::vector<const char*> vertexShaderPaths;
-    vertexShaderPaths.push_back("shaders/version330.glsl");
-    vertexShaderPaths.push_back("shaders/default.vert");
-    Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-    std::vector<const char*> fragmentShaderPaths;
-    fragmentShaderPaths.push_back("shaders/version330.glsl");
-    fragmentShaderPaths.push_back("shaders/utils.glsl");
-    fragmentShaderPaths.push_back("shaders/map.glsl");
-    fragmentShaderPaths.push_back("shaders/lambert-ggx.glsl");
-    fragmentShaderPaths.push_back("shaders/lighting.glsl");
-    fragmentShaderPaths.push_back("shaders/bayer_matrix.glsl");
-    fragmentShaderPaths.push_back("shaders/dithered_pbr.frag");
-    Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-    std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-    shaderProgramPtr->Build(vertexShader, fragmentShader);
-
-    // Get transform related uniform locations
-    ShaderProgram::Location cameraPositionLocation = shaderProgramPtr->GetUniformLocation("CameraPosition");
-    ShaderProgram::Location worldMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldMatrix");
-    ShaderProgram::Location viewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("ViewProjMatrix");
+void MarioDitherDemo::RegisterFlagDitherShaderProgram(std::shared_ptr<ShaderProgram> shaderProgramPtr)
+{
+    std::shared_ptr<const ShaderProgram> vertexStagePtr = m_defaultVertexStage;
+
+    // Get transform related uniform locations. The matrices are in the shared vertex stage
+    ShaderProgram::Location cameraPositionLocation = shaderProgramPtr->GetUniformLocation("CameraPosition"_u);
+    ShaderProgram::Location worldMatrixLocation = vertexStagePtr->GetUniformLocation("WorldMatrix"_u);
+    ShaderProgram::Location viewProjMatrixLocation = vertexStagePtr->GetUniformLocation("ViewProjMatrix"_u);
 
     // Get dither related uniform locations
-    ShaderProgram::Location ditherThresholdLocation = shaderProgramPtr->GetUniformLocation("DitherThreshold");
-    ShaderProgram::Location ditherScaleLocation = shaderProgramPtr->GetUniformLocation("DitherScale");
-    ShaderProgram::Location camDistanceLocation = shaderProgramPtr->GetUniformLocation("CameraObjectDistance");
+    ShaderProgram::Location ditherThresholdLocation = shaderProgramPtr->GetUniformLocation("DitherThreshold"_u);
+    ShaderProgram::Location ditherScaleLocation = shaderProgramPtr->GetUniformLocation("DitherScale"_u);
+    ShaderProgram::Location camDistanceLocation = shaderProgramPtr->GetUniformLocation("CameraObjectDistance"_u);
 
     // Register shader with renderer
     m_renderer.RegisterShaderProgram(shaderProgramPtr,
@@ -211,83 +326,82 @@ void MarioDitherDemo::InitializeFlagDitherMaterial() {
             if (cameraChanged)
             {
                 shaderProgram.SetUniform(cameraPositionLocation, camera.ExtractTranslation());
-                shaderProgram.SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
+                if (m_renderer.NeedsSharedStageCamera(*vertexStagePtr))
+                {
+                    vertexStagePtr->SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
+                }
             }
-            shaderProgram.SetUniform(worldMatrixLocation, worldMatrix);
+            vertexStagePtr->SetUniform(worldMatrixLocation, worldMatrix);
 
             shaderProgram.SetUniform(ditherThresholdLocation, m_ditherThreshold);
             shaderProgram.SetUniform(ditherScaleLocation, m_ditherScale);
-            shaderProgram.SetUniform(camDistanceLocation, m_cameraFlagDistance);
+            shaderProgram.SetUniform(camDistanceLocation, m_renderCameraFlagDistance);
         },
         m_renderer.GetDefaultUpdateLightsFunction(*shaderProgramPtr)
     );
+}
+
+void MarioDitherDemo::InitializeFlagDitherMaterial() {
+    std::shared_ptr<ShaderProgram> shaderProgramPtr = m_flagDitherShaderProgram;
+
+    // Register shader and its variants with renderer
+    RegisterFlagDitherShaderProgram(shaderProgramPtr);
+    m_renderer.RegisterShaderVariants(shaderProgramPtr, m_flagDitherShaderVariants);
 
     // Filter out uniforms that are not material properties
     ShaderUniformCollection::NameSet filteredUniforms;
     filteredUniforms.insert("CameraPosition");
     filteredUniforms.insert("WorldMatrix");
     filteredUniforms.insert("ViewProjMatrix");
-    filteredUniforms.insert("LightIndirect");
-    filteredUniforms.insert("LightColor");
-    filteredUniforms.insert("LightPosition");
-    filteredUniforms.insert("LightDirection");
-    filteredUniforms.insert("LightAttenuation");
     filteredUniforms.insert("DitherThreshold");
     filteredUniforms.insert("DitherScale");
     filteredUniforms.insert("CameraObjectDistance");
+    filteredUniforms.insert("LodFade");
 
     // Create reference material
     assert(shaderProgramPtr);
     m_flagDitherMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+    ShaderProgramVariants::KeywordMask keywordMask = 0;
+    m_flagDitherShaderVariants.GetVariantMask(*shaderProgramPtr, keywordMask);
+    m_flagDitherMaterial->SetProgramPipeline(m_flagDitherShaderVariants.GetPipeline(keywordMask));
 
     // Set Depth and Stencil functions
     m_flagDitherMaterial->SetStencilTestFunction(Material::TestFunction::Always, 1, 0xFF);
     m_flagDitherMaterial->SetStencilOperations(Material::StencilOperation::Keep, Material::StencilOperation::Keep, Material::StencilOperation::Replace);
+
+    // The dithering discards fragments, so the flag writes its own depth
+    m_flagDitherMaterial->SetDepthPrepass(false);
 }
 
 void MarioDitherDemo::InitializeMarioDitherMaterial()
 {
-    // Load and build shader
-    std::vector<const char*> vertexShaderPaths;
-    vertexShaderPaths.push_back("shaders/version330.glsl");
-    vertexShaderPaths.push_back("shaders/default.vert");
-    Shader vertexShader = ShaderLoader(Shader::VertexShader).Load(vertexShaderPaths);
-
-    std::vector<const char*> fragmentShaderPaths;
-    fragmentShaderPaths.push_back("shaders/version330.glsl");
-    fragmentShaderPaths.push_back("shaders/map.glsl");
-    fragmentShaderPaths.push_back("shaders/bayer_matrix.glsl");
-    fragmentShaderPaths.push_back("shaders/mario_dithered.frag");
-    Shader fragmentShader = ShaderLoader(Shader::FragmentShader).Load(fragmentShaderPaths);
-
-    std::shared_ptr<ShaderProgram> shaderProgramPtr = std::make_shared<ShaderProgram>();
-    shaderProgramPtr->Build(vertexShader, fragmentShader);
-
-    // Get transform related uniform locations
-    ShaderProgram::Location cameraPositionLocation = shaderProgramPtr->GetUniformLocation("CameraPosition");
-    ShaderProgram::Location worldMatrixLocation = shaderProgramPtr->GetUniformLocation("WorldMatrix");
-    ShaderProgram::Location viewProjMatrixLocation = shaderProgramPtr->GetUniformLocation("ViewProjMatrix");
+    std::shared_ptr<ShaderProgram> shaderProgramPtr = m_marioDitherShaderProgram;
+    std::shared_ptr<const ShaderProgram> vertexStagePtr = m_defaultVertexStage;
+
+    // Get transform related uniform locations, from the vertex stage
+    ShaderProgram::Location worldMatrixLocation = vertexStagePtr->GetUniformLocation("WorldMatrix"_u);
+    ShaderProgram::Location viewProjMatrixLocation = vertexStagePtr->GetUniformLocation("ViewProjMatrix"_u);
 
     // Get dither related uniform locations
-    ShaderProgram::Location ditherThresholdLocation = shaderProgramPtr->GetUniformLocation("DitherThreshold");
-    ShaderProgram::Location ditherScaleLocation = shaderProgramPtr->GetUniformLocation("DitherScale");
-    ShaderProgram::Location camDistanceLocation = shaderProgramPtr->GetUniformLocation("CameraObjectDistance");
-    ShaderProgram::Location marioDitherLocation = shaderProgramPtr->GetUniformLocation("MarioDitherAmount");
+    ShaderProgram::Location ditherThresholdLocation = shaderProgramPtr->GetUniformLocation("DitherThreshold"_u);
+    ShaderProgram::Location ditherScaleLocation = shaderProgramPtr->GetUniformLocation("DitherScale"_u);
+    ShaderProgram::Location camDistanceLocation = shaderProgramPtr->GetUniformLocation("CameraObjectDistance"_u);
+    ShaderProgram::Location marioDitherLocation = shaderProgramPtr->GetUniformLocation("MarioDitherAmount"_u);
 
     // Register shader with renderer
     m_renderer.RegisterShaderProgram(shaderProgramPtr,
         [=](const ShaderProgram& shaderProgram, const glm::mat4& worldMatrix, const Camera& camera, bool cameraChanged)
         {
-            if (cameraChanged)
+            // The vertex stage is shared with other pipelines, but they all draw with the camera of the pass
+            if (cameraChanged && m_renderer.NeedsSharedStageCamera(*vertexStagePtr))
             {
-                shaderProgram.SetUniform(cameraPositionLocation, camera.ExtractTranslation());
-                shaderProgram.SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
+                vertexStagePtr->SetUniform(viewProjMatrixLocation, camera.GetViewProjectionMatrix());
             }
-            shaderProgram.SetUniform(worldMatrixLocation, worldMatrix);
+            vertexStagePtr->SetUniform(worldMatrixLocation, worldMatrix);
 
             shaderProgram.SetUniform(ditherThresholdLocation, m_ditherThreshold);
             shaderProgram.SetUniform(ditherScaleLocation, m_ditherScale);
-            shaderProgram.SetUniform(camDistanceLocation, m_cameraFlagDistance);
+            shaderProgram.SetUniform(camDistanceLocation, m_renderCameraFlagDistance);
             shaderProgram.SetUniform(marioDitherLocation, m_marioDitherAmount);
         },
         m_renderer.GetDefaultUpdateLightsFunction(*shaderProgramPtr)
@@ -305,6 +419,7 @@ void MarioDitherDemo::InitializeMarioDitherMaterial()
     // Create reference material
     assert(shaderProgramPtr);
     m_marioDitherMaterial = std::make_shared<Material>(shaderProgramPtr, filteredUniforms);
+    m_marioDitherMaterial->SetProgramPipeline(m_marioDitherPipeline);
 
     // Set Depth and Stencil Functions
     m_marioDitherMaterial->SetDepthTestFunction(Material::TestFunction::NotEqual);
@@ -323,8 +438,27 @@ void MarioDitherDemo::PrepareLoaderAttributes(ModelLoader* loader)
     // Create a new material copy for each submaterial
     loader->SetCreateMaterials(true);
 
+    // Use compact vertex attributes. Positions are not quantized to avoid cracks between submeshes
+    loader->SetCompactVertices(true);
+
+    // Reorder the triangles for the vertex cache. The submeshes of the demo are opaque, so the order doesn't change the result
+    loader->SetOptimizeMeshes(true);
+
+    // Generate simplified levels of detail, selected by the renderer from their size on screen
+    loader->SetLodCount(3);
+
+    // Store the geometry in the shared buffers, so submeshes with the same vertex format share the VAO
+    loader->SetGeometryArena(m_geometryArena);
+
+    // Keep a separate stream with only the positions, read by the depth pre-pass
+    loader->SetPositionStream(true);
+
     // Flip vertically textures loaded by the model loader
     loader->GetTexture2DLoader().SetFlipVertical(true);
+
+    // Store textures block compressed, to reduce memory and bandwidth. The blocks are encoded in the jobs of the demo
+    loader->GetTexture2DLoader().SetCompress(true);
+    loader->GetTexture2DLoader().SetJobSystem(&m_jobSystem);
           
     // Link vertex properties to attributes
     loader->SetMaterialAttribute(VertexAttribute::Semantic::Position, "VertexPosition");
@@ -349,18 +483,23 @@ void MarioDitherDemo::InitializeModels()
     m_skyboxTexture->GetParameter(TextureObject::ParameterFloat::MaxLod, maxLod);
     TextureCubemapObject::Unbind();
 
-    m_defaultMaterial->SetUniformValue("EnvironmentTexture", m_skyboxTexture);
-    m_defaultMaterial->SetUniformValue("EnvironmentMaxLod", maxLod);
+    m_defaultMaterial->SetUniformValue("EnvironmentTexture"_u, m_skyboxTexture);
+    m_defaultMaterial->SetUniformValue("EnvironmentMaxLod"_u, maxLod);
 
-    m_flagDitherMaterial->SetUniformValue("EnvironmentTexture", m_skyboxTexture);
-    m_flagDitherMaterial->SetUniformValue("EnvironmentMaxLod", maxLod);
+    m_flagDitherMaterial->SetUniformValue("EnvironmentTexture"_u, m_skyboxTexture);
+    m_flagDitherMaterial->SetUniformValue("EnvironmentMaxLod"_u, maxLod);
 
-    m_marioPbrMaterial->SetUniformValue("EnvironmentTexture", m_skyboxTexture);
-    m_marioPbrMaterial->SetUniformValue("EnvironmentMaxLod", maxLod);
+    m_marioPbrMaterial->SetUniformValue("EnvironmentTexture"_u, m_skyboxTexture);
+    m_marioPbrMaterial->SetUniformValue("EnvironmentMaxLod"_u, maxLod);
+
+    // All the models share the same vertex and element buffers
+    m_geometryArena = std::make_shared<GeometryArena>();
 
     // Configure Environment loader
     ModelLoader environmentLoader(m_defaultMaterial);
     PrepareLoaderAttributes(&environmentLoader);
+    // The environment hides most of the scene, keep a simplified copy of it to rasterize in the occlusion culling
+    environmentLoader.SetOccluderReduction(0.1f);
     // Configure Flag loader
     ModelLoader flagLoader(m_flagDitherMaterial);
     PrepareLoaderAttributes(&flagLoader);
@@ -377,8 +516,8 @@ void MarioDitherDemo::InitializeModels()
 
     // Load Flag model
     std::shared_ptr<Model> flagModel = flagLoader.LoadShared("models/flag/flag.obj");
-    m_scene.AddSceneNode(std::make_shared<SceneModel>("Flag", flagModel, std::vector<int>{0}));
-    std::shared_ptr<Transform> flagTransform = m_scene.GetSceneNode("Flag")->GetTransform();
+    m_flagNode = m_scene.AddSceneNode(std::make_shared<SceneModel>("Flag", flagModel, std::vector<int>{0}));
+    std::shared_ptr<Transform> flagTransform = m_scene.GetSceneNode(m_flagNode)->GetTransform();
     flagTransform->SetScale(glm::vec3(.01f));
 
     // Load Mario model
@@ -387,16 +526,106 @@ void MarioDitherDemo::InitializeModels()
     std::shared_ptr<Transform> marioTransform = m_scene.GetSceneNode("Mario")->GetTransform();
     marioTransform->SetTranslation(glm::vec3(.0f, .0f, -2.0f));
     marioTransform->SetScale(glm::vec3(.01f));
+
+    // Shown in the GUI, instead of printing them for each mesh
+    m_optimizeStatistics.emplace_back("Environment", environmentLoader.GetOptimizeStatistics());
+    m_optimizeStatistics.emplace_back("Flag", flagLoader.GetOptimizeStatistics());
+    m_optimizeStatistics.emplace_back("Mario", marioLoader.GetOptimizeStatistics());
+}
+
+void MarioDitherDemo::InitializeFramebuffers()
+{
+    int width, height;
+    GetMainWindow().GetDimensions(width, height);
+
+    // Half float color, so the post-processing gets the range of the lighting before the tone mapping
+    m_sceneColorTexture = std::make_shared<Texture2DObject>();
+    m_sceneColorTexture->Bind();
+    m_sceneColorTexture->SetImage(0, width, height, TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA16F);
+    m_sceneColorTexture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
+    m_sceneColorTexture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+    m_sceneColorTexture->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+    m_sceneColorTexture->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+
+    // The dithered passes use the stencil buffer
+    m_sceneDepthStencilTexture = std::make_shared<Texture2DObject>();
+    m_sceneDepthStencilTexture->Bind();
+    m_sceneDepthStencilTexture->SetImage<std::byte>(0, width, height, TextureObject::FormatDepthStencil, TextureObject::InternalFormatDepth24Stencil8, {}, Data::Type::UInt248);
+    m_sceneDepthStencilTexture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_NEAREST);
+    m_sceneDepthStencilTexture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_NEAREST);
+    Texture2DObject::Unbind();
+
+    m_sceneFramebuffer = std::make_shared<FramebufferObject>();
+    m_sceneFramebuffer->Bind();
+    m_sceneFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::DepthStencil, *m_sceneDepthStencilTexture);
+    m_sceneFramebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color0, *m_sceneColorTexture);
+    FramebufferObject::Unbind();
+}
+
+void MarioDitherDemo::InitializePostFX(std::unique_ptr<PostFXStack>& postFXStack)
+{
+    // Per pixel effects, merged in a single pass
+
+    // Reinhard on the luminance, off by default to keep the look of the scene
+    m_toneMappingEffect = postFXStack->AddPerPixelEffect(
+        "uniform float Exposure;",
+        "color *= Exposure;"
+        "float luminance = dot(color, vec3(0.2126f, 0.7152f, 0.0722f));"
+        "color *= 1.0f / (1.0f + luminance);",
+        [this](ShaderProgram& shaderProgram)
+        {
+            shaderProgram.SetUniform(shaderProgram.GetUniformLocation("Exposure"_u), m_exposure);
+        });
+    postFXStack->SetEffectEnabled(m_toneMappingEffect, false);
+
+    m_colorGradingEffect = postFXStack->AddPerPixelEffect(
+        "uniform float Contrast;"
+        "uniform float Saturation;",
+        "float luminance = dot(color, vec3(0.2126f, 0.7152f, 0.0722f));"
+        "color = mix(vec3(luminance), color, Saturation);"
+        "color = max((color - 0.5f) * Contrast + 0.5f, 0.0f);",
+        [this](ShaderProgram& shaderProgram)
+        {
+            shaderProgram.SetUniform(shaderProgram.GetUniformLocation("Contrast"_u), m_contrast);
+            shaderProgram.SetUniform(shaderProgram.GetUniformLocation("Saturation"_u), m_saturation);
+        });
+
+    // Noise of half a step of the 8 bit output, to break the banding of the gradients
+    m_screenDitherEffect = postFXStack->AddPerPixelEffect(
+        "",
+        "float noise = fract(52.9829189f * fract(dot(gl_FragCoord.xy, vec2(0.06711056f, 0.00583715f))));"
+        "color += (noise - 0.5f) / 255.0f;");
+
+    m_postFXStack = postFXStack.get();
 }
 
 void MarioDitherDemo::InitializeRenderer()
 {
-    m_renderer.AddRenderPass(std::make_unique<ForwardRenderPass>());
+    // The PBR shaders are expensive, draw the depth first so each pixel is shaded once per light
+    // The depth shader comes from the same SPIR-V modules as the vertex stage of the materials, or from GLSL like it
+    std::unique_ptr<ForwardRenderPass> forwardRenderPass = std::make_unique<ForwardRenderPass>(0);
+#ifdef SPIRV_DIRECTORY
+    forwardRenderPass->SetSpirvDirectory(SPIRV_DIRECTORY);
+#endif
+    forwardRenderPass->SetDepthPrepassEnabled(true);
+    m_renderer.AddRenderPass(std::move(forwardRenderPass));
     m_renderer.AddRenderPass(std::make_unique<MarioDitherRenderPass>(1, *m_marioDitherMaterial));
     m_renderer.AddRenderPass(std::make_unique<SkyboxRenderPass>(m_skyboxTexture));
+
+    int width, height;
+    GetMainWindow().GetDimensions(width, height);
+    std::unique_ptr<PostFXStack> postFXStack = std::make_unique<PostFXStack>(m_sceneColorTexture, width, height);
+    InitializePostFX(postFXStack);
+    m_renderer.AddRenderPass(std::move(postFXStack));
+
+    // Only the forward collection is culled. Mario is drawn dithered through the occluders in collection 1
+    m_renderer.SetOcclusionCullingEnabled(0, true);
+
+    // Only the forward pass sets LodFade. The dithered Mario pass draws the selected level of detail alone
+    m_renderer.SetLodFadeEnabled(0, true);
 }
 
-void MarioDitherDemo::RenderGUI()
+void MarioDitherDemo::UpdateGUI()
 {
     m_imGui.BeginFrame();
 
@@ -415,5 +644,162 @@ void MarioDitherDemo::RenderGUI()
         ImGui::SliderFloat("Mario Dither Amount", &m_marioDitherAmount, 0.0f, 1.0f);
     }
 
-    m_imGui.EndFrame();
+    // Draw GUI for level of detail settings
+    if (auto window = m_imGui.UseWindow("Level of Detail"))
+    {
+        float lodThreshold = m_renderer.GetLodThreshold();
+        if (ImGui::SliderFloat("LOD Threshold", &lodThreshold, 0.0f, 0.01f, "%.4f"))
+        {
+            m_renderer.SetLodThreshold(lodThreshold);
+        }
+        float lodFadeRange = m_renderer.GetLodFadeRange();
+        if (ImGui::SliderFloat("LOD Fade Range", &lodFadeRange, 0.0f, 2.0f))
+        {
+            m_renderer.SetLodFadeRange(lodFadeRange);
+        }
+    }
+
+    // Draw GUI for occlusion culling
+    if (auto window = m_imGui.UseWindow("Occlusion Culling"))
+    {
+        bool occlusionCulling = m_renderer.IsOcclusionCullingEnabled(0);
+        if (ImGui::Checkbox("Enabled", &occlusionCulling))
+        {
+            m_renderer.SetOcclusionCullingEnabled(0, occlusionCulling);
+        }
+        if (const OcclusionCuller* occlusionCuller = m_renderer.GetOcclusionCuller())
+        {
+            ImGui::Text("Culled drawcalls: %u", m_renderer.GetOccludedDrawcallCount());
+            ImGui::Text("Outside of the frustum: %u", m_renderer.GetFrustumCulledDrawcallCount());
+            ImGui::Text("Occluder triangles: %u", occlusionCuller->GetTriangleCount());
+            ImGui::Text("Rasterization: %.3f ms", occlusionCuller->GetRasterizationTime());
+        }
+    }
+
+    // Draw GUI for post-processing
+    if (auto window = m_imGui.UseWindow("Post-processing"))
+    {
+        bool toneMapping = m_postFXStack->IsEffectEnabled(m_toneMappingEffect);
+        if (ImGui::Checkbox("Tone Mapping", &toneMapping))
+        {
+            m_postFXStack->SetEffectEnabled(m_toneMappingEffect, toneMapping);
+        }
+        ImGui::SliderFloat("Exposure", &m_exposure, 0.0f, 4.0f);
+        ImGui::SliderFloat("Contrast", &m_contrast, 0.0f, 2.0f);
+        ImGui::SliderFloat("Saturation", &m_saturation, 0.0f, 2.0f);
+        bool screenDither = m_postFXStack->IsEffectEnabled(m_screenDitherEffect);
+        if (ImGui::Checkbox("Screen Dither", &screenDither))
+        {
+            m_postFXStack->SetEffectEnabled(m_screenDitherEffect, screenDither);
+        }
+        ImGui::Text("Passes: %u", m_postFXStack->GetPassCount());
+    }
+
+    // Draw GUI for dynamic resolution
+    if (auto window = m_imGui.UseWindow("Dynamic Resolution"))
+    {
+        bool enabled = m_dynamicResolution.IsEnabled();
+        if (ImGui::Checkbox("Enabled", &enabled))
+        {
+            m_dynamicResolution.SetEnabled(enabled);
+        }
+        float targetTime = m_dynamicResolution.GetTargetTime();
+        if (ImGui::SliderFloat("Budget (ms)", &targetTime, 1.0f, 50.0f))
+        {
+            m_dynamicResolution.SetTargetTime(targetTime);
+        }
+        ImGui::Text("Scale: %.2f", m_dynamicResolution.GetScale());
+        ImGui::Text("GPU time: %.2f ms", m_gpuTimer.GetTime());
+    }
+
+    // Draw GUI for the allocations
+    if (auto window = m_imGui.UseWindow("Memory"))
+    {
+        ImGui::Text("Frame allocations: %zu (%zu bytes)", AllocationTracker::GetFrameAllocationCount(), AllocationTracker::GetFrameAllocatedBytes());
+        ImGui::Text("Allocating frames after warm-up: %u", m_allocatingFrameCount);
+        if (AllocationTracker::IsCallSiteCaptureSupported())
+        {
+            bool captureCallSites = AllocationTracker::IsCallSiteCaptureEnabled();
+            if (ImGui::Checkbox("Capture Call Sites", &captureCallSites))
+            {
+                AllocationTracker::SetCallSiteCaptureEnabled(captureCallSites);
+            }
+            if (ImGui::Button("Print Call Sites"))
+            {
+                AllocationTracker::PrintCallSites(std::cout);
+            }
+        }
+    }
+
+    // Draw GUI for the vertex cache statistics of the loaded models
+    if (auto window = m_imGui.UseWindow("Mesh Optimization"))
+    {
+        for (const auto& [name, statistics] : m_optimizeStatistics)
+        {
+            ImGui::Text("%s (%u triangles)", name.c_str(), statistics.triangleCount);
+            ImGui::Text("  ACMR: %.3f -> %.3f", statistics.acmrBefore, statistics.acmrAfter);
+            ImGui::Text("  ATVR: %.3f -> %.3f", statistics.atvrBefore, statistics.atvrAfter);
+        }
+    }
+
+    // Draw GUI for the shader program cache
+    if (auto window = m_imGui.UseWindow("Shader Cache"))
+    {
+        ImGui::Text("Hits: %u, misses: %u", m_shaderProgramCache.GetHitCount(), m_shaderProgramCache.GetMissCount());
+        ImGui::Text("Pending builds: %u", m_shaderProgramCache.GetPendingCount());
+    }
+
+    // Draw GUI for the frame capture
+    if (auto window = m_imGui.UseWindow("Frame Capture"))
+    {
+        ImGui::Combo("Format", &m_captureFormat, "PNG\0Raw RGBA\0Y4M\0");
+        if (!m_frameCapture.IsCapturing())
+        {
+            if (ImGui::Button("Start"))
+            {
+                m_frameCapture.Start("capture", static_cast<FrameCapture::Format>(m_captureFormat), 60);
+            }
+        }
+        else
+        {
+            if (ImGui::Button("Stop"))
+            {
+                m_frameCapture.Stop();
+            }
+
+            // Keep drawing while capturing, even in render on demand mode
+            RequestRedraw();
+        }
+        ImGui::Text("Captured: %u, written: %u", m_frameCapture.GetCapturedFrameCount(), m_frameCapture.GetWrittenFrameCount());
+        ImGui::Text("Stalls: %u", m_frameCapture.GetStallCount());
+    }
+
+    // Draw GUI for the frame loop
+    if (auto window = m_imGui.UseWindow("Frame Loop"))
+    {
+        bool pipelined = IsPipelined();
+        if (ImGui::Checkbox("Pipelined", &pipelined))
+        {
+            SetPipelined(pipelined);
+            m_renderer.SetPipelined(pipelined);
+        }
+        bool fixedTimeStep = GetFixedTimeStep() > 0.0f;
+        if (ImGui::Checkbox("Fixed Time Step", &fixedTimeStep))
+        {
+            SetFixedTimeStep(fixedTimeStep ? 1.0f / 60.0f : 0.0f);
+        }
+        bool renderOnDemand = IsRenderOnDemand();
+        if (ImGui::Checkbox("Render On Demand", &renderOnDemand))
+        {
+            SetRenderOnDemand(renderOnDemand);
+        }
+        float minRefreshRate = GetMinRefreshRate();
+        if (ImGui::SliderFloat("Min Refresh Rate", &minRefreshRate, 0.0f, 10.0f))
+        {
+            SetMinRefreshRate(minRefreshRate);
+        }
+        ImGui::Text("Frame time: %.2f ms", GetDeltaTime() * 1000.0f);
+    }
+
+    m_imGui.BuildFrame();
 }
\ No newline at end of file
@@ -4,14 +4,25 @@
 
 #include <ituGL/scene/Scene.h>
 #include <ituGL/renderer/Renderer.h>
+#include <ituGL/scene/RendererSceneVisitor.h>
+#include <ituGL/renderer/DynamicResolution.h>
+#include <ituGL/core/GpuTimer.h>
+#include <ituGL/renderer/FrameCapture.h>
 #include <ituGL/camera/CameraController.h>
 #include <ituGL/utils/DearImGui.h>
 #include <ituGL/asset/ModelLoader.h>
+#include <ituGL/asset/ShaderProgramCache.h>
+#include <ituGL/asset/ShaderProgramVariants.h>
+#include <ituGL/core/JobSystem.h>
 
 #include <map>
 
 class TextureCubemapObject;
+class Texture2DObject;
+class FramebufferObject;
 class Material;
+class ProgramPipeline;
+class PostFXStack;
 
 class MarioDitherDemo : public Application
 {
@@ -20,39 +31,98 @@ public:
 
 protected:
     void Initialize() override;
+    void ProcessInput() override;
     void Update() override;
+    void ExtractFrame() override;
+    void Synchronize() override;
     void Render() override;
     void Cleanup() override;
 
 private:
     void InitializeCamera();
     void InitializeLights();
+    void InitializeShaderPrograms();
+    void RegisterDefaultShaderProgram(std::shared_ptr<ShaderProgram> shaderProgramPtr);
+    void RegisterFlagDitherShaderProgram(std::shared_ptr<ShaderProgram> shaderProgramPtr);
     void InitializeDefaultMaterial();
     void InitializeFlagDitherMaterial();
     void InitializeMarioDitherMaterial();
     void InitializeMarioPbrMaterial();
     void PrepareLoaderAttributes(ModelLoader* loader);
     void InitializeModels();
+    void InitializeFramebuffers();
     void InitializeRenderer();
+    void InitializePostFX(std::unique_ptr<PostFXStack>& postFXStack);
 
-    void RenderGUI();
+    void UpdateGUI();
 
 private:
+    // Worker threads for the loading tasks, created with the demo so the main thread is the one with the OpenGL context
+    JobSystem m_jobSystem;
+
     // Helper object for debug GUI
     DearImGui m_imGui;
 
     // Camera controller
     CameraController m_cameraController;
 
-    // Global scene
-    Scene m_scene;
-
     // Renderer
     Renderer m_renderer;
 
+    // Keeps the scene nodes registered as proxies of the renderer, updating the ones that changed
+    RendererSceneVisitor m_rendererSceneVisitor;
+
+    // Global scene. Declared after the renderer, so the nodes remove their proxies before it is destroyed
+    Scene m_scene;
+
+    // Nodes read every frame, resolved once when they are added
+    Scene::Handle m_cameraNode;
+    Scene::Handle m_flagNode;
+
+    // Stores the binaries of the shader programs, to avoid compiling them on every run
+    ShaderProgramCache m_shaderProgramCache;
+
+    // Permutations of the PBR shaders, selected by the renderer for each light type
+    ShaderProgramVariants m_defaultShaderVariants;
+    ShaderProgramVariants m_flagDitherShaderVariants;
+
+    // Shared storage for the geometry of all the models
+    std::shared_ptr<GeometryArena> m_geometryArena;
+
+    // Vertex cache statistics of the meshes reordered by each loader
+    std::vector<std::pair<std::string, ModelLoader::OptimizeStatistics>> m_optimizeStatistics;
+
+    // The scene is drawn to these targets, then read by the post-processing
+    std::shared_ptr<Texture2DObject> m_sceneColorTexture;
+    std::shared_ptr<Texture2DObject> m_sceneDepthStencilTexture;
+    std::shared_ptr<FramebufferObject> m_sceneFramebuffer;
+
+    // Measures the GPU time of the frame, and scales the viewport of the scene to fit it in the budget
+    GpuTimer m_gpuTimer;
+    DynamicResolution m_dynamicResolution;
+
+    // Records the frames to disk, in the format selected in the GUI
+    FrameCapture m_frameCapture;
+    int m_captureFormat = 0;
+
+    // Post-processing effects, owned by the renderer. The first pass also upscales the scene
+    PostFXStack* m_postFXStack = nullptr;
+    int m_toneMappingEffect = -1;
+    int m_colorGradingEffect = -1;
+    int m_screenDitherEffect = -1;
+
     // Skybox texture
     std::shared_ptr<TextureCubemapObject> m_skyboxTexture;
 
+    // Shader programs, built in parallel before the materials are created. The PBR ones are variants of the sets above
+    std::shared_ptr<ShaderProgram> m_defaultShaderProgram;
+    std::shared_ptr<ShaderProgram> m_flagDitherShaderProgram;
+    std::shared_ptr<ShaderProgram> m_marioDitherShaderProgram;
+
+    // Vertex stage shared by all the materials, combined with their fragment stages in pipelines
+    std::shared_ptr<ShaderProgram> m_defaultVertexStage;
+    std::shared_ptr<ProgramPipeline> m_marioDitherPipeline;
+
     // Default material
     std::shared_ptr<Material> m_defaultMaterial;
     std::shared_ptr<Material> m_flagDitherMaterial;
@@ -62,5 +132,15 @@ private:
     float m_ditherThreshold = 3.0f;
     float m_ditherScale = 1.0f;
     float m_cameraFlagDistance = 1.0f;
+    // Copy of the distance for the frame being rendered, while the worker updates the next one
+    float m_renderCameraFlagDistance = 1.0f;
     float m_marioDitherAmount = 0.8f;
+
+    // After the warm-up, frames should not allocate. Frames that do are counted, and reported the first time
+    unsigned int m_frameIndex = 0;
+    unsigned int m_allocatingFrameCount = 0;
+
+    float m_exposure = 1.0f;
+    float m_contrast = 1.0f;
+    float m_saturation = 1.0f;
 };
@@ -74,4 +74,11 @@ bool dither8x8(vec2 position, float ditherThreshold, float ditherScale) {
  }
 
   return ditherThreshold < limit ? false : true;
-}
\ No newline at end of file
+}
+
+// Cross-fade between two levels of detail without blending
+// The finer level discards a fraction lodFade of the pixels, and the coarser one (negative lodFade) draws only those
+bool lodCrossFade(vec2 position, float lodFade) {
+	bool faded = dither8x8(position, abs(lodFade), 1.0);
+	return lodFade < 0.0 ? faded : !faded;
+}
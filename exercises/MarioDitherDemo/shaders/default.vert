@@ -1,8 +1,10 @@
 //Inputs
 layout (location = 0) in vec3 VertexPosition;
 layout (location = 1) in vec3 VertexNormal;
-layout (location = 2) in vec3 VertexTangent;
+layout (location = 2) in vec4 VertexTangent;
+#ifndef COMPACT_VERTICES
 layout (location = 3) in vec3 VertexBitangent;
+#endif
 layout (location = 4) in vec2 VertexTexCoord;
 
 //Outputs
@@ -16,6 +18,9 @@ out vec2 TexCoord;
 uniform mat4 WorldMatrix;
 uniform mat4 ViewProjMatrix;
 
+// Same position as in the depth pre-pass, that is tested for equal depth
+invariant gl_Position;
+
 void main()
 {
 	// vertex position in world space (for lighting computation)
@@ -25,10 +30,17 @@ void main()
 	WorldNormal = (WorldMatrix * vec4(VertexNormal, 0.0)).xyz;
 
 	// tangent in world space (for lighting computation)
-	WorldTangent = (WorldMatrix * vec4(VertexTangent, 0.0)).xyz;
+	WorldTangent = (WorldMatrix * vec4(VertexTangent.xyz, 0.0)).xyz;
+
+#ifdef COMPACT_VERTICES
+	// Compact vertices don't have a bitangent. Reconstruct it from the normal and tangent, with the sign stored in the tangent W
+	vec3 bitangent = cross(VertexNormal, VertexTangent.xyz) * VertexTangent.w;
+#else
+	vec3 bitangent = VertexBitangent;
+#endif
 
 	// bitangent in world space (for lighting computation)
-	WorldBitangent = (WorldMatrix * vec4(VertexBitangent, 0.0)).xyz;
+	WorldBitangent = (WorldMatrix * vec4(bitangent, 0.0)).xyz;
 
 	// texture coordinates
 	TexCoord = VertexTexCoord;
@@ -1,3 +1,7 @@
+#include "lambert-ggx.glsl"
+#include "lighting.glsl"
+#include "bayer_matrix.glsl"
+
 //Inputs
 in vec3 WorldPosition;
 in vec3 WorldNormal;
@@ -16,10 +20,23 @@ uniform sampler2D SpecularTexture;
 
 uniform vec3 CameraPosition;
 
+#if defined(LOD_FADE)
+uniform float LodFade;
+#endif
+
 void main()
 {
+#if defined(LOD_FADE)
+	if (!lodCrossFade(gl_FragCoord.xy, LodFade))
+		discard;
+#endif
+
 	SurfaceData data;
+#if defined(NORMAL_MAP)
 	data.normal = SampleNormalMap(NormalTexture, TexCoord, normalize(WorldNormal), normalize(WorldTangent), normalize(WorldBitangent));
+#else
+	data.normal = normalize(WorldNormal);
+#endif
 	data.albedo = Color * texture(ColorTexture, TexCoord).rgb;
 	vec3 arm = texture(SpecularTexture, TexCoord).rgb;
 	data.ambientOcclusion = arm.x;
@@ -1,3 +1,8 @@
+#include "map.glsl"
+#include "lambert-ggx.glsl"
+#include "lighting.glsl"
+#include "bayer_matrix.glsl"
+
 //Inputs
 in vec3 WorldPosition;
 in vec3 WorldNormal;
@@ -20,8 +25,17 @@ uniform float DitherThreshold;
 uniform float DitherScale;
 uniform float CameraObjectDistance;
 
+#if defined(LOD_FADE)
+uniform float LodFade;
+#endif
+
 void main()
 {
+#if defined(LOD_FADE)
+	if (!lodCrossFade(gl_FragCoord.xy, LodFade))
+		discard;
+#endif
+
 	float clampedDistance = clamp(CameraObjectDistance, 0, DitherThreshold);
 	float mappedDistance01 = map(clampedDistance, 0, DitherThreshold, 0, 1); 
 	bool keep = dither8x8(gl_FragCoord.xy, mappedDistance01, DitherScale);
@@ -29,7 +43,11 @@ void main()
 		discard;
 
 	SurfaceData data;
+#if defined(NORMAL_MAP)
 	data.normal = SampleNormalMap(NormalTexture, TexCoord, normalize(WorldNormal), normalize(WorldTangent), normalize(WorldBitangent));
+#else
+	data.normal = normalize(WorldNormal);
+#endif
 	data.albedo = Color * texture(ColorTexture, TexCoord).rgb;
 	vec3 arm = texture(SpecularTexture, TexCoord).rgb;
 	data.ambientOcclusion = arm.x;
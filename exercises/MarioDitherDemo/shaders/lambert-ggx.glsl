@@ -1,4 +1,6 @@
 
+#include "utils.glsl"
+
 uniform samplerCube EnvironmentTexture;
 uniform float EnvironmentMaxLod;
 
@@ -1,9 +1,24 @@
+#include "utils.glsl"
 
-uniform bool LightIndirect;
-uniform vec3 LightColor;
-uniform vec3 LightPosition;
-uniform vec3 LightDirection;
-uniform vec4 LightAttenuation;
+// The renderer can define a keyword with the type of the light, so only the code of that type is compiled
+// Without them, the type is found at runtime from the attenuation values
+#if defined(LIGHT_DIRECTIONAL) || defined(LIGHT_POINT) || defined(LIGHT_SPOT)
+#define LIGHT_TYPE_KEYWORDS
+#endif
+
+// Written by the renderer once per frame for all the lights, and bound to the light being drawn
+#if defined(GL_SPIRV)
+layout(std140, binding = 0) uniform LightBlock
+#else
+layout(std140) uniform LightBlock
+#endif
+{
+	vec3 LightColor;
+	bool LightIndirect;
+	vec3 LightPosition;
+	vec3 LightDirection;
+	vec4 LightAttenuation;
+};
 
 float ComputeDistanceAttenuation(vec3 position)
 {
@@ -21,20 +36,32 @@ float ComputeAngularAttenuation(vec3 lightDir)
 float ComputeAttenuation(vec3 position, vec3 lightDir)
 {
 	float attenuation = 1.0f;
+#if !defined(LIGHT_DIRECTIONAL)
 	if (LightAttenuation.y > 0)
 	{
 		attenuation *= ComputeDistanceAttenuation(position);
 	}
+#endif
+#if defined(LIGHT_SPOT)
+	attenuation *= ComputeAngularAttenuation(lightDir);
+#elif !defined(LIGHT_TYPE_KEYWORDS)
 	if (LightAttenuation.w > 0)
 	{
 		attenuation *= ComputeAngularAttenuation(lightDir);
 	}
+#endif
 	return attenuation;
 }
 
 vec3 ComputeLightDirection(vec3 position)
 {
+#if defined(LIGHT_DIRECTIONAL)
+	return -LightDirection;
+#elif defined(LIGHT_TYPE_KEYWORDS)
+	return GetDirection(position, LightPosition);
+#else
 	return LightAttenuation.y >= 0 ? GetDirection(position, LightPosition) : -LightDirection;
+#endif
 }
 
 vec3 ComputeLight(SurfaceData data, vec3 viewDir, vec3 position)
@@ -53,12 +80,18 @@ vec3 ComputeLighting(vec3 position, SurfaceData data, vec3 viewDir, bool indirec
 {
 	vec3 light = ComputeLight(data, viewDir, position);
 	
-	if (indirect && LightIndirect)
+	// With the light keywords, the indirect lighting is only compiled in the variant of the first light
+#if defined(LIGHT_INDIRECT) || !defined(LIGHT_TYPE_KEYWORDS)
+#if !defined(LIGHT_INDIRECT)
+	indirect = indirect && LightIndirect;
+#endif
+	if (indirect)
 	{
 		vec3 diffuseIndirect = ComputeDiffuseIndirectLighting(data);
 		vec3 specularIndirect = ComputeSpecularIndirectLighting(data, viewDir);
 		light += CombineIndirectLighting(diffuseIndirect, specularIndirect, data, viewDir);
 	}
+#endif
 
 	return light;
 }
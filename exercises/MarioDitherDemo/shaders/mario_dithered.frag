@@ -1,3 +1,6 @@
+#include "map.glsl"
+#include "bayer_matrix.glsl"
+
 //Outputs
 out vec4 FragColor;
 
@@ -0,0 +1,17 @@
+#version 330 core
+
+//Inputs
+layout (location = 0) in vec3 VertexPosition;
+
+//Uniforms
+uniform mat4 WorldMatrix;
+uniform mat4 ViewProjMatrix;
+
+// The shading pass tests for equal depth, so the position is computed exactly as in the material shaders
+invariant gl_Position;
+
+void main()
+{
+	vec3 worldPosition = (WorldMatrix * vec4(VertexPosition, 1.0)).xyz;
+	gl_Position = ViewProjMatrix * vec4(worldPosition, 1.0);
+}
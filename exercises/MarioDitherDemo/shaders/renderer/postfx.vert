@@ -0,0 +1,14 @@
+#version 330 core
+
+//Inputs
+layout (location = 0) in vec3 VertexPosition;
+
+//Outputs
+out vec2 TexCoord;
+
+void main()
+{
+	// The fullscreen triangle covers the [-1, 1] range, that maps to [0, 1] texture coordinates
+	gl_Position = vec4(VertexPosition.xy, 0.0f, 1.0f);
+	TexCoord = VertexPosition.xy * 0.5f + 0.5f;
+}
@@ -0,0 +1,159 @@
+# ---------------------------------------------------------------------------------
+# Offline compilation of shader file lists into SPIR-V modules, loaded with ShaderLoader::LoadSpirv
+# Each line of the manifest is a shader stage followed by its file list, relative to the manifest, and optionally
+# a colon followed by the keywords defined in that variant, in the order they are declared in ShaderProgramVariants:
+#     frag version330.glsl default_pbr.frag : NORMAL_MAP LIGHT_DIRECTIONAL
+# The files are preprocessed like ShaderLoader::Preprocess does (each include added once), the #version is raised
+# to 450 as required by SPIR-V, and the result is compiled with glslangValidator into <output>/<last file name>[.<keyword>...].spv
+# Variants that are not in the manifest are compiled from the GLSL sources at runtime
+# ---------------------------------------------------------------------------------
+
+if(NOT CMAKE_SCRIPT_MODE_FILE)
+
+set(ITUGL_SPIRV_SCRIPT ${CMAKE_CURRENT_LIST_FILE})
+
+# Off by default: uniforms are found by name, and the names of SPIR-V uniforms are only debug information, that
+# drivers are not required to reflect. Enable it only with drivers that do, or the materials lose their uniforms
+option(ITUGL_SPIRV_SHADERS "Compile the shaders to SPIR-V modules offline, and load them instead of the GLSL sources" OFF)
+
+# Add the modules in the manifest as a dependency of the target, and define SPIRV_DIRECTORY with their directory
+# Without ITUGL_SPIRV_SHADERS or glslangValidator nothing is added, and the target compiles the GLSL sources at runtime
+function(itugl_add_spirv_modules target manifest outputDirectory)
+    if(NOT ITUGL_SPIRV_SHADERS)
+        return()
+    endif()
+
+    find_program(GLSLANG_VALIDATOR glslangValidator)
+    if(NOT GLSLANG_VALIDATOR)
+        message(STATUS "glslangValidator not found, ${target} will compile the GLSL shaders")
+        return()
+    endif()
+
+    get_filename_component(manifestDirectory ${manifest} DIRECTORY)
+    file(STRINGS ${manifest} lines)
+    set(modules "")
+    FOREACH(line ${lines})
+        # Keywords after the colon
+        set(keywords "")
+        string(FIND "${line}" ":" colon)
+        if(NOT colon EQUAL -1)
+            math(EXPR keywordsStart "${colon} + 1")
+            string(SUBSTRING "${line}" ${keywordsStart} -1 keywordsLine)
+            string(SUBSTRING "${line}" 0 ${colon} line)
+            string(STRIP "${keywordsLine}" keywordsLine)
+            if(keywordsLine)
+                string(REGEX REPLACE "[ \t]+" ";" keywords "${keywordsLine}")
+            endif()
+        endif()
+        string(STRIP "${line}" line)
+        string(REGEX REPLACE "[ \t]+" ";" items "${line}")
+        list(LENGTH items itemCount)
+        if(itemCount GREATER 1)
+            list(GET items 0 stage)
+            list(REMOVE_AT items 0)
+
+            set(paths "")
+            set(dependencies ${manifest})
+            FOREACH(item ${items})
+                set(path ${manifestDirectory}/${item})
+                list(APPEND paths ${path})
+                # Included files are not known here, so depend on all the chunks next to each file
+                get_filename_component(pathDirectory ${path} DIRECTORY)
+                file(GLOB chunks ${pathDirectory}/*.glsl)
+                list(APPEND dependencies ${path} ${chunks})
+            ENDFOREACH()
+            list(REMOVE_DUPLICATES dependencies)
+
+            list(GET items -1 lastItem)
+            get_filename_component(moduleName ${lastItem} NAME)
+            FOREACH(keyword ${keywords})
+                set(moduleName ${moduleName}.${keyword})
+            ENDFOREACH()
+            set(module ${outputDirectory}/${moduleName}.spv)
+
+            # Lists can't be passed in a -D argument, use another separator
+            string(REPLACE ";" "|" pathsArgument "${paths}")
+            string(REPLACE ";" "|" keywordsArgument "${keywords}")
+            add_custom_command(OUTPUT ${module}
+                COMMAND ${CMAKE_COMMAND} -DSTAGE=${stage} "-DPATHS=${pathsArgument}" "-DKEYWORDS=${keywordsArgument}" -DOUTPUT=${module}
+                    -DGLSLANG_VALIDATOR=${GLSLANG_VALIDATOR} -P ${ITUGL_SPIRV_SCRIPT}
+                DEPENDS ${dependencies} ${ITUGL_SPIRV_SCRIPT}
+                COMMENT "Compiling SPIR-V module ${moduleName}"
+                VERBATIM)
+            list(APPEND modules ${module})
+        endif()
+    ENDFOREACH()
+
+    add_custom_target(${target}_spirv DEPENDS ${modules} SOURCES ${manifest})
+    add_dependencies(${target} ${target}_spirv)
+    target_compile_definitions(${target} PRIVATE SPIRV_DIRECTORY="${outputDirectory}")
+endfunction()
+
+else()
+
+# Script mode: preprocess the files in PATHS and compile them into OUTPUT, with the KEYWORDS defined
+cmake_minimum_required(VERSION 3.3)
+
+# Append the file to the SPIRV_SOURCE global property, replacing the includes with the included files
+function(spirv_preprocess path)
+    get_filename_component(path ${path} REALPATH)
+    get_property(includedFiles GLOBAL PROPERTY SPIRV_INCLUDED_FILES)
+    list(FIND includedFiles ${path} includedIndex)
+    if(NOT includedIndex EQUAL -1)
+        return()
+    endif()
+    set_property(GLOBAL APPEND PROPERTY SPIRV_INCLUDED_FILES ${path})
+
+    if(NOT EXISTS ${path})
+        message(FATAL_ERROR "ERROR::SHADER::FILE_NOT_FOUND ${path}")
+    endif()
+    get_filename_component(directory ${path} DIRECTORY)
+    file(READ ${path} content)
+
+    # Like ShaderLoader, only directives at the start of a line are includes, so the ones in comments are skipped
+    # The content starts with a new line, so the first line matches too
+    set(includeRegex "\n[ \t]*#include[ \t]*\"[^\"]*\"")
+    set(content "\n${content}")
+    string(REGEX MATCH "${includeRegex}" directive "${content}")
+    while(directive)
+        string(FIND "${content}" "${directive}" directiveStart)
+        string(LENGTH "${directive}" directiveLength)
+        math(EXPR directiveEnd "${directiveStart} + ${directiveLength}")
+        # Keep the new line before the directive
+        math(EXPR beforeLength "${directiveStart} + 1")
+        string(SUBSTRING "${content}" 0 ${beforeLength} before)
+        string(SUBSTRING "${content}" ${directiveEnd} -1 content)
+        set_property(GLOBAL APPEND_STRING PROPERTY SPIRV_SOURCE "${before}")
+
+        string(REGEX REPLACE ".*\"([^\"]*)\"" "\\1" includeName "${directive}")
+        spirv_preprocess(${directory}/${includeName})
+
+        # The rest of the line of the directive starts the content, so the next directive is still after a new line
+        string(REGEX MATCH "${includeRegex}" directive "${content}")
+    endwhile()
+    set_property(GLOBAL APPEND_STRING PROPERTY SPIRV_SOURCE "${content}\n")
+endfunction()
+
+string(REPLACE "|" ";" paths "${PATHS}")
+string(REPLACE "|" ";" keywords "${KEYWORDS}")
+set(defineArguments "")
+FOREACH(keyword ${keywords})
+    list(APPEND defineArguments -D${keyword})
+ENDFOREACH()
+set_property(GLOBAL PROPERTY SPIRV_SOURCE "")
+FOREACH(path ${paths})
+    spirv_preprocess(${path})
+ENDFOREACH()
+get_property(source GLOBAL PROPERTY SPIRV_SOURCE)
+string(REGEX REPLACE "#version[^\n]*" "#version 450 core" source "${source}")
+
+file(WRITE ${OUTPUT}.glsl "${source}")
+execute_process(
+    COMMAND ${GLSLANG_VALIDATOR} -G --auto-map-locations --auto-map-bindings ${defineArguments} -S ${STAGE} -o ${OUTPUT} ${OUTPUT}.glsl
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    file(REMOVE ${OUTPUT})
+    message(FATAL_ERROR "Failed to compile SPIR-V module ${OUTPUT}")
+endif()
+
+endif()
@@ -3,6 +3,11 @@
 #include <ituGL/core/DeviceGL.h>
 #include <ituGL/application/Window.h>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
 
 class Application
 {
@@ -16,6 +21,9 @@ public:
     // Start the application
     int Run();
 
+    // In render on demand mode, draw another frame even if nothing else changed. It can be called from any thread
+    void RequestRedraw();
+
 protected:
     // (C++) 1
     // Get the OpenGL device
@@ -33,6 +41,28 @@ protected:
     // Get time in seconds of the current frame
     inline float GetDeltaTime() const { return m_deltaTime; }
 
+    // Time in seconds simulated by each Update, or 0 to update once per frame with the time of the frame
+    inline float GetFixedTimeStep() const { return m_fixedTimeStep; }
+    inline void SetFixedTimeStep(float fixedTimeStep) { m_fixedTimeStep = fixedTimeStep; }
+
+    // Get time in seconds simulated by the current Update
+    inline float GetUpdateDeltaTime() const { return m_fixedTimeStep > 0.0f ? m_fixedTimeStep : m_deltaTime; }
+
+    // In pipelined mode, Update and ExtractFrame prepare the next frame in a worker thread, while Render draws the current one
+    // The main thread can only modify the data they use in ProcessInput and Synchronize, when the worker is idle
+    inline bool IsPipelined() const { return m_pipelined; }
+    void SetPipelined(bool pipelined);
+
+    // In render on demand mode, the loop waits for events when nothing changed, instead of drawing the same frame again
+    // Frames are drawn after input, changes in the transforms and the materials, and calls to RequestRedraw, like the ones of the animations
+    // Values set in the shader setup functions of the materials are not tracked, request a redraw when they change without input
+    inline bool IsRenderOnDemand() const { return m_renderOnDemand.load(std::memory_order_relaxed); }
+    void SetRenderOnDemand(bool renderOnDemand);
+
+    // Frames per second drawn at least in render on demand mode, or 0 to wait for changes forever
+    inline float GetMinRefreshRate() const { return m_minRefreshRate; }
+    inline void SetMinRefreshRate(float minRefreshRate) { m_minRefreshRate = minRefreshRate; }
+
     // Test if the application is currently running
     bool IsRunning() const;
 
@@ -42,9 +72,18 @@ protected:
     // Load initial resources and initialize data before the main loop
     virtual void Initialize();
 
-    // Update the application logic for the current frame
+    // Handle the input of the current frame, in the main thread before the updates
+    virtual void ProcessInput();
+
+    // Update the application logic, once per frame or once per fixed time step
     virtual void Update();
 
+    // Copy the data needed to render the frame, after the updates
+    virtual void ExtractFrame();
+
+    // Called in the main thread between the extraction of a frame and its rendering, with the worker idle
+    virtual void Synchronize();
+
     // Render the current frame
     virtual void Render();
 
@@ -60,6 +99,17 @@ private:
     // Set the new current time and compute the delta since the last time
     void UpdateTime(float newCurrentTime);
 
+    // Run the updates of the frame and extract it
+    void UpdateFrame();
+
+    // In render on demand mode, wait until something changes. The time waiting is not part of the delta time
+    void WaitForRedraw();
+
+    // Loop of the worker thread in pipelined mode, updating a frame each time it is started
+    void WorkerLoop();
+    void StartWorker();
+    void WaitWorker();
+
 private:
     // OpenGL device
     DeviceGL m_device;
@@ -71,6 +121,28 @@ private:
     // Time in seconds of the current frame
     float m_deltaTime;
 
+    // Fixed time step of the updates, and time still to be simulated with it
+    float m_fixedTimeStep;
+    float m_accumulatedTime;
+
+    // Worker thread of the pipelined mode. Busy while it updates a frame
+    bool m_pipelined;
+    bool m_workerBusy;
+    bool m_workerStopping;
+    std::mutex m_workerMutex;
+    std::condition_variable m_workerCondition;
+    std::thread m_workerThread;
+
+    // Render on demand mode, and what was seen when the last frame started, to detect the changes
+    // The mode is atomic, as RequestRedraw can read it from other threads
+    std::atomic<bool> m_renderOnDemand;
+    float m_minRefreshRate;
+    std::atomic<bool> m_redrawRequested;
+    unsigned int m_pendingRedrawCount;
+    unsigned int m_lastEventCount;
+    std::uint64_t m_lastTransformVersion;
+    std::uint64_t m_lastMaterialVersion;
+
     // Exit code
     int m_exitCode;
     // Error message to display on exit
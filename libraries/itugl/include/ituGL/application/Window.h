@@ -32,6 +32,9 @@ public:
     // Swaps the front and back buffers of the window
     void SwapBuffers();
 
+    // Number of input and window events received, to check if anything happened since a previous frame
+    inline unsigned int GetEventCount() const { return m_eventCount; }
+
 public:
     // Pressed state of a button or key
     enum class PressedState
@@ -78,4 +81,10 @@ public:
 private:
     // Pointer to a GLFW window object. Its lifetime should match the lifetime of this object
     GLFWwindow* m_window;
+
+    // Incremented by the callbacks of the internal window. Callbacks installed later, like the GUI ones, chain to these
+    unsigned int m_eventCount;
+
+private:
+    static void CountEvent(GLFWwindow* window);
 };
@@ -5,7 +5,9 @@
 #include <ituGL/geometry/Model.h>
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/asset/Texture2DLoader.h>
+#include <glm/vec3.hpp>
 #include <vector>
+#include <span>
 
 struct aiMesh;
 struct aiMaterial;
@@ -18,6 +20,16 @@ public:
     // Enum to read material properties from the file
     enum class MaterialProperty;
 
+    // Vertex cache statistics of the triangles reordered by the loader, before and after, averaged weighting them by the triangle count
+    struct OptimizeStatistics
+    {
+        unsigned int triangleCount = 0;
+        float acmrBefore = 0.0f;
+        float acmrAfter = 0.0f;
+        float atvrBefore = 0.0f;
+        float atvrAfter = 0.0f;
+    };
+
 public:
     ModelLoader(std::shared_ptr<Material> referenceMaterial = nullptr);
 
@@ -27,6 +39,47 @@ public:
     bool GetCreateMaterials() const;
     void SetCreateMaterials(bool createMaterials);
 
+    // Compact vertices store normals and tangents packed in 10 bits per component, the bitangent as the sign of the tangent W, and half float UVs
+    bool GetCompactVertices() const;
+    void SetCompactVertices(bool compactVertices);
+
+    // Define for the vertex shaders of compact vertices, that reconstruct the bitangent instead of reading it
+    static constexpr const char* CompactVerticesDefine = "COMPACT_VERTICES";
+
+    // Quantize compact vertex positions to 16 bits, relative to the bounds of each submesh
+    bool GetQuantizePositions() const;
+    void SetQuantizePositions(bool quantizePositions);
+
+    // Reorder triangles and vertices of each submesh for the vertex caches and to reduce overdraw. Disabled by default,
+    // as the triangle order matters for the blended submeshes
+    bool GetOptimizeMeshes() const;
+    void SetOptimizeMeshes(bool optimizeMeshes);
+
+    // Statistics of all the meshes optimized by this loader
+    inline const OptimizeStatistics& GetOptimizeStatistics() const { return m_optimizeStatistics; }
+
+    // Number of simplified levels of detail generated for each triangle submesh, stored in the same buffers
+    unsigned int GetLodCount() const;
+    void SetLodCount(unsigned int lodCount);
+
+    // Ratio of triangles kept from one level of detail to the next
+    float GetLodReduction() const;
+    void SetLodReduction(float lodReduction);
+
+    // Ratio of triangles kept in the occluder of each mesh, a simplified copy in CPU memory used by the occlusion culling
+    // 0 to not generate occluders
+    float GetOccluderReduction() const;
+    void SetOccluderReduction(float occluderReduction);
+
+    // Store a tightly packed copy of the positions and a VAO with only them, used by the depth only passes
+    // Only for interleaved vertex data
+    bool GetPositionStream() const;
+    void SetPositionStream(bool positionStream);
+
+    // Store the geometry of the loaded meshes in a shared arena, instead of creating buffers for each mesh
+    std::shared_ptr<GeometryArena> GetGeometryArena() const;
+    void SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena);
+
     Texture2DLoader& GetTexture2DLoader();
     const Texture2DLoader& GetTexture2DLoader() const;
 
@@ -39,6 +92,16 @@ public:
     // Maps a material property to a uniform in the shader program used by the material
     bool SetMaterialProperty(MaterialProperty materialProperty, const char* uniformName);
 
+private:
+    // Range of elements of a simplified level of detail, for one of the primitive groups
+    struct LodRange
+    {
+        int group;
+        int first;
+        int count;
+        float error;
+    };
+
 private:
     // Generate a submesh from the loaded mesh data
     void GenerateSubmesh(Mesh& mesh, const aiMesh& meshData);
@@ -51,12 +114,39 @@ private:
         TextureObject::Format format, TextureObject::InternalFormat internalFormat) const;
 
     // Build the vertex data from the mesh data
-    static std::vector<GLubyte> CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved);
+    std::vector<GLubyte> CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, glm::mat4& positionTransform) const;
+
+    // Build the vertex format and the vertex data using compact attributes
+    // positionTransform is the matrix that decodes quantized positions, if used
+    std::vector<GLubyte> CollectCompactVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, glm::mat4& positionTransform) const;
 
-    // Build the element data from the mesh data
-    static std::vector<GLubyte> CollectElementData(const aiMesh& meshData, Data::Type& elementType,
+    // Build the element indices from the mesh data. elementCounts is the index where each primitive group ends
+    static std::vector<unsigned int> CollectElementData(const aiMesh& meshData,
         std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts);
 
+    // Pack the element indices using the element type
+    static std::vector<GLubyte> PackElementData(const std::vector<unsigned int>& indices, Data::Type elementType);
+
+    // Simplify each triangle primitive group, appending the indices of each level of detail after the existing ones
+    std::vector<LodRange> GenerateLods(std::vector<unsigned int>& indices, std::span<const glm::vec3> positions,
+        const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts) const;
+
+    // Simplify the triangle primitive groups together, and add them to the mesh as its occluder
+    void GenerateOccluder(Mesh& mesh, std::span<const unsigned int> indices, std::span<const glm::vec3> positions,
+        const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts) const;
+
+    // Reorder the triangles of each primitive group and level of detail, and the vertex data, adding their vertex cache statistics
+    void OptimizeMesh(std::span<const glm::vec3> positions, std::vector<unsigned int>& indices,
+        const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts, const std::vector<LodRange>& lods,
+        std::vector<GLubyte>& vertexData, size_t vertexSize, unsigned int& vertexCount);
+
+    // Copy the position attribute of the interleaved vertex data, keeping its format. positionFormat gets only that attribute
+    static std::vector<GLubyte> CollectPositionData(const VertexFormat& vertexFormat, std::span<const GLubyte> vertexData,
+        unsigned int vertexCount, VertexFormat& positionFormat);
+
+    // Compute a sphere containing the referenced positions. xyz is the center and w the radius
+    static glm::vec4 ComputeBoundingSphere(std::span<const unsigned int> indices, std::span<const glm::vec3> positions);
+
     // Get the correct vertex data pointer for a specific semantic
     static const void* GetVertexDataPointer(const aiMesh& meshData, VertexAttribute::Semantic semantic, int& stride);
 
@@ -82,6 +172,31 @@ private:
     // Should create new materials for each submesh or use the reference material
     bool m_createMaterials;
 
+    // Should store vertex attributes in compact formats
+    bool m_compactVertices;
+
+    // Should quantize positions, when using compact vertices
+    bool m_quantizePositions;
+
+    // Should optimize the triangle and vertex order of each submesh
+    bool m_optimizeMeshes;
+    OptimizeStatistics m_optimizeStatistics;
+
+    // Number of simplified levels of detail to generate
+    unsigned int m_lodCount;
+
+    // Ratio of triangles kept on each level of detail
+    float m_lodReduction;
+
+    // Ratio of triangles kept in the occluders, or 0 to skip them
+    float m_occluderReduction;
+
+    // Should add a separate stream with the positions
+    bool m_positionStream;
+
+    // Shared storage for the geometry, if any
+    std::shared_ptr<GeometryArena> m_geometryArena;
+
     // Texture loader to cache already loaded shared textures
     mutable Texture2DLoader m_textureLoader;
 };
@@ -3,6 +3,7 @@
 #include <ituGL/asset/AssetLoader.h>
 #include <ituGL/shader/Shader.h>
 #include <span>
+#include <string>
 
 class ShaderLoader : AssetLoader<Shader>
 {
@@ -20,10 +21,40 @@ public:
     Shader* LoadNew(std::span<const char*> paths);
     bool LoadInto(Shader& shader, std::span<const char*> paths);
 
+    // Create and compile a shader from source code already loaded
+    Shader LoadSources(std::span<const char*> sources);
+
     static Shader Load(Shader::Type type, const char* path);
 
+    // If async, shaders are compiled without waiting for the result, and errors must be checked with CheckCompilation
+    inline bool IsAsync() const { return m_async; }
+    inline void SetAsync(bool async) { m_async = async; }
+
+    // Directory with the SPIR-V modules compiled offline (see itugl_add_spirv_modules). Empty to always compile the GLSL sources
+    // If set, Load looks for the module of the paths first, and falls back to the sources if it can't be used
+    inline const std::string& GetSpirvDirectory() const { return m_spirvDirectory; }
+    inline void SetSpirvDirectory(const char* spirvDirectory) { m_spirvDirectory = spirvDirectory; }
+
+    // Load the SPIR-V module of the paths, named after the last path and the defines, like "default_pbr.frag.NORMAL_MAP.spv"
+    // Returns false if SPIR-V is not supported or the module was not compiled for these defines. Use the GLSL sources then
+    bool LoadSpirv(Shader& shader, std::span<const char*> paths, std::span<const char* const> defines = {});
+
+    // Check if the shader compiled, printing the errors if it didn't
+    static bool CheckCompilation(const Shader& shader);
+
+    // Read the source files into a single source, resolving the #include "file" directives relative to the including file
+    // Each file is added only once, so chunks included by several files (or also listed in paths) are not repeated
+    // The defines are inserted after the #version directive, as "#define <define>"
+    // #line directives keep the line numbers of each file, with the file index in the order they were added as source string
+    // Files that can't be read are reported as errors, and left out of the source
+    static std::string Preprocess(std::span<const char*> paths, std::span<const char* const> defines = {});
+
 private:
     void Compile(Shader& shader);
 
     Shader::Type m_type;
+
+    bool m_async;
+
+    std::string m_spirvDirectory;
 };
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <ituGL/shader/Shader.h>
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+class ShaderProgram;
+class ProgramPipeline;
+
+// Builds shader programs from their source files, storing the linked binaries in a directory
+// Binaries are identified by a hash of the sources, shader types, defines and driver version,
+// so any change in those will compile the program again
+// Single stages can also be built as separable programs, and combined in program pipelines. Each stage is built once
+// and shared by all its combinations, so N vertex and M fragment stages need N + M builds instead of N x M
+class ShaderProgramCache
+{
+public:
+    // Source files of one shader stage, in the same order as ShaderLoader::Load
+    struct Stage
+    {
+        Shader::Type type;
+        std::span<const char*> paths;
+    };
+
+public:
+    ShaderProgramCache(const char* directory);
+
+    // If disabled, Build always compiles the shaders and doesn't store the binaries
+    inline bool IsEnabled() const { return m_enabled; }
+    inline void SetEnabled(bool enabled) { m_enabled = enabled; }
+
+    // Directory with the SPIR-V modules compiled offline, used when the programs are not in the cache (see ShaderLoader::LoadSpirv)
+    inline void SetSpirvDirectory(const char* spirvDirectory) { m_spirvDirectory = spirvDirectory; }
+
+    // Build the program from the source files of each stage, or load its binary if it is in the cache
+    // Sources are preprocessed with ShaderLoader::Preprocess, that resolves the includes and inserts the defines after #version
+    bool Build(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const char* const> defines = {});
+
+    // Submit the build of the program without waiting for it. Programs found in the cache are linked immediately
+    // Submitting all the programs first lets the driver compile them in parallel (see DeviceGL::IsParallelShaderCompileSupported)
+    void BuildAsync(std::shared_ptr<ShaderProgram> shaderProgram, std::span<const Stage> stages, std::span<const char* const> defines = {});
+
+    // Build a separable program with a single stage, or get it if it was already built with the same sources and defines
+    std::shared_ptr<ShaderProgram> BuildStage(Shader::Type type, std::span<const char*> paths, std::span<const char* const> defines = {});
+
+    // Get the pipeline that combines a vertex and a fragment stage obtained with BuildStage, creating it the first time
+    std::shared_ptr<ProgramPipeline> GetPipeline(std::shared_ptr<const ShaderProgram> vertexStage, std::shared_ptr<const ShaderProgram> fragmentStage);
+
+    // Finish the builds that have completed, reporting their errors and storing their binaries. Doesn't wait for the rest
+    // Returns true if there are no pending builds left
+    bool Poll();
+
+    // Wait for all the pending builds and finish them
+    void Wait();
+
+    // True if the program was submitted with BuildAsync and has not been finished yet
+    bool IsPending(const ShaderProgram& shaderProgram) const;
+
+    // Number of builds submitted with BuildAsync that have not been finished yet
+    inline unsigned int GetPendingCount() const { return static_cast<unsigned int>(m_pendingBuilds.size()); }
+
+    // Number of programs loaded from the cache, and compiled because they were not in the cache
+    inline unsigned int GetHitCount() const { return m_hitCount; }
+    inline unsigned int GetMissCount() const { return m_missCount; }
+
+private:
+    // Program being compiled in the background
+    struct PendingBuild
+    {
+        std::shared_ptr<ShaderProgram> shaderProgram;
+        // Kept to report their errors if the program fails to link
+        std::vector<Shader> shaders;
+        // Empty if the cache is disabled
+        std::string binaryPath;
+    };
+
+private:
+    // Read and preprocess the source files of each stage, adding the defines
+    static std::vector<std::vector<std::string>> ReadSources(std::span<const Stage> stages, std::span<const char* const> defines);
+
+    // Query the driver string and if binaries are supported. Done once, before the first key is computed
+    void InitializeDriver();
+
+    // Try to load the binary from the cache. If it is not there, binaryPath is set to the path where it should be stored
+    bool LoadCached(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+        std::span<const char* const> defines, std::string& binaryPath);
+
+    // Report the errors or store the binary of a build that completed
+    void FinishBuild(const PendingBuild& pendingBuild);
+
+    // Hash of everything that affects the binary
+    uint64_t ComputeKey(std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+        std::span<const char* const> defines, bool separable) const;
+
+    std::string GetBinaryPath(uint64_t key) const;
+
+    bool LoadBinary(ShaderProgram& shaderProgram, const std::string& path) const;
+    void SaveBinary(const ShaderProgram& shaderProgram, const std::string& path) const;
+
+    // Create and compile the shaders of each stage, from their SPIR-V modules if available
+    std::vector<Shader> CompileShaders(std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+        std::span<const char* const> defines, bool async) const;
+
+    // Compile the shaders and link them with the matching Build method of the program
+    bool Compile(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+        std::span<const char* const> defines) const;
+
+    static void PrintLinkingErrors(const ShaderProgram& shaderProgram);
+
+private:
+    std::string m_directory;
+
+    std::string m_spirvDirectory;
+
+    bool m_enabled;
+
+    // Vendor, renderer and version of the driver. Queried on the first build
+    std::string m_driverString;
+
+    unsigned int m_hitCount;
+    unsigned int m_missCount;
+
+    std::vector<PendingBuild> m_pendingBuilds;
+
+    // Separable programs built with BuildStage, by key
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> m_stages;
+
+    // Pipelines, by their vertex and fragment stages
+    std::map<std::pair<const ShaderProgram*, const ShaderProgram*>, std::shared_ptr<ProgramPipeline>> m_pipelines;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <ituGL/asset/ShaderProgramCache.h>
+#include <ituGL/shader/ShaderUniformCollection.h>
+#include <functional>
+#include <unordered_map>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class ShaderProgram;
+class ProgramPipeline;
+
+// Permutations of a shader program, built from the same sources with a different set of keywords defined
+// Each keyword is a #define that lets the sources compile away the branches that don't apply, like #if defined(LIGHT_POINT)
+// Variants are identified by a bitmask of their keywords, and built through the cache the first time they are requested
+class ShaderProgramVariants
+{
+public:
+    // One bit per keyword, in the order they were declared
+    using KeywordMask = uint32_t;
+
+    // Called when a new variant is built, so it can be registered (for instance, in the Renderer)
+    using VariantBuiltFunction = std::function<void(std::shared_ptr<ShaderProgram>)>;
+
+    // Source files of one shader stage. Paths are copied, so they don't need to outlive the variants
+    struct Stage
+    {
+        Shader::Type type;
+        std::vector<std::string> paths;
+    };
+
+public:
+    ShaderProgramVariants(ShaderProgramCache& shaderProgramCache, std::initializer_list<Stage> stages, std::initializer_list<const char*> keywords);
+
+    void SetVariantBuiltFunction(const VariantBuiltFunction& variantBuiltFunction) { m_variantBuiltFunction = variantBuiltFunction; }
+
+    // Share a vertex stage, built with ShaderProgramCache::BuildStage, instead of linking one in each variant
+    // The variants are then separable programs with the stages declared here, combined with it in a pipeline (see GetPipeline)
+    // Must be set before the first variant is built, and the vertex stage must not depend on the keywords
+    void SetVertexStage(std::shared_ptr<const ShaderProgram> vertexStage);
+    inline std::shared_ptr<const ShaderProgram> GetVertexStage() const { return m_vertexStage; }
+
+    // Bit of the keyword in the masks, or 0 if the keyword was not declared
+    KeywordMask GetKeywordMask(const char* keyword) const;
+
+    // Get the variant with the keywords in the mask defined, building it if needed
+    std::shared_ptr<ShaderProgram> GetVariant(KeywordMask keywordMask);
+
+    // Same as GetVariant, but submitting the build with ShaderProgramCache::BuildAsync instead of waiting for it
+    // Used to build the variants known in advance in parallel. The variant built function is not called for them
+    std::shared_ptr<ShaderProgram> GetVariantAsync(KeywordMask keywordMask);
+
+    // Get the variant only if it is ready to be used, without waiting for it. Used while rendering
+    // If it was not requested yet, the build is submitted in the background, and null is returned until
+    // ShaderProgramCache::Poll finishes it. Then the variant built function is called, the first time it is found
+    // Variants that failed to link are never returned
+    std::shared_ptr<ShaderProgram> FindVariant(KeywordMask keywordMask);
+
+    // Pipeline of the variant with the shared vertex stage, or null if there is no shared vertex stage
+    // The variant must be ready, as the pipeline is created the first time with its stages
+    std::shared_ptr<ProgramPipeline> GetPipeline(KeywordMask keywordMask);
+
+    // Find the keywords of a variant built by this object. Returns false if the program is not one of the variants
+    bool GetVariantMask(const ShaderProgram& shaderProgram, KeywordMask& keywordMask) const;
+
+    // Map from the uniform locations in one variant to the same uniforms in another, to set material uniforms in any variant
+    // Uniforms that were compiled away in the target variant are left out
+    const ShaderUniformCollection::LocationMap& GetLocationMap(KeywordMask sourceMask, KeywordMask targetMask);
+
+    inline unsigned int GetVariantCount() const { return static_cast<unsigned int>(m_variants.size()); }
+
+private:
+    // Build the variant with the cache. If not async, it is compiled right away, because it is needed now
+    std::shared_ptr<ShaderProgram> BuildVariant(KeywordMask keywordMask, bool async);
+
+private:
+    enum class VariantState
+    {
+        // Submitted by FindVariant, and not found finished yet
+        Building,
+        // Built, or requested with GetVariant or GetVariantAsync
+        Ready,
+        // Built by FindVariant, but failed to link
+        Failed,
+    };
+
+    struct Variant
+    {
+        std::shared_ptr<ShaderProgram> shaderProgram;
+        VariantState state;
+    };
+
+private:
+    ShaderProgramCache& m_shaderProgramCache;
+
+    std::vector<Stage> m_stages;
+
+    // Shared vertex stage, if the variants are separable
+    std::shared_ptr<const ShaderProgram> m_vertexStage;
+
+    std::vector<std::string> m_keywords;
+
+    VariantBuiltFunction m_variantBuiltFunction;
+
+    std::unordered_map<KeywordMask, Variant> m_variants;
+
+    // Location maps, indexed by the source mask in the high bits and the target mask in the low bits
+    std::unordered_map<uint64_t, ShaderUniformCollection::LocationMap> m_locationMaps;
+};
@@ -3,6 +3,8 @@
 #include <ituGL/asset/TextureLoader.h>
 #include <ituGL/texture/Texture2DObject.h>
 
+class JobSystem;
+
 // Asset loader for Texture2DObject
 class Texture2DLoader : public TextureLoader<Texture2DObject>
 {
@@ -21,8 +23,25 @@ public:
     inline bool GetFlipVertical() const { return m_flipVertical; }
     inline void SetFlipVertical(bool flipVertical) { m_flipVertical = flipVertical; }
 
+    inline bool GetCompress() const { return m_compress; }
+    inline void SetCompress(bool compress) { m_compress = compress; }
+
+    // If set, the compression runs in the jobs of the system. Otherwise it starts its own threads for each image
+    inline JobSystem* GetJobSystem() const { return m_jobSystem; }
+    inline void SetJobSystem(JobSystem* jobSystem) { m_jobSystem = jobSystem; }
+
+private:
+    // Encode the image (and its mipmaps, if needed) on the CPU and upload it in a block compressed format
+    void SetCompressedImage(Texture2DObject& texture2D, std::span<const std::byte> data, int width, int height,
+        TextureObject::InternalFormat compressedFormat) const;
+
 private:
     // If true, the texture will be flipped vertically on load
     // This option exists because some systems define the vertical origin as "up", and others as "down"
     bool m_flipVertical;
+
+    // If true, 8-bit textures are stored with the block compressed format matching the internal format (BC1, BC3, BC4 or BC5)
+    bool m_compress;
+
+    JobSystem* m_jobSystem;
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+// Counts the heap allocations of the whole program, replacing the global operator new and delete
+// The replacement is linked only in programs that use the tracker. Counting costs a few atomic increments per allocation
+// In debug builds, the call stacks of the allocations can also be captured, to find where a frame allocates
+class AllocationTracker
+{
+public:
+    // Allocations and bytes since the program started
+    static std::size_t GetAllocationCount();
+    static std::size_t GetAllocatedBytes();
+    static std::size_t GetFreeCount();
+
+    // Close the current frame and start a new one. Call it once per frame, at the same point of the loop
+    static void NextFrame();
+
+    // Allocations and bytes of the last frame closed, in any thread
+    static std::size_t GetFrameAllocationCount();
+    static std::size_t GetFrameAllocatedBytes();
+
+    // Call site capture is only available in debug builds
+    static bool IsCallSiteCaptureSupported();
+    static bool IsCallSiteCaptureEnabled();
+    static void SetCallSiteCaptureEnabled(bool enabled);
+
+    // Print the call sites that allocated most often since they were reset, and forget them
+    static void PrintCallSites(std::ostream& stream, unsigned int maxCount = 16);
+    static void ResetCallSites();
+};
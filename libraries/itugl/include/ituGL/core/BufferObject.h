@@ -13,7 +13,18 @@ public:
         ArrayBuffer = GL_ARRAY_BUFFER,
         // Element Buffer Object
         ElementArrayBuffer = GL_ELEMENT_ARRAY_BUFFER,
-        // TODO: There are more types, add them when they are supported
+        // Source and destination of buffer to buffer copies
+        CopyReadBuffer = GL_COPY_READ_BUFFER,
+        CopyWriteBuffer = GL_COPY_WRITE_BUFFER,
+        // Uniform Buffer Object, storage for uniform blocks
+        UniformBuffer = GL_UNIFORM_BUFFER,
+        // Shader Storage Buffer Object, storage for buffer blocks that shaders can read and write
+        ShaderStorageBuffer = GL_SHADER_STORAGE_BUFFER,
+        // Source of the parameters of indirect drawcalls
+        DrawIndirectBuffer = GL_DRAW_INDIRECT_BUFFER,
+        // Destination of pixel reads (glReadPixels) and source of texture uploads
+        PixelPackBuffer = GL_PIXEL_PACK_BUFFER,
+        PixelUnpackBuffer = GL_PIXEL_UNPACK_BUFFER,
     };
 
     // Usage: How the buffer will be used
@@ -34,6 +45,35 @@ public:
         StreamDraw = GL_STREAM_DRAW,    StreamRead = GL_STREAM_READ,    StreamCopy = GL_STREAM_COPY
     };
 
+    // Storage flags: Bitmask of the operations allowed on immutable storage (see AllocateStorage)
+    // - DynamicStorage: The contents can be modified with UpdateData
+    // - MapRead / MapWrite: The buffer can be mapped for reading / writing
+    // - MapPersistent: The buffer can stay mapped while it is used by OpenGL
+    // - MapCoherent: Writes to a persistent mapping are visible to OpenGL without flushing them
+    // - ClientStorage: Hint to keep the storage in client memory
+    enum StorageFlags : GLbitfield
+    {
+        DynamicStorage = GL_DYNAMIC_STORAGE_BIT,
+        MapReadStorage = GL_MAP_READ_BIT,
+        MapWriteStorage = GL_MAP_WRITE_BIT,
+        MapPersistentStorage = GL_MAP_PERSISTENT_BIT,
+        MapCoherentStorage = GL_MAP_COHERENT_BIT,
+        ClientStorage = GL_CLIENT_STORAGE_BIT
+    };
+
+    // Map access: Bitmask of how a mapped range will be accessed (see MapRange)
+    enum MapAccess : GLbitfield
+    {
+        MapRead = GL_MAP_READ_BIT,
+        MapWrite = GL_MAP_WRITE_BIT,
+        MapPersistent = GL_MAP_PERSISTENT_BIT,
+        MapCoherent = GL_MAP_COHERENT_BIT,
+        MapInvalidateRange = GL_MAP_INVALIDATE_RANGE_BIT,
+        MapInvalidateBuffer = GL_MAP_INVALIDATE_BUFFER_BIT,
+        MapFlushExplicit = GL_MAP_FLUSH_EXPLICIT_BIT,
+        MapUnsynchronized = GL_MAP_UNSYNCHRONIZED_BIT
+    };
+
 public:
     BufferObject();
     virtual ~BufferObject();
@@ -55,10 +95,34 @@ public:
     void AllocateData(size_t size, Usage usage);
     void AllocateData(std::span<const std::byte> data, Usage usage);
 
+    // Allocate immutable storage, with a combination of StorageFlags. The size can't change afterwards
+    // Without OpenGL 4.4 or GL_ARB_buffer_storage, it allocates regular data with a usage matching the flags and returns false
+    // In that case the buffer can't be mapped persistently, and has to be unmapped before OpenGL uses it
+    bool AllocateStorage(size_t size, GLbitfield storageFlags);
+    bool AllocateStorage(std::span<const std::byte> data, GLbitfield storageFlags);
+
     // Modify the contents of the buffer, starting at offset
     void UpdateData(std::span<const std::byte> data, size_t offset = 0);
 
+    // Map a range of the buffer into client memory, with a combination of MapAccess flags
+    void* MapRange(size_t offset, size_t size, GLbitfield access);
+    // Make the writes to a range mapped with MapFlushExplicit visible. offset is relative to the mapped range
+    void FlushMappedRange(size_t offset, size_t size);
+    // Unmap the buffer. Returns false if the contents were corrupted while mapped
+    bool Unmap();
+
+    // Bind the buffer, or a range of it, to an indexed binding point (UniformBuffer or ShaderStorageBuffer)
+    void BindBase(Target target, GLuint index) const;
+    void BindRange(Target target, GLuint index, size_t offset, size_t size) const;
+
+    // Copy size bytes from another buffer (or from this one, if the ranges don't overlap) without reading them back
+    // Uses the copy targets, so it doesn't need any buffer to be bound
+    void CopyData(const BufferObject& source, size_t sourceOffset, size_t offset, size_t size);
+
 protected:
+    // Usage hint for the storage flags, when immutable storage is not supported
+    static Usage GetStorageUsage(GLbitfield storageFlags);
+
     // Bind the specific target. Used by the Bind() method in derived classes
     void Bind(Target target) const;
     // Unbind the specific target. It is static because we dont need any objects to do it
@@ -20,6 +20,11 @@ public:
         UShort = GL_UNSIGNED_SHORT,
         Int = GL_INT,
         UInt = GL_UNSIGNED_INT,
+        // Packed types, 4 components stored in a single value
+        Int2101010Rev = GL_INT_2_10_10_10_REV,
+        UInt2101010Rev = GL_UNSIGNED_INT_2_10_10_10_REV,
+        // Depth and stencil in a single value, only for textures
+        UInt248 = GL_UNSIGNED_INT_24_8,
         // And more...
     };
 
@@ -37,6 +42,9 @@ public:
     // Get size in bytes for each Type
     static unsigned int GetTypeSize(Type type);
 
+    // Check if the Type packs all the components in a single value
+    static bool IsPackedType(Type type);
+
     // Convert data to a span of bytes
     template <typename T>
     static std::span<std::byte> GetBytes(T& data);
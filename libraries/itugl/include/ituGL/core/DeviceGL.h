@@ -33,6 +33,12 @@ public:
     // Poll the events in the window event queue
     void PollEvents();
 
+    // Wait until there are events in the queue and process them. Without a timeout, it can wait forever
+    void WaitEvents(double timeout = 0.0);
+
+    // Wake up the thread waiting for events. It can be called from any thread
+    void PostEmptyEvent();
+
     // Clear the framebuffer with the specified color
     inline void Clear(const Color& color) { Clear(true, color, false, 0.0, false, 0); }
     // Clear the framebuffer with the specified color and depth
@@ -53,10 +59,41 @@ public:
     // enable / disable v-sync
     void SetVSyncEnabled(bool enabled);
 
+    // Check if shaders and programs can be compiled in background threads (GL_KHR_parallel_shader_compile)
+    // If supported, their completion status can be queried without waiting for them
+    inline bool IsParallelShaderCompileSupported() const { return m_parallelShaderCompile; }
+
+    // Check if shaders can be loaded from SPIR-V modules (OpenGL 4.6 or GL_ARB_gl_spirv)
+    inline bool IsSpirvSupported() const { return m_spirv; }
+
+    // Check if buffers can have immutable storage, that can stay mapped while in use (OpenGL 4.4 or GL_ARB_buffer_storage)
+    inline bool IsBufferStorageSupported() const { return m_bufferStorage; }
+
+    // Check if BC1 and BC3 textures can be uploaded (GL_EXT_texture_compression_s3tc). BC4 and BC5 are core
+    inline bool IsTextureCompressionS3TCSupported() const { return m_textureCompressionS3TC; }
+
+private:
+    // Enable the background compilation of shaders, if the driver supports it
+    void InitializeParallelShaderCompile();
+
+    // Load the SPIR-V functions missing in the context version, if the driver supports the extension
+    void InitializeSpirv();
+
+    // Load the buffer storage function missing in the context version, if the driver supports the extension
+    void InitializeBufferStorage();
+
 private:
     // Has a context been loaded? We use the context of the current window
     bool m_contextLoaded;
 
+    bool m_parallelShaderCompile;
+
+    bool m_spirv;
+
+    bool m_bufferStorage;
+
+    bool m_textureCompressionS3TC;
+
 private:
     // Singleton instance
     static DeviceGL* m_instance;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+// Measures the GPU time of the commands between Begin and End, with timer queries
+// Each frame uses a different query, and results are read a few frames later when they are available, so the CPU never waits
+class GpuTimer
+{
+public:
+    // frameCount is the number of queries in flight. Frames are not measured if all of them are still pending
+    GpuTimer(unsigned int frameCount = 4);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator = (const GpuTimer&) = delete;
+
+    // Start measuring. Also reads the results of the previous queries that are already available
+    void Begin();
+
+    // Stop measuring the current frame
+    void End();
+
+    // True if Begin read a new result
+    inline bool HasNewTime() const { return m_newTime; }
+
+    // Time of the most recent result, in milliseconds. 0 until the first result is available
+    inline float GetTime() const { return m_time; }
+
+private:
+    std::vector<GLuint> m_queries;
+
+    // Queries waiting for their result, in the order they were issued
+    std::vector<bool> m_pending;
+    unsigned int m_oldestQuery;
+    unsigned int m_currentQuery;
+
+    // If the current frame is being measured
+    bool m_measuring;
+
+    bool m_newTime;
+    float m_time;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Runs small jobs in a fixed pool of worker threads
+// Each thread pushes and pops the jobs it spawns at one end of its own queue, and idle threads steal from the other end
+// The thread that creates the system is the main thread. It has a queue too, and also runs the jobs that need the OpenGL context
+// Jobs are taken from a ring in each queue, so spawning from the threads of the system doesn't allocate them
+class JobSystem
+{
+public:
+    using JobFunction = std::function<void()>;
+    using RangeFunction = std::function<void(unsigned int, unsigned int)>;
+
+    // Number of unfinished jobs in a group. Spawning a job with a counter increments it, and finishing the job decrements it
+    // Jobs can spawn child jobs with their own counter and wait for them, for fork-join parallelism
+    class Counter
+    {
+    public:
+        Counter() : m_count(0) {}
+
+        Counter(const Counter&) = delete;
+        Counter& operator = (const Counter&) = delete;
+
+        inline bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend JobSystem;
+        std::atomic<unsigned int> m_count;
+    };
+
+public:
+    // Without a worker count, one worker for each hardware thread except the main one
+    JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator = (const JobSystem&) = delete;
+
+    // Worker threads, not counting the main thread
+    inline unsigned int GetWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+    // Queue a job to run in any thread. The counter, if any, must live until the job finishes
+    void Spawn(JobFunction function, Counter* counter = nullptr);
+
+    // Queue a job to run in the main thread, the next time it waits or calls RunMainThreadJobs. For OpenGL calls
+    void SpawnMainThread(JobFunction function, Counter* counter = nullptr);
+
+    // Run other jobs until all the jobs of the counter finish. Jobs can wait, the thread keeps working instead of blocking
+    void Wait(const Counter& counter);
+
+    // Run the jobs queued for the main thread. Only from the main thread, usually once per frame
+    void RunMainThreadJobs();
+
+    // Split the range [begin, end) in chunks, and call the function with the limits of each chunk in parallel
+    // Returns when all the chunks are done. Without a chunk size, the range is split in a few chunks per thread
+    void ParallelFor(unsigned int begin, unsigned int end, const RangeFunction& function, unsigned int chunkSize = 0);
+
+    // If the calling thread is the one that created the system
+    bool IsMainThread() const;
+
+private:
+    struct Job;
+    class JobQueue;
+
+private:
+    void WorkerLoop(unsigned int threadIndex);
+
+    // Queue of the calling thread, or null if it is not the main thread or a worker of this system
+    JobQueue* GetThreadQueue() const;
+
+    // Take a job from the queue of the thread, or steal it from the others
+    Job* FindJob(JobQueue* threadQueue);
+
+    // Take a job from the pool of the thread queue, or from the heap for other threads and when the pool is exhausted
+    static Job* CreateJob(JobQueue* threadQueue, JobFunction&& function, Counter* counter);
+
+    // Release a job that finished, or that never ran
+    static void DestroyJob(Job* job);
+
+    void Execute(Job* job);
+
+private:
+    // Queue of the main thread first, then one for each worker
+    std::vector<std::unique_ptr<JobQueue>> m_queues;
+
+    std::vector<std::thread> m_workers;
+
+    std::thread::id m_mainThreadId;
+
+    // Jobs spawned from threads that are not part of the system
+    std::vector<Job*> m_externalJobs;
+    std::atomic<unsigned int> m_externalJobCount;
+    std::mutex m_externalMutex;
+
+    std::vector<Job*> m_mainThreadJobs;
+    std::vector<Job*> m_runningMainThreadJobs;
+    std::mutex m_mainThreadMutex;
+
+    // Jobs waiting in any queue. Workers sleep when there are none
+    std::atomic<unsigned int> m_queuedJobCount;
+    std::atomic<unsigned int> m_sleepingCount;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::atomic<bool> m_stopping;
+};
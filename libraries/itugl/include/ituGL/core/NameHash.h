@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <compare>
+
+// Hash of the name of a uniform, uniform block or vertex attribute, used to find them without comparing strings
+// Names are hashed with 32 bit FNV-1a. Write "Name"_u to hash a literal at compile time
+class NameHash
+{
+public:
+    using Value = uint32_t;
+
+public:
+    constexpr NameHash() : m_value(0) {}
+    constexpr explicit NameHash(std::string_view name) : m_value(Hash(name)) {}
+
+    constexpr Value GetValue() const { return m_value; }
+
+    constexpr bool operator == (const NameHash& other) const = default;
+    constexpr auto operator <=> (const NameHash& other) const = default;
+
+    static constexpr Value Hash(std::string_view name)
+    {
+        Value hash = 0x811c9dc5u;
+        for (char c : name)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x01000193u;
+        }
+        return hash;
+    }
+
+private:
+    Value m_value;
+};
+
+// Hash a name literal during compilation, for instance material.SetUniformValue("Color"_u, color)
+consteval NameHash operator ""_u(const char* name, size_t length)
+{
+    return NameHash(std::string_view(name, length));
+}
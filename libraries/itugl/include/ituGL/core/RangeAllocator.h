@@ -0,0 +1,65 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+// Suballocates ranges of a linear resource (like a buffer), in any unit
+// Uses first fit over a list of free ranges that are merged with their neighbours when freed
+class RangeAllocator
+{
+public:
+    // Offset returned when there is no free range large enough
+    static constexpr size_t InvalidOffset = ~static_cast<size_t>(0);
+
+    // Range that was moved during a compaction
+    struct Relocation
+    {
+        size_t oldOffset;
+        size_t newOffset;
+        size_t size;
+    };
+
+public:
+    RangeAllocator(size_t capacity = 0);
+
+    // Total size that can be allocated
+    inline size_t GetCapacity() const { return m_capacity; }
+
+    // Size currently allocated
+    inline size_t GetAllocatedSize() const { return m_allocatedSize; }
+
+    // Size of the largest range that could be allocated now
+    size_t GetLargestFreeSize() const;
+
+    // Number of ranges currently allocated
+    inline size_t GetAllocationCount() const { return m_allocations.size(); }
+
+    // Allocate a range of the specified size. Returns InvalidOffset if there is no space
+    size_t Allocate(size_t size);
+
+    // Free a range returned by Allocate
+    void Free(size_t offset);
+
+    // Increase the capacity, adding the new space at the end
+    void Grow(size_t capacity);
+
+    // Move all the allocations to the beginning, keeping their order, so all the free space is a single range at the end
+    // Returns the list of allocations that changed their offset, to move their contents
+    std::vector<Relocation> Compact();
+
+private:
+    // Add a free range, merging it with the adjacent ones
+    void AddFreeRange(size_t offset, size_t size);
+
+private:
+    size_t m_capacity;
+
+    size_t m_allocatedSize;
+
+    // Free ranges, sorted by offset: offset -> size
+    std::map<size_t, size_t> m_freeRanges;
+
+    // Allocated ranges, sorted by offset: offset -> size
+    std::map<size_t, size_t> m_allocations;
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+#include <ituGL/core/Data.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+// Buffer for data that changes every frame, like instance, uniform or light data
+// The storage is persistently mapped and split in several regions, one per frame in flight
+// Each frame writes to a different region with plain memcpy, and a fence prevents overwriting a region that OpenGL is still using
+// Without immutable storage, the writes go to a copy in client memory, and Flush uploads them to the region
+template<BufferObject::Target T>
+class StreamingBuffer : public BufferObjectBase<T>
+{
+public:
+    // Offset returned by Allocate when the current region is full
+    static constexpr size_t InvalidOffset = ~static_cast<size_t>(0);
+
+public:
+    // frameSize is the space available for each frame, in bytes. 3 regions let the CPU work 2 frames ahead of the GPU
+    StreamingBuffer(size_t frameSize, unsigned int frameCount = 3);
+    ~StreamingBuffer();
+
+    // The mapped pointer and the fences can't be shared
+    StreamingBuffer(StreamingBuffer&&) = delete;
+    StreamingBuffer& operator = (StreamingBuffer&&) = delete;
+
+    inline size_t GetFrameSize() const { return m_frameSize; }
+    inline unsigned int GetFrameCount() const { return static_cast<unsigned int>(m_fences.size()); }
+
+    // Space already allocated in the current region
+    inline size_t GetUsedSize() const { return m_frameOffset; }
+
+    // Minimum alignment of the offsets returned by Allocate (required by BindRange in uniform and storage buffers)
+    inline size_t GetOffsetAlignment() const { return m_offsetAlignment; }
+
+    // Number of times BeginFrame had to wait for OpenGL to release a region
+    inline unsigned int GetStallCount() const { return m_stallCount; }
+
+    // If false, the data is not visible to OpenGL until Flush is called
+    inline bool IsPersistent() const { return m_persistent; }
+
+    // Move to the next region, waiting until OpenGL has finished using it
+    void BeginFrame();
+
+    // Insert the fence that protects the current region. Call after submitting all the commands that read from it
+    void EndFrame();
+
+    // Upload the data written since the last flush, if the buffer is not persistently mapped. Call before the commands that read it
+    void Flush();
+
+    // Reserve size bytes in the current region. Returns the offset from the start of the buffer, or InvalidOffset if it doesn't fit
+    size_t Allocate(size_t size, size_t alignment = 1);
+
+    // Pointer to the mapped memory at offset
+    inline void* GetData(size_t offset) const { return m_mappedData + offset; }
+
+    // Allocate space for the data and copy it. Returns the offset of the copy, or InvalidOffset if it doesn't fit
+    template<typename U>
+    size_t Write(std::span<const U> data, size_t alignment = alignof(U));
+    template<typename U>
+    inline size_t Write(std::span<U> data, size_t alignment = alignof(U)) { return Write(std::span<const U>(data), alignment); }
+
+private:
+    static size_t AlignOffset(size_t offset, size_t alignment) { return (offset + alignment - 1) / alignment * alignment; }
+
+private:
+    size_t m_frameSize;
+
+    size_t m_offsetAlignment;
+
+    // Pointer to the whole persistent mapping, or to the client copy
+    std::byte* m_mappedData;
+
+    bool m_persistent;
+    std::vector<std::byte> m_clientData;
+
+    // Current region, the space used in it, and the space already uploaded by Flush
+    unsigned int m_currentFrame;
+    size_t m_frameOffset;
+    size_t m_flushedOffset;
+
+    // Fence of each region, or null if the region is not in use
+    std::vector<GLsync> m_fences;
+
+    unsigned int m_stallCount;
+};
+
+
+template<BufferObject::Target T>
+StreamingBuffer<T>::StreamingBuffer(size_t frameSize, unsigned int frameCount)
+    : m_frameSize(0)
+    , m_offsetAlignment(1)
+    , m_mappedData(nullptr)
+    , m_persistent(false)
+    , m_currentFrame(0)
+    , m_frameOffset(0)
+    , m_flushedOffset(0)
+    , m_fences(frameCount, nullptr)
+    , m_stallCount(0)
+{
+    assert(frameCount > 0);
+
+    // Indexed targets require their ranges to start at an aligned offset
+    GLint offsetAlignment = 1;
+    if constexpr (T == BufferObject::UniformBuffer)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    }
+    else if constexpr (T == BufferObject::ShaderStorageBuffer)
+    {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    }
+    m_offsetAlignment = static_cast<size_t>(offsetAlignment);
+
+    // Align the regions too, so the offsets of all the frames are aligned
+    m_frameSize = AlignOffset(frameSize, m_offsetAlignment);
+    size_t size = m_frameSize * frameCount;
+
+    GLbitfield flags = BufferObject::MapWriteStorage | BufferObject::MapPersistentStorage | BufferObject::MapCoherentStorage;
+    this->Bind();
+    m_persistent = this->AllocateStorage(size, flags);
+    if (m_persistent)
+    {
+        m_mappedData = static_cast<std::byte*>(this->MapRange(0, size, flags));
+    }
+    else
+    {
+        m_clientData.resize(size);
+        m_mappedData = m_clientData.data();
+    }
+    BufferObjectBase<T>::Unbind();
+    assert(m_mappedData);
+}
+
+// The mapping is released when the buffer is deleted, only the fences need to be deleted
+template<BufferObject::Target T>
+StreamingBuffer<T>::~StreamingBuffer()
+{
+    for (GLsync fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+}
+
+template<BufferObject::Target T>
+void StreamingBuffer<T>::BeginFrame()
+{
+    m_currentFrame = (m_currentFrame + 1) % GetFrameCount();
+    m_frameOffset = 0;
+    m_flushedOffset = 0;
+
+    GLsync& fence = m_fences[m_currentFrame];
+    if (fence)
+    {
+        // Check without waiting first, so we only count real stalls
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            ++m_stallCount;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        assert(result != GL_WAIT_FAILED);
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+template<BufferObject::Target T>
+void StreamingBuffer<T>::EndFrame()
+{
+    GLsync& fence = m_fences[m_currentFrame];
+    assert(!fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// The region is not in use by OpenGL, so the upload doesn't need to wait
+template<BufferObject::Target T>
+void StreamingBuffer<T>::Flush()
+{
+    if (!m_persistent && m_frameOffset > m_flushedOffset)
+    {
+        size_t offset = m_currentFrame * m_frameSize + m_flushedOffset;
+        this->Bind();
+        this->UpdateData(std::span<const std::byte>(m_mappedData + offset, m_frameOffset - m_flushedOffset), offset);
+        BufferObjectBase<T>::Unbind();
+    }
+    m_flushedOffset = m_frameOffset;
+}
+
+template<BufferObject::Target T>
+size_t StreamingBuffer<T>::Allocate(size_t size, size_t alignment)
+{
+    size_t offset = AlignOffset(m_frameOffset, std::max(alignment, m_offsetAlignment));
+    if (offset + size > m_frameSize)
+    {
+        return InvalidOffset;
+    }
+    m_frameOffset = offset + size;
+    return m_currentFrame * m_frameSize + offset;
+}
+
+// Allocate the space and copy the data converted to bytes
+template<BufferObject::Target T>
+template<typename U>
+size_t StreamingBuffer<T>::Write(std::span<const U> data, size_t alignment)
+{
+    std::span<const std::byte> bytes = Data::GetBytes(data);
+    size_t offset = Allocate(bytes.size(), alignment);
+    if (offset != InvalidOffset)
+    {
+        std::memcpy(GetData(offset), bytes.data(), bytes.size());
+    }
+    return offset;
+}
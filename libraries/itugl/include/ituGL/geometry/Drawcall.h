@@ -26,11 +26,21 @@ public:
 public:
     Drawcall();
     Drawcall(Primitive primitive, GLsizei count, GLint first = 0);
-    Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first = 0);
+    Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first = 0, GLint baseVertex = 0);
 
     // Check if the drawcall is valid
     inline bool IsValid() const { return m_primitive != Primitive::Invalid && m_count > 0; }
 
+    inline Primitive GetPrimitive() const { return m_primitive; }
+    inline GLsizei GetCount() const { return m_count; }
+    inline Data::Type GetElementType() const { return m_eboType; }
+
+    inline GLint GetFirst() const { return m_first; }
+    inline void SetFirst(GLint first) { m_first = first; }
+
+    inline GLint GetBaseVertex() const { return m_baseVertex; }
+    inline void SetBaseVertex(GLint baseVertex) { m_baseVertex = baseVertex; }
+
     // Execute the drawcall
     void Draw() const;
 
@@ -44,6 +54,9 @@ private:
     // Number of vertices or elements that we want to render
     GLsizei m_count;
 
+    // Value added to each element before fetching the vertex. Used when several meshes share the same buffers
+    GLint m_baseVertex;
+
     // Data type of the elements in the EBO (int, uint, short, byte, etc.). A value of None means no EBO
     Data::Type m_eboType;
 };
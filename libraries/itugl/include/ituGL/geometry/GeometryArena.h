@@ -0,0 +1,137 @@
+#pragma once
+
+#include <ituGL/core/RangeAllocator.h>
+#include <ituGL/geometry/VertexBufferObject.h>
+#include <ituGL/geometry/ElementBufferObject.h>
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <span>
+
+class Mesh;
+
+// Shared storage for the geometry of many meshes
+// Vertices are stored in a few large VBOs per vertex format, and elements in a single EBO with 32 bit indices
+// Each VBO has its own VAO, and drawcalls use a base vertex, so meshes with the same vertex format don't need to change the VAO
+class GeometryArena
+{
+public:
+    // Maps vertex attribute semantics with their location on a shader program (same as Mesh::SemanticMap)
+    using SemanticMap = std::unordered_map<VertexAttribute::Semantic, ShaderProgram::Location>;
+
+    // Identifies an allocation. Remains valid after defragmenting the arena
+    using Handle = unsigned int;
+    static constexpr Handle InvalidHandle = ~0u;
+
+    // Location of an allocation inside the shared buffers
+    struct Allocation
+    {
+        // VBO and VAO used by the vertices
+        unsigned int poolIndex;
+        // First vertex in the VBO, to be used as base vertex
+        GLint baseVertex;
+        GLsizei vertexCount;
+        // First element in the EBO
+        GLint firstElement;
+        GLsizei elementCount;
+    };
+
+public:
+    // poolSize is the size in bytes of each VBO, and elementCapacity the initial number of elements in the EBO
+    GeometryArena(size_t poolSize = 32 * 1024 * 1024, size_t elementCapacity = 4 * 1024 * 1024);
+
+    // Copy the vertex data and the elements to the shared buffers. Element values are relative to the first vertex
+    // locations override the default attribute locations, like in Mesh::AddVertexArray
+    // positionData is an optional copy of the position attribute, tightly packed, stored in the position stream of the pool
+    // The stream is created with the first position data. Allocations without it get their positions from the vertex data
+    Handle Allocate(const VertexFormat& vertexFormat, std::span<const std::byte> vertexData,
+        std::span<const unsigned int> elements, const SemanticMap& locations = SemanticMap(),
+        std::span<const std::byte> positionData = {});
+
+    // Release the space of an allocation
+    void Free(Handle handle);
+
+    inline const Allocation& GetAllocation(Handle handle) const { return m_allocations[handle]; }
+
+    // Type of the elements stored in the EBO
+    inline Data::Type GetElementType() const { return Data::Type::UInt; }
+
+    inline unsigned int GetPoolCount() const { return static_cast<unsigned int>(m_pools.size()); }
+    inline const VertexArrayObject& GetVertexArray(unsigned int poolIndex) const { return m_pools[poolIndex].vao; }
+
+    // VAO that binds only the position stream of the pool, with the same base vertices. The full VAO if it has no stream
+    inline bool HasPositionStream(unsigned int poolIndex) const { return m_pools[poolIndex].positionSize > 0; }
+    inline const VertexArrayObject& GetPositionVertexArray(unsigned int poolIndex) const { return HasPositionStream(poolIndex) ? m_pools[poolIndex].positionVao : m_pools[poolIndex].vao; }
+
+    // Memory used by the allocations and reserved in the buffers, in bytes
+    size_t GetAllocatedSize() const;
+    size_t GetCapacity() const;
+
+    // Move the allocations of each buffer together, so all the free space is at the end
+    // Allocation handles remain valid, but their offsets change. The drawcalls of the registered meshes are updated
+    // It must not run while a frame is recorded, but the frame being rendered sees the updated drawcalls
+    // Returns true if any allocation was moved
+    bool Defragment();
+
+    // Meshes drawing from the arena, updated by Defragment. Mesh registers itself with its first allocation, and
+    // unregisters when its allocations are freed
+    void RegisterMesh(Mesh& mesh);
+    void UnregisterMesh(Mesh& mesh);
+
+private:
+    // VBO and VAO for vertices of one format, with the allocator of its vertices
+    struct VertexPool
+    {
+        VertexFormat vertexFormat;
+        std::vector<GLuint> locations;
+        VertexBufferObject vbo;
+        VertexArrayObject vao;
+        RangeAllocator allocator;
+        // Positions of the vertices in a separate VBO, for depth only passes. Created with the first position data
+        VertexBufferObject positionVbo;
+        VertexArrayObject positionVao;
+        size_t positionSize;
+        // Offset of the position attribute in the interleaved vertices
+        size_t positionOffset;
+    };
+
+private:
+    // Find a pool with the same format and space for vertexCount vertices, or create a new one
+    unsigned int FindPool(const VertexFormat& vertexFormat, const std::vector<GLuint>& locations, size_t vertexCount);
+
+    // Create a VBO and a VAO for the vertex format, with the EBO attached
+    unsigned int CreatePool(const VertexFormat& vertexFormat, const std::vector<GLuint>& locations, size_t vertexCapacity);
+
+    // Create the position VBO and VAO of the pool, with the same capacity as the vertex VBO
+    // The positions of the allocations already in the pool are read back from the vertex VBO
+    // Takes the index, as creating pools can't move the others in the deque, but references are easier to keep by mistake
+    void CreatePositionStream(unsigned int poolIndex);
+
+    // Copy the position attribute of the interleaved vertices to the position stream, starting at baseVertex
+    static void CopyPositions(VertexPool& pool, std::span<const std::byte> vertexData, size_t baseVertex);
+
+    // Reallocate the EBO with more space, keeping its contents
+    void GrowElementBuffer(size_t elementCapacity);
+
+    // Move the contents of the relocated ranges in the buffer, using a temporary buffer to avoid overlaps
+    static void RelocateBufferData(BufferObject& buffer, std::span<const RangeAllocator::Relocation> relocations, size_t unitSize);
+
+private:
+    // Size in bytes of each VBO
+    size_t m_poolSize;
+
+    // Deque, so adding a pool doesn't move the others. VAOs returned by GetVertexArray stay valid while the arena exists
+    std::deque<VertexPool> m_pools;
+
+    ElementBufferObject m_ebo;
+    RangeAllocator m_elementAllocator;
+
+    std::vector<Allocation> m_allocations;
+    std::vector<Handle> m_freeHandles;
+
+    // Meshes with allocations in the arena
+    std::vector<Mesh*> m_meshes;
+};
@@ -5,9 +5,14 @@
 #include <ituGL/geometry/VertexArrayObject.h>
 #include <ituGL/geometry/VertexAttribute.h>
 #include <ituGL/geometry/Drawcall.h>
+#include <ituGL/geometry/GeometryArena.h>
 #include <ituGL/shader/ShaderProgram.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <span>
 
 // Class that groups several VBO, EBO and VAO that are part of the same object
 // Can contain several drawcalls using the data in those objects
@@ -19,6 +24,12 @@ public:
 
 public:
     Mesh();
+    ~Mesh();
+
+    // (C++) 8
+    // Move semantics. The arena allocations are owned by the new mesh, and the moved mesh doesn't free them
+    Mesh(Mesh&& mesh) noexcept;
+    Mesh& operator = (Mesh&& mesh) noexcept;
 
     // Adds a new VBO with uninitialized data
     unsigned int AddVertexData(size_t size);
@@ -46,12 +57,34 @@ public:
     template<typename TIterator>
     unsigned int AddVertexArray(std::span<unsigned int> vboIndices, TIterator& it, const TIterator itEnd, const SemanticMap& locations = SemanticMap());
 
+    // Adds a new VAO, with data stored in a single VBO and an EBO inside the mesh, and an iterator for the attributes
+    template<typename TIterator>
+    unsigned int AddVertexArray(unsigned int vboIndex, unsigned int eboIndex, TIterator it, const TIterator itEnd, const SemanticMap& locations = SemanticMap());
+
     // Adds a new submesh, with the index of the VAO to be bound, and the Drawcall parameters
     unsigned int AddSubmesh(unsigned int vaoIndex, const Drawcall& drawcall);
 
     // Adds a new submesh, with the index of the VAO to be bound, and the parameters to create a Drawcall
     unsigned int AddSubmesh(unsigned int vaoIndex, Drawcall::Primitive primitive, GLint first, GLsizei count, Data::Type eboType);
 
+    // Geometry arena where AddArenaData stores the vertex and element data, instead of creating buffers for this mesh
+    inline std::shared_ptr<GeometryArena> GetGeometryArena() const { return m_geometryArena; }
+    void SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena);
+
+    // Copies vertex and element data to the geometry arena. Element values are relative to the first vertex
+    // The allocation is freed when the mesh is destroyed
+    // positionData is an optional tightly packed copy of the positions, see GetSubmeshPositionVertexArray
+    GeometryArena::Handle AddArenaData(const VertexFormat& vertexFormat, std::span<const std::byte> vertexData,
+        std::span<const unsigned int> elements, const SemanticMap& locations = SemanticMap(),
+        std::span<const std::byte> positionData = {});
+
+    // Adds a new submesh that draws a range of the elements of an arena allocation, using the VAO shared by its vertex format
+    unsigned int AddArenaSubmesh(GeometryArena::Handle handle, Drawcall::Primitive primitive, int firstElement, int elementCount);
+
+    // Updates the drawcalls of the arena submeshes with the current offsets of their allocations
+    // Called by GeometryArena::Defragment for every mesh with allocations in it
+    void UpdateArenaDrawcalls();
+
     // (C++) 7
     // Adds a new submesh, adding a new VAO that uses a single VBO, no EBO, and providing the parameters to create a Drawcall
     // vboIndex is the index inside m_vbos of the VBO to be used
@@ -110,19 +143,69 @@ public:
     inline const VertexArrayObject& GetVertexArray(unsigned int vaoIndex) const { return m_vaos[vaoIndex]; }
 
     inline unsigned int GetSubmeshCount() const { return static_cast<unsigned int>(m_submeshes.size()); }
-    inline const VertexArrayObject& GetSubmeshVertexArray(unsigned int submeshIndex) const { return m_vaos[m_submeshes[submeshIndex].vaoIndex]; }
+    const VertexArrayObject& GetSubmeshVertexArray(unsigned int submeshIndex) const;
+
+    // VAO with only the position attribute, for passes that only write depth. Drawn with the same drawcalls
+    // If the submesh has no position stream, it is the same VAO as GetSubmeshVertexArray
+    const VertexArrayObject& GetSubmeshPositionVertexArray(unsigned int submeshIndex) const;
+    inline void SetSubmeshPositionVertexArray(unsigned int submeshIndex, unsigned int vaoIndex) { m_submeshes[submeshIndex].positionVaoIndex = vaoIndex; }
     inline const Drawcall& GetSubmeshDrawcall(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].drawcall; }
 
+    // Local transform of the submesh vertices, applied before the world matrix. Used to decode quantized positions
+    inline const glm::mat4& GetSubmeshTransform(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].transform; }
+    inline void SetSubmeshTransform(unsigned int submeshIndex, const glm::mat4& transform) { m_submeshes[submeshIndex].transform = transform; }
+    inline bool HasSubmeshTransform(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].transform != glm::mat4(1.0f); }
+
+    // Sphere containing the submesh vertices, before the submesh transform. xyz is the center and w the radius
+    inline const glm::vec4& GetSubmeshBoundingSphere(unsigned int submeshIndex) const { return m_submeshes[submeshIndex].boundingSphere; }
+    inline void SetSubmeshBoundingSphere(unsigned int submeshIndex, const glm::vec4& boundingSphere) { m_submeshes[submeshIndex].boundingSphere = boundingSphere; }
+
+    // Adds a simplified version of the submesh, drawn with the same VAO. error is the distance to the original surface
+    // For arena submeshes, the first element is relative to the allocation
+    // Returns the index of the new level of detail
+    unsigned int AddSubmeshLod(unsigned int submeshIndex, const Drawcall& drawcall, float error);
+
+    // Number of levels of detail of the submesh, including the original drawcall as level 0
+    inline unsigned int GetSubmeshLodCount(unsigned int submeshIndex) const { return 1 + static_cast<unsigned int>(m_submeshes[submeshIndex].lods.size()); }
+    inline const Drawcall& GetSubmeshDrawcall(unsigned int submeshIndex, unsigned int lod) const { return lod == 0 ? m_submeshes[submeshIndex].drawcall : m_submeshes[submeshIndex].lods[lod - 1].drawcall; }
+    inline float GetSubmeshLodError(unsigned int submeshIndex, unsigned int lod) const { return lod == 0 ? 0.0f : m_submeshes[submeshIndex].lods[lod - 1].error; }
+
+    // Simplified triangles of the whole mesh, kept in CPU memory to be rasterized by the occlusion culling
+    // Positions are in object space, and indices relative to the positions added in the same call
+    // error is the largest distance from the occluder to the surface it replaces, the depth is biased by it to stay conservative
+    void AddOccluder(std::span<const glm::vec3> positions, std::span<const unsigned int> indices, float error = 0.0f);
+
+    inline bool HasOccluder() const { return !m_occluderIndices.empty(); }
+    inline std::span<const glm::vec3> GetOccluderPositions() const { return m_occluderPositions; }
+    inline std::span<const unsigned int> GetOccluderIndices() const { return m_occluderIndices; }
+    inline float GetOccluderError() const { return m_occluderError; }
+
     // Draws a submesh
     void DrawSubmesh(int submeshIndex) const;
 
 private:
 
+    // Simplified drawcall of a submesh, and its error in object space
+    struct SubmeshLod
+    {
+        Drawcall drawcall;
+        float error;
+    };
+
     // Helper structure that contains a drawcall and its VAO to be bound
     struct Submesh
     {
         unsigned int vaoIndex;
+        // VAO with only the positions, or -1 to use the full VAO
+        int positionVaoIndex;
         Drawcall drawcall;
+        glm::mat4 transform;
+        glm::vec4 boundingSphere;
+        std::vector<SubmeshLod> lods;
+        // Allocation in the geometry arena, and the offsets currently applied to the drawcalls
+        GeometryArena::Handle arenaHandle;
+        GLint arenaFirstElement;
+        GLint arenaBaseVertex;
     };
 
 private:
@@ -136,6 +219,9 @@ private:
     inline const Submesh& GetSubmesh(unsigned int submeshIndex) const { return m_submeshes[submeshIndex]; }
     inline Submesh& GetSubmesh(unsigned int submeshIndex) { return m_submeshes[submeshIndex]; }
 
+    // Release the allocations of this mesh in the geometry arena
+    void FreeArenaData();
+
     // Set a vertex attribute in a VAO, using the specified layout, and increases the location index according to the size of the attribute
     void SetupVertexAttribute(VertexArrayObject& vao, const VertexAttribute::Layout& attributeLayout, GLuint& location, const SemanticMap& locations);
 
@@ -151,6 +237,17 @@ private:
 
     // Submeshes contained in this mesh
     std::vector<Submesh> m_submeshes;
+
+    // Shared storage for the data added with AddArenaData
+    std::shared_ptr<GeometryArena> m_geometryArena;
+
+    // Allocations owned by this mesh in the geometry arena
+    std::vector<GeometryArena::Handle> m_arenaHandles;
+
+    // Occluder triangles, not uploaded to the GPU
+    std::vector<glm::vec3> m_occluderPositions;
+    std::vector<unsigned int> m_occluderIndices;
+    float m_occluderError = 0.0f;
 };
 
 template<typename T>
@@ -228,6 +325,23 @@ unsigned int Mesh::AddVertexArray(std::span<unsigned int> vboIndices, TIterator&
     return vaoIndex;
 }
 
+template<typename TIterator>
+unsigned int Mesh::AddVertexArray(unsigned int vboIndex, unsigned int eboIndex, TIterator it, const TIterator itEnd, const SemanticMap& locations)
+{
+    unsigned int vaoIndex = AddVertexArray(vboIndex, it, itEnd, locations);
+
+    VertexArrayObject& vao = GetVertexArray(vaoIndex);
+    vao.Bind();
+
+    const ElementBufferObject& ebo = GetElementBuffer(eboIndex);
+    ebo.Bind();
+
+    VertexArrayObject::Unbind();
+    ElementBufferObject::Unbind();
+
+    return vaoIndex;
+}
+
 template<typename TIterator>
 unsigned int Mesh::AddSubmesh(Drawcall::Primitive primitive, int firstVertex, int vertexCount,
     unsigned int vboIndex,
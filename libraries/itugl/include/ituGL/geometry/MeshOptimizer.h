@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Reorders triangle lists and vertex data to make better use of the GPU caches
+// All the methods work on 32 bit triangle list indices, before they are packed to the final element type
+class MeshOptimizer
+{
+public:
+    // Vertex cache efficiency of a triangle list, simulated with a FIFO cache
+    struct CacheStatistics
+    {
+        // Average cache miss ratio: transformed vertices per triangle. 0.5 is the best possible, 3.0 the worst
+        float acmr;
+        // Average transform to vertex ratio: transformed vertices per referenced vertex. 1.0 is the best possible
+        float atvr;
+    };
+
+public:
+    // MeshOptimizer class is static, so we delete the constructor
+    MeshOptimizer() = delete;
+
+    // Simulate a FIFO vertex cache of cacheSize entries and compute the statistics of the triangle list
+    static CacheStatistics AnalyzeVertexCache(std::span<const unsigned int> indices, unsigned int vertexCount, unsigned int cacheSize = DefaultCacheSize);
+
+    // Reorder the triangles for the post-transform vertex cache using Tipsify (Sander, Nehab and Barczak 2007)
+    // clusters receives the first triangle of each group of triangles that starts with a cold cache
+    static void OptimizeVertexCache(std::span<unsigned int> indices, unsigned int vertexCount,
+        std::vector<unsigned int>& clusters, unsigned int cacheSize = DefaultCacheSize);
+
+    // Reorder the clusters of an optimized triangle list so that outward facing clusters are drawn first, reducing overdraw
+    // Clusters are split further as long as the cache miss ratio does not grow more than threshold times
+    static void OptimizeOverdraw(std::span<unsigned int> indices, std::span<const glm::vec3> positions,
+        std::span<const unsigned int> clusters, float threshold = 1.05f, unsigned int cacheSize = DefaultCacheSize);
+
+    // Reorder the vertices in the order they are first referenced by the indices, for the pre-transform vertex cache
+    // vertexData is interleaved with vertexSize bytes per vertex. Unreferenced vertices are removed
+    // Returns the new vertex count
+    static unsigned int OptimizeVertexFetch(std::span<unsigned int> indices, std::vector<unsigned char>& vertexData, size_t vertexSize);
+
+    // Size of the cache used when none is specified, close to the effective size in most current GPUs
+    static constexpr unsigned int DefaultCacheSize = 16;
+
+private:
+    // Split each hard cluster where the cache miss ratio is already close to the one of the full cluster
+    static void SplitClusters(std::span<const unsigned int> indices, std::span<const unsigned int> hardClusters,
+        std::vector<unsigned int>& softClusters, float threshold, unsigned int cacheSize);
+};
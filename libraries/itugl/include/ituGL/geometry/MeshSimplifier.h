@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Reduces the triangle count of triangle lists using quadric error metrics (Garland and Heckbert 1997)
+// Vertices are collapsed into other existing vertices, so the simplified indices can reuse the original vertex data
+class MeshSimplifier
+{
+public:
+    // MeshSimplifier class is static, so we delete the constructor
+    MeshSimplifier() = delete;
+
+    // Simplify the triangle list until it has targetIndexCount indices, or until no collapse is possible without exceeding maxError
+    // Vertices on open borders only collapse along the border. Vertices on attribute seams (two vertices with the same position)
+    // collapse along the seam, moving the vertices of both sides, so the texture coordinates and normals stay continuous
+    // error receives the largest distance from the simplified surface to the original one, in the units of the positions
+    static std::vector<unsigned int> Simplify(std::span<const unsigned int> indices, std::span<const glm::vec3> positions,
+        size_t targetIndexCount, float maxError, float& error);
+};
@@ -36,10 +36,15 @@ public:
     // Draw all the submeshes of the mesh, each one with a material on the list
     void Draw();
 
+    // Increases every time the mesh or the materials are replaced
+    unsigned int GetVersion() const { return m_version; }
+
 private:
     // Pointer to the model Mesh
     std::shared_ptr<Mesh> m_mesh;
 
     // List of material pointers, one for each submesh
     std::vector<std::shared_ptr<Material>> m_materials;
+
+    unsigned int m_version;
 };
@@ -21,6 +21,12 @@ public:
     // Gets a specific attribute
     inline VertexAttribute GetAttribute(int index) const { return m_attributes[index]; }
 
+    // Gets the index of the first attribute with the semantic, or -1 if there is none
+    int FindAttribute(VertexAttribute::Semantic semantic) const;
+
+    // Gets the offset in bytes of an attribute inside an interleaved vertex
+    size_t GetAttributeOffset(int index) const;
+
     // Removes all the attributes
     void Clear();
 
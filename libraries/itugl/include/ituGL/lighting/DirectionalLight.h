@@ -9,6 +9,8 @@ public:
 
     Type GetType() const override;
 
+    void CopyTo(std::unique_ptr<Light>& copy) const override;
+
     using Light::GetDirection;
     glm::vec3 GetDirection(const glm::vec3& fallback) const override;
     void SetDirection(const glm::vec3& direction) override;
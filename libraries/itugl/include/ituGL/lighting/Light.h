@@ -24,6 +24,10 @@ public:
 
     virtual Type GetType() const = 0;
 
+    // Copy the light with its current parameters, for a renderer that draws a frame while the scene keeps changing
+    // The copy is assigned if it is a light of the same type, or replaced with a new one
+    virtual void CopyTo(std::unique_ptr<Light>& copy) const = 0;
+
     glm::vec3 GetPosition() const;
     virtual glm::vec3 GetPosition(const glm::vec3& fallback) const;
     virtual void SetPosition(const glm::vec3& position);
@@ -10,6 +10,8 @@ public:
 
     Type GetType() const override;
 
+    void CopyTo(std::unique_ptr<Light>& copy) const override;
+
     using Light::GetPosition;
     glm::vec3 GetPosition(const glm::vec3& fallback) const override;
     void SetPosition(const glm::vec3& position) override;
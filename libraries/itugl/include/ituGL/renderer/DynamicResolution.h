@@ -0,0 +1,52 @@
+#pragma once
+
+// Controls the fraction of the target size used to render the scene, to keep the frame time under a budget
+// The scale goes down quickly when the time is over the budget, and up slowly when it is well below it, so it doesn't oscillate
+class DynamicResolution
+{
+public:
+    // targetTime is the budget in milliseconds
+    DynamicResolution(float targetTime = 16.0f);
+
+    inline bool IsEnabled() const { return m_enabled; }
+    void SetEnabled(bool enabled);
+
+    inline float GetTargetTime() const { return m_targetTime; }
+    inline void SetTargetTime(float targetTime) { m_targetTime = targetTime; }
+
+    // Range of the scale, applied to the width and the height
+    inline float GetMinScale() const { return m_minScale; }
+    inline float GetMaxScale() const { return m_maxScale; }
+    void SetScaleRange(float minScale, float maxScale);
+
+    // Current scale, and the time it was computed from, smoothed over the last frames
+    inline float GetScale() const { return m_scale; }
+    inline float GetAverageTime() const { return m_averageTime; }
+
+    // Add a measured frame time, in milliseconds, and adapt the scale
+    void Update(float frameTime);
+
+    // Size of the viewport with the current scale, at least 1 pixel
+    void GetScaledSize(int width, int height, int& scaledWidth, int& scaledHeight) const;
+
+private:
+    // Forget the measures taken with the previous scale
+    void ResetHistory();
+
+private:
+    bool m_enabled;
+
+    float m_targetTime;
+
+    float m_minScale;
+    float m_maxScale;
+
+    float m_scale;
+
+    // Exponential moving average of the frame time. Negative when there are no measures
+    float m_averageTime;
+
+    // Consecutive frames over the budget, or under the lower threshold
+    unsigned int m_overBudgetFrames;
+    unsigned int m_underBudgetFrames;
+};
@@ -2,14 +2,49 @@
 
 #include <ituGL/renderer/RenderPass.h>
 
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <vector>
+#include <utility>
+#include <span>
+#include <string>
+
 class ForwardRenderPass : public RenderPass
 {
 public:
     ForwardRenderPass();
-    ForwardRenderPass(int drawcallCollectionIndex);
+    ForwardRenderPass(int drawcallCollectionIndex, bool depthPrepass = false);
+
+    // Draw the depth of the opaque drawcalls first, front to back, and then shade only the visible fragments
+    // The position-only shader is loaded from shaders/renderer/depth.vert and depth.frag
+    bool IsDepthPrepassEnabled() const { return m_depthPrepass; }
+    void SetDepthPrepassEnabled(bool depthPrepass);
+
+    // The shading tests for equal depth, so the depth shader must be compiled the same way as the vertex shaders of the materials
+    // If these are loaded from SPIR-V modules, set the same directory before enabling the pre-pass, with depth.vert in the manifest
+    const std::string& GetSpirvDirectory() const { return m_spirvDirectory; }
+    void SetSpirvDirectory(const char* spirvDirectory);
 
     void Render() override;
 
+private:
+    // Drawcalls in the pre-pass write the same depth when shaded. Cross-fading and custom depth states write their own
+    // Blended drawcalls are left out, they must not hide what is behind them
+    static bool IsInDepthPrepass(const Renderer::DrawcallInfo& drawcallInfo);
+
+    void RenderDepthPrepass(std::span<const Renderer::DrawcallInfo> drawcallCollection);
+
 private:
     int m_drawcallCollectionIndex;
+
+    bool m_depthPrepass;
+
+    std::string m_spirvDirectory;
+
+    ShaderProgram m_depthShaderProgram;
+    ShaderProgram::Location m_worldMatrixLocation;
+    ShaderProgram::Location m_viewProjMatrixLocation;
+
+    // Squared distance to the camera and index of the drawcalls in the pre-pass, sorted front to back
+    std::vector<std::pair<float, unsigned int>> m_depthOrder;
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <ituGL/core/BufferObject.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class FramebufferObject;
+
+// Records the frames of a framebuffer to disk without stalling the rendering
+// Each capture reads the pixels into one of a ring of pixel pack buffers, and a fence tells when the copy is done
+// A few frames later, a worker thread reads the persistently mapped buffer and writes the file, while the ring keeps going
+// Without buffer storage, the buffers are mapped when their fence is signaled, and unmapped before they are read into again
+class FrameCapture
+{
+public:
+    enum class Format
+    {
+        // One PNG file for each frame, without the alpha channel
+        Png,
+        // One file for each frame with the RGBA bytes, top row first
+        Raw,
+        // One YUV4MPEG2 stream with all the frames, in 4:2:0 full range. Frames with a different size are skipped
+        Y4m,
+    };
+
+public:
+    // bufferCount is the number of frames in flight, read by the GPU or written by the worker
+    FrameCapture(unsigned int bufferCount = 3);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator = (const FrameCapture&) = delete;
+
+    // Start a new sequence. Files are named after path, adding the frame number and the extension of the format
+    // The frame rate is only stored in the Y4M streams
+    void Start(const std::string& path, Format format, int frameRate = 60);
+
+    // Stop capturing. Waits for the reads still in the GPU, that are written by the worker with the other frames in flight
+    // The Y4M stream is closed after the last one
+    void Stop();
+
+    inline bool IsCapturing() const { return m_sequence != nullptr; }
+
+    // Read a region of the framebuffer, if capturing. Call once per frame, after drawing what should be captured
+    void Capture(const FramebufferObject& framebuffer, int x, int y, int width, int height);
+
+    // Frames captured in the current sequence, and frames written to disk in total
+    inline unsigned int GetCapturedFrameCount() const { return m_capturedFrameCount; }
+    inline unsigned int GetWrittenFrameCount() const { return m_writtenFrameCount.load(std::memory_order_relaxed); }
+
+    // Number of times Capture had to wait for a buffer of the ring, because the GPU or the worker were behind
+    inline unsigned int GetStallCount() const { return m_stallCount; }
+
+    // Encode RGBA pixels, bottom row first as OpenGL reads them, as a PNG without the alpha channel
+    // The filtered rows are stored in rowBuffer, that can be kept between calls to avoid the allocations
+    static bool EncodePng(std::ostream& stream, const std::byte* pixels, int width, int height, std::vector<std::byte>& rowBuffer);
+
+private:
+    // Output of a sequence. Shared by the frames in flight, the Y4M stream is closed when the last one is written
+    struct Sequence
+    {
+        std::string path;
+        Format format;
+        int frameRate;
+
+        // Only used by the worker
+        std::ofstream stream;
+        int streamWidth = 0;
+        int streamHeight = 0;
+    };
+
+    enum class SlotState
+    {
+        // Available for the next capture
+        Free,
+        // Pixels being copied by the GPU, until the fence is signaled
+        Reading,
+        // Pixels being written to disk by the worker
+        Writing,
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<BufferObjectBase<BufferObject::PixelPackBuffer>> buffer;
+        size_t capacity = 0;
+        const std::byte* mappedData = nullptr;
+        GLsync fence = nullptr;
+
+        // Mapped for its whole life. Otherwise, mapped only while the pixels are written by the worker
+        bool persistent = false;
+
+        // Guarded by the mutex
+        SlotState state = SlotState::Free;
+
+        std::shared_ptr<Sequence> sequence;
+        unsigned int frameIndex = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+private:
+    // Hand the finished reads to the worker, in order. If wait is true, wait for the fence of the oldest one
+    void SubmitReadSlots(bool waitOldest);
+
+    // Wait until the slot is free, waiting for its read and its write if needed
+    void WaitSlot(unsigned int slotIndex);
+
+    void WorkerLoop();
+
+    // Encoders, only used by the worker
+    void WriteFrame(Slot& slot);
+    bool WritePng(const std::string& path, const std::byte* pixels, int width, int height);
+    bool WriteRaw(const std::string& path, const std::byte* pixels, int width, int height);
+    bool WriteY4m(Sequence& sequence, const std::byte* pixels, int width, int height);
+
+    static std::string GetFramePath(const Sequence& sequence, unsigned int frameIndex, const char* extension);
+
+private:
+    std::vector<Slot> m_slots;
+
+    // Next slot to capture to, and oldest slot still being read by the GPU. Both move around the ring in order
+    unsigned int m_captureSlot;
+    unsigned int m_readSlot;
+
+    std::shared_ptr<Sequence> m_sequence;
+    unsigned int m_capturedFrameCount;
+    unsigned int m_stallCount;
+
+    // Next slot to write, only used by the worker. Slots are handed in the order they were captured
+    unsigned int m_writeSlot;
+    std::atomic<unsigned int> m_writtenFrameCount;
+
+    // Rows flipped or converted by the encoders, kept between frames. Only used by the worker
+    std::vector<std::byte> m_encodeBuffer;
+
+    bool m_stopping;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_freeCondition;
+
+    std::thread m_thread;
+};
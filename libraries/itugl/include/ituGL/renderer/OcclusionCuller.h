@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Software occlusion culling, with a hierarchical depth buffer rasterized in the CPU
+// Simplified occluder meshes are rasterized at low resolution in a worker thread, while the rest of the frame is recorded
+// Then bounding boxes are tested against the max depth of the covered texels, without any query to the GPU
+// Rows are rasterized with AVX2 if the CPU supports it, otherwise with SSE2
+class PackedBounds;
+
+class OcclusionCuller
+{
+public:
+    // Width is rounded up to a multiple of 8, the number of pixels rasterized at once with AVX2
+    OcclusionCuller(int width = 256, int height = 128);
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator = (const OcclusionCuller&) = delete;
+
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+
+    // True between Begin and End, while occluders can be added
+    inline bool IsActive() const { return m_active; }
+
+    // Start a new frame, clearing the depth buffer. Occluders and boxes are projected with the view projection matrix
+    void Begin(const glm::mat4& viewProjMatrix);
+
+    // Queue an occluder mesh to be rasterized in the worker thread. Positions and indices must be valid until End
+    // Simplified occluders can cover more than the original mesh, so their vertices are pushed away from the camera by depthBias,
+    // the largest distance in world space between the occluder and the original surface
+    void AddOccluder(std::span<const glm::vec3> positions, std::span<const unsigned int> indices, const glm::mat4& worldMatrix, float depthBias = 0.0f);
+
+    // Wait for the queued occluders and build the depth hierarchy
+    void End();
+
+    // Check if a box in world space is hidden behind the occluders
+    // Boxes crossing the near plane, and empty boxes with min greater than max, are never occluded
+    bool IsOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+    // Clear the bits of the mask, as filled by PackedBounds::TestFrustum, of the elements hidden behind the occluders
+    // Only the elements still visible are tested, and the ones with an infinite radius are never occluded
+    void TestOcclusion(const PackedBounds& bounds, std::vector<uint8_t>& visibilityMask) const;
+
+    // Time spent rasterizing the occluders in the last frame, in milliseconds
+    inline float GetRasterizationTime() const { return m_rasterizationTime; }
+
+    // Triangles rasterized in the last frame, after clipping
+    inline unsigned int GetTriangleCount() const { return m_triangleCount; }
+
+private:
+    struct Occluder
+    {
+        std::span<const glm::vec3> positions;
+        std::span<const unsigned int> indices;
+        glm::mat4 worldMatrix;
+        float depthBias;
+    };
+
+private:
+    void WorkerLoop();
+
+    // Rasterize the triangles of an occluder in the base level. Returns the number of triangles rasterized
+    unsigned int RasterizeOccluder(const Occluder& occluder);
+
+    // Rasterize a triangle in screen space, keeping the closest depth
+    void RasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+
+    // Project a position in clip space to pixels, with depth in the [0, 1] range
+    glm::vec3 ToScreen(const glm::vec4& clipPosition) const;
+
+    // Fill each level with the max depth of 2x2 texels of the previous level
+    void BuildHierarchy();
+
+private:
+    int m_width;
+    int m_height;
+
+    glm::mat4 m_viewProjMatrix;
+
+    // Camera position in world space, or the view direction with w = 0 for orthographic projections
+    glm::vec4 m_eyePosition;
+
+    bool m_active;
+
+    // Depth levels, where level 0 is the rasterized depth buffer
+    std::vector<std::vector<float>> m_levels;
+    std::vector<glm::ivec2> m_levelSizes;
+
+    // Clip space positions of the occluder being rasterized, only used by the worker
+    std::vector<glm::vec4> m_clipPositions;
+
+    float m_rasterizationTime;
+    unsigned int m_triangleCount;
+
+    // Accumulated by the worker during the current frame
+    float m_frameRasterizationTime;
+    unsigned int m_frameTriangleCount;
+
+    // Queue of occluders. The worker rasterizes them in order, while the main thread adds more
+    std::vector<Occluder> m_occluders;
+    size_t m_nextOccluder;
+    bool m_working;
+    bool m_stopping;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_doneCondition;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <ituGL/renderer/RenderPass.h>
+
+#include <ituGL/shader/Material.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <glm/vec2.hpp>
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+
+class Shader;
+class Texture2DObject;
+class FramebufferObject;
+
+// Chain of post-processing effects, drawn with fullscreen triangles after the scene
+// Each effect reads the result of the previous one from two reusable ping-pong targets, and the last one writes to the target framebuffer
+// Adjacent per pixel effects are merged in a single uber-shader pass, so the image is read and written once for all of them
+class PostFXStack : public RenderPass
+{
+public:
+    // Size of the intermediate target an effect writes to. Smaller targets are upsampled with bilinear filtering by the next effect
+    enum class Resolution
+    {
+        Full = 1,
+        Half = 2,
+        Quarter = 4,
+    };
+
+public:
+    // sourceTexture is the scene color, with the size of the target framebuffer (the default one if null)
+    PostFXStack(std::shared_ptr<Texture2DObject> sourceTexture, int width, int height, std::shared_ptr<const FramebufferObject> targetFramebuffer = nullptr);
+    ~PostFXStack();
+
+    inline std::shared_ptr<Texture2DObject> GetSourceTexture() const { return m_sourceTexture; }
+    void SetSourceTexture(std::shared_ptr<Texture2DObject> sourceTexture);
+
+    // Fraction of the source texture covered by the image, when the scene is drawn to a smaller viewport
+    // The first pass stretches it to the full size, reading it with the "SourceScale" uniform
+    inline const glm::vec2& GetSourceScale() const { return m_sourceScale; }
+    inline void SetSourceScale(const glm::vec2& sourceScale) { m_sourceScale = sourceScale; }
+
+    // Size of the full resolution targets. Intermediate targets are recreated the next time they are used
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+    void Resize(int width, int height);
+
+    // Adds an effect drawn with its own material. The shader reads the previous result from the "SourceTexture" uniform
+    // If it is the first effect, it must multiply the texture coordinates by the "SourceScale" uniform
+    // shaders/renderer/postfx.vert can be used as vertex shader, it outputs "TexCoord"
+    // The effect is never merged, and it can write to a smaller target if the next effects allow it. Returns the index of the effect
+    int AddEffect(std::shared_ptr<Material> material, Resolution resolution = Resolution::Full);
+
+    // Adds an effect that only changes the color of each pixel, and can be merged with the adjacent ones
+    // declarations is GLSL code placed before main, like uniforms and functions. Names must be unique in the stack
+    // code is GLSL code that modifies "vec3 color", and can read "vec2 TexCoord". It is placed in its own scope
+    // setupFunction sets the uniforms of the effect in the merged program, before each draw
+    int AddPerPixelEffect(const char* declarations, const char* code, Material::ShaderSetupFunction setupFunction = nullptr);
+
+    inline int GetEffectCount() const { return static_cast<int>(m_effects.size()); }
+
+    // Disabled effects are skipped. Changing the enabled effects merges the passes again
+    inline bool IsEffectEnabled(int effectIndex) const { return m_effects[effectIndex].enabled; }
+    void SetEffectEnabled(int effectIndex, bool enabled);
+
+    // Fullscreen passes drawn in the last frame, after merging
+    inline unsigned int GetPassCount() const { return static_cast<unsigned int>(m_passes.size()); }
+
+    void Render() override;
+
+private:
+    struct Effect
+    {
+        // Material of a full effect, or null for a per pixel effect
+        std::shared_ptr<Material> material;
+        Resolution resolution;
+        std::string declarations;
+        std::string code;
+        Material::ShaderSetupFunction setupFunction;
+        bool enabled;
+    };
+
+    // Fullscreen draw of one effect, or several merged per pixel effects
+    struct Pass
+    {
+        std::shared_ptr<Material> material;
+        Resolution resolution;
+        ShaderProgram::Location sourceTextureLocation;
+        ShaderProgram::Location sourceScaleLocation;
+    };
+
+    // Intermediate color texture and the framebuffer to draw to it
+    struct Target
+    {
+        std::shared_ptr<Texture2DObject> texture;
+        std::shared_ptr<FramebufferObject> framebuffer;
+    };
+
+private:
+    // Group the enabled effects in passes, building the merged programs
+    void BuildPasses();
+
+    // Build the material of a pass with the per pixel effects in the range
+    std::shared_ptr<Material> BuildMergedMaterial(std::vector<Effect>::const_iterator first, std::vector<Effect>::const_iterator last);
+
+    // Get one of the two targets with the resolution that is not the input texture, creating it if needed
+    const Target& GetTarget(Resolution resolution, const std::shared_ptr<Texture2DObject>& inputTexture);
+
+    // Create a pass drawing the material
+    static Pass CreatePass(std::shared_ptr<Material> material, Resolution resolution);
+
+    static int GetResolutionIndex(Resolution resolution);
+
+private:
+    std::shared_ptr<Texture2DObject> m_sourceTexture;
+    glm::vec2 m_sourceScale;
+
+    int m_width;
+    int m_height;
+
+    std::vector<Effect> m_effects;
+
+    // Built again when the effects change
+    std::vector<Pass> m_passes;
+    bool m_passesDirty;
+
+    // Vertex shader shared by the merged programs, loaded with the first one
+    std::unique_ptr<Shader> m_vertexShader;
+
+    // Ping-pong targets for each resolution, created the first time they are used
+    std::array<std::array<Target, 2>, 3> m_targets;
+};
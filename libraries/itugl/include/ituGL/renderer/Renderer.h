@@ -1,15 +1,22 @@
 #pragma once
 
 #include <ituGL/core/DeviceGL.h>
+#include <ituGL/core/StreamingBuffer.h>
 #include <ituGL/renderer/RenderPass.h>
 #include <ituGL/geometry/Drawcall.h>
 #include <ituGL/geometry/Mesh.h>
+#include <ituGL/asset/ShaderProgramVariants.h>
+#include <ituGL/camera/Camera.h>
+#include <ituGL/scene/PackedBounds.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 #include <vector>
+#include <array>
 #include <unordered_map>
 #include <memory>
 #include <span>
 #include <functional>
+#include <utility>
 
 class Camera;
 class Light;
@@ -19,21 +26,30 @@ class VertexArrayObject;
 class Drawcall;
 class Model;
 class FramebufferObject;
+class OcclusionCuller;
 
 class Renderer
 {
 public:
     struct DrawcallInfo
     {
-        DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const Drawcall& drawcall)
-            : material(material), worldMatrixIndex(worldMatrixIndex), vao(vao), drawcall(drawcall)
+        DrawcallInfo(const Material& material, unsigned int worldMatrixIndex, const VertexArrayObject& vao, const VertexArrayObject& positionVao,
+            const Drawcall& drawcall, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float lodFade = 0.0f)
+            : material(material), worldMatrixIndex(worldMatrixIndex), vao(vao), positionVao(positionVao), drawcall(drawcall), boundsMin(boundsMin), boundsMax(boundsMax), lodFade(lodFade)
         {
         }
 
         const Material& material;
         unsigned int worldMatrixIndex;
         const VertexArrayObject& vao;
+        // VAO with only the positions, for the depth only passes. Can be the same as vao
+        const VertexArrayObject& positionVao;
         const Drawcall& drawcall;
+        // Box in world space containing the drawcall, used by the occlusion culling
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        // Fraction of pixels dithered out when cross-fading levels of detail. Negative for the coarser level, that draws only those
+        float lodFade;
     };
 
     using DrawcallCollection = std::vector<DrawcallInfo>;
@@ -41,15 +57,33 @@ public:
     using UpdateTransformsFunction = std::function<void(const ShaderProgram&, const glm::mat4&, const Camera&, bool)>;
     using UpdateLightsFunction = std::function<bool(const ShaderProgram&, std::span<const Light* const>, unsigned int&)>;
 
+    // Keywords defined in the shader variant selected for each light (see RegisterShaderVariants)
+    static constexpr const char* LightDirectionalKeyword = "LIGHT_DIRECTIONAL";
+    static constexpr const char* LightPointKeyword = "LIGHT_POINT";
+    static constexpr const char* LightSpotKeyword = "LIGHT_SPOT";
+    static constexpr const char* LightIndirectKeyword = "LIGHT_INDIRECT";
+
+    // Keyword defined in the variant selected for the drawcalls cross-fading their level of detail, that dithers them with LodFade
+    static constexpr const char* LodFadeKeyword = "LOD_FADE";
+
+    // Binding point of the LightBlock uniform block, where the default update lights function binds the current light
+    static constexpr GLuint LightBlockBinding = 0;
+
 public:
     Renderer(DeviceGL& device);
+    ~Renderer();
 
     const DeviceGL& GetDevice() const { return m_device; }
     DeviceGL& GetDevice() { return m_device; }
 
     int AddRenderPass(std::unique_ptr<RenderPass> renderPass);
 
+    // If the frame being recorded has a camera
     bool HasCamera() const;
+    // Camera of the frame being recorded. It is copied, so it can change while the frame renders
+    void AddCamera(const Camera& camera);
+
+    // Camera used by the passes. Passes can replace it while they render, like the shadow maps
     const Camera& GetCurrentCamera() const;
     void SetCurrentCamera(const Camera& camera);
 
@@ -60,8 +94,64 @@ public:
     std::span<const Light* const> GetLights() const;
     void AddLight(const Light& light);
 
+    // Light of the frame being rendered, for passes that update it. In pipelined mode it is a copy of the scene light
+    Light& GetRenderLight(Light& light);
+
     std::span<const DrawcallInfo> GetDrawcalls(unsigned int collectionIndex) const;
-    void AddModel(const Model& model, const glm::mat4& worldMatrix, const std::vector<int> drawCallCollectionIndeces);
+
+    // World matrix of a drawcall, for passes that set the transforms of their own shader programs
+    const glm::mat4& GetWorldMatrix(unsigned int worldMatrixIndex) const { return m_frames[m_renderFrame].worldMatrices[worldMatrixIndex]; }
+    void AddModel(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces);
+
+    // Proxies are models and lights registered once, and recorded in every frame by AddProxies until they are removed
+    // Models keep their world matrix and bounds until they are updated, so static models are not traversed every frame
+    // Like the other recording functions, they can't be used while the same frame is being recorded in another thread
+    int AddModelProxy(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces);
+    void UpdateModelProxy(int proxyIndex, const Model& model, const glm::mat4& worldMatrix);
+    void RemoveModelProxy(int proxyIndex);
+
+    int AddLightProxy(const Light& light);
+    void UpdateLightProxy(int proxyIndex, const Light& light);
+    void RemoveLightProxy(int proxyIndex);
+
+    // Record all the proxies in the current frame, before the frame is ended
+    void AddProxies();
+
+    // Maximum error of the selected level of detail, projected on screen, as a fraction of the viewport height
+    float GetLodThreshold() const { return m_lodThreshold; }
+    void SetLodThreshold(float lodThreshold) { m_lodThreshold = lodThreshold; }
+
+    // Range of projected errors, relative to the threshold, where two levels of detail are cross-faded
+    float GetLodFadeRange() const { return m_lodFadeRange; }
+    void SetLodFadeRange(float lodFadeRange) { m_lodFadeRange = lodFadeRange; }
+
+    // Cross-fading of the levels of detail in a collection, off by default. Enable it only for collections drawn by passes
+    // that set LodFade, like ForwardRenderPass. The other collections get the selected level alone, drawn whole
+    bool IsLodFadeEnabled(unsigned int collectionIndex) const;
+    void SetLodFadeEnabled(unsigned int collectionIndex, bool enabled);
+
+    // Add the drawcall of a submesh to the collections. If it is cross-fading, the collections with cross-fading enabled
+    // also get the next level of detail, drawing only the pixels dithered out of the first one
+    static void AddSubmeshDrawcalls(std::span<DrawcallCollection> collections, std::span<const int> collectionIndices,
+        const std::vector<bool>& lodFadeCollections, const DrawcallInfo& drawcallInfo, const Drawcall& fadeDrawcall);
+
+    // Number of drawcalls skipped in the last frame because their shader program was still compiling
+    unsigned int GetSkippedDrawcallCount() const { return m_lastSkippedDrawcallCount; }
+
+    // Software occlusion culling of the drawcalls in a collection, with the occluders of the meshes seen from the current camera
+    // The drawcalls are first culled against the frustum of the camera, and only the ones inside are tested against the occluders
+    // Collections drawn from another point of view, like shadow maps, must not be culled
+    bool IsOcclusionCullingEnabled(unsigned int collectionIndex) const;
+    void SetOcclusionCullingEnabled(unsigned int collectionIndex, bool enabled);
+
+    // Created the first time occlusion culling is enabled, to read its statistics
+    const OcclusionCuller* GetOcclusionCuller() const { return m_occlusionCuller.get(); }
+
+    // Number of drawcalls culled in the last frame because they were behind the occluders
+    unsigned int GetOccludedDrawcallCount() const { return m_lastOccludedDrawcallCount; }
+
+    // Number of drawcalls culled in the last frame because they were outside of the frustum
+    unsigned int GetFrustumCulledDrawcallCount() const { return m_lastFrustumCulledDrawcallCount; }
 
     const Mesh& GetFullscreenMesh() const;
 
@@ -69,20 +159,145 @@ public:
         const UpdateTransformsFunction& updateTransformFunction,
         const UpdateLightsFunction& updateLightsFunction);
 
-    void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged = true) const;
-    void UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged = true) const;
+    // Register the variants of a program used by materials. For each light, the renderer switches to the variant with
+    // the same material keywords and the light keywords of that light. Variants must be registered with RegisterShaderProgram too
+    // Drawcalls cross-fading their level of detail use the variant with LodFadeKeyword too
+    // Missing variants are built in the background. Until they are ready, the variant without light keywords is used
+    void RegisterShaderVariants(std::shared_ptr<const ShaderProgram> shaderProgramPtr, ShaderProgramVariants& shaderProgramVariants);
+
+    void UpdateTransforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged = true) const;
+    void UpdateTransforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged = true) const;
+
+    // For transform functions setting the camera in a stage shared by several programs. Returns true the first time it is
+    // called for the stage since the pass started or the current camera changed, so the camera is uploaded once per pass
+    bool NeedsSharedStageCamera(const ShaderProgram& sharedStage) const;
 
+    // Programs with the LightBlock uniform block read the light from a buffer written once per frame
+    // Otherwise, the light is set in the LightColor, LightPosition, LightDirection, LightAttenuation and LightIndirect uniforms
     UpdateLightsFunction GetDefaultUpdateLightsFunction(const ShaderProgram& shaderProgram);
-    bool UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const;
+    bool UpdateLights(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const;
 
     void PrepareDrawcall(const DrawcallInfo& drawcallInfo);
 
+    // Forget the material, program and VAO set by the last PrepareDrawcall, when the pass binds others in between
+    void ResetCurrentState();
+
+    // Switch to the variant of the material program for the light, after PrepareDrawcall. Returns the program in use,
+    // that is the material program if it has no variants, and must be used to update the lights
+    std::shared_ptr<const ShaderProgram> SelectLightVariant(const DrawcallInfo& drawcallInfo, std::span<const Light* const> lights, unsigned int lightIndex);
+
     void SetLightingRenderStates(bool firstPass);
 
+    // In pipelined mode, a frame is recorded while the previous one is rendered, usually in another thread.
+    // Recording doesn't make OpenGL calls, and the lights are copied, so the scene can change while the other frame renders
+    bool IsPipelined() const { return m_pipelined; }
+    void SetPipelined(bool pipelined);
+
+    // Finish recording the frame, culling the occluded drawcalls. Render and SwapFrames call it if it was not called before
+    void EndRecording();
+
+    // In pipelined mode, render the recorded frame next and start recording a new one. Neither frame can be in use
+    void SwapFrames();
+
     void Render();
 
 private:
-    void Reset();
+    // Everything recorded for a frame. In pipelined mode there are two of them, one is rendered while the other is recorded
+    struct FrameData
+    {
+        Camera camera;
+        bool hasCamera = false;
+
+        std::vector<const Light*> lights;
+
+        // In pipelined mode, the lights are copies of the scene lights, in the same order
+        // The copies are kept when the frame is reset, and reused by the next lights of the same type
+        std::vector<std::unique_ptr<Light>> lightCopies;
+        std::vector<const Light*> sceneLights;
+
+        std::vector<glm::mat4> worldMatrices;
+
+        std::vector<DrawcallCollection> drawcallCollections;
+
+        unsigned int skippedDrawcallCount = 0;
+        unsigned int occludedDrawcallCount = 0;
+        unsigned int frustumCulledDrawcallCount = 0;
+    };
+
+    // Model registered with AddModelProxy. Removed proxies have no model, and their index is reused
+    struct ModelProxy
+    {
+        const Model* model = nullptr;
+        glm::mat4 worldMatrix;
+        std::vector<int> drawCallCollectionIndeces;
+
+        // World space box of each submesh, minimum and maximum, computed when the proxy is updated
+        std::vector<glm::vec3> submeshBounds;
+    };
+
+private:
+    // Everything registered for a program, found with a single lookup when a drawcall is prepared
+    struct ShaderProgramInfo
+    {
+        UpdateTransformsFunction updateTransformsFunction;
+        UpdateLightsFunction updateLightsFunction;
+        // Location of the LodFade uniform, -1 if the program doesn't cross-fade levels of detail
+        ShaderProgram::Location lodFadeLocation = -1;
+        // Camera generation last set by UpdateDrawcallUniforms, to pass cameraChanged only the first time in each pass
+        mutable unsigned int cameraGeneration = 0;
+    };
+
+    // Data of a light in the LightBlock uniform block, with std140 layout
+    struct LightBlockData
+    {
+        glm::vec3 color;
+        GLint indirect;
+        glm::vec3 position;
+        float padding0;
+        glm::vec3 direction;
+        float padding1;
+        glm::vec4 attenuation;
+    };
+
+    // Variants of a material program, with the masks of the keywords that the renderer selects
+    struct ShaderVariantInfo
+    {
+        ShaderProgramVariants* variants;
+        ShaderProgramVariants::KeywordMask materialMask;
+        ShaderProgramVariants::KeywordMask lightKeywordsMask;
+        ShaderProgramVariants::KeywordMask directionalMask;
+        ShaderProgramVariants::KeywordMask pointMask;
+        ShaderProgramVariants::KeywordMask spotMask;
+        ShaderProgramVariants::KeywordMask indirectMask;
+        ShaderProgramVariants::KeywordMask lodFadeMask;
+    };
+
+private:
+    void Reset(FrameData& frame);
+
+    // Set the transforms and the level of detail fade of the drawcall in the program, or in a variant of it
+    // The transforms can be skipped if the program already has the world matrix of the drawcall
+    void UpdateDrawcallUniforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, const DrawcallInfo& drawcallInfo, bool updateTransforms = true) const;
+
+    // Remove the drawcalls outside of the frustum, or hidden by the occluders, from the collections with occlusion culling enabled
+    void CullDrawcalls(FrameData& frame, bool useOccluders);
+
+    // Remove the drawcalls with programs still compiling, that can only be checked in the thread with the OpenGL context
+    void RemoveIncompleteDrawcalls(FrameData& frame);
+
+    // Add a model using the submesh bounds of its proxy, or computing them if they are empty
+    void AddModel(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces, std::span<const glm::vec3> submeshBounds);
+
+    void UpdateModelProxyBounds(ModelProxy& modelProxy);
+
+    // Write the data of the lights of the frame to the light buffer, growing it if needed
+    void UploadLights(std::span<const Light* const> lights);
+
+    // World space box containing the bounding sphere of a submesh
+    static void ComputeSubmeshBounds(const Mesh& mesh, unsigned int submeshIndex, const glm::mat4& worldMatrix, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    // Select the level of detail of a submesh from the size of its bounding sphere on screen
+    unsigned int SelectLod(const Mesh& mesh, unsigned int submeshIndex, const glm::mat4& worldMatrix, float& lodFade) const;
 
     void InitializeFullscreenMesh();
 
@@ -91,19 +306,72 @@ private:
 
     const Camera *m_currentCamera;
 
-    std::shared_ptr<const Material> m_currentMaterial;
+    // Incremented when a pass starts or the current camera changes, so the programs know when to set the camera again
+    unsigned int m_cameraGeneration;
+
+    // Camera generation set in each shared stage. A few stages, searched linearly
+    mutable std::vector<std::pair<const ShaderProgram*, unsigned int>> m_sharedStageCameras;
+
+    // Material set by the last PrepareDrawcall, and the world matrix set in the current program
+    // Consecutive drawcalls with the same material only change the render states and the uniforms that differ
+    const Material* m_currentMaterial;
+    unsigned int m_currentWorldMatrixIndex;
+
+    // Program in use for the current drawcall, that can be a variant of the material program
+    std::shared_ptr<const ShaderProgram> m_currentShaderProgram;
+
+    // VAO bound by the last PrepareDrawcall in the current pass. Drawcalls in a geometry arena usually share it
+    const VertexArrayObject* m_currentVertexArray;
 
     std::shared_ptr<const FramebufferObject> m_defaultFramebuffer;
     std::shared_ptr<const FramebufferObject> m_currentFramebuffer;
 
-    std::vector<const Light*> m_lights;
+    // Camera matrices used to select the levels of detail. Kept from the last frame if the camera is added after the models
+    glm::mat4 m_lodViewMatrix;
+    glm::mat4 m_lodProjMatrix;
+
+    float m_lodThreshold;
+    float m_lodFadeRange;
+
+    // Frame being recorded and frame being rendered. They are the same if the renderer is not pipelined
+    std::array<FrameData, 2> m_frames;
+    unsigned int m_recordFrame;
+    unsigned int m_renderFrame;
+    bool m_pipelined;
+
+    // Drawcalls skipped in the last frame rendered
+    unsigned int m_lastSkippedDrawcallCount;
+
+    // Registered proxies, and the indices of the removed ones to reuse
+    std::vector<ModelProxy> m_modelProxies;
+    std::vector<int> m_freeModelProxies;
+    std::vector<const Light*> m_lightProxies;
+    std::vector<int> m_freeLightProxies;
+
+    // Rasterizes the occluders while the models are added. Null until occlusion culling is enabled
+    std::unique_ptr<OcclusionCuller> m_occlusionCuller;
+    std::vector<bool> m_occlusionCulledCollections;
+
+    // Collections where the levels of detail are cross-faded
+    std::vector<bool> m_lodFadeCollections;
+
+    // Visible drawcalls of the collection being culled, swapped with it to keep both allocations
+    DrawcallCollection m_visibleDrawcalls;
+
+    // Bounds of the drawcalls of the collection being culled, and their visibility. Kept to reuse the allocations
+    PackedBounds m_drawcallBounds;
+    std::vector<uint8_t> m_visibilityMask;
 
-    std::vector<glm::mat4> m_worldMatrices;
+    // Drawcalls culled by occlusion and by the frustum in the last frame rendered
+    unsigned int m_lastOccludedDrawcallCount;
+    unsigned int m_lastFrustumCulledDrawcallCount;
 
-    std::vector<DrawcallCollection> m_drawcallCollections;
+    std::unordered_map<std::shared_ptr<const ShaderProgram>, ShaderProgramInfo> m_shaderProgramInfos;
+    std::unordered_map<std::shared_ptr<const ShaderProgram>, ShaderVariantInfo> m_shaderVariants;
 
-    std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateTransformsFunction> m_updateTransformsFunctions;
-    std::unordered_map<std::shared_ptr<const ShaderProgram>, UpdateLightsFunction> m_updateLightsFunctions;
+    // Light blocks of the frames in flight, and the offset of each light of the frame being rendered
+    std::unique_ptr<StreamingBuffer<BufferObject::UniformBuffer>> m_lightBuffer;
+    std::vector<size_t> m_lightBlockOffsets;
 
     Mesh m_fullscreenMesh;
 
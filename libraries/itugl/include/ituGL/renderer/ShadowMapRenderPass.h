@@ -19,7 +19,7 @@ public:
 
 private:
     void InitFramebuffer();
-    void InitLightCamera(Camera& lightCamera) const;
+    void InitLightCamera(const Light& light, Camera& lightCamera) const;
 
 private:
     std::shared_ptr<Light> m_light;
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/geometric.hpp>
+#include <array>
+#include <cassert>
 
 class Bounds
 {
@@ -106,18 +111,31 @@ private:
 class FrustumBounds : public RotatedBounds
 {
 public:
-    FrustumBounds(const glm::vec3& center, const glm::vec3& size);
+    // Planes in order left, right, bottom, top, near, far
+    using Planes = std::array<glm::vec4, 6>;
+
+public:
+    // Frustum of a camera, in the space the view projection matrix transforms from (usually world space)
+    FrustumBounds(const glm::mat4& viewProjMatrix);
 
     inline Type GetType() const override { return Type::Frustum; }
 
+    // Each plane is stored as the normal, pointing inside, and the distance in w. Points inside have dot(plane, (p, 1)) >= 0
+    inline const Planes& GetPlanes() const { return m_planes; }
+    inline const glm::vec4& GetPlane(unsigned int planeIndex) const { return m_planes[planeIndex]; }
+
+    // Signed distance of a point to a plane, negative outside
+    inline float GetDistance(unsigned int planeIndex, const glm::vec3& point) const { return glm::dot(glm::vec3(m_planes[planeIndex]), point) + m_planes[planeIndex].w; }
+
 private:
+    Planes m_planes;
 };
 
 
 template<typename T>
 bool Bounds::Intersects(const T& other) const
 {
-    Bounds::Intersects(this, other);
+    return Bounds::Intersects(*this, other);
 }
 
 template<typename TA, typename TB>
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <ituGL/scene/Bounds.h>
+#include <glm/vec3.hpp>
+#include <vector>
+#include <cstdint>
+
+// Spheres and AABBs stored as structure of arrays, to test many of them against a frustum at once
+// Each element has a center, the half size of the box and a radius. Spheres have no size, and boxes no radius,
+// so both kinds are tested with the same code, 8 elements per iteration
+class PackedBounds
+{
+public:
+    // Elements tested in each iteration, and stored in each byte of the visibility mask
+    static const unsigned int BatchSize = 8;
+
+public:
+    PackedBounds();
+
+    inline unsigned int GetCount() const { return m_count; }
+
+    // Add an element, and return its index
+    unsigned int AddSphere(const glm::vec3& center, float radius);
+    unsigned int AddAabb(const glm::vec3& center, const glm::vec3& size);
+
+    // Add spheres and AABBs with their own type. Boxes are added as the AABB containing them
+    unsigned int Add(const Bounds& bounds);
+
+    // Spheres with an infinite radius are always visible, for elements without bounds
+    inline glm::vec3 GetCenter(unsigned int index) const { return glm::vec3(m_centerX[index], m_centerY[index], m_centerZ[index]); }
+    inline glm::vec3 GetSize(unsigned int index) const { return glm::vec3(m_sizeX[index], m_sizeY[index], m_sizeZ[index]); }
+    inline float GetRadius(unsigned int index) const { return m_radius[index]; }
+
+    // Replace the element at the index
+    void SetSphere(unsigned int index, const glm::vec3& center, float radius);
+    void SetAabb(unsigned int index, const glm::vec3& center, const glm::vec3& size);
+
+    // Remove all the elements, keeping the allocations
+    void Clear();
+
+    // Test all the elements against the frustum planes. Bit i % 8 of byte i / 8 is set if element i is inside or intersecting
+    // The mask is resized to hold all the elements
+    void TestFrustum(const FrustumBounds& frustum, std::vector<uint8_t>& visibilityMask) const;
+
+    static inline bool IsVisible(const std::vector<uint8_t>& visibilityMask, unsigned int index) { return (visibilityMask[index / BatchSize] >> (index % BatchSize)) & 1; }
+
+private:
+    // Grow the arrays to a multiple of the batch size. Padding elements are never visible
+    void Resize(unsigned int count);
+
+private:
+    unsigned int m_count;
+
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_sizeX;
+    std::vector<float> m_sizeY;
+    std::vector<float> m_sizeZ;
+    std::vector<float> m_radius;
+};
@@ -11,7 +11,11 @@ class Transform;
 class RendererSceneVisitor : public SceneVisitor
 {
 public:
-    RendererSceneVisitor(Renderer& renderer);
+    // Retained visitors register the models and lights as proxies of the renderer, and only update them when they change
+    // The proxies are recorded with Renderer::AddProxies, after visiting the scene
+    RendererSceneVisitor(Renderer& renderer, bool retained = false);
+
+    bool IsRetained() const { return m_retained; }
 
     void VisitCamera(SceneCamera& sceneCamera) override;
 
@@ -21,4 +25,5 @@ public:
 
 private:
     Renderer& m_renderer;
+    bool m_retained;
 };
@@ -1,28 +1,108 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 class SceneNode;
+class SceneCamera;
+class SceneLight;
+class SceneModel;
 class SceneVisitor;
 
 class Scene
 {
+public:
+    // Reference to a node that can be resolved without hashing its name
+    // The generation detects handles to removed nodes, even if their slot was reused by another node
+    struct Handle
+    {
+        static constexpr std::uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        std::uint32_t index = InvalidIndex;
+        std::uint32_t generation = 0;
+
+        bool IsValid() const { return index != InvalidIndex; }
+        explicit operator bool() const { return IsValid(); }
+
+        bool operator == (const Handle& other) const = default;
+    };
+
 public:
     Scene();
     ~Scene();
 
+    // Null if the handle is invalid, or its node was removed
+    std::shared_ptr<SceneNode> GetSceneNode(Handle handle) const;
+
+    // Lookups by name are for tools and initialization. Use the handles every frame
     std::shared_ptr<SceneNode> GetSceneNode(const std::string& name) const;
+    Handle GetHandle(const std::string& name) const;
 
-    bool AddSceneNode(std::shared_ptr<SceneNode> node);
+    // Adding a node with the name of another one replaces it
+    Handle AddSceneNode(std::shared_ptr<SceneNode> node);
 
+    bool RemoveSceneNode(Handle handle);
     bool RemoveSceneNode(std::shared_ptr<SceneNode> node);
     bool RemoveSceneNode(const std::string& name);
 
+    // Cameras first, then lights, models and other nodes, each type in a tight loop
     void AcceptVisitor(SceneVisitor& visitor);
     void AcceptVisitor(SceneVisitor& visitor) const;
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<SceneNode>> m_nodes;
+    friend class SceneNode;
+
+    // Dense array of the nodes of each type, so the visitors don't go through the virtual AcceptVisitor
+    enum class NodeType : std::uint8_t
+    {
+        Camera,
+        Light,
+        Model,
+        Other,
+    };
+
+    struct Slot
+    {
+        std::uint32_t generation = 0;
+        // Position in the dense array of its type, or the next free slot if it is not used
+        std::uint32_t denseIndex = Handle::InvalidIndex;
+        NodeType type = NodeType::Other;
+    };
+
+    template<typename T>
+    struct DenseArray
+    {
+        std::vector<std::shared_ptr<T>> nodes;
+        // Slot of each node, to update it when the last node is moved to fill a gap
+        std::vector<std::uint32_t> slots;
+    };
+
+private:
+    const Slot* GetSlot(Handle handle) const;
+
+    template<typename T>
+    std::uint32_t AddDense(DenseArray<T>& denseArray, std::shared_ptr<T> node, std::uint32_t slotIndex);
+
+    template<typename T>
+    std::shared_ptr<SceneNode> RemoveDense(DenseArray<T>& denseArray, std::uint32_t denseIndex);
+
+    template<typename T>
+    std::shared_ptr<SceneNode> GetDense(const DenseArray<T>& denseArray, std::uint32_t denseIndex) const;
+
+    // Called by SceneNode::Rename, to keep the name index up to date
+    void RenameSceneNode(const std::string& oldName, const std::string& newName);
+
+private:
+    std::vector<Slot> m_slots;
+    std::uint32_t m_firstFreeSlot;
+
+    DenseArray<SceneCamera> m_cameras;
+    DenseArray<SceneLight> m_lights;
+    DenseArray<SceneModel> m_models;
+    DenseArray<SceneNode> m_otherNodes;
+
+    std::unordered_map<std::string, Handle> m_nameIndex;
 };
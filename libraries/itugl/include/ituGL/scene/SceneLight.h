@@ -3,12 +3,14 @@
 #include <ituGL/scene/SceneNode.h>
 
 class Light;
+class Renderer;
 
 class SceneLight : public SceneNode
 {
 public:
     SceneLight(const std::string& name, std::shared_ptr<Light> light);
     SceneLight(const std::string& name, std::shared_ptr<Light> light, std::shared_ptr<Transform> transform);
+    ~SceneLight();
 
     std::shared_ptr<Light> GetLight() const;
     void SetLight(std::shared_ptr<Light> light);
@@ -19,9 +21,22 @@ public:
     void MatchLightToTransform();
     void MatchTransformToLight();
 
+    // Register the light as a proxy of the renderer, or update the proxy if the light was replaced
+    // The proxy is removed when the node is removed from the scene or destroyed, so the renderer must outlive it
+    void UpdateRendererProxy(Renderer& renderer);
+    void RemoveRendererProxy();
+
+protected:
+    void SetOwnerScene(Scene* scene) override;
+
 private:
     glm::vec3 GetRotationFromDirection(const glm::vec3& direction) const;
 
 private:
     std::shared_ptr<Light> m_light;
+
+    // Proxy registered in the renderer, and the light it was registered with
+    Renderer* m_proxyRenderer;
+    int m_proxyIndex;
+    const Light* m_proxyLight;
 };
@@ -3,14 +3,17 @@
 #include <ituGL/scene/SceneNode.h>
 //#include <ituGL/renderer/Renderable.h>
 #include <vector>
+#include <cstdint>
 
 class Model;
+class Renderer;
 
 class SceneModel : public SceneNode//, public Renderable
 {
 public:
     SceneModel(const std::string& name, std::shared_ptr<Model> model, std::vector<int> drawCallCollectionIndeces);
     SceneModel(const std::string& name, std::shared_ptr<Model> model, std::shared_ptr<Transform> transform);
+    ~SceneModel();
 
     std::shared_ptr<Model> GetModel() const;
     void SetModel(std::shared_ptr<Model> model);
@@ -26,9 +29,24 @@ public:
     void AcceptVisitor(SceneVisitor& visitor) override;
     void AcceptVisitor(SceneVisitor& visitor) const override;
 
-    std::vector<int> GetDrawCallCollectionIndeces();
+    const std::vector<int>& GetDrawCallCollectionIndeces() const;
+
+    // Register the model as a proxy of the renderer, or update the proxy if the transform or the model changed
+    // The proxy is removed when the node is removed from the scene or destroyed, so the renderer must outlive it
+    void UpdateRendererProxy(Renderer& renderer);
+    void RemoveRendererProxy();
+
+protected:
+    void SetOwnerScene(Scene* scene) override;
 
 private:
     std::shared_ptr<Model> m_model;
     std::vector<int> m_drawCallCollectionIndeces;
+
+    // Proxy registered in the renderer, and the versions it was last updated with
+    Renderer* m_proxyRenderer;
+    int m_proxyIndex;
+    const Model* m_proxyModel;
+    unsigned int m_proxyModelVersion;
+    std::uint64_t m_proxyTransformVersion;
 };
@@ -30,12 +30,14 @@ public:
     virtual void AcceptVisitor(SceneVisitor& visitor);
     virtual void AcceptVisitor(SceneVisitor& visitor) const;
 
-private:
+protected:
     friend class Scene;
 
     Scene* GetOwnerScene() const;
-    void SetOwnerScene(Scene* scene);
+    // Nodes that register something outside the scene can override it, to unregister when they are removed
+    virtual void SetOwnerScene(Scene* scene);
 
+private:
     Scene* m_scene;
 
 protected:
@@ -3,6 +3,7 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <memory>
+#include <cstdint>
 
 class Transform
 {
@@ -10,16 +11,16 @@ public:
     Transform();
 
     inline glm::vec3 GetTranslation() const { return m_translation; }
-    inline void SetTranslation(const glm::vec3& translation) { m_translation = translation; m_dirty = true; }
+    inline void SetTranslation(const glm::vec3& translation) { if (m_translation != translation) { m_translation = translation; Changed(); } }
 
     inline glm::vec3 GetRotation() const { return m_rotation; }
-    inline void SetRotation(const glm::vec3& rotation) { m_rotation = rotation; m_dirty = true; }
+    inline void SetRotation(const glm::vec3& rotation) { if (m_rotation != rotation) { m_rotation = rotation; Changed(); } }
 
     inline glm::vec3 GetScale() const { return m_scale; }
-    inline void SetScale(const glm::vec3& scale) { m_scale = scale; m_dirty = true; }
+    inline void SetScale(const glm::vec3& scale) { if (m_scale != scale) { m_scale = scale; Changed(); } }
 
     inline std::shared_ptr<Transform> GetParent() const { return m_parent; }
-    inline void SetParent(std::shared_ptr<Transform> parent) { m_parent = parent; m_dirty = true; }
+    inline void SetParent(std::shared_ptr<Transform> parent) { if (m_parent != parent) { m_parent = parent; Changed(); } }
 
     glm::mat4 GetTranslationMatrix() const;
     glm::mat4 GetRotationMatrix() const;
@@ -29,6 +30,16 @@ public:
 
     bool IsDirty() const;
 
+    // Increases every time the transform or its parents change, to detect changes without comparing the matrices
+    // Setting the same value again is not a change
+    std::uint64_t GetVersion() const;
+
+    // Version of the last change of any transform
+    static std::uint64_t GetLastVersion();
+
+private:
+    void Changed();
+
 private:
     glm::vec3 m_translation;
     glm::vec3 m_rotation;
@@ -39,4 +50,7 @@ private:
     // Cached matrix
     mutable glm::mat4 m_matrix;
     mutable bool m_dirty;
+
+    // Taken from a counter shared by all the transforms, so a change in any parent gives a higher version
+    std::uint64_t m_version;
 };
@@ -6,6 +6,8 @@
 #include <functional>
 #include <array>
 
+class ProgramPipeline;
+
 // Class to group all the properties that may affect the look of a rendered geometry
 class Material : public ShaderUniformCollection
 {
@@ -46,8 +48,14 @@ public:
 
 
     // The function that will be executed for additional shader program setup
+    // The values it sets are not part of the version, so a redraw must be requested when they change without input
     void SetShaderSetupFunction(ShaderSetupFunction shaderSetupFunction);
 
+    // Pipeline to use instead of the shader program, when it is one of the separable stages of the pipeline
+    // Uniforms are still set in the shader program, so it should be the stage with the material properties
+    inline std::shared_ptr<ProgramPipeline> GetProgramPipeline() const { return m_programPipeline; }
+    void SetProgramPipeline(std::shared_ptr<ProgramPipeline> programPipeline);
+
 
     // The test function for the depth test, if depth test is enabled
     TestFunction GetDepthTestFunction() const;
@@ -57,6 +65,11 @@ public:
     bool GetDepthWrite() const;
     void SetDepthWrite(bool depthWrite);
 
+    // If the depth pre-pass of the render pass should draw this material. Disable it for materials that discard fragments,
+    // so they write their own depth when shaded
+    bool GetDepthPrepass() const;
+    void SetDepthPrepass(bool depthPrepass);
+
 
     // Set the test function to use for stencil, front and back
     // refValue: the value we compare against
@@ -113,6 +126,9 @@ public:
     // You can skip depth, stencil or blending using the override flags
     void Use(OverrideFlags overrideFlags = OverrideFlags::NoOverride) const;
 
+    // Set only the depth, stencil, blending and culling properties, when the program and the uniforms are already in use
+    void UseRenderStates(OverrideFlags overrideFlags = OverrideFlags::NoOverride) const;
+
 private:
     // Set all the properties relative to depth
     void UseDepthTest() const;
@@ -130,12 +146,18 @@ private:
     // Function pointer to prepare the shader used by the material
     ShaderSetupFunction m_shaderSetupFunction;
 
+    // Optional pipeline with the separable stages. Default: null, use the shader program
+    std::shared_ptr<ProgramPipeline> m_programPipeline;
+
     // Test function for depth. Default: Less
     TestFunction m_depthTestFunction;
 
     // If it should write to depth or not. Default: True
     bool m_depthWrite;
 
+    // If it is drawn in the depth pre-pass. Default: True
+    bool m_depthPrepass;
+
     // Test functions for front and back stencil. Default: Never
     std::array<TestFunction, 2> m_stencilTestFunctions;
 
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ituGL/core/Object.h>
+#include <span>
+
+class ShaderProgram;
+
+// Program pipeline is an OpenGL Object that combines the stages of several separable shader programs
+// Each stage is compiled and linked once, and shared by all the pipelines that use it, instead of linking every combination
+class ProgramPipeline : public Object
+{
+public:
+    ProgramPipeline();
+    virtual ~ProgramPipeline();
+
+    // (C++) 8
+    // Move semantics
+    ProgramPipeline(ProgramPipeline&& programPipeline) noexcept;
+    ProgramPipeline& operator = (ProgramPipeline&& programPipeline) noexcept;
+
+    // Implements the Bind required by Object
+    void Bind() const override;
+    // Unbinds currently bound ProgramPipeline
+    static void Unbind();
+
+    // Use the stages of a separable program in this pipeline. stages is a combination of bits like GL_VERTEX_SHADER_BIT
+    void UseProgramStages(const ShaderProgram& shaderProgram, GLbitfield stages);
+
+    // Use the stages of all the shaders linked in the separable program
+    void UseProgramStages(const ShaderProgram& shaderProgram);
+
+    // Set the pipeline for rendering. A program set with ShaderProgram::Use would take priority, so it is removed first
+    void Use() const;
+
+    // Check if the stages can be used together, for instance, if their interfaces match
+    bool Validate() const;
+
+    // Get a string with the validation error messages
+    // The max length of the string returned is determined by the capacity of the span
+    void GetValidationErrors(std::span<char> errors) const;
+};
@@ -3,6 +3,12 @@
 #include <ituGL/core/Object.h>
 
 #include <span>
+#include <cstddef>
+
+// Not included in glad, defined by GL_KHR_parallel_shader_compile (same value in the ARB version)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 // Shader is an OpenGL Object that represents a program that runs on the GPU
 // There are different types, with different requirements. See Lecture 2: Shaders for more information
@@ -44,12 +50,26 @@ public:
     // Set the source code of the shader (multiple sources)
     void SetSource(std::span<const char*> source);
 
+    // Set the code of the shader from a binary in the given format, like a SPIR-V module, instead of the source code
+    void SetBinary(GLenum format, std::span<const std::byte> binary);
+
+    // Specialize a shader set from a SPIR-V module: choose its entry point and set the value of the specialization constants
+    // This is the compilation of SPIR-V shaders. Constants not in the list keep their default value
+    bool Specialize(const char* entryPoint, std::span<const GLuint> constantIndices, std::span<const GLuint> constantValues);
+
     // Compile the shader source code
     bool Compile();
 
+    // Start compiling the shader source code, without waiting for the result
+    void CompileAsync();
+
     // Check if the shader has been successfully compiled
     bool IsCompiled() const;
 
+    // Check if the compilation has finished, so IsCompiled won't wait for it
+    // Always true if the driver doesn't compile in the background
+    bool IsCompileComplete() const;
+
     // Get compilation error messages in case of a failure
     void GetCompilationErrors(std::span<char> errors) const;
 };
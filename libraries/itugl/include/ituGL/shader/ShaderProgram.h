@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ituGL/core/Object.h>
+#include <ituGL/core/NameHash.h>
 
 // Include the glm types for vectors and matrices
 #include <glm/vec2.hpp>
@@ -17,6 +18,7 @@
 #include <glm/mat4x4.hpp>
 
 #include <span>
+#include <vector>
 
 class Shader;
 class TextureObject;
@@ -29,6 +31,31 @@ public:
     // Declare the type used for uniform locations
     using Location = GLint;
 
+    // Reflection data of the active uniforms, uniform blocks and vertex attributes, read once after linking
+    // Arrays are found by their name with and without the "[0]" suffix
+    struct UniformInfo
+    {
+        NameHash name;
+        Location location;
+        GLenum glType;
+        GLint size;
+    };
+
+    struct UniformBlockInfo
+    {
+        NameHash name;
+        GLuint index;
+        GLint dataSize;
+    };
+
+    struct AttributeInfo
+    {
+        NameHash name;
+        Location location;
+        GLenum glType;
+        GLint size;
+    };
+
 public:
     ShaderProgram();
     virtual ~ShaderProgram();
@@ -71,18 +98,56 @@ public:
         return Build(vertexShader, fragmentShader, tesselationControlShader, &tesselationEvaluationShader, &geometryShader);
     }
 
+    // Build (Attach and link) a separable program with only one stage, to be combined with others in a ProgramPipeline
+    bool BuildSeparable(const Shader& shader);
+
+    // Attach and link any combination of shaders without waiting for the compilation or the linking to finish
+    // Use IsLinkComplete to know when IsLinked and the other queries can be called without waiting
+    void BuildAsync(std::span<const Shader* const> shaders);
+
     // Check if shaders have been linked to create a valid program
     bool IsLinked() const;
 
+    // Check if the linking has finished, so IsLinked won't wait for it
+    // Always true if the driver doesn't compile in the background. Once complete, it is not queried again
+    bool IsLinkComplete() const;
+
+    // Allow using the program for some of the stages of a ProgramPipeline. Must be set before building or loading the binary
+    void SetSeparable(bool separable);
+    inline bool IsSeparable() const { return m_separable; }
+
+    // Allow getting the binary of the program after linking. Must be set before building
+    void SetBinaryRetrievable(bool retrievable);
+
+    // Get the driver specific binary of a linked program, and the format it uses
+    bool GetBinary(GLenum& format, std::vector<std::byte>& binary) const;
+
+    // Link the program from a binary obtained with GetBinary, instead of building it
+    // Returns false if the driver doesn't accept the binary (for instance, after a driver update)
+    bool LoadBinary(GLenum format, std::span<const std::byte> binary);
+
     // Get a string with linking error messages
     // The max length of the string returned is determined by the capacity of the span
     void GetLinkingErrors(std::span<char> errors) const;
 
     // Find an attribute location by name
     Location GetAttributeLocation(const char* name) const;
+    Location GetAttributeLocation(NameHash name) const;
 
-    // Find a uniform location by name
+    // Find a uniform location by name. Names not in the reflection table, like array elements, are queried to OpenGL
     Location GetUniformLocation(const char *name) const;
+    Location GetUniformLocation(NameHash name) const;
+
+    // Find a uniform block index by name. Returns GL_INVALID_INDEX if not found
+    GLuint GetUniformBlockIndex(NameHash name) const;
+
+    // Set the binding point where the uniform block reads its buffer (see BufferObject::BindRange)
+    void SetUniformBlockBinding(GLuint uniformBlockIndex, GLuint binding) const;
+
+    // Reflection tables, sorted by name hash
+    std::span<const UniformInfo> GetUniformTable() const;
+    std::span<const UniformBlockInfo> GetUniformBlockTable() const;
+    std::span<const AttributeInfo> GetAttributeTable() const;
 
     // Get how many uniforms exist in this shader program
     unsigned int GetUniformCount() const;
@@ -101,6 +166,7 @@ public:
     void GetUniforms(Location location, std::span<T> values) const;
 
     // Template method combinations to simplify setting uniforms
+    // Uniforms are set directly in the program, so separable programs don't need to be in use
     template<typename T>
     void SetUniform(Location location, const T& value) const;
     template<typename T>
@@ -116,6 +182,9 @@ public:
     // Set the shader program as the active one to be used for rendering
     void Use() const;
 
+    // Remove the active shader program, so the bound ProgramPipeline is used instead
+    static void Unuse();
+
 private:
     // Build (Attach and link) all shaders provided for the rasterization pipeline
     bool Build(const Shader& vertexShader, const Shader& fragmentShader,
@@ -128,6 +197,17 @@ private:
     // Link currently attached shaders
     bool Link();
 
+    // Read the uniforms, blocks and attributes of the linked program into the reflection tables
+    // Programs built with BuildAsync read them on the first query, when the link is complete
+    void BuildReflection() const;
+
+    // Report an error if the name was removed from the tables because its hash collides with another name
+    void ReportCollision(NameHash name) const;
+
+    // Binary search in a reflection table
+    template<typename T>
+    static const T* FindInTable(std::span<const T> table, NameHash name);
+
     // Helper template method for getting uniforms
     template<typename T>
     void GetUniform(Location location, std::span<T> value) const;
@@ -139,6 +219,18 @@ private:
     void SetUniforms(Location location, const T* values, GLsizei count) const;
 
 private:
+    bool m_separable;
+
+    // Set when the linking is known to be finished, false only after BuildAsync
+    mutable bool m_linkComplete;
+
+    mutable bool m_hasReflection;
+    mutable std::vector<UniformInfo> m_uniformTable;
+    mutable std::vector<UniformBlockInfo> m_uniformBlockTable;
+    mutable std::vector<AttributeInfo> m_attributeTable;
+    // Hashes shared by several names, left out of the tables
+    mutable std::vector<NameHash> m_collidingNames;
+
 #ifndef NDEBUG
     inline bool IsUsed() const { return s_usedHandle == GetHandle(); }
     static Handle s_usedHandle;
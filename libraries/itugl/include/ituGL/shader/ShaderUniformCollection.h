@@ -4,10 +4,13 @@
 #include <ituGL/texture/TextureObject.h>
 #include <ituGL/core/Data.h>
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 class ShaderUniformCollection
 {
@@ -15,6 +18,10 @@ public:
     // Alias for a set of names
     using NameSet = std::unordered_set<std::string>;
 
+    // Maps the uniform locations of this collection to the locations of the same uniforms in another program
+    // Pairs of both locations, sorted by the first. Uniforms that are not in the other program are left out
+    using LocationMap = std::vector<std::pair<ShaderProgram::Location, ShaderProgram::Location>>;
+
 public:
     ShaderUniformCollection();
     // Initialize with the shader program, will extract all the properties. Skip the names in filtered uniforms
@@ -29,14 +36,18 @@ public:
 
     // Get the vertex attribute location by name
     ShaderProgram::Location GetAttributeLocation(const char* name) const;
+    ShaderProgram::Location GetAttributeLocation(NameHash name) const;
 
     // Get the shader uniform location by name
     ShaderProgram::Location GetUniformLocation(const char* name) const;
+    ShaderProgram::Location GetUniformLocation(NameHash name) const;
 
-    // Get uniform value for different types, using the name or the uniform location
+    // Get uniform value for different types, using the name, its hash or the uniform location
     template<typename T>
     T GetUniformValue(const char* name) const;
     template<typename T>
+    T GetUniformValue(NameHash name) const;
+    template<typename T>
     T GetUniformValue(ShaderProgram::Location location) const;
     template<typename T>
     void GetUniformValue(const char* name, T& value) const;
@@ -49,16 +60,20 @@ public:
     template<typename T>
     void GetUniformValues(ShaderProgram::Location location, std::span<T> value) const;
 
-    // Set uniform value for different types, using the name or the uniform location
+    // Set uniform value for different types, using the name, its hash or the uniform location
     template<typename T>
     void SetUniformValue(const char* name, const T& value);
     template<typename T>
+    void SetUniformValue(NameHash name, const T& value);
+    template<typename T>
     void SetUniformValue(ShaderProgram::Location location, const T& value);
     template<typename T>
     void SetUniformValue(ShaderProgram::Location location, const std::shared_ptr<T>& value);
     template<typename T>
     void SetUniformValues(const char* name, std::span<const T> value);
     template<typename T>
+    void SetUniformValues(NameHash name, std::span<const T> value);
+    template<typename T>
     void SetUniformValues(ShaderProgram::Location location, std::span<const T> value);
 
     // Get the pointer to the uniform data
@@ -67,9 +82,20 @@ public:
     template<typename T>
     T* GetDataUniformPointer(ShaderProgram::Location location);
 
+    // Increases every time a value changes, to detect changes without comparing the values. Setting the same value again is not a change
+    // Values set to the shader program directly, like the ones in the shader setup function of the materials, are not tracked
+    inline std::uint64_t GetVersion() const { return m_version; }
+
+    // Version of the last change of any collection
+    static std::uint64_t GetLastVersion();
+
     // Set all the properties to the shader. Requires the shader program to be in use
     void SetUniforms() const;
 
+    // Set the properties to another program built from the same sources, like a different variant of the shader
+    // Uniforms missing in the location map are skipped. Requires that program to be in use
+    void SetUniforms(const ShaderProgram& shaderProgram, const LocationMap& locations) const;
+
 private:
     // Different dimensions of the properties
     enum class UniformDimension
@@ -128,17 +154,28 @@ private:
     // Check if an OpenGL type is a texture and, if so, return the target type
     static bool IsTextureUniform(GLenum glType, TextureObject::Target& target);
 
+    // Binary search of the property in a list sorted by location. Returns the end of the list if it is not there
+    template<typename T>
+    static typename std::vector<T>::const_iterator FindUniform(const std::vector<T>& uniforms, ShaderProgram::Location location);
+
+    // Insert the property in the list, keeping it sorted by location
+    template<typename T>
+    static void InsertUniform(std::vector<T>& uniforms, const T& uniform);
+
+    // Location of the same uniform in the other program of the map, or -1
+    static ShaderProgram::Location MapLocation(const LocationMap& locations, ShaderProgram::Location location);
+
     // Add uniform property
     void AddUniform(const DataUniform& uniform);
     template<typename T>
     void AddUniform(const DataUniform& uniform);
     void AddUniform(const TextureUniform& uniform);
 
-    // Use uniform property
-    void UseUniform(const DataUniform& uniform) const;
+    // Use uniform property, setting it in the location of the shader program
+    void UseUniform(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const;
     template<typename T>
-    void UseUniform(const DataUniform& uniform) const;
-    void UseUniform(const TextureUniform& uniform) const;
+    void UseUniform(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const;
+    void UseUniform(const TextureUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const;
 
     // Get the buffer where data values are stored for a certain type
     template<typename T>
@@ -174,21 +211,23 @@ private:
     bool IsMatrixSize(UniformDimension dimension, int columns, int rows) const;
 #endif
 
+protected:
+    // Give the collection a new version
+    void Changed();
+
 protected:
     // The shader program
     std::shared_ptr<ShaderProgram> m_shaderProgram;
 
 private:
-    // The list of data properties
+    // Version of the last change of the values
+    std::uint64_t m_version;
+
+    // The list of data properties, sorted by location. Locations can be sparse, like the explicit ones, so they are searched
     std::vector<DataUniform> m_dataUniforms;
-    // The list of texture properties
+    // The list of texture properties, sorted by location
     std::vector<TextureUniform> m_textureUniforms;
 
-    // Map to find data properties in the data list
-    std::unordered_map<ShaderProgram::Location, int> m_locationDataIndex;
-    // Map to find texture properties in the texture list
-    std::unordered_map<ShaderProgram::Location, int> m_locationTextureIndex;
-
     // Buffers that store the values for data properties
     std::vector<int> m_intDataValues;
     std::vector<unsigned int> m_uintDataValues;
@@ -205,6 +244,14 @@ inline T ShaderUniformCollection::GetUniformValue(const char* name) const
     return value;
 }
 
+template<typename T>
+inline T ShaderUniformCollection::GetUniformValue(NameHash name) const
+{
+    ShaderProgram::Location location = GetUniformLocation(name);
+    assert(location >= 0);
+    return GetUniformValue<T>(location);
+}
+
 template<typename T>
 inline T ShaderUniformCollection::GetUniformValue(ShaderProgram::Location location) const
 {
@@ -266,6 +313,16 @@ inline void ShaderUniformCollection::SetUniformValue(const char* name, const T&
     }
 }
 
+template<typename T>
+inline void ShaderUniformCollection::SetUniformValue(NameHash name, const T& value)
+{
+    ShaderProgram::Location location = GetUniformLocation(name);
+    if (location >= 0)
+    {
+        SetUniformValue(location, value);
+    }
+}
+
 template<typename T>
 inline void ShaderUniformCollection::SetUniformValue(ShaderProgram::Location location, const T& value)
 {
@@ -290,13 +347,25 @@ inline void ShaderUniformCollection::SetUniformValues(const char* name, std::spa
     SetUniformValues(location, values);
 }
 
+template<typename T>
+inline void ShaderUniformCollection::SetUniformValues(NameHash name, std::span<const T> values)
+{
+    ShaderProgram::Location location = GetUniformLocation(name);
+    assert(location >= 0);
+    SetUniformValues(location, values);
+}
+
 template<typename T>
 void ShaderUniformCollection::SetUniformValues(ShaderProgram::Location location, std::span<const T> values)
 {
     std::span<T> storedValues;
     GetDataValues(location, storedValues);
     assert(values.size() == storedValues.size());
-    std::memcpy(storedValues.data(), values.data(), values.size_bytes());
+    if (std::memcmp(storedValues.data(), values.data(), values.size_bytes()) != 0)
+    {
+        std::memcpy(storedValues.data(), values.data(), values.size_bytes());
+        Changed();
+    }
 }
 
 template<typename T>
@@ -379,6 +448,8 @@ T* ShaderUniformCollection::GetDataUniformPointer(const char* name)
 template<typename T>
 T* ShaderUniformCollection::GetDataUniformPointer(ShaderProgram::Location location)
 {
+    // The values are written through the pointer, so assume they change
+    Changed();
     const DataUniform& uniform = GetDataUniform(location);
     std::vector<T>& allValues = GetDataValues<T>();
     return &allValues[uniform.index];
@@ -387,35 +458,51 @@ T* ShaderUniformCollection::GetDataUniformPointer(ShaderProgram::Location locati
 template<typename T>
 void ShaderUniformCollection::AddUniform(const DataUniform& uniform)
 {
-    m_locationDataIndex.insert(std::make_pair(uniform.location, static_cast<int>(m_dataUniforms.size())));
-    m_dataUniforms.push_back(uniform);
-
     std::vector<T>& values = GetDataValues<T>();
-    m_dataUniforms.back().index = static_cast<int>(values.size());
+    DataUniform dataUniform = uniform;
+    dataUniform.index = static_cast<int>(values.size());
+    InsertUniform(m_dataUniforms, dataUniform);
+
     int size = GetDataUniformSize(uniform);
     values.insert(values.end(), size, T());
 }
 
+template<typename T>
+typename std::vector<T>::const_iterator ShaderUniformCollection::FindUniform(const std::vector<T>& uniforms, ShaderProgram::Location location)
+{
+    auto itUniform = std::lower_bound(uniforms.begin(), uniforms.end(), location,
+        [](const T& uniform, ShaderProgram::Location location) { return uniform.location < location; });
+    return itUniform != uniforms.end() && itUniform->location == location ? itUniform : uniforms.end();
+}
+
+template<typename T>
+void ShaderUniformCollection::InsertUniform(std::vector<T>& uniforms, const T& uniform)
+{
+    auto itUniform = std::lower_bound(uniforms.begin(), uniforms.end(), uniform.location,
+        [](const T& uniform, ShaderProgram::Location location) { return uniform.location < location; });
+    assert(itUniform == uniforms.end() || itUniform->location != uniform.location);
+    uniforms.insert(itUniform, uniform);
+}
+
 template<>
-void ShaderUniformCollection::UseUniform<float>(const DataUniform& uniform) const;
+void ShaderUniformCollection::UseUniform<float>(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const;
 
 template<typename T>
-void ShaderUniformCollection::UseUniform(const DataUniform& uniform) const
+void ShaderUniformCollection::UseUniform(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const
 {
-    ShaderProgram::Location location = uniform.location;
     switch (uniform.dimension)
     {
     case UniformDimension::Scalar:
-        m_shaderProgram->SetUniforms<T>(location, GetDataValues<T>(location));
+        shaderProgram.SetUniforms<T>(location, GetDataValues<T>(uniform.location));
         break;
     case UniformDimension::Vector2:
-        m_shaderProgram->SetUniforms<T, 2>(location, GetDataValues<glm::vec<2, T>>(location));
+        shaderProgram.SetUniforms<T, 2>(location, GetDataValues<glm::vec<2, T>>(uniform.location));
         break;
     case UniformDimension::Vector3:
-        m_shaderProgram->SetUniforms<T, 3>(location, GetDataValues<glm::vec<3, T>>(location));
+        shaderProgram.SetUniforms<T, 3>(location, GetDataValues<glm::vec<3, T>>(uniform.location));
         break;
     case UniformDimension::Vector4:
-        m_shaderProgram->SetUniforms<T, 4>(location, GetDataValues<glm::vec<4, T>>(location));
+        shaderProgram.SetUniforms<T, 4>(location, GetDataValues<glm::vec<4, T>>(uniform.location));
         break;
     default:
         assert(false);
@@ -20,6 +20,11 @@ public:
         GLsizei width, GLsizei height,
         Format format, InternalFormat internalFormat,
         std::span<const T> data, Data::Type type = Data::Type::None);
+
+    // Initialize the texture2D with data already encoded in a compressed internal format
+    void SetCompressedImage(GLint level,
+        GLsizei width, GLsizei height,
+        InternalFormat internalFormat, std::span<const std::byte> data);
 };
 
 // Set image with data in bytes
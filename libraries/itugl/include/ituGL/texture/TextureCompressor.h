@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ituGL/texture/TextureObject.h>
+#include <span>
+
+class JobSystem;
+
+// CPU encoder for block compressed formats (BC1, BC3, BC4 and BC5)
+// Images are split in rows of 4x4 blocks that are encoded in parallel, using SSE2 when available
+class TextureCompressor
+{
+public:
+    // TextureCompressor class is static, so we delete the constructor
+    TextureCompressor() = delete;
+
+    // Get the block compressed format that matches an uncompressed internal format. Invalid if there is none
+    static TextureObject::InternalFormat GetCompressedFormat(TextureObject::InternalFormat internalFormat);
+
+    // Check if the internal format is one of the block compressed formats supported by the encoder
+    static bool IsCompressedFormat(TextureObject::InternalFormat internalFormat);
+
+    // Check if the format is BC1 or BC3, that need GL_EXT_texture_compression_s3tc to be uploaded
+    static bool IsS3TCFormat(TextureObject::InternalFormat compressedFormat);
+
+    // Get the size in bytes of each 4x4 block: 8 for BC1 and BC4, 16 for BC3 and BC5
+    static unsigned int GetBlockSize(TextureObject::InternalFormat compressedFormat);
+
+    // Get the size in bytes of a compressed image with these dimensions
+    static unsigned int GetCompressedSize(TextureObject::InternalFormat compressedFormat, int width, int height);
+
+    // Encode 8-bit image data with componentCount channels into compressedData, that must be GetCompressedSize() bytes
+    // If threadCount is 0, the number of hardware threads is used
+    static void Compress(TextureObject::InternalFormat compressedFormat, std::span<const std::byte> data,
+        int width, int height, int componentCount, std::span<std::byte> compressedData, unsigned int threadCount = 0);
+
+    // Same, encoding the rows of blocks as jobs of the system, instead of starting threads for each image
+    static void Compress(TextureObject::InternalFormat compressedFormat, std::span<const std::byte> data,
+        int width, int height, int componentCount, std::span<std::byte> compressedData, JobSystem& jobSystem);
+
+private:
+    // Encode all the blocks in the rows [firstRow, lastRow)
+    static void CompressRows(TextureObject::InternalFormat compressedFormat, const unsigned char* data,
+        int width, int height, int componentCount, unsigned char* compressedData, int firstRow, int lastRow);
+};
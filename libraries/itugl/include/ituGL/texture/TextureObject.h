@@ -3,6 +3,20 @@
 #include <ituGL/core/Object.h>
 #include <span>
 
+// S3TC formats are not part of the core profile, they come from EXT_texture_compression_s3tc and EXT_texture_sRGB
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 // Abstract OpenGL object that encapsulates a Texture
 // There are different subtypes depending on the target
 class TextureObject : public Object
@@ -229,6 +243,13 @@ enum TextureObject::InternalFormat : GLint
     InternalFormatRGBACompressed = GL_COMPRESSED_RGBA,
     InternalFormatSRGBCompressed = GL_COMPRESSED_SRGB,
     InternalFormatSRGBACompressed = GL_COMPRESSED_SRGB_ALPHA,
+    // Block compressed
+    InternalFormatRBC4 = GL_COMPRESSED_RED_RGTC1,
+    InternalFormatRGBC5 = GL_COMPRESSED_RG_RGTC2,
+    InternalFormatRGBBC1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+    InternalFormatRGBABC3 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+    InternalFormatSRGBBC1 = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+    InternalFormatSRGBABC3 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
     // Depth Stencil
     InternalFormatDepth = GL_DEPTH_COMPONENT,
     InternalFormatDepth16 = GL_DEPTH_COMPONENT16,
@@ -27,5 +27,9 @@ public:
     void BeginFrame();
     void EndFrame();
 
+    // EndFrame in two steps: build the frame without OpenGL calls, then draw it, for example after rendering the scene
+    void BuildFrame();
+    void DrawFrame();
+
     Window UseWindow(const char* name);
 };
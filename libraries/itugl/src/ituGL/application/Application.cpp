@@ -1,15 +1,41 @@
 #include <ituGL/application/Application.h>
 
+#include <ituGL/scene/Transform.h>
+#include <ituGL/shader/Material.h>
+
 // For breaking execution in debug when an unexpected condition is found
 #include <cassert>
 // For accurate application time
 #include <chrono>
 // For error messages
 #include <iostream>
+// For std::min
+#include <algorithm>
+
+// Fixed steps simulated in a frame at most. The time left is dropped, so a slow frame doesn't make the next ones slower
+static constexpr unsigned int MaxFixedStepCount = 5;
+
+// Frames drawn after the one with the input, in render on demand mode. The GUI shows some changes a frame later
+static constexpr unsigned int InputRedrawFrameCount = 1;
 
 // DeviceGL and main Window are constructed in the correct order because they were declared like that!
 Application::Application(int width, int height, const char* title)
-    : m_mainWindow(width, height, title), m_exitCode(0)
+    : m_mainWindow(width, height, title)
+    , m_currentTime(0.0f)
+    , m_deltaTime(0.0f)
+    , m_fixedTimeStep(0.0f)
+    , m_accumulatedTime(0.0f)
+    , m_pipelined(false)
+    , m_workerBusy(false)
+    , m_workerStopping(false)
+    , m_renderOnDemand(false)
+    , m_minRefreshRate(0.0f)
+    , m_redrawRequested(false)
+    , m_pendingRedrawCount(0)
+    , m_lastEventCount(0)
+    , m_lastTransformVersion(0)
+    , m_lastMaterialVersion(0)
+    , m_exitCode(0)
 {
     // If the main window is not valid, exit with error
     if (!m_mainWindow.IsValid())
@@ -30,6 +56,8 @@ Application::Application(int width, int height, const char* title)
 
 Application::~Application()
 {
+    SetPipelined(false);
+
     // If something didn't go as expected, display an error message
     if (m_exitCode)
     {
@@ -50,19 +78,39 @@ int Application::Run()
         // Main loop
         while (IsRunning())
         {
+            if (IsRenderOnDemand())
+            {
+                WaitForRedraw();
+            }
+
             // set current time relative to start time
             std::chrono::duration<float> duration = std::chrono::steady_clock::now() - startTime;
             UpdateTime(duration.count());
 
-            Update();
+            ProcessInput();
 
-            Render();
+            if (m_pipelined)
+            {
+                // The worker prepares the next frame while this one is rendered
+                StartWorker();
+                Render();
+                WaitWorker();
+                Synchronize();
+            }
+            else
+            {
+                UpdateFrame();
+                Synchronize();
+                Render();
+            }
 
             // Swap buffers and poll events at the end of the frame
             m_mainWindow.SwapBuffers();
             m_device.PollEvents();
         }
 
+        SetPipelined(false);
+
         Cleanup();
     }
 
@@ -74,7 +122,7 @@ void Application::Initialize()
 {
 }
 
-void Application::Update()
+void Application::ProcessInput()
 {
     if (m_mainWindow.IsKeyPressed(GLFW_KEY_ESCAPE))
     {
@@ -82,6 +130,18 @@ void Application::Update()
     }
 }
 
+void Application::Update()
+{
+}
+
+void Application::ExtractFrame()
+{
+}
+
+void Application::Synchronize()
+{
+}
+
 void Application::Render()
 {
 }
@@ -116,6 +176,146 @@ void Application::UpdateTime(float newCurrentTime)
     m_currentTime = newCurrentTime;
 }
 
+void Application::UpdateFrame()
+{
+    if (m_fixedTimeStep > 0.0f)
+    {
+        m_accumulatedTime += m_deltaTime;
+        unsigned int stepCount = 0;
+        while (m_accumulatedTime >= m_fixedTimeStep && stepCount < MaxFixedStepCount)
+        {
+            Update();
+            m_accumulatedTime -= m_fixedTimeStep;
+            ++stepCount;
+        }
+        m_accumulatedTime = std::min(m_accumulatedTime, m_fixedTimeStep);
+    }
+    else
+    {
+        Update();
+    }
+
+    ExtractFrame();
+}
+
+void Application::RequestRedraw()
+{
+    m_redrawRequested.store(true, std::memory_order_relaxed);
+    if (m_renderOnDemand.load(std::memory_order_relaxed))
+    {
+        m_device.PostEmptyEvent();
+    }
+}
+
+void Application::SetRenderOnDemand(bool renderOnDemand)
+{
+    m_pendingRedrawCount = 0;
+    m_lastEventCount = m_mainWindow.GetEventCount();
+    m_lastTransformVersion = Transform::GetLastVersion();
+    m_lastMaterialVersion = Material::GetLastVersion();
+    m_renderOnDemand.store(renderOnDemand, std::memory_order_relaxed);
+}
+
+void Application::WaitForRedraw()
+{
+    // A change is drawn in the next frame, or in the one after it if the frame is prepared while the previous one renders
+    unsigned int frameLatency = m_pipelined ? 2 : 1;
+
+    unsigned int eventCount = m_mainWindow.GetEventCount();
+    if (eventCount != m_lastEventCount)
+    {
+        m_pendingRedrawCount = std::max(m_pendingRedrawCount, frameLatency + InputRedrawFrameCount);
+        m_lastEventCount = eventCount;
+    }
+
+    std::uint64_t transformVersion = Transform::GetLastVersion();
+    std::uint64_t materialVersion = Material::GetLastVersion();
+    bool redrawRequested = m_redrawRequested.exchange(false, std::memory_order_relaxed);
+    if (redrawRequested || transformVersion != m_lastTransformVersion || materialVersion != m_lastMaterialVersion)
+    {
+        m_pendingRedrawCount = std::max(m_pendingRedrawCount, frameLatency);
+        m_lastTransformVersion = transformVersion;
+        m_lastMaterialVersion = materialVersion;
+    }
+
+    if (m_pendingRedrawCount > 0)
+    {
+        --m_pendingRedrawCount;
+        return;
+    }
+
+    // Nothing changed. The events that wake it up are counted in the next call
+    auto waitStartTime = std::chrono::steady_clock::now();
+    m_device.WaitEvents(m_minRefreshRate > 0.0f ? 1.0 / m_minRefreshRate : 0.0);
+    std::chrono::duration<float> waitDuration = std::chrono::steady_clock::now() - waitStartTime;
+
+    // Move the current time forward, so the next delta time doesn't include the wait
+    m_currentTime += waitDuration.count();
+
+    // The frame drawn after waking up is prepared in this one if pipelined
+    m_pendingRedrawCount = frameLatency - 1;
+}
+
+void Application::SetPipelined(bool pipelined)
+{
+    if (pipelined == m_pipelined)
+    {
+        return;
+    }
+
+    // Only called from the main thread, so the worker is idle
+    m_pipelined = pipelined;
+    if (pipelined)
+    {
+        m_workerStopping = false;
+        m_workerThread = std::thread(&Application::WorkerLoop, this);
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_workerMutex);
+            m_workerStopping = true;
+        }
+        m_workerCondition.notify_all();
+        m_workerThread.join();
+    }
+}
+
+void Application::StartWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_workerMutex);
+        m_workerBusy = true;
+    }
+    m_workerCondition.notify_all();
+}
+
+void Application::WaitWorker()
+{
+    std::unique_lock<std::mutex> lock(m_workerMutex);
+    m_workerCondition.wait(lock, [this] { return !m_workerBusy; });
+}
+
+void Application::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_workerMutex);
+    while (true)
+    {
+        m_workerCondition.wait(lock, [this] { return m_workerStopping || m_workerBusy; });
+        if (m_workerStopping)
+        {
+            break;
+        }
+
+        lock.unlock();
+        UpdateFrame();
+        lock.lock();
+
+        m_workerBusy = false;
+        m_workerCondition.notify_all();
+    }
+}
+
 bool Application::IsRunning() const
 {
     // Run while the window is valid and it has not been requested to close
@@ -1,7 +1,7 @@
 #include <ituGL/application/Window.h>
 
 // Create the internal GLFW window. We provide some hints about it to OpenGL
-Window::Window(int width, int height, const char* title) : m_window(nullptr)
+Window::Window(int width, int height, const char* title) : m_window(nullptr), m_eventCount(0)
 {
     // Set some hints for window creation
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -10,6 +10,21 @@ Window::Window(int width, int height, const char* title) : m_window(nullptr)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
     m_window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+
+    // Count any event that can change what is displayed
+    if (m_window)
+    {
+        glfwSetWindowUserPointer(m_window, this);
+        glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int) { CountEvent(window); });
+        glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int) { CountEvent(window); });
+        glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int) { CountEvent(window); });
+        glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double) { CountEvent(window); });
+        glfwSetCursorEnterCallback(m_window, [](GLFWwindow* window, int) { CountEvent(window); });
+        glfwSetScrollCallback(m_window, [](GLFWwindow* window, double, double) { CountEvent(window); });
+        glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int) { CountEvent(window); });
+        glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int, int) { CountEvent(window); });
+        glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window) { CountEvent(window); });
+    }
 }
 
 // If we have an internal GLFW window, destroy it
@@ -21,6 +36,15 @@ Window::~Window()
     }
 }
 
+// Callbacks of the internal window only get the GLFW window, the object is stored in its user pointer
+void Window::CountEvent(GLFWwindow* window)
+{
+    if (Window* windowObject = static_cast<Window*>(glfwGetWindowUserPointer(window)))
+    {
+        ++windowObject->m_eventCount;
+    }
+}
+
 // Get the current dimensions (width and height) of the window
 void Window::GetDimensions(int& width, int& height) const
 {
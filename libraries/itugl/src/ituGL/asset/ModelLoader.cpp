@@ -1,16 +1,31 @@
 #include <ituGL/asset/ModelLoader.h>
 
 #include <ituGL/geometry/VertexFormat.h>
+#include <ituGL/geometry/MeshOptimizer.h>
+#include <ituGL/geometry/MeshSimplifier.h>
 #include <ituGL/shader/Material.h>
 #include <ituGL/asset/Texture2DLoader.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <limits>
 #include <iostream>
 
 ModelLoader::ModelLoader(std::shared_ptr<Material> referenceMaterial)
     : m_referenceMaterial(referenceMaterial)
     , m_createMaterials(false)
+    , m_compactVertices(false)
+    , m_quantizePositions(false)
+    , m_optimizeMeshes(false)
+    , m_lodCount(0)
+    , m_lodReduction(0.5f)
+    , m_occluderReduction(0.0f)
+    , m_positionStream(false)
 {
     m_textureLoader.SetGenerateMipmap(true);
 }
@@ -38,6 +53,88 @@ void ModelLoader::SetCreateMaterials(bool createMaterials)
     m_createMaterials = createMaterials;
 }
 
+bool ModelLoader::GetCompactVertices() const
+{
+    return m_compactVertices;
+}
+
+void ModelLoader::SetCompactVertices(bool compactVertices)
+{
+    m_compactVertices = compactVertices;
+}
+
+bool ModelLoader::GetQuantizePositions() const
+{
+    return m_quantizePositions;
+}
+
+void ModelLoader::SetQuantizePositions(bool quantizePositions)
+{
+    m_quantizePositions = quantizePositions;
+}
+
+bool ModelLoader::GetOptimizeMeshes() const
+{
+    return m_optimizeMeshes;
+}
+
+void ModelLoader::SetOptimizeMeshes(bool optimizeMeshes)
+{
+    m_optimizeMeshes = optimizeMeshes;
+}
+
+unsigned int ModelLoader::GetLodCount() const
+{
+    return m_lodCount;
+}
+
+void ModelLoader::SetLodCount(unsigned int lodCount)
+{
+    m_lodCount = lodCount;
+}
+
+float ModelLoader::GetLodReduction() const
+{
+    return m_lodReduction;
+}
+
+void ModelLoader::SetLodReduction(float lodReduction)
+{
+    assert(lodReduction > 0.0f && lodReduction < 1.0f);
+    m_lodReduction = lodReduction;
+}
+
+float ModelLoader::GetOccluderReduction() const
+{
+    return m_occluderReduction;
+}
+
+void ModelLoader::SetOccluderReduction(float occluderReduction)
+{
+    assert(occluderReduction >= 0.0f && occluderReduction <= 1.0f);
+    m_occluderReduction = occluderReduction;
+}
+
+bool ModelLoader::GetPositionStream() const
+{
+    return m_positionStream;
+}
+
+void ModelLoader::SetPositionStream(bool positionStream)
+{
+    m_positionStream = positionStream;
+}
+
+std::shared_ptr<GeometryArena> ModelLoader::GetGeometryArena() const
+{
+    return m_geometryArena;
+}
+
+void ModelLoader::SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena)
+{
+    m_geometryArena = geometryArena;
+}
+
 Texture2DLoader& ModelLoader::GetTexture2DLoader()
 {
     return m_textureLoader;
@@ -89,6 +186,7 @@ Model ModelLoader::Load(const char* path)
     {
         model.SetMesh(std::make_shared<Mesh>());
         Mesh& mesh = model.GetMesh();
+        mesh.SetGeometryArena(m_geometryArena);
         for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex)
         {
             aiMesh& meshData = *scene->mMeshes[meshIndex];
@@ -112,26 +210,296 @@ void ModelLoader::GenerateSubmesh(Mesh& mesh, const aiMesh& meshData)
     // Collect vertex data
     VertexFormat vertexFormat;
     bool interleaved = true;
-    std::vector<GLubyte> vertexData = CollectVertexData(meshData, vertexFormat, interleaved);
-    int vboIndex = mesh.AddVertexData<GLubyte>(vertexData);
+    glm::mat4 positionTransform;
+    std::vector<GLubyte> vertexData = CollectVertexData(meshData, vertexFormat, interleaved, positionTransform);
+    unsigned int vertexCount = meshData.mNumVertices;
+
+    // Positions in object space, used for the bounds, the simplification and the overdraw optimization
+    std::vector<glm::vec3> positions(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        positions[i] = glm::vec3(meshData.mVertices[i].x, meshData.mVertices[i].y, meshData.mVertices[i].z);
+    }
 
     // Collect element data
-    Data::Type elementType;
     std::vector<Drawcall::Primitive> primitives;
     std::vector<int> elementCounts;
-    std::vector<GLubyte> elementData = CollectElementData(meshData, elementType, primitives, elementCounts);
-    int eboIndex = mesh.AddElementData<GLubyte>(elementData);
+    std::vector<unsigned int> indices = CollectElementData(meshData, primitives, elementCounts);
 
-    // Add submeshes
+    // Bounds of each primitive group, computed before the vertices are reordered
+    std::vector<glm::vec4> boundingSpheres;
     int start = 0;
+    for (int end : elementCounts)
+    {
+        boundingSpheres.push_back(ComputeBoundingSphere(std::span<const unsigned int>(indices.data() + start, end - start), positions));
+        start = end;
+    }
+
+    if (m_occluderReduction > 0.0f)
+    {
+        GenerateOccluder(mesh, indices, positions, primitives, elementCounts);
+    }
+
+    // Simplified levels of detail are stored in the same element buffer, after the original elements
+    std::vector<LodRange> lods = GenerateLods(indices, positions, primitives, elementCounts);
+
+    // Optimize the triangle order before the indices are packed, and the vertex order to match it
+    if (m_optimizeMeshes && interleaved)
+    {
+        OptimizeMesh(positions, indices, primitives, elementCounts, lods, vertexData, vertexFormat.GetSize(), vertexCount);
+    }
+
+    // Positions copied after the vertex order is final, so the same drawcalls can use them
+    VertexFormat positionFormat;
+    std::vector<GLubyte> positionData;
+    if (m_positionStream && interleaved)
+    {
+        positionData = CollectPositionData(vertexFormat, vertexData, vertexCount, positionFormat);
+    }
+
+    // Store the data in the geometry arena, or in new buffers for this mesh
+    std::vector<unsigned int> submeshIndices;
+    Data::Type elementType = Data::Type::UInt;
+    if (mesh.GetGeometryArena() && interleaved)
+    {
+        GeometryArena::Handle arenaHandle = mesh.AddArenaData(vertexFormat, std::as_bytes(std::span(vertexData)), indices, m_materialAttributeMap,
+            std::as_bytes(std::span(positionData)));
+        elementType = mesh.GetGeometryArena()->GetElementType();
+
+        start = 0;
+        for (int i = 0; i < primitives.size(); ++i)
+        {
+            int end = elementCounts[i];
+            submeshIndices.push_back(mesh.AddArenaSubmesh(arenaHandle, primitives[i], start, end - start));
+            start = end;
+        }
+    }
+    else
+    {
+        int vboIndex = mesh.AddVertexData<GLubyte>(vertexData);
+
+        elementType = ElementBufferObject::GetSmallestType(vertexCount);
+        std::vector<GLubyte> elementData = PackElementData(indices, elementType);
+        int eboIndex = mesh.AddElementData<GLubyte>(elementData);
+
+        // One position VAO shared by all the primitive groups
+        int positionVaoIndex = -1;
+        if (!positionData.empty())
+        {
+            int positionVboIndex = mesh.AddVertexData<GLubyte>(positionData);
+            positionVaoIndex = mesh.AddVertexArray(positionVboIndex, eboIndex, positionFormat.LayoutBegin(static_cast<int>(vertexCount), true), positionFormat.LayoutEnd(), m_materialAttributeMap);
+        }
+
+        start = 0;
+        for (int i = 0; i < primitives.size(); ++i)
+        {
+            int end = elementCounts[i];
+            submeshIndices.push_back(mesh.AddSubmesh(primitives[i], start, end - start, elementType, vboIndex, eboIndex, vertexFormat.LayoutBegin(static_cast<int>(vertexCount), interleaved), vertexFormat.LayoutEnd(), m_materialAttributeMap));
+            if (positionVaoIndex >= 0)
+            {
+                mesh.SetSubmeshPositionVertexArray(submeshIndices.back(), positionVaoIndex);
+            }
+            start = end;
+        }
+    }
+
+    // Set the submesh properties
     assert(primitives.size() == elementCounts.size());
     for (int i = 0; i < primitives.size(); ++i)
     {
-        Drawcall::Primitive primitive = primitives[i];
+        unsigned int submeshIndex = submeshIndices[i];
+        mesh.SetSubmeshTransform(submeshIndex, positionTransform);
+        mesh.SetSubmeshBoundingSphere(submeshIndex, boundingSpheres[i]);
+        for (const LodRange& lod : lods)
+        {
+            if (lod.group == i)
+            {
+                mesh.AddSubmeshLod(submeshIndex, Drawcall(primitives[i], lod.count, elementType, lod.first), lod.error);
+            }
+        }
+    }
+}
+
+void ModelLoader::GenerateOccluder(Mesh& mesh, std::span<const unsigned int> indices, std::span<const glm::vec3> positions,
+    const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts) const
+{
+    std::vector<unsigned int> triangleIndices;
+    int start = 0;
+    for (int i = 0; i < primitives.size(); ++i)
+    {
         int end = elementCounts[i];
-        mesh.AddSubmesh(primitive, start, end - start, elementType, eboIndex, vboIndex, vertexFormat.LayoutBegin(static_cast<int>(vertexData.size()), interleaved), vertexFormat.LayoutEnd(), m_materialAttributeMap);
+        if (primitives[i] == Drawcall::Primitive::Triangles)
+        {
+            triangleIndices.insert(triangleIndices.end(), indices.begin() + start, indices.begin() + end);
+        }
         start = end;
     }
+
+    if (triangleIndices.empty())
+    {
+        return;
+    }
+
+    float error = 0.0f;
+    if (m_occluderReduction < 1.0f)
+    {
+        size_t targetIndexCount = static_cast<size_t>(triangleIndices.size() * m_occluderReduction) / 3 * 3;
+        triangleIndices = MeshSimplifier::Simplify(triangleIndices, positions, targetIndexCount, std::numeric_limits<float>::max(), error);
+    }
+
+    // Keep only the positions referenced by the remaining triangles
+    std::vector<unsigned int> remap(positions.size(), std::numeric_limits<unsigned int>::max());
+    std::vector<glm::vec3> occluderPositions;
+    for (unsigned int& index : triangleIndices)
+    {
+        if (remap[index] == std::numeric_limits<unsigned int>::max())
+        {
+            remap[index] = static_cast<unsigned int>(occluderPositions.size());
+            occluderPositions.push_back(positions[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.AddOccluder(occluderPositions, triangleIndices, error);
+}
+
+std::vector<ModelLoader::LodRange> ModelLoader::GenerateLods(std::vector<unsigned int>& indices, std::span<const glm::vec3> positions,
+    const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts) const
+{
+    std::vector<LodRange> lods;
+
+    int start = 0;
+    for (int i = 0; i < primitives.size(); ++i)
+    {
+        int end = elementCounts[i];
+        if (primitives[i] == Drawcall::Primitive::Triangles)
+        {
+            // Each level is simplified from the original triangles, so the errors don't accumulate
+            std::vector<unsigned int> groupIndices(indices.begin() + start, indices.begin() + end);
+            size_t previousCount = groupIndices.size();
+            float targetCount = static_cast<float>(groupIndices.size());
+            for (unsigned int lod = 0; lod < m_lodCount; ++lod)
+            {
+                targetCount *= m_lodReduction;
+                size_t targetIndexCount = static_cast<size_t>(targetCount) / 3 * 3;
+
+                float error;
+                std::vector<unsigned int> lodIndices = MeshSimplifier::Simplify(groupIndices, positions, targetIndexCount, std::numeric_limits<float>::max(), error);
+
+                // Stop when the simplification can't remove a significant amount of triangles
+                if (lodIndices.empty() || lodIndices.size() > previousCount * 9 / 10)
+                {
+                    break;
+                }
+
+                lods.push_back(LodRange{ i, static_cast<int>(indices.size()), static_cast<int>(lodIndices.size()), error });
+                indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+                previousCount = lodIndices.size();
+            }
+        }
+        start = end;
+    }
+
+    return lods;
+}
+
+void ModelLoader::OptimizeMesh(std::span<const glm::vec3> positions, std::vector<unsigned int>& indices,
+    const std::vector<Drawcall::Primitive>& primitives, const std::vector<int>& elementCounts, const std::vector<LodRange>& lods,
+    std::vector<GLubyte>& vertexData, size_t vertexSize, unsigned int& vertexCount)
+{
+    // Triangle lists to optimize: the primitive groups and their levels of detail
+    std::vector<std::pair<int, int>> ranges;
+    int start = 0;
+    for (int i = 0; i < primitives.size(); ++i)
+    {
+        if (primitives[i] == Drawcall::Primitive::Triangles)
+        {
+            ranges.emplace_back(start, elementCounts[i]);
+        }
+        start = elementCounts[i];
+    }
+    for (const LodRange& lod : lods)
+    {
+        ranges.emplace_back(lod.first, lod.first + lod.count);
+    }
+
+    std::vector<unsigned int> clusters;
+    for (const auto& range : ranges)
+    {
+        std::span<unsigned int> triangleIndices(indices.data() + range.first, range.second - range.first);
+        MeshOptimizer::CacheStatistics before = MeshOptimizer::AnalyzeVertexCache(triangleIndices, vertexCount);
+
+        MeshOptimizer::OptimizeVertexCache(triangleIndices, vertexCount, clusters);
+        MeshOptimizer::OptimizeOverdraw(triangleIndices, positions, clusters);
+
+        MeshOptimizer::CacheStatistics after = MeshOptimizer::AnalyzeVertexCache(triangleIndices, vertexCount);
+
+        // Running averages, weighted by the triangles of each range
+        unsigned int triangleCount = static_cast<unsigned int>(triangleIndices.size() / 3);
+        OptimizeStatistics& statistics = m_optimizeStatistics;
+        unsigned int totalCount = statistics.triangleCount + triangleCount;
+        if (totalCount > 0)
+        {
+            float weight = static_cast<float>(triangleCount) / static_cast<float>(totalCount);
+            statistics.acmrBefore += (before.acmr - statistics.acmrBefore) * weight;
+            statistics.acmrAfter += (after.acmr - statistics.acmrAfter) * weight;
+            statistics.atvrBefore += (before.atvr - statistics.atvrBefore) * weight;
+            statistics.atvrAfter += (after.atvr - statistics.atvrAfter) * weight;
+            statistics.triangleCount = totalCount;
+        }
+    }
+
+    // Vertices are stored in the order they are first used, for all the primitive groups
+    vertexCount = MeshOptimizer::OptimizeVertexFetch(indices, vertexData, vertexSize);
+}
+
+std::vector<GLubyte> ModelLoader::CollectPositionData(const VertexFormat& vertexFormat, std::span<const GLubyte> vertexData,
+    unsigned int vertexCount, VertexFormat& positionFormat)
+{
+    std::vector<GLubyte> positionData;
+
+    int positionIndex = vertexFormat.FindAttribute(VertexAttribute::Semantic::Position);
+    if (positionIndex < 0)
+    {
+        return positionData;
+    }
+
+    // Same type as in the full vertex, so quantized positions are decoded with the same submesh transform
+    VertexAttribute positionAttribute = vertexFormat.GetAttribute(positionIndex);
+    positionFormat.Clear();
+    positionFormat.AddVertexAttribute(positionAttribute.GetType(), positionAttribute.GetComponents(), positionAttribute.IsNormalized(), VertexAttribute::Semantic::Position);
+
+    size_t positionSize = positionAttribute.GetSize();
+    size_t offset = vertexFormat.GetAttributeOffset(positionIndex);
+    positionData.resize(vertexCount * positionSize);
+    CopyBuffer(positionData.data(), positionSize, vertexData.data() + offset, vertexFormat.GetSize(), vertexCount, positionSize);
+
+    return positionData;
+}
+
+glm::vec4 ModelLoader::ComputeBoundingSphere(std::span<const unsigned int> indices, std::span<const glm::vec3> positions)
+{
+    if (indices.empty())
+    {
+        return glm::vec4(0.0f);
+    }
+
+    // Center of the bounding box, and the distance to the furthest vertex
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (unsigned int index : indices)
+    {
+        minPosition = glm::min(minPosition, positions[index]);
+        maxPosition = glm::max(maxPosition, positions[index]);
+    }
+    glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+
+    float radius = 0.0f;
+    for (unsigned int index : indices)
+    {
+        radius = std::max(radius, glm::distance(center, positions[index]));
+    }
+    return glm::vec4(center, radius);
 }
 
 std::shared_ptr<Material> ModelLoader::GenerateMaterial(const aiMaterial& materialData)
@@ -173,7 +541,9 @@ std::shared_ptr<Material> ModelLoader::GenerateMaterial(const aiMaterial& materi
             LoadTexture(materialData, aiTextureType_DIFFUSE, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
             break;
         case MaterialProperty::NormalTexture:
-            LoadTexture(materialData, aiTextureType_NORMALS, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatRGB8);
+            // When compressing, keep only XY of the normal map (BC5). Z is reconstructed in the shader
+            LoadTexture(materialData, aiTextureType_NORMALS, *material, location, TextureObject::FormatRGB,
+                m_textureLoader.GetCompress() ? TextureObject::InternalFormatRG8 : TextureObject::InternalFormatRGB8);
             break;
         case MaterialProperty::SpecularTexture:
             LoadTexture(materialData, aiTextureType_SHININESS, *material, location, TextureObject::FormatRGB, TextureObject::InternalFormatSRGB8);
@@ -202,8 +572,15 @@ void ModelLoader::LoadTexture(const aiMaterial& materialData, int textureTypeVal
     }
 }
 
-std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved)
+std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, glm::mat4& positionTransform) const
 {
+    if (m_compactVertices)
+    {
+        return CollectCompactVertexData(meshData, vertexFormat, interleaved, positionTransform);
+    }
+
+    positionTransform = glm::mat4(1.0f);
+
     vertexFormat.Clear();
 
     // Buid the vertex format with the available vertex data
@@ -252,49 +629,222 @@ std::vector<GLubyte> ModelLoader::CollectVertexData(const aiMesh& meshData, Vert
     return vertexData;
 }
 
-std::vector<GLubyte> ModelLoader::CollectElementData(const aiMesh& meshData, Data::Type& elementType,
-    std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts)
+std::vector<GLubyte> ModelLoader::CollectCompactVertexData(const aiMesh& meshData, VertexFormat& vertexFormat, bool interleaved, glm::mat4& positionTransform) const
 {
-    std::vector<GLubyte> elementData;
+    vertexFormat.Clear();
 
-    elementType = ElementBufferObject::GetSmallestType(meshData.mNumVertices);
-    int elementSize = Data::GetTypeSize(elementType);
+    // Positions are quantized relative to the submesh bounds, with the same scale in all axes
+    // This way, the decoding matrix can be applied together with the world matrix without distorting the normals
+    glm::vec3 positionMin(0.0f);
+    float positionScale = 1.0f;
+    positionTransform = glm::mat4(1.0f);
 
-    //Reserve max possible size
-    elementData.reserve(meshData.mNumFaces * elementSize * 3);
+    // Buid the vertex format with the available vertex data
 
-    int numIndices = 0;
-    for (unsigned int faceIndex = 0; faceIndex < meshData.mNumFaces; ++faceIndex)
+    assert(meshData.HasPositions());
+    if (m_quantizePositions)
     {
-        aiFace& face = meshData.mFaces[faceIndex];
+        glm::vec3 positionMax(std::numeric_limits<float>::lowest());
+        positionMin = glm::vec3(std::numeric_limits<float>::max());
+        for (unsigned int i = 0; i < meshData.mNumVertices; ++i)
+        {
+            glm::vec3 position(meshData.mVertices[i].x, meshData.mVertices[i].y, meshData.mVertices[i].z);
+            positionMin = glm::min(positionMin, position);
+            positionMax = glm::max(positionMax, position);
+        }
+        glm::vec3 extent = positionMax - positionMin;
+        positionScale = std::max(std::max(extent.x, extent.y), extent.z);
+        if (positionScale <= 0.0f)
+        {
+            positionScale = 1.0f;
+        }
+        positionTransform = glm::scale(glm::translate(glm::mat4(1.0f), positionMin), glm::vec3(positionScale));
 
-        int currentSize = static_cast<int>(elementData.size());
-        elementData.resize(currentSize + face.mNumIndices * elementSize);
+        // 4 components to keep the attribute aligned
+        vertexFormat.AddVertexAttribute<GLushort>(4, true, VertexAttribute::Semantic::Position);
+    }
+    else
+    {
+        vertexFormat.AddVertexAttribute<float>(3, VertexAttribute::Semantic::Position);
+    }
+    if (meshData.HasNormals())
+    {
+        vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Normal);
+    }
+    if (meshData.HasTangentsAndBitangents())
+    {
+        // Bitangent is reconstructed in the shader, using the sign stored in W
+        vertexFormat.AddVertexAttribute(Data::Type::Int2101010Rev, 4, true, VertexAttribute::Semantic::Tangent);
+    }
+    unsigned int colorSemantic = static_cast<unsigned int>(VertexAttribute::Semantic::Color0);
+    for (unsigned int colorChannel = 0; colorChannel < meshData.GetNumColorChannels(); ++colorChannel)
+    {
+        vertexFormat.AddVertexAttribute<GLubyte>(4, true, static_cast<VertexAttribute::Semantic>(colorSemantic + colorChannel));
+    }
+    unsigned int uvSemantic = static_cast<unsigned int>(VertexAttribute::Semantic::TexCoord0);
+    for (unsigned int uvChannel = 0; uvChannel < meshData.GetNumUVChannels(); ++uvChannel)
+    {
+        // 3D texture coordinates are padded to 4 components to keep the attribute aligned
+        int components = meshData.mNumUVComponents[uvChannel] > 2 ? 4 : 2;
+        vertexFormat.AddVertexAttribute(Data::Type::Half, components, false, static_cast<VertexAttribute::Semantic>(uvSemantic + uvChannel));
+    }
 
-        void* dstBuffer = &elementData[currentSize];
-        unsigned int dstStride = elementSize;
-        const void* srcBuffer = face.mIndices;
-        unsigned int srcStride = sizeof(*face.mIndices);
+    std::vector<GLubyte> vertexData;
+    vertexData.resize(vertexFormat.GetSize() * meshData.mNumVertices);
 
-        if (std::endian::native == std::endian::big)
+    // Pack each attribute, converting from the float data
+    auto it = vertexFormat.LayoutBegin(meshData.mNumVertices, interleaved);
+    auto itEnd = vertexFormat.LayoutEnd();
+    for (; it != itEnd; it++)
+    {
+        const VertexAttribute& attribute = it->GetAttribute();
+        int dstStride = it->GetStride() != 0 ? it->GetStride() : attribute.GetSize();
+        GLubyte* dstBuffer = &vertexData[it->GetOffset()];
+        VertexAttribute::Semantic semantic = attribute.GetSemantic();
+        switch (semantic)
         {
-            intptr_t srcAddress = reinterpret_cast<intptr_t>(srcBuffer);
-            srcAddress += srcStride - elementSize;
-            srcBuffer = reinterpret_cast<const void*>(srcAddress);
+        case VertexAttribute::Semantic::Position:
+            for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBuffer += dstStride)
+            {
+                glm::vec3 position(meshData.mVertices[i].x, meshData.mVertices[i].y, meshData.mVertices[i].z);
+                if (m_quantizePositions)
+                {
+                    glm::vec3 quantized = glm::round(glm::clamp((position - positionMin) / positionScale, 0.0f, 1.0f) * 65535.0f);
+                    GLushort packed[4] = { static_cast<GLushort>(quantized.x), static_cast<GLushort>(quantized.y), static_cast<GLushort>(quantized.z), 0 };
+                    memcpy(dstBuffer, packed, sizeof(packed));
+                }
+                else
+                {
+                    memcpy(dstBuffer, &position, sizeof(position));
+                }
+            }
+            break;
+        case VertexAttribute::Semantic::Normal:
+            for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBuffer += dstStride)
+            {
+                glm::vec3 normal(meshData.mNormals[i].x, meshData.mNormals[i].y, meshData.mNormals[i].z);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : normal;
+                GLuint packed = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+                memcpy(dstBuffer, &packed, sizeof(packed));
+            }
+            break;
+        case VertexAttribute::Semantic::Tangent:
+            for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBuffer += dstStride)
+            {
+                glm::vec3 normal = meshData.HasNormals() ? glm::vec3(meshData.mNormals[i].x, meshData.mNormals[i].y, meshData.mNormals[i].z) : glm::vec3(0.0f);
+                glm::vec3 tangent(meshData.mTangents[i].x, meshData.mTangents[i].y, meshData.mTangents[i].z);
+                glm::vec3 bitangent(meshData.mBitangents[i].x, meshData.mBitangents[i].y, meshData.mBitangents[i].z);
+                float length = glm::length(tangent);
+                tangent = length > 0.0f ? tangent / length : tangent;
+                float sign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+                GLuint packed = glm::packSnorm3x10_1x2(glm::vec4(tangent, sign));
+                memcpy(dstBuffer, &packed, sizeof(packed));
+            }
+            break;
+        case VertexAttribute::Semantic::TexCoord0:
+        case VertexAttribute::Semantic::TexCoord1:
+        case VertexAttribute::Semantic::TexCoord2:
+        case VertexAttribute::Semantic::TexCoord3:
+        case VertexAttribute::Semantic::TexCoord4:
+        case VertexAttribute::Semantic::TexCoord5:
+        case VertexAttribute::Semantic::TexCoord6:
+        case VertexAttribute::Semantic::TexCoord7:
+            {
+                unsigned int uvChannel = static_cast<unsigned int>(semantic) - uvSemantic;
+                const aiVector3D* texCoords = meshData.mTextureCoords[uvChannel];
+                for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBuffer += dstStride)
+                {
+                    GLushort packed[4] = { glm::packHalf1x16(texCoords[i].x), glm::packHalf1x16(texCoords[i].y), glm::packHalf1x16(texCoords[i].z), 0 };
+                    memcpy(dstBuffer, packed, attribute.GetSize());
+                }
+            }
+            break;
+        case VertexAttribute::Semantic::Color0:
+        case VertexAttribute::Semantic::Color1:
+        case VertexAttribute::Semantic::Color2:
+        case VertexAttribute::Semantic::Color3:
+        case VertexAttribute::Semantic::Color4:
+        case VertexAttribute::Semantic::Color5:
+        case VertexAttribute::Semantic::Color6:
+        case VertexAttribute::Semantic::Color7:
+            {
+                unsigned int colorChannel = static_cast<unsigned int>(semantic) - colorSemantic;
+                const aiColor4D* colors = meshData.mColors[colorChannel];
+                for (unsigned int i = 0; i < meshData.mNumVertices; ++i, dstBuffer += dstStride)
+                {
+                    glm::vec4 color = glm::round(glm::clamp(glm::vec4(colors[i].r, colors[i].g, colors[i].b, colors[i].a), 0.0f, 1.0f) * 255.0f);
+                    GLubyte packed[4] = { static_cast<GLubyte>(color.r), static_cast<GLubyte>(color.g), static_cast<GLubyte>(color.b), static_cast<GLubyte>(color.a) };
+                    memcpy(dstBuffer, packed, sizeof(packed));
+                }
+            }
+            break;
+        default:
+            assert(false);
+            break;
         }
-        CopyBuffer(dstBuffer, dstStride, srcBuffer, srcStride, face.mNumIndices, elementSize);
+    }
+
+    return vertexData;
+}
+
+std::vector<unsigned int> ModelLoader::CollectElementData(const aiMesh& meshData,
+    std::vector<Drawcall::Primitive>& primitives, std::vector<int>& elementCounts)
+{
+    std::vector<unsigned int> indices;
+
+    //Reserve max possible size
+    indices.reserve(meshData.mNumFaces * 3);
+
+    int numIndices = 0;
+    for (unsigned int faceIndex = 0; faceIndex < meshData.mNumFaces; ++faceIndex)
+    {
+        aiFace& face = meshData.mFaces[faceIndex];
+
+        int currentCount = static_cast<int>(indices.size());
+        indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
 
         if (numIndices != face.mNumIndices)
         {
             numIndices = face.mNumIndices;
             primitives.push_back(GetPrimitiveType(face.mNumIndices));
-            if (currentSize > 0)
+            if (currentCount > 0)
+            {
+                elementCounts.push_back(currentCount);
+            }
+        }
+    }
+    elementCounts.push_back(static_cast<int>(indices.size()));
+
+    return indices;
+}
+
+std::vector<GLubyte> ModelLoader::PackElementData(const std::vector<unsigned int>& indices, Data::Type elementType)
+{
+    int elementSize = Data::GetTypeSize(elementType);
+    std::vector<GLubyte> elementData(indices.size() * elementSize);
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        switch (elementType)
+        {
+        case Data::Type::UByte:
+            elementData[i] = static_cast<GLubyte>(indices[i]);
+            break;
+        case Data::Type::UShort:
             {
-                elementCounts.push_back(currentSize);
+                GLushort index = static_cast<GLushort>(indices[i]);
+                memcpy(&elementData[i * elementSize], &index, elementSize);
             }
+            break;
+        case Data::Type::UInt:
+            memcpy(&elementData[i * elementSize], &indices[i], elementSize);
+            break;
+        default:
+            assert(false);
+            break;
         }
     }
-    elementCounts.push_back(static_cast<int>(elementData.size()));
 
     return elementData;
 }
@@ -381,10 +931,13 @@ Drawcall::Primitive ModelLoader::GetPrimitiveType(int elementCount)
     {
     case 1:
         primitive = Drawcall::Primitive::Points;
+        break;
     case 2:
         primitive = Drawcall::Primitive::Lines;
+        break;
     case 3:
         primitive = Drawcall::Primitive::Triangles;
+        break;
     }
     return primitive;
 }
@@ -1,14 +1,90 @@
 #include <ituGL/asset/ShaderLoader.h>
 
+#include <ituGL/core/DeviceGL.h>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <array>
+#include <unordered_set>
+#include <string_view>
 #include <cassert>
 
 #include <iostream>
 
-ShaderLoader::ShaderLoader(Shader::Type type) : m_type(type)
+namespace
+{
+    // Append the lines of the file to source, replacing the includes with the contents of the included files
+    // includedFiles contains the canonical paths of the files already added
+    bool PreprocessFile(const std::filesystem::path& path, std::unordered_set<std::string>& includedFiles,
+        const std::string& defineSource, bool& definesInserted, std::string& source)
+    {
+        std::error_code error;
+        std::string canonicalPath = std::filesystem::weakly_canonical(path, error).string();
+        if (!includedFiles.insert(canonicalPath).second)
+        {
+            return true;
+        }
+
+        // Files are numbered in the order they are added, and the number is the source string in the compilation errors
+        // #line can't go before #version, so the lines are only tracked after it
+        size_t fileIndex = includedFiles.size() - 1;
+        auto addLineDirective = [&](unsigned int lineNumber)
+        {
+            if (definesInserted)
+            {
+                source += "#line " + std::to_string(lineNumber) + " " + std::to_string(fileIndex) + " // " + path.generic_string() + '\n';
+            }
+        };
+        addLineDirective(1);
+
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_FOUND " << path.string() << std::endl;
+            return false;
+        }
+
+        bool success = true;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            ++lineNumber;
+            size_t start = line.find_first_not_of(" \t");
+            std::string_view directive = start != std::string::npos ? std::string_view(line).substr(start) : std::string_view();
+
+            if (directive.starts_with("#include"))
+            {
+                size_t nameStart = directive.find('"');
+                size_t nameEnd = nameStart != std::string_view::npos ? directive.find('"', nameStart + 1) : std::string_view::npos;
+                if (nameEnd == std::string_view::npos)
+                {
+                    std::cout << "ERROR::SHADER::INVALID_INCLUDE " << path.string() << ": " << line << std::endl;
+                    success = false;
+                    continue;
+                }
+                std::filesystem::path includePath = path.parent_path() / directive.substr(nameStart + 1, nameEnd - nameStart - 1);
+                success &= PreprocessFile(includePath, includedFiles, defineSource, definesInserted, source);
+                addLineDirective(lineNumber + 1);
+                continue;
+            }
+
+            source += line;
+            source += '\n';
+
+            if (!definesInserted && directive.starts_with("#version"))
+            {
+                source += defineSource;
+                definesInserted = true;
+                addLineDirective(lineNumber + 1);
+            }
+        }
+        return success;
+    }
+}
+
+ShaderLoader::ShaderLoader(Shader::Type type) : m_type(type), m_async(false)
 {
 }
 
@@ -24,31 +100,29 @@ bool ShaderLoader::IsValid(std::span<const char*> paths)
 
 Shader ShaderLoader::Load(const char* path)
 {
-    Shader shader(m_type);
-    std::ifstream file(path);
-    assert(file.is_open());
-    std::stringstream stringStream;
-    stringStream << file.rdbuf() << '\0';
-    shader.SetSource(stringStream.str().c_str());
-    Compile(shader);
-    return shader;
+    return Load(std::span<const char*>(&path, 1));
 }
 
 Shader ShaderLoader::Load(std::span<const char*> paths)
+{
+    if (!m_spirvDirectory.empty())
+    {
+        Shader shader(m_type);
+        if (LoadSpirv(shader, paths))
+        {
+            return shader;
+        }
+    }
+
+    std::string sourceCode = Preprocess(paths);
+    const char* sources[] = { sourceCode.c_str() };
+    return LoadSources(sources);
+}
+
+Shader ShaderLoader::LoadSources(std::span<const char*> sources)
 {
     Shader shader(m_type);
-    std::vector<std::stringstream> stringStreams(paths.size());
-    std::vector<std::string> sourceCodeStrings(paths.size());
-    std::vector<const char*> sourceCode(paths.size());
-    for (int i = 0; i < paths.size(); ++i)
-    {
-        std::ifstream file(paths[i]);
-        assert(file.is_open());
-        stringStreams[i] << file.rdbuf() << '\0';
-        sourceCodeStrings[i] = stringStreams[i].str();
-        sourceCode[i] = sourceCodeStrings[i].c_str();
-    }
-    shader.SetSource(sourceCode);
+    shader.SetSource(sources);
     Compile(shader);
     return shader;
 }
@@ -73,9 +147,66 @@ bool ShaderLoader::LoadInto(Shader& shader, std::span<const char*> paths)
     return valid;
 }
 
+bool ShaderLoader::LoadSpirv(Shader& shader, std::span<const char*> paths, std::span<const char* const> defines)
+{
+    assert(!paths.empty());
+    const DeviceGL* device = DeviceGL::GetInstancePointer();
+    if (!device || !device->IsSpirvSupported() || m_spirvDirectory.empty())
+    {
+        return false;
+    }
+
+    // Each set of keywords is a different module, as the sources remove the code of the other keywords with #if
+    std::filesystem::path modulePath = std::filesystem::path(m_spirvDirectory) / std::filesystem::path(paths.back()).filename();
+    for (const char* define : defines)
+    {
+        modulePath += '.';
+        modulePath += define;
+    }
+    modulePath += ".spv";
+    std::ifstream file(modulePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> words(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(uint32_t));
+
+    const uint32_t SpirvMagic = 0x07230203;
+    if (!file || words.empty() || words[0] != SpirvMagic)
+    {
+        std::cout << "WARNING::SHADER::INVALID_SPIRV_MODULE " << modulePath.string() << std::endl;
+        return false;
+    }
+
+    shader.SetBinary(GL_SHADER_BINARY_FORMAT_SPIR_V, std::as_bytes(std::span(words)));
+    bool compiled = shader.Specialize("main", {}, {});
+    if (!m_async && !compiled)
+    {
+        CheckCompilation(shader);
+    }
+    return true;
+}
+
 void ShaderLoader::Compile(Shader& shader)
 {
-    if (!shader.Compile())
+    if (m_async)
+    {
+        shader.CompileAsync();
+    }
+    else
+    {
+        shader.Compile();
+        CheckCompilation(shader);
+    }
+}
+
+bool ShaderLoader::CheckCompilation(const Shader& shader)
+{
+    bool compiled = shader.IsCompiled();
+    if (!compiled)
     {
         std::array<char, 512> infoLog;
         shader.GetCompilationErrors(infoLog);
@@ -104,6 +235,7 @@ void ShaderLoader::Compile(Shader& shader)
         }
         std::cout << "ERROR::SHADER::" << typeName << "::COMPILATION_FAILED\n" << infoLog.data() << std::endl;
     }
+    return compiled;
 }
 
 Shader ShaderLoader::Load(Shader::Type type, const char* path)
@@ -111,3 +243,36 @@ Shader ShaderLoader::Load(Shader::Type type, const char* path)
     ShaderLoader shaderLoader(type);
     return shaderLoader.Load(path);
 }
+
+std::string ShaderLoader::Preprocess(std::span<const char*> paths, std::span<const char* const> defines)
+{
+    std::string defineSource;
+    for (const char* define : defines)
+    {
+        defineSource += "#define ";
+        defineSource += define;
+        defineSource += '\n';
+    }
+
+    std::string source;
+    std::unordered_set<std::string> includedFiles;
+    bool definesInserted = false;
+    bool success = true;
+    for (const char* path : paths)
+    {
+        success &= PreprocessFile(path, includedFiles, defineSource, definesInserted, source);
+    }
+
+    // The missing files were already reported. The source is still returned, and its compilation reports what is missing
+    if (!success)
+    {
+        std::cout << "ERROR::SHADER::PREPROCESSING_FAILED " << (paths.empty() ? "" : paths.back()) << std::endl;
+    }
+
+    // Without a #version directive, the defines can go first
+    if (!definesInserted)
+    {
+        source.insert(0, defineSource);
+    }
+    return source;
+}
@@ -0,0 +1,449 @@
+#include <ituGL/asset/ShaderProgramCache.h>
+
+#include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <ituGL/shader/ProgramPipeline.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <array>
+#include <cassert>
+#include <iostream>
+
+namespace
+{
+    // Identifies the files written by the cache
+    const uint32_t BinaryFileMagic = 0x42505355; // "USPB"
+
+    // FNV-1a 64 bit hash
+    const uint64_t HashOffsetBasis = 0xcbf29ce484222325ull;
+    const uint64_t HashPrime = 0x100000001b3ull;
+
+    void HashBytes(uint64_t& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * HashPrime;
+        }
+    }
+
+    // Include the size, so different splits of the same text produce different hashes
+    void HashString(uint64_t& hash, const std::string& string)
+    {
+        size_t size = string.size();
+        HashBytes(hash, &size, sizeof(size));
+        HashBytes(hash, string.data(), size);
+    }
+
+    const char* GetString(GLenum name)
+    {
+        const char* string = reinterpret_cast<const char*>(glGetString(name));
+        return string ? string : "";
+    }
+}
+
+ShaderProgramCache::ShaderProgramCache(const char* directory)
+    : m_directory(directory)
+    , m_enabled(true)
+    , m_hitCount(0)
+    , m_missCount(0)
+{
+}
+
+bool ShaderProgramCache::Build(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const char* const> defines)
+{
+    std::vector<std::vector<std::string>> sources = ReadSources(stages, defines);
+
+    std::string binaryPath;
+    if (LoadCached(shaderProgram, stages, sources, defines, binaryPath))
+    {
+        return true;
+    }
+
+    bool success = Compile(shaderProgram, stages, sources, defines);
+    if (success && !binaryPath.empty())
+    {
+        SaveBinary(shaderProgram, binaryPath);
+    }
+    return success;
+}
+
+void ShaderProgramCache::BuildAsync(std::shared_ptr<ShaderProgram> shaderProgram, std::span<const Stage> stages, std::span<const char* const> defines)
+{
+    assert(shaderProgram);
+    std::vector<std::vector<std::string>> sources = ReadSources(stages, defines);
+
+    std::string binaryPath;
+    if (LoadCached(*shaderProgram, stages, sources, defines, binaryPath))
+    {
+        return;
+    }
+
+    // Submit all the compilations, and the linking, without checking their status
+    PendingBuild& pendingBuild = m_pendingBuilds.emplace_back(PendingBuild{ shaderProgram, CompileShaders(stages, sources, defines, true), binaryPath });
+    std::vector<const Shader*> shaders;
+    for (const Shader& shader : pendingBuild.shaders)
+    {
+        shaders.push_back(&shader);
+    }
+    shaderProgram->BuildAsync(shaders);
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramCache::BuildStage(Shader::Type type, std::span<const char*> paths, std::span<const char* const> defines)
+{
+    Stage stages[] = { { type, paths } };
+    std::vector<std::vector<std::string>> sources = ReadSources(stages, defines);
+
+    // Stages are shared, so look for it in memory before trying the binaries
+    InitializeDriver();
+    uint64_t key = ComputeKey(stages, sources, defines, true);
+    auto itStage = m_stages.find(key);
+    if (itStage != m_stages.end())
+    {
+        return itStage->second;
+    }
+
+    // The program must be separable before loading the binary too
+    std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
+    shaderProgram->SetSeparable(true);
+    m_stages[key] = shaderProgram;
+
+    std::string binaryPath;
+    if (LoadCached(*shaderProgram, stages, sources, defines, binaryPath))
+    {
+        return shaderProgram;
+    }
+
+    std::vector<Shader> shaders = CompileShaders(stages, sources, defines, false);
+    if (shaderProgram->BuildSeparable(shaders[0]))
+    {
+        if (!binaryPath.empty())
+        {
+            SaveBinary(*shaderProgram, binaryPath);
+        }
+    }
+    else
+    {
+        PrintLinkingErrors(*shaderProgram);
+    }
+    return shaderProgram;
+}
+
+std::shared_ptr<ProgramPipeline> ShaderProgramCache::GetPipeline(std::shared_ptr<const ShaderProgram> vertexStage, std::shared_ptr<const ShaderProgram> fragmentStage)
+{
+    assert(vertexStage && vertexStage->IsSeparable());
+    assert(fragmentStage && fragmentStage->IsSeparable());
+
+    std::shared_ptr<ProgramPipeline>& programPipeline = m_pipelines[std::make_pair(vertexStage.get(), fragmentStage.get())];
+    if (!programPipeline)
+    {
+        programPipeline = std::make_shared<ProgramPipeline>();
+        programPipeline->UseProgramStages(*vertexStage, GL_VERTEX_SHADER_BIT);
+        programPipeline->UseProgramStages(*fragmentStage, GL_FRAGMENT_SHADER_BIT);
+    }
+    return programPipeline;
+}
+
+bool ShaderProgramCache::Poll()
+{
+    auto itPending = m_pendingBuilds.begin();
+    while (itPending != m_pendingBuilds.end())
+    {
+        if (itPending->shaderProgram->IsLinkComplete())
+        {
+            FinishBuild(*itPending);
+            itPending = m_pendingBuilds.erase(itPending);
+        }
+        else
+        {
+            ++itPending;
+        }
+    }
+    return m_pendingBuilds.empty();
+}
+
+bool ShaderProgramCache::IsPending(const ShaderProgram& shaderProgram) const
+{
+    for (const PendingBuild& pendingBuild : m_pendingBuilds)
+    {
+        if (pendingBuild.shaderProgram.get() == &shaderProgram)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShaderProgramCache::Wait()
+{
+    // Checking the status waits for the build to complete
+    for (const PendingBuild& pendingBuild : m_pendingBuilds)
+    {
+        FinishBuild(pendingBuild);
+    }
+    m_pendingBuilds.clear();
+}
+
+std::vector<std::vector<std::string>> ShaderProgramCache::ReadSources(std::span<const Stage> stages, std::span<const char* const> defines)
+{
+    assert(!stages.empty());
+
+    // Each stage is preprocessed into a single source, so the key also changes when an included file changes
+    std::vector<std::vector<std::string>> sources(stages.size());
+    for (size_t stageIndex = 0; stageIndex < stages.size(); ++stageIndex)
+    {
+        sources[stageIndex].push_back(ShaderLoader::Preprocess(stages[stageIndex].paths, defines));
+    }
+    return sources;
+}
+
+void ShaderProgramCache::InitializeDriver()
+{
+    if (m_driverString.empty())
+    {
+        // Binaries are not supported if the driver has no binary formats
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        m_enabled = m_enabled && formatCount > 0;
+
+        m_driverString = std::string(GetString(GL_VENDOR)) + '\n' + GetString(GL_RENDERER) + '\n' + GetString(GL_VERSION);
+    }
+}
+
+bool ShaderProgramCache::LoadCached(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+    std::span<const char* const> defines, std::string& binaryPath)
+{
+    if (m_enabled)
+    {
+        InitializeDriver();
+    }
+
+    binaryPath.clear();
+    if (!m_enabled)
+    {
+        return false;
+    }
+
+    binaryPath = GetBinaryPath(ComputeKey(stages, sources, defines, shaderProgram.IsSeparable()));
+    if (LoadBinary(shaderProgram, binaryPath))
+    {
+        ++m_hitCount;
+        return true;
+    }
+
+    // Not in the cache, or not accepted by the driver: it will be compiled and the binary replaced
+    ++m_missCount;
+    shaderProgram.SetBinaryRetrievable(true);
+    return false;
+}
+
+void ShaderProgramCache::FinishBuild(const PendingBuild& pendingBuild)
+{
+    if (pendingBuild.shaderProgram->IsLinked())
+    {
+        if (!pendingBuild.binaryPath.empty())
+        {
+            SaveBinary(*pendingBuild.shaderProgram, pendingBuild.binaryPath);
+        }
+    }
+    else
+    {
+        for (const Shader& shader : pendingBuild.shaders)
+        {
+            ShaderLoader::CheckCompilation(shader);
+        }
+        PrintLinkingErrors(*pendingBuild.shaderProgram);
+    }
+}
+
+uint64_t ShaderProgramCache::ComputeKey(std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+    std::span<const char* const> defines, bool separable) const
+{
+    uint64_t hash = HashOffsetBasis;
+    HashString(hash, m_driverString);
+    HashBytes(hash, &separable, sizeof(separable));
+    for (const char* define : defines)
+    {
+        HashString(hash, define);
+    }
+    for (size_t stageIndex = 0; stageIndex < stages.size(); ++stageIndex)
+    {
+        GLenum type = stages[stageIndex].type;
+        HashBytes(hash, &type, sizeof(type));
+        for (const std::string& source : sources[stageIndex])
+        {
+            HashString(hash, source);
+        }
+    }
+    return hash;
+}
+
+std::string ShaderProgramCache::GetBinaryPath(uint64_t key) const
+{
+    std::stringstream stringStream;
+    stringStream << std::hex << std::setfill('0') << std::setw(16) << key << ".bin";
+    return (std::filesystem::path(m_directory) / stringStream.str()).string();
+}
+
+bool ShaderProgramCache::LoadBinary(ShaderProgram& shaderProgram, const std::string& path) const
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    GLenum format = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!file || magic != BinaryFileMagic)
+    {
+        return false;
+    }
+
+    // The rest of the file is the binary
+    std::streampos start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::vector<std::byte> binary(static_cast<size_t>(file.tellg() - start));
+    file.seekg(start);
+    file.read(reinterpret_cast<char*>(binary.data()), binary.size());
+
+    return file && !binary.empty() && shaderProgram.LoadBinary(format, binary);
+}
+
+void ShaderProgramCache::SaveBinary(const ShaderProgram& shaderProgram, const std::string& path) const
+{
+    GLenum format = 0;
+    std::vector<std::byte> binary;
+    if (!shaderProgram.GetBinary(format, binary))
+    {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "WARNING::SHADER_CACHE::WRITE_FAILED " << path << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&BinaryFileMagic), sizeof(BinaryFileMagic));
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+}
+
+std::vector<Shader> ShaderProgramCache::CompileShaders(std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+    std::span<const char* const> defines, bool async) const
+{
+    std::vector<Shader> shaders;
+    for (size_t stageIndex = 0; stageIndex < stages.size(); ++stageIndex)
+    {
+        std::vector<const char*> sourceCode;
+        for (const std::string& source : sources[stageIndex])
+        {
+            sourceCode.push_back(source.c_str());
+        }
+        ShaderLoader shaderLoader(stages[stageIndex].type);
+        shaderLoader.SetAsync(async);
+        if (!m_spirvDirectory.empty())
+        {
+            // The sources are still read for the key, but the driver doesn't need to compile them
+            shaderLoader.SetSpirvDirectory(m_spirvDirectory.c_str());
+            Shader shader(stages[stageIndex].type);
+            if (shaderLoader.LoadSpirv(shader, stages[stageIndex].paths, defines))
+            {
+                shaders.push_back(std::move(shader));
+                continue;
+            }
+        }
+        shaders.push_back(shaderLoader.LoadSources(sourceCode));
+    }
+    return shaders;
+}
+
+bool ShaderProgramCache::Compile(ShaderProgram& shaderProgram, std::span<const Stage> stages, std::span<const std::vector<std::string>> sources,
+    std::span<const char* const> defines) const
+{
+    std::vector<Shader> shaders = CompileShaders(stages, sources, defines, false);
+
+    const Shader* computeShader = nullptr;
+    const Shader* vertexShader = nullptr;
+    const Shader* fragmentShader = nullptr;
+    const Shader* tesselationControlShader = nullptr;
+    const Shader* tesselationEvaluationShader = nullptr;
+    const Shader* geometryShader = nullptr;
+    for (size_t stageIndex = 0; stageIndex < stages.size(); ++stageIndex)
+    {
+        const Shader* shader = &shaders[stageIndex];
+        switch (stages[stageIndex].type)
+        {
+        case Shader::ComputeShader:
+            computeShader = shader;
+            break;
+        case Shader::VertexShader:
+            vertexShader = shader;
+            break;
+        case Shader::FragmentShader:
+            fragmentShader = shader;
+            break;
+        case Shader::TesselationControlShader:
+            tesselationControlShader = shader;
+            break;
+        case Shader::TesselationEvaluationShader:
+            tesselationEvaluationShader = shader;
+            break;
+        case Shader::GeometryShader:
+            geometryShader = shader;
+            break;
+        }
+    }
+
+    bool success = false;
+    if (shaderProgram.IsSeparable() && stages.size() == 1)
+    {
+        // Single stage, to be combined with others in a pipeline
+        success = shaderProgram.BuildSeparable(shaders[0]);
+    }
+    else if (computeShader)
+    {
+        success = shaderProgram.Build(*computeShader);
+    }
+    else
+    {
+        assert(vertexShader && fragmentShader);
+        if (tesselationEvaluationShader && geometryShader)
+        {
+            success = shaderProgram.Build(*vertexShader, *fragmentShader, tesselationControlShader, *tesselationEvaluationShader, *geometryShader);
+        }
+        else if (tesselationEvaluationShader)
+        {
+            success = shaderProgram.Build(*vertexShader, *fragmentShader, tesselationControlShader, *tesselationEvaluationShader);
+        }
+        else if (geometryShader)
+        {
+            success = shaderProgram.Build(*vertexShader, *fragmentShader, *geometryShader);
+        }
+        else
+        {
+            success = shaderProgram.Build(*vertexShader, *fragmentShader);
+        }
+    }
+
+    if (!success)
+    {
+        PrintLinkingErrors(shaderProgram);
+    }
+    return success;
+}
+
+void ShaderProgramCache::PrintLinkingErrors(const ShaderProgram& shaderProgram)
+{
+    std::array<char, 512> infoLog;
+    shaderProgram.GetLinkingErrors(infoLog);
+    std::cout << "ERROR::SHADER_PROGRAM::LINKING_FAILED\n" << infoLog.data() << std::endl;
+}
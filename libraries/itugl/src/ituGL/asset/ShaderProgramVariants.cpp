@@ -0,0 +1,182 @@
+#include <ituGL/asset/ShaderProgramVariants.h>
+
+#include <ituGL/shader/ShaderProgram.h>
+#include <algorithm>
+#include <cassert>
+
+ShaderProgramVariants::ShaderProgramVariants(ShaderProgramCache& shaderProgramCache, std::initializer_list<Stage> stages, std::initializer_list<const char*> keywords)
+    : m_shaderProgramCache(shaderProgramCache)
+    , m_stages(stages)
+    , m_keywords(keywords.begin(), keywords.end())
+{
+    assert(m_keywords.size() <= sizeof(KeywordMask) * 8);
+}
+
+void ShaderProgramVariants::SetVertexStage(std::shared_ptr<const ShaderProgram> vertexStage)
+{
+    assert(m_variants.empty());
+    assert(!vertexStage || vertexStage->IsSeparable());
+    m_vertexStage = vertexStage;
+}
+
+ShaderProgramVariants::KeywordMask ShaderProgramVariants::GetKeywordMask(const char* keyword) const
+{
+    for (size_t i = 0; i < m_keywords.size(); ++i)
+    {
+        if (m_keywords[i] == keyword)
+        {
+            return KeywordMask(1) << i;
+        }
+    }
+    return 0;
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramVariants::GetVariant(KeywordMask keywordMask)
+{
+    auto itVariant = m_variants.find(keywordMask);
+    if (itVariant != m_variants.end())
+    {
+        return itVariant->second.shaderProgram;
+    }
+    return BuildVariant(keywordMask, false);
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramVariants::GetVariantAsync(KeywordMask keywordMask)
+{
+    auto itVariant = m_variants.find(keywordMask);
+    if (itVariant != m_variants.end())
+    {
+        return itVariant->second.shaderProgram;
+    }
+    return BuildVariant(keywordMask, true);
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramVariants::FindVariant(KeywordMask keywordMask)
+{
+    auto itVariant = m_variants.find(keywordMask);
+    if (itVariant == m_variants.end())
+    {
+        BuildVariant(keywordMask, true);
+        itVariant = m_variants.find(keywordMask);
+        itVariant->second.state = VariantState::Building;
+    }
+
+    Variant& variant = itVariant->second;
+    if (variant.state == VariantState::Building && !m_shaderProgramCache.IsPending(*variant.shaderProgram))
+    {
+        // Finished by the cache, register it before it is used
+        if (variant.shaderProgram->IsLinked())
+        {
+            variant.state = VariantState::Ready;
+            if (m_variantBuiltFunction)
+            {
+                m_variantBuiltFunction(variant.shaderProgram);
+            }
+        }
+        else
+        {
+            variant.state = VariantState::Failed;
+        }
+    }
+    return variant.state == VariantState::Ready ? variant.shaderProgram : nullptr;
+}
+
+std::shared_ptr<ProgramPipeline> ShaderProgramVariants::GetPipeline(KeywordMask keywordMask)
+{
+    if (!m_vertexStage)
+    {
+        return nullptr;
+    }
+
+    // The cache keeps the pipelines by stage pair, so this only creates it once
+    return m_shaderProgramCache.GetPipeline(m_vertexStage, GetVariant(keywordMask));
+}
+
+bool ShaderProgramVariants::GetVariantMask(const ShaderProgram& shaderProgram, KeywordMask& keywordMask) const
+{
+    for (const auto& variant : m_variants)
+    {
+        if (variant.second.shaderProgram.get() == &shaderProgram)
+        {
+            keywordMask = variant.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+const ShaderUniformCollection::LocationMap& ShaderProgramVariants::GetLocationMap(KeywordMask sourceMask, KeywordMask targetMask)
+{
+    uint64_t key = (static_cast<uint64_t>(sourceMask) << 32) | targetMask;
+    auto itLocationMap = m_locationMaps.find(key);
+    if (itLocationMap != m_locationMaps.end())
+    {
+        return itLocationMap->second;
+    }
+
+    // Match the uniforms by their full name, so names with the same hash are still told apart. Only done once per pair
+    const ShaderProgram& sourceProgram = *GetVariant(sourceMask);
+    const ShaderProgram& targetProgram = *GetVariant(targetMask);
+    ShaderUniformCollection::LocationMap& locationMap = m_locationMaps[key];
+    for (unsigned int i = 0, count = sourceProgram.GetUniformCount(); i < count; ++i)
+    {
+        int size;
+        GLenum glType;
+        char uniformName[256];
+        sourceProgram.GetUniformInfo(i, size, glType, std::span(uniformName, sizeof(uniformName)));
+
+        ShaderProgram::Location sourceLocation = sourceProgram.GetUniformLocation(uniformName);
+        ShaderProgram::Location targetLocation = targetProgram.GetUniformLocation(uniformName);
+        if (sourceLocation >= 0 && targetLocation >= 0)
+        {
+            locationMap.emplace_back(sourceLocation, targetLocation);
+        }
+    }
+    std::sort(locationMap.begin(), locationMap.end());
+    return locationMap;
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramVariants::BuildVariant(KeywordMask keywordMask, bool async)
+{
+    std::vector<const char*> defines;
+    for (size_t i = 0; i < m_keywords.size(); ++i)
+    {
+        if (keywordMask & (KeywordMask(1) << i))
+        {
+            defines.push_back(m_keywords[i].c_str());
+        }
+    }
+
+    // The cache takes the paths as C strings
+    std::vector<std::vector<const char*>> paths(m_stages.size());
+    std::vector<ShaderProgramCache::Stage> stages;
+    for (size_t stageIndex = 0; stageIndex < m_stages.size(); ++stageIndex)
+    {
+        for (const std::string& path : m_stages[stageIndex].paths)
+        {
+            paths[stageIndex].push_back(path.c_str());
+        }
+        stages.push_back(ShaderProgramCache::Stage{ m_stages[stageIndex].type, paths[stageIndex] });
+    }
+
+    // The program must be separable before building it, or loading its binary
+    std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
+    if (m_vertexStage)
+    {
+        shaderProgram->SetSeparable(true);
+    }
+    m_variants[keywordMask] = Variant{ shaderProgram, VariantState::Ready };
+    if (async)
+    {
+        m_shaderProgramCache.BuildAsync(shaderProgram, stages, defines);
+    }
+    else
+    {
+        m_shaderProgramCache.Build(*shaderProgram, stages, defines);
+        if (m_variantBuiltFunction)
+        {
+            m_variantBuiltFunction(shaderProgram);
+        }
+    }
+    return shaderProgram;
+}
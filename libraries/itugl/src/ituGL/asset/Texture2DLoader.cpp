@@ -1,15 +1,75 @@
 #include <ituGL/asset/Texture2DLoader.h>
 
+#include <ituGL/texture/TextureCompressor.h>
+#include <ituGL/core/DeviceGL.h>
+#include <array>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <vector>
+
+// Table to convert 8-bit sRGB values to linear, built once before any thread uses it
+static const std::array<float, 256> s_sRGBToLinear = []()
+{
+    std::array<float, 256> table = {};
+    for (int i = 0; i < 256; ++i)
+    {
+        float value = i / 255.0f;
+        table[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+}();
+
+// Downsample an 8-bit image to half its size with a box filter. Color channels of sRGB images are averaged in linear space
+static void DownsampleImage(const std::vector<std::byte>& data, int width, int height, int componentCount, bool sRGB,
+    std::vector<std::byte>& halfData, int& halfWidth, int& halfHeight)
+{
+    halfWidth = std::max(width / 2, 1);
+    halfHeight = std::max(height / 2, 1);
+    halfData.resize(static_cast<size_t>(halfWidth) * halfHeight * componentCount);
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+    unsigned char* dst = reinterpret_cast<unsigned char*>(halfData.data());
+    for (int y = 0; y < halfHeight; ++y)
+    {
+        int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < halfWidth; ++x)
+        {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            const unsigned char* p00 = src + (static_cast<size_t>(y0) * width + x0) * componentCount;
+            const unsigned char* p01 = src + (static_cast<size_t>(y0) * width + x1) * componentCount;
+            const unsigned char* p10 = src + (static_cast<size_t>(y1) * width + x0) * componentCount;
+            const unsigned char* p11 = src + (static_cast<size_t>(y1) * width + x1) * componentCount;
+            for (int c = 0; c < componentCount; ++c)
+            {
+                // Alpha is always linear
+                if (sRGB && c < 3)
+                {
+                    float value = 0.25f * (s_sRGBToLinear[p00[c]] + s_sRGBToLinear[p01[c]] + s_sRGBToLinear[p10[c]] + s_sRGBToLinear[p11[c]]);
+                    value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                    *dst++ = static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+                else
+                {
+                    *dst++ = static_cast<unsigned char>((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
 
 Texture2DLoader::Texture2DLoader()
     : m_flipVertical(false)
+    , m_compress(false)
+    , m_jobSystem(nullptr)
 {
 }
 
 Texture2DLoader::Texture2DLoader(TextureObject::Format format, TextureObject::InternalFormat internalFormat)
     : TextureLoader(format, internalFormat)
     , m_flipVertical(false)
+    , m_compress(false)
+    , m_jobSystem(nullptr)
 {
 }
 
@@ -26,8 +86,28 @@ Texture2DObject Texture2DLoader::Load(const char* path)
     assert(!data.empty());
     if (!data.empty())
     {
+        // Only 8-bit data can be block compressed
+        TextureObject::InternalFormat compressedFormat = TextureObject::InternalFormatInvalid;
+        if (m_compress && dataType == Data::Type::UByte)
+        {
+            compressedFormat = TextureCompressor::GetCompressedFormat(m_internalFormat);
+
+            // Without the S3TC extension, the texture is uploaded uncompressed
+            if (TextureCompressor::IsS3TCFormat(compressedFormat) && !DeviceGL::GetInstance().IsTextureCompressionS3TCSupported())
+            {
+                compressedFormat = TextureObject::InternalFormatInvalid;
+            }
+        }
+
         texture2D.Bind();
-        texture2D.SetImage<std::byte>(0, width, height, m_format, m_internalFormat, data, dataType);
+        if (compressedFormat != TextureObject::InternalFormatInvalid)
+        {
+            SetCompressedImage(texture2D, data, width, height, compressedFormat);
+        }
+        else
+        {
+            texture2D.SetImage<std::byte>(0, width, height, m_format, m_internalFormat, data, dataType);
+        }
 
         texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
         texture2D.SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
@@ -35,7 +115,11 @@ Texture2DObject Texture2DLoader::Load(const char* path)
         // Generate mipmap if needed
         if (m_generateMipmap)
         {
-            texture2D.GenerateMipmap();
+            // Compressed textures already have their mipmaps, generated on the CPU
+            if (compressedFormat == TextureObject::InternalFormatInvalid)
+            {
+                texture2D.GenerateMipmap();
+            }
             texture2D.SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR_MIPMAP_LINEAR);
 
             // Adjust mip levels
@@ -52,6 +136,41 @@ Texture2DObject Texture2DLoader::Load(const char* path)
     return texture2D;
 }
 
+void Texture2DLoader::SetCompressedImage(Texture2DObject& texture2D, std::span<const std::byte> data, int width, int height,
+    TextureObject::InternalFormat compressedFormat) const
+{
+    int componentCount = TextureObject::GetComponentCount(m_format);
+    bool sRGB = compressedFormat == TextureObject::InternalFormatSRGBBC1 || compressedFormat == TextureObject::InternalFormatSRGBABC3;
+
+    std::vector<std::byte> levelData(data.begin(), data.end());
+    std::vector<std::byte> nextLevelData;
+    std::vector<std::byte> compressedData;
+    for (int level = 0; ; ++level)
+    {
+        compressedData.resize(TextureCompressor::GetCompressedSize(compressedFormat, width, height));
+        if (m_jobSystem)
+        {
+            TextureCompressor::Compress(compressedFormat, levelData, width, height, componentCount, compressedData, *m_jobSystem);
+        }
+        else
+        {
+            TextureCompressor::Compress(compressedFormat, levelData, width, height, componentCount, compressedData);
+        }
+        texture2D.SetCompressedImage(level, width, height, compressedFormat, compressedData);
+
+        if (!m_generateMipmap || (width == 1 && height == 1))
+        {
+            break;
+        }
+
+        int nextWidth, nextHeight;
+        DownsampleImage(levelData, width, height, componentCount, sRGB, nextLevelData, nextWidth, nextHeight);
+        levelData.swap(nextLevelData);
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
+
 std::shared_ptr<Texture2DObject> Texture2DLoader::LoadTextureShared(const char* path,
     TextureObject::Format format, TextureObject::InternalFormat internalFormat, bool generateMipmap, bool flipVertical)
 {
@@ -0,0 +1,334 @@
+#include <ituGL/core/AllocationTracker.h>
+
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+#if !defined(NDEBUG) && (defined(__GLIBC__) || defined(__APPLE__))
+#define ALLOCATION_TRACKER_CALL_SITES
+#include <execinfo.h>
+#endif
+
+// Counters since the program started. Constant initialized, so they work for allocations before main
+static std::atomic<std::size_t> s_allocationCount(0);
+static std::atomic<std::size_t> s_allocatedBytes(0);
+static std::atomic<std::size_t> s_freeCount(0);
+
+// Counters when the current frame started, and the totals of the last frame
+static std::size_t s_frameStartAllocationCount = 0;
+static std::size_t s_frameStartAllocatedBytes = 0;
+static std::size_t s_frameAllocationCount = 0;
+static std::size_t s_frameAllocatedBytes = 0;
+
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+
+// Frames of the call stack stored for each call site, skipping the capture and the operator new. Debug builds don't inline them
+// The first frames are usually inside the standard containers, so the stack is deep enough to reach the code using them
+static constexpr int CallSiteFrameCount = 10;
+static constexpr int SkippedFrameCount = 3;
+
+// Fixed table, because it can't allocate. Call sites that don't fit are not recorded
+static constexpr std::size_t CallSiteCapacity = 1024;
+
+struct CallSite
+{
+    std::atomic<std::uintptr_t> key;
+    void* frames[CallSiteFrameCount];
+    std::atomic<std::size_t> count;
+    std::atomic<std::size_t> bytes;
+};
+
+static CallSite s_callSites[CallSiteCapacity];
+static std::atomic<bool> s_callSiteCaptureEnabled(false);
+
+// Set while capturing, because the first backtrace call can allocate
+static thread_local bool s_capturing = false;
+
+static void CaptureCallSite(std::size_t size)
+{
+    if (!s_callSiteCaptureEnabled.load(std::memory_order_relaxed) || s_capturing)
+    {
+        return;
+    }
+    s_capturing = true;
+
+    void* frames[CallSiteFrameCount + SkippedFrameCount] = {};
+    int frameCount = backtrace(frames, CallSiteFrameCount + SkippedFrameCount);
+
+    // Hash of the addresses, never 0 because it marks the empty entries
+    std::uintptr_t key = 14695981039346656037ull;
+    for (int i = SkippedFrameCount; i < frameCount; ++i)
+    {
+        key = (key ^ reinterpret_cast<std::uintptr_t>(frames[i])) * 1099511628211ull;
+    }
+    key = key ? key : 1;
+
+    // Open addressing, claiming the first empty entry
+    for (std::size_t probe = 0; probe < CallSiteCapacity; ++probe)
+    {
+        CallSite& callSite = s_callSites[(key + probe) % CallSiteCapacity];
+        std::uintptr_t currentKey = callSite.key.load(std::memory_order_acquire);
+        if (currentKey == 0)
+        {
+            if (callSite.key.compare_exchange_strong(currentKey, key, std::memory_order_acq_rel))
+            {
+                std::copy(frames + SkippedFrameCount, frames + CallSiteFrameCount + SkippedFrameCount, callSite.frames);
+                currentKey = key;
+            }
+        }
+        if (currentKey == key)
+        {
+            callSite.count.fetch_add(1, std::memory_order_relaxed);
+            callSite.bytes.fetch_add(size, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    s_capturing = false;
+}
+
+#endif
+
+static void TrackAllocation(std::size_t size)
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    CaptureCallSite(size);
+#endif
+}
+
+std::size_t AllocationTracker::GetAllocationCount()
+{
+    return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+std::size_t AllocationTracker::GetAllocatedBytes()
+{
+    return s_allocatedBytes.load(std::memory_order_relaxed);
+}
+
+std::size_t AllocationTracker::GetFreeCount()
+{
+    return s_freeCount.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::NextFrame()
+{
+    std::size_t allocationCount = GetAllocationCount();
+    std::size_t allocatedBytes = GetAllocatedBytes();
+    s_frameAllocationCount = allocationCount - s_frameStartAllocationCount;
+    s_frameAllocatedBytes = allocatedBytes - s_frameStartAllocatedBytes;
+    s_frameStartAllocationCount = allocationCount;
+    s_frameStartAllocatedBytes = allocatedBytes;
+}
+
+std::size_t AllocationTracker::GetFrameAllocationCount()
+{
+    return s_frameAllocationCount;
+}
+
+std::size_t AllocationTracker::GetFrameAllocatedBytes()
+{
+    return s_frameAllocatedBytes;
+}
+
+bool AllocationTracker::IsCallSiteCaptureSupported()
+{
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool AllocationTracker::IsCallSiteCaptureEnabled()
+{
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    return s_callSiteCaptureEnabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::SetCallSiteCaptureEnabled(bool enabled)
+{
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    s_callSiteCaptureEnabled.store(enabled, std::memory_order_relaxed);
+#endif
+}
+
+void AllocationTracker::PrintCallSites(std::ostream& stream, unsigned int maxCount)
+{
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    // Don't capture the allocations of the printing
+    bool enabled = IsCallSiteCaptureEnabled();
+    SetCallSiteCaptureEnabled(false);
+
+    CallSite* sorted[CallSiteCapacity];
+    std::size_t callSiteCount = 0;
+    for (CallSite& callSite : s_callSites)
+    {
+        if (callSite.key.load(std::memory_order_acquire) != 0)
+        {
+            sorted[callSiteCount++] = &callSite;
+        }
+    }
+    std::size_t printCount = std::min<std::size_t>(callSiteCount, maxCount);
+    std::partial_sort(sorted, sorted + printCount, sorted + callSiteCount,
+        [](const CallSite* a, const CallSite* b) { return a->count.load() > b->count.load(); });
+
+    stream << "ALLOCATIONS::CALL_SITES " << callSiteCount << " call sites" << std::endl;
+    for (std::size_t i = 0; i < printCount; ++i)
+    {
+        const CallSite& callSite = *sorted[i];
+        stream << callSite.count.load() << " allocations, " << callSite.bytes.load() << " bytes" << std::endl;
+
+        // Addresses can be resolved with addr2line if the symbols are not exported
+        char** symbols = backtrace_symbols(callSite.frames, CallSiteFrameCount);
+        for (int frame = 0; frame < CallSiteFrameCount && callSite.frames[frame]; ++frame)
+        {
+            stream << "    " << (symbols ? symbols[frame] : "?") << std::endl;
+        }
+        std::free(symbols);
+    }
+
+    ResetCallSites();
+    SetCallSiteCaptureEnabled(enabled);
+#else
+    stream << "ALLOCATIONS::CALL_SITES only captured in debug builds" << std::endl;
+#endif
+}
+
+void AllocationTracker::ResetCallSites()
+{
+#ifdef ALLOCATION_TRACKER_CALL_SITES
+    for (CallSite& callSite : s_callSites)
+    {
+        callSite.key.store(0, std::memory_order_relaxed);
+        callSite.count.store(0, std::memory_order_relaxed);
+        callSite.bytes.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+// Allocate like the default operator new, calling the handler until the allocation succeeds
+static void* Allocate(std::size_t size, std::size_t alignment)
+{
+    TrackAllocation(size);
+
+    size = size ? size : 1;
+    if (alignment > alignof(std::max_align_t))
+    {
+        // aligned_alloc needs a size multiple of the alignment
+        size = (size + alignment - 1) / alignment * alignment;
+    }
+    while (true)
+    {
+        void* ptr = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            ptr = std::malloc(size);
+        }
+        else
+        {
+#ifdef _MSC_VER
+            ptr = _aligned_malloc(size, alignment);
+#else
+            ptr = std::aligned_alloc(alignment, size);
+#endif
+        }
+        if (ptr)
+        {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+static void Free(void* ptr, std::size_t alignment)
+{
+    if (ptr)
+    {
+        s_freeCount.fetch_add(1, std::memory_order_relaxed);
+#ifdef _MSC_VER
+        if (alignment > alignof(std::max_align_t))
+        {
+            _aligned_free(ptr);
+            return;
+        }
+#endif
+        std::free(ptr);
+    }
+}
+
+// Replacements of the global allocation functions. The nothrow forms call these, and the placement forms don't allocate
+// The aligned forms are replaced too, so types with extended alignment are counted, and freed with the matching function
+
+void* operator new(std::size_t size)
+{
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size)
+{
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    Free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    Free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    Free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    Free(ptr, alignof(std::max_align_t));
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+    Free(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+    Free(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    Free(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    Free(ptr, static_cast<std::size_t>(alignment));
+}
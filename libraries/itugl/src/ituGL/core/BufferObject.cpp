@@ -1,5 +1,6 @@
 #include <ituGL/core/BufferObject.h>
 
+#include <ituGL/core/DeviceGL.h>
 #include <cassert>
 
 // Create the object initially null, get object handle and generate 1 buffer
@@ -56,6 +57,48 @@ void BufferObject::AllocateData(std::span<const std::byte> data, Usage usage)
     glBufferData(target, data.size_bytes(), data.data(), usage);
 }
 
+// Get buffer Target and allocate immutable buffer storage, or mutable buffer data if not supported
+bool BufferObject::AllocateStorage(size_t size, GLbitfield storageFlags)
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    if (!DeviceGL::GetInstance().IsBufferStorageSupported())
+    {
+        glBufferData(target, size, nullptr, GetStorageUsage(storageFlags));
+        return false;
+    }
+    glBufferStorage(target, size, nullptr, storageFlags);
+    return true;
+}
+
+// Get buffer Target and allocate immutable buffer storage, or mutable buffer data if not supported
+bool BufferObject::AllocateStorage(std::span<const std::byte> data, GLbitfield storageFlags)
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    if (!DeviceGL::GetInstance().IsBufferStorageSupported())
+    {
+        glBufferData(target, data.size_bytes(), data.data(), GetStorageUsage(storageFlags));
+        return false;
+    }
+    glBufferStorage(target, data.size_bytes(), data.data(), storageFlags);
+    return true;
+}
+
+// Buffers read by the CPU are STREAM_READ, buffers written by the CPU are DYNAMIC_DRAW, and the rest STATIC_DRAW
+BufferObject::Usage BufferObject::GetStorageUsage(GLbitfield storageFlags)
+{
+    if (storageFlags & MapReadStorage)
+    {
+        return StreamRead;
+    }
+    if (storageFlags & (DynamicStorage | MapWriteStorage))
+    {
+        return DynamicDraw;
+    }
+    return StaticDraw;
+}
+
 // Get buffer Target and set buffer subdata
 void BufferObject::UpdateData(std::span<const std::byte> data, size_t offset)
 {
@@ -63,3 +106,53 @@ void BufferObject::UpdateData(std::span<const std::byte> data, size_t offset)
     Target target = GetTarget();
     glBufferSubData(target, offset, data.size_bytes(), data.data());
 }
+
+// Get buffer Target and map the range
+void* BufferObject::MapRange(size_t offset, size_t size, GLbitfield access)
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    return glMapBufferRange(target, offset, size, access);
+}
+
+// Get buffer Target and flush the range
+void BufferObject::FlushMappedRange(size_t offset, size_t size)
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    glFlushMappedBufferRange(target, offset, size);
+}
+
+// Get buffer Target and unmap the buffer
+bool BufferObject::Unmap()
+{
+    assert(IsBound());
+    Target target = GetTarget();
+    return glUnmapBuffer(target) == GL_TRUE;
+}
+
+// Bind the buffer handle to the indexed target
+void BufferObject::BindBase(Target target, GLuint index) const
+{
+    assert(target == Target::UniformBuffer || target == Target::ShaderStorageBuffer);
+    Handle handle = GetHandle();
+    glBindBufferBase(target, index, handle);
+}
+
+// Bind the buffer range to the indexed target
+void BufferObject::BindRange(Target target, GLuint index, size_t offset, size_t size) const
+{
+    assert(target == Target::UniformBuffer || target == Target::ShaderStorageBuffer);
+    Handle handle = GetHandle();
+    glBindBufferRange(target, index, handle, offset, size);
+}
+
+// Bind the buffers to the copy targets and copy the range
+void BufferObject::CopyData(const BufferObject& source, size_t sourceOffset, size_t offset, size_t size)
+{
+    source.Bind(Target::CopyReadBuffer);
+    Bind(Target::CopyWriteBuffer);
+    glCopyBufferSubData(Target::CopyReadBuffer, Target::CopyWriteBuffer, sourceOffset, offset, size);
+    Unbind(Target::CopyReadBuffer);
+    Unbind(Target::CopyWriteBuffer);
+}
@@ -18,3 +18,16 @@ unsigned int Data::GetTypeSize(Type type)
         return 4;
     }
 }
+
+// Check if the Type packs all the components in a single value
+bool Data::IsPackedType(Type type)
+{
+    switch (type)
+    {
+    case Type::Int2101010Rev:
+    case Type::UInt2101010Rev:
+        return true;
+    default:
+        return false;
+    }
+}
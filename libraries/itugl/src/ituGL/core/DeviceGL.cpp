@@ -6,7 +6,7 @@
 
 DeviceGL* DeviceGL::m_instance = nullptr;
 
-DeviceGL::DeviceGL() : m_contextLoaded(false)
+DeviceGL::DeviceGL() : m_contextLoaded(false), m_parallelShaderCompile(false), m_spirv(false), m_bufferStorage(false), m_textureCompressionS3TC(false)
 {
     m_instance = this;
 
@@ -35,7 +35,58 @@ void DeviceGL::SetCurrentWindow(Window& window)
     {
         // Set callback to be called when the window is resized
         glfwSetFramebufferSizeCallback(glfwWindow, FrameBufferResized);
+
+        InitializeParallelShaderCompile();
+        InitializeSpirv();
+        InitializeBufferStorage();
+
+        // The S3TC formats are not core, even if all desktop drivers support them
+        m_textureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+    }
+}
+
+// glad is generated without extensions, so the function is loaded here
+void DeviceGL::InitializeParallelShaderCompile()
+{
+    using MaxShaderCompilerThreadsFunction = void (*)(GLuint);
+    MaxShaderCompilerThreadsFunction maxShaderCompilerThreads = nullptr;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+    {
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsFunction>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    }
+    else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+    {
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsFunction>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
     }
+
+    m_parallelShaderCompile = maxShaderCompilerThreads != nullptr;
+    if (m_parallelShaderCompile)
+    {
+        // Let the driver choose the number of threads
+        maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+}
+
+// glad only loads glSpecializeShader with an OpenGL 4.6 context. glShaderBinary is core since 4.1
+void DeviceGL::InitializeSpirv()
+{
+    if (!glad_glSpecializeShader && glfwExtensionSupported("GL_ARB_gl_spirv"))
+    {
+        glad_glSpecializeShader = reinterpret_cast<PFNGLSPECIALIZESHADERPROC>(glfwGetProcAddress("glSpecializeShaderARB"));
+    }
+
+    m_spirv = glad_glSpecializeShader != nullptr;
+}
+
+// glad only loads glBufferStorage with an OpenGL 4.4 context. The extension uses the same name
+void DeviceGL::InitializeBufferStorage()
+{
+    if (!glad_glBufferStorage && glfwExtensionSupported("GL_ARB_buffer_storage"))
+    {
+        glad_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+    }
+
+    m_bufferStorage = glad_glBufferStorage != nullptr;
 }
 
 // Get the dimensions of the viewport
@@ -61,6 +112,25 @@ void DeviceGL::PollEvents()
     glfwPollEvents();
 }
 
+// Wait for events in the window event queue, up to the timeout if there is one
+void DeviceGL::WaitEvents(double timeout)
+{
+    if (timeout > 0.0)
+    {
+        glfwWaitEventsTimeout(timeout);
+    }
+    else
+    {
+        glfwWaitEvents();
+    }
+}
+
+// Post an event without data to the window event queue, to wake up WaitEvents
+void DeviceGL::PostEmptyEvent()
+{
+    glfwPostEmptyEvent();
+}
+
 // Callback called when the framebuffer changes size
 void DeviceGL::FrameBufferResized(GLFWwindow* window, GLsizei width, GLsizei height)
 {
@@ -0,0 +1,65 @@
+#include <ituGL/core/GpuTimer.h>
+
+#include <cassert>
+
+GpuTimer::GpuTimer(unsigned int frameCount)
+    : m_queries(frameCount, 0)
+    , m_pending(frameCount, false)
+    , m_oldestQuery(0)
+    , m_currentQuery(0)
+    , m_measuring(false)
+    , m_newTime(false)
+    , m_time(0.0f)
+{
+    assert(frameCount > 0);
+    glGenQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+}
+
+void GpuTimer::Begin()
+{
+    assert(!m_measuring);
+
+    // Read the finished queries in order, stopping at the first one that is not available yet
+    m_newTime = false;
+    while (m_pending[m_oldestQuery])
+    {
+        GLuint query = m_queries[m_oldestQuery];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        m_time = static_cast<float>(elapsed) * 1e-6f;
+        m_newTime = true;
+
+        m_pending[m_oldestQuery] = false;
+        m_oldestQuery = (m_oldestQuery + 1) % m_queries.size();
+    }
+
+    // Skip this frame if the query is still in flight
+    if (!m_pending[m_currentQuery])
+    {
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[m_currentQuery]);
+        m_measuring = true;
+    }
+}
+
+void GpuTimer::End()
+{
+    if (m_measuring)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_pending[m_currentQuery] = true;
+        m_currentQuery = (m_currentQuery + 1) % m_queries.size();
+        m_measuring = false;
+    }
+}
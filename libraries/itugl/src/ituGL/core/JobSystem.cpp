@@ -0,0 +1,411 @@
+#include <ituGL/core/JobSystem.h>
+
+#include <algorithm>
+#include <cassert>
+
+// Jobs a thread can have queued at once. When its queue is full, the job runs immediately instead
+static constexpr long long JobQueueCapacity = 4096;
+
+// Chunks per thread in ParallelFor without a chunk size, so threads that finish early can steal the rest
+static constexpr unsigned int ChunksPerThread = 4;
+
+// Index of the calling thread in the system it belongs to: 0 for the main thread, and 1 onwards for the workers
+static thread_local const JobSystem* s_threadJobSystem = nullptr;
+static thread_local unsigned int s_threadIndex = 0;
+
+// Rotates the first queue to steal from, so idle threads don't all compete for the same one
+static thread_local unsigned int s_stealOffset = 0;
+
+struct JobSystem::Job
+{
+    JobFunction function;
+    Counter* counter = nullptr;
+
+    // Jobs from the pool of a queue are released after they run, the others are deleted
+    bool pooled = false;
+    std::atomic<bool> busy = false;
+};
+
+// Chase-Lev deque with a fixed capacity. The owner pushes and pops at the bottom, the other threads steal from the top
+class JobSystem::JobQueue
+{
+public:
+    JobQueue() : m_top(0), m_bottom(0), m_jobs(JobQueueCapacity), m_pool(JobQueueCapacity), m_nextPoolJob(0)
+    {
+        for (Job& job : m_pool)
+        {
+            job.pooled = true;
+        }
+    }
+
+    // Only from the owner. The next job of the ring, or null if it is still queued or running in another thread
+    Job* AllocateJob()
+    {
+        Job& job = m_pool[m_nextPoolJob];
+        if (job.busy.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        job.busy.store(true, std::memory_order_relaxed);
+        m_nextPoolJob = (m_nextPoolJob + 1) % JobQueueCapacity;
+        return &job;
+    }
+
+    // Only from the owner. Returns false if the queue is full
+    bool Push(Job* job)
+    {
+        long long bottom = m_bottom.load(std::memory_order_relaxed);
+        long long top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= JobQueueCapacity)
+        {
+            return false;
+        }
+
+        // Released with the bottom, so the thieves that see the new bottom also see the job
+        m_jobs[bottom % JobQueueCapacity].store(job, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only from the owner. The most recent job, that is likely still in the cache
+    Job* Pop()
+    {
+        long long bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long top = m_top.load(std::memory_order_relaxed);
+
+        Job* job = nullptr;
+        if (top <= bottom)
+        {
+            job = m_jobs[bottom % JobQueueCapacity].load(std::memory_order_relaxed);
+            if (top == bottom)
+            {
+                // Last job, race with the thieves for it
+                if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    job = nullptr;
+                }
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // From any thread. The oldest job, that usually spawns more work
+    Job* Steal()
+    {
+        long long top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top < bottom)
+        {
+            Job* job = m_jobs[top % JobQueueCapacity].load(std::memory_order_relaxed);
+            if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    // Separate cache lines, the top is written by the thieves and the bottom by the owner
+    alignas(64) std::atomic<long long> m_top;
+    alignas(64) std::atomic<long long> m_bottom;
+    std::vector<std::atomic<Job*>> m_jobs;
+
+    // Jobs spawned by the owner, reused in order. Only the owner allocates them, any thread can release them
+    std::vector<Job> m_pool;
+    size_t m_nextPoolJob;
+};
+
+JobSystem::Job* JobSystem::CreateJob(JobQueue* threadQueue, JobFunction&& function, Counter* counter)
+{
+    Job* job = threadQueue ? threadQueue->AllocateJob() : nullptr;
+    if (!job)
+    {
+        job = new Job();
+    }
+    job->function = std::move(function);
+    job->counter = counter;
+    return job;
+}
+
+void JobSystem::DestroyJob(Job* job)
+{
+    if (job->pooled)
+    {
+        // Destroy the captures in this thread, before the owner can reuse the job
+        job->function = nullptr;
+        job->busy.store(false, std::memory_order_release);
+    }
+    else
+    {
+        delete job;
+    }
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+    : m_mainThreadId(std::this_thread::get_id())
+    , m_externalJobCount(0)
+    , m_queuedJobCount(0)
+    , m_sleepingCount(0)
+    , m_stopping(false)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    for (unsigned int i = 0; i <= workerCount; ++i)
+    {
+        m_queues.push_back(std::make_unique<JobQueue>());
+    }
+
+    s_threadJobSystem = this;
+    s_threadIndex = 0;
+
+    for (unsigned int i = 1; i <= workerCount; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_sleepCondition.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    // Jobs still queued are not executed
+    while (Job* job = FindJob(m_queues[0].get()))
+    {
+        DestroyJob(job);
+    }
+    for (Job* job : m_mainThreadJobs)
+    {
+        DestroyJob(job);
+    }
+
+    if (s_threadJobSystem == this)
+    {
+        s_threadJobSystem = nullptr;
+    }
+}
+
+bool JobSystem::IsMainThread() const
+{
+    return std::this_thread::get_id() == m_mainThreadId;
+}
+
+void JobSystem::Spawn(JobFunction function, Counter* counter)
+{
+    if (counter)
+    {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    JobQueue* threadQueue = GetThreadQueue();
+    Job* job = CreateJob(threadQueue, std::move(function), counter);
+
+    // Counted before it is queued, so it is never taken before being counted
+    m_queuedJobCount.fetch_add(1, std::memory_order_seq_cst);
+
+    if (threadQueue)
+    {
+        if (!threadQueue->Push(job))
+        {
+            m_queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+            Execute(job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        m_externalJobs.push_back(job);
+        m_externalJobCount.fetch_add(1, std::memory_order_release);
+    }
+
+    // Wake up a worker, if any is sleeping. Both counters are sequentially consistent, so the worker can't miss the job
+    if (m_sleepingCount.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_sleepCondition.notify_one();
+    }
+}
+
+void JobSystem::SpawnMainThread(JobFunction function, Counter* counter)
+{
+    if (counter)
+    {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The queue of the calling thread is only used to allocate the job
+    Job* job = CreateJob(GetThreadQueue(), std::move(function), counter);
+
+    std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+    m_mainThreadJobs.push_back(job);
+}
+
+void JobSystem::Wait(const Counter& counter)
+{
+    JobQueue* threadQueue = GetThreadQueue();
+    bool mainThread = IsMainThread();
+    while (!counter.IsDone())
+    {
+        // The jobs for the main thread could be the ones we are waiting for
+        if (mainThread)
+        {
+            RunMainThreadJobs();
+        }
+
+        if (Job* job = FindJob(threadQueue))
+        {
+            Execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+    assert(IsMainThread());
+
+    // Jobs can spawn more main thread jobs, they run in the next call
+    {
+        std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+        if (m_mainThreadJobs.empty())
+        {
+            return;
+        }
+        m_runningMainThreadJobs.swap(m_mainThreadJobs);
+    }
+
+    for (Job* job : m_runningMainThreadJobs)
+    {
+        Execute(job);
+    }
+    m_runningMainThreadJobs.clear();
+}
+
+void JobSystem::ParallelFor(unsigned int begin, unsigned int end, const RangeFunction& function, unsigned int chunkSize)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    unsigned int count = end - begin;
+    if (chunkSize == 0)
+    {
+        unsigned int chunkCount = static_cast<unsigned int>(m_queues.size()) * ChunksPerThread;
+        chunkSize = std::max((count + chunkCount - 1) / chunkCount, 1u);
+    }
+
+    // The calling thread runs the first chunk, and then helps with the others while it waits
+    Counter counter;
+    for (unsigned int chunkBegin = begin + chunkSize; chunkBegin < end; chunkBegin += chunkSize)
+    {
+        unsigned int chunkEnd = chunkBegin + std::min(chunkSize, end - chunkBegin);
+        Spawn([&function, chunkBegin, chunkEnd]() { function(chunkBegin, chunkEnd); }, &counter);
+    }
+    function(begin, begin + std::min(chunkSize, count));
+
+    Wait(counter);
+}
+
+void JobSystem::WorkerLoop(unsigned int threadIndex)
+{
+    s_threadJobSystem = this;
+    s_threadIndex = threadIndex;
+    s_stealOffset = threadIndex;
+
+    JobQueue* threadQueue = m_queues[threadIndex].get();
+    while (!m_stopping.load(std::memory_order_relaxed))
+    {
+        if (Job* job = FindJob(threadQueue))
+        {
+            Execute(job);
+            continue;
+        }
+
+        // Nothing to do, sleep until a job is spawned
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+        m_sleepCondition.wait(lock, [this] { return m_stopping || m_queuedJobCount.load(std::memory_order_seq_cst) > 0; });
+        m_sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+JobSystem::JobQueue* JobSystem::GetThreadQueue() const
+{
+    return s_threadJobSystem == this ? m_queues[s_threadIndex].get() : nullptr;
+}
+
+JobSystem::Job* JobSystem::FindJob(JobQueue* threadQueue)
+{
+    Job* job = threadQueue ? threadQueue->Pop() : nullptr;
+
+    if (!job && m_externalJobCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        if (!m_externalJobs.empty())
+        {
+            job = m_externalJobs.back();
+            m_externalJobs.pop_back();
+            m_externalJobCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!job)
+    {
+        unsigned int queueCount = static_cast<unsigned int>(m_queues.size());
+        for (unsigned int i = 0; i < queueCount && !job; ++i)
+        {
+            JobQueue* queue = m_queues[(s_stealOffset + i) % queueCount].get();
+            if (queue != threadQueue)
+            {
+                job = queue->Steal();
+            }
+        }
+        ++s_stealOffset;
+    }
+
+    if (job)
+    {
+        m_queuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->function();
+
+    // Released first, so the job is free when the waiting thread sees the counter
+    Counter* counter = job->counter;
+    DestroyJob(job);
+    if (counter)
+    {
+        counter->m_count.fetch_sub(1, std::memory_order_release);
+    }
+}
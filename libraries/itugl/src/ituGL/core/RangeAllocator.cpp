@@ -0,0 +1,121 @@
+#include <ituGL/core/RangeAllocator.h>
+
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+RangeAllocator::RangeAllocator(size_t capacity) : m_capacity(0), m_allocatedSize(0)
+{
+    Grow(capacity);
+}
+
+size_t RangeAllocator::GetLargestFreeSize() const
+{
+    size_t largestSize = 0;
+    for (const auto& freeRange : m_freeRanges)
+    {
+        largestSize = std::max(largestSize, freeRange.second);
+    }
+    return largestSize;
+}
+
+size_t RangeAllocator::Allocate(size_t size)
+{
+    assert(size > 0);
+
+    // Find the first free range that fits
+    auto itFree = std::find_if(m_freeRanges.begin(), m_freeRanges.end(),
+        [size](const auto& freeRange) { return freeRange.second >= size; });
+    if (itFree == m_freeRanges.end())
+    {
+        return InvalidOffset;
+    }
+
+    // Take the beginning of the free range, and keep the rest free
+    size_t offset = itFree->first;
+    size_t remainingSize = itFree->second - size;
+    m_freeRanges.erase(itFree);
+    if (remainingSize > 0)
+    {
+        m_freeRanges[offset + size] = remainingSize;
+    }
+
+    m_allocations[offset] = size;
+    m_allocatedSize += size;
+    return offset;
+}
+
+void RangeAllocator::Free(size_t offset)
+{
+    auto itAllocation = m_allocations.find(offset);
+    assert(itAllocation != m_allocations.end());
+
+    size_t size = itAllocation->second;
+    m_allocations.erase(itAllocation);
+    m_allocatedSize -= size;
+
+    AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Grow(size_t capacity)
+{
+    assert(capacity >= m_capacity);
+    if (capacity > m_capacity)
+    {
+        AddFreeRange(m_capacity, capacity - m_capacity);
+        m_capacity = capacity;
+    }
+}
+
+std::vector<RangeAllocator::Relocation> RangeAllocator::Compact()
+{
+    std::vector<Relocation> relocations;
+
+    std::map<size_t, size_t> allocations;
+    size_t offset = 0;
+    for (const auto& allocation : m_allocations)
+    {
+        if (allocation.first != offset)
+        {
+            relocations.push_back(Relocation{ allocation.first, offset, allocation.second });
+        }
+        allocations[offset] = allocation.second;
+        offset += allocation.second;
+    }
+    m_allocations.swap(allocations);
+
+    m_freeRanges.clear();
+    if (offset < m_capacity)
+    {
+        m_freeRanges[offset] = m_capacity - offset;
+    }
+
+    return relocations;
+}
+
+void RangeAllocator::AddFreeRange(size_t offset, size_t size)
+{
+    auto itNext = m_freeRanges.lower_bound(offset);
+
+    // Merge with the previous free range, if it ends where this one starts
+    if (itNext != m_freeRanges.begin())
+    {
+        auto itPrevious = std::prev(itNext);
+        assert(itPrevious->first + itPrevious->second <= offset);
+        if (itPrevious->first + itPrevious->second == offset)
+        {
+            offset = itPrevious->first;
+            size += itPrevious->second;
+            m_freeRanges.erase(itPrevious);
+        }
+    }
+
+    // Merge with the next free range, if it starts where this one ends
+    if (itNext != m_freeRanges.end() && offset + size == itNext->first)
+    {
+        size += itNext->second;
+        m_freeRanges.erase(itNext);
+    }
+
+    m_freeRanges[offset] = size;
+}
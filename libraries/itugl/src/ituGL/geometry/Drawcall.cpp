@@ -5,7 +5,7 @@
 #include <cassert>
 
 Drawcall::Drawcall()
-    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_eboType(Data::Type::None)
+    : m_primitive(Primitive::Invalid), m_first(0), m_count(0), m_baseVertex(0), m_eboType(Data::Type::None)
 {
 }
 
@@ -14,12 +14,13 @@ Drawcall::Drawcall(Primitive primitive, GLsizei count, GLint first)
 {
 }
 
-Drawcall::Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first)
-    : m_primitive(primitive), m_first(first), m_count(count), m_eboType(eboType)
+Drawcall::Drawcall(Primitive primitive, GLsizei count, Data::Type eboType, GLint first, GLint baseVertex)
+    : m_primitive(primitive), m_first(first), m_count(count), m_baseVertex(baseVertex), m_eboType(eboType)
 {
     assert(primitive != Primitive::Invalid);
     assert(first >= 0);
     assert(count > 0);
+    assert(baseVertex == 0 || eboType != Data::Type::None);
 }
 
 // Execute the drawcall
@@ -36,9 +37,18 @@ void Drawcall::Draw() const
     }
     else
     {
-        // If there is an EBO, use glDrawElements
+        // If there is an EBO, use glDrawElements, or glDrawElementsBaseVertex if the vertices don't start at 0
         assert(ElementBufferObject::IsSupportedType(m_eboType));
+        // m_first is an element index, converted to a byte offset in the EBO
         const char* basePointer = nullptr; // Actual element pointer is in VAO
-        glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), basePointer + m_first);
+        const void* elements = basePointer + m_first * Data::GetTypeSize(m_eboType);
+        if (m_baseVertex == 0)
+        {
+            glDrawElements(primitive, m_count, static_cast<GLenum>(m_eboType), elements);
+        }
+        else
+        {
+            glDrawElementsBaseVertex(primitive, m_count, static_cast<GLenum>(m_eboType), elements, m_baseVertex);
+        }
     }
 }
@@ -0,0 +1,373 @@
+#include <ituGL/geometry/GeometryArena.h>
+
+#include <ituGL/geometry/Mesh.h>
+#include <algorithm>
+#include <cassert>
+
+GeometryArena::GeometryArena(size_t poolSize, size_t elementCapacity)
+    : m_poolSize(poolSize)
+{
+    // Make sure the EBO is not attached to any VAO by accident
+    VertexArrayObject::Unbind();
+    m_ebo.Bind();
+    m_ebo.AllocateData<unsigned int>(elementCapacity);
+    ElementBufferObject::Unbind();
+
+    m_elementAllocator.Grow(elementCapacity);
+}
+
+GeometryArena::Handle GeometryArena::Allocate(const VertexFormat& vertexFormat, std::span<const std::byte> vertexData,
+    std::span<const unsigned int> elements, const SemanticMap& locations, std::span<const std::byte> positionData)
+{
+    size_t vertexSize = vertexFormat.GetSize();
+    assert(vertexSize > 0 && vertexData.size() % vertexSize == 0);
+    assert(!elements.empty());
+    size_t vertexCount = vertexData.size() / vertexSize;
+
+    // Resolve the location of each attribute, the same way Mesh does
+    std::vector<GLuint> attributeLocations;
+    GLuint location = 0;
+    for (int i = 0; i < vertexFormat.GetAttributeCount(); ++i)
+    {
+        VertexAttribute attribute = vertexFormat.GetAttribute(i);
+        auto itLocation = locations.find(attribute.GetSemantic());
+        if (itLocation != locations.end())
+        {
+            location = itLocation->second;
+        }
+        attributeLocations.push_back(location);
+        location += attribute.GetLocationSize();
+    }
+
+    unsigned int poolIndex = FindPool(vertexFormat, attributeLocations, vertexCount);
+    VertexPool& pool = m_pools[poolIndex];
+    size_t baseVertex = pool.allocator.Allocate(vertexCount);
+    assert(baseVertex != RangeAllocator::InvalidOffset);
+
+    size_t firstElement = m_elementAllocator.Allocate(elements.size());
+    if (firstElement == RangeAllocator::InvalidOffset)
+    {
+        GrowElementBuffer(std::max(m_elementAllocator.GetCapacity() * 2, m_elementAllocator.GetCapacity() + elements.size()));
+        firstElement = m_elementAllocator.Allocate(elements.size());
+        assert(firstElement != RangeAllocator::InvalidOffset);
+    }
+
+    // Upload the data. Unbind the VAO first, so binding the EBO doesn't modify it
+    VertexArrayObject::Unbind();
+
+    pool.vbo.Bind();
+    pool.vbo.UpdateData(vertexData, baseVertex * vertexSize);
+    VertexBufferObject::Unbind();
+
+    // The new allocation is not registered yet, so the stream is only filled with the positions of the previous ones
+    if (!positionData.empty() && pool.positionSize == 0)
+    {
+        CreatePositionStream(poolIndex);
+    }
+    if (!positionData.empty())
+    {
+        assert(positionData.size() == vertexCount * pool.positionSize);
+        pool.positionVbo.Bind();
+        pool.positionVbo.UpdateData(positionData, baseVertex * pool.positionSize);
+        VertexBufferObject::Unbind();
+    }
+    else if (pool.positionSize > 0)
+    {
+        CopyPositions(pool, vertexData, baseVertex);
+    }
+
+    m_ebo.Bind();
+    m_ebo.UpdateData(elements, firstElement * sizeof(unsigned int));
+    ElementBufferObject::Unbind();
+
+    // Reuse a released handle if possible
+    Handle handle = static_cast<Handle>(m_allocations.size());
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        m_allocations.emplace_back();
+    }
+
+    Allocation& allocation = m_allocations[handle];
+    allocation.poolIndex = poolIndex;
+    allocation.baseVertex = static_cast<GLint>(baseVertex);
+    allocation.vertexCount = static_cast<GLsizei>(vertexCount);
+    allocation.firstElement = static_cast<GLint>(firstElement);
+    allocation.elementCount = static_cast<GLsizei>(elements.size());
+    return handle;
+}
+
+void GeometryArena::Free(Handle handle)
+{
+    Allocation& allocation = m_allocations[handle];
+    assert(allocation.vertexCount > 0);
+
+    m_pools[allocation.poolIndex].allocator.Free(allocation.baseVertex);
+    m_elementAllocator.Free(allocation.firstElement);
+
+    allocation.vertexCount = 0;
+    allocation.elementCount = 0;
+    m_freeHandles.push_back(handle);
+}
+
+size_t GeometryArena::GetAllocatedSize() const
+{
+    size_t size = m_elementAllocator.GetAllocatedSize() * sizeof(unsigned int);
+    for (const VertexPool& pool : m_pools)
+    {
+        size += pool.allocator.GetAllocatedSize() * (pool.vertexFormat.GetSize() + pool.positionSize);
+    }
+    return size;
+}
+
+size_t GeometryArena::GetCapacity() const
+{
+    size_t size = m_elementAllocator.GetCapacity() * sizeof(unsigned int);
+    for (const VertexPool& pool : m_pools)
+    {
+        size += pool.allocator.GetCapacity() * (pool.vertexFormat.GetSize() + pool.positionSize);
+    }
+    return size;
+}
+
+bool GeometryArena::Defragment()
+{
+    bool moved = false;
+
+    // Relocations are sorted by their old offset, so we can search them
+    auto findRelocation = [](const std::vector<RangeAllocator::Relocation>& relocations, size_t offset)
+    {
+        auto it = std::lower_bound(relocations.begin(), relocations.end(), offset,
+            [](const RangeAllocator::Relocation& relocation, size_t offset) { return relocation.oldOffset < offset; });
+        return it != relocations.end() && it->oldOffset == offset ? it->newOffset : offset;
+    };
+
+    for (unsigned int poolIndex = 0; poolIndex < m_pools.size(); ++poolIndex)
+    {
+        VertexPool& pool = m_pools[poolIndex];
+        std::vector<RangeAllocator::Relocation> relocations = pool.allocator.Compact();
+        if (relocations.empty())
+        {
+            continue;
+        }
+
+        RelocateBufferData(pool.vbo, relocations, pool.vertexFormat.GetSize());
+        if (pool.positionSize > 0)
+        {
+            RelocateBufferData(pool.positionVbo, relocations, pool.positionSize);
+        }
+        for (Allocation& allocation : m_allocations)
+        {
+            if (allocation.vertexCount > 0 && allocation.poolIndex == poolIndex)
+            {
+                allocation.baseVertex = static_cast<GLint>(findRelocation(relocations, allocation.baseVertex));
+            }
+        }
+        moved = true;
+    }
+
+    std::vector<RangeAllocator::Relocation> relocations = m_elementAllocator.Compact();
+    if (!relocations.empty())
+    {
+        RelocateBufferData(m_ebo, relocations, sizeof(unsigned int));
+        for (Allocation& allocation : m_allocations)
+        {
+            if (allocation.elementCount > 0)
+            {
+                allocation.firstElement = static_cast<GLint>(findRelocation(relocations, allocation.firstElement));
+            }
+        }
+        moved = true;
+    }
+
+    // The meshes move their drawcalls with the allocations
+    if (moved)
+    {
+        for (Mesh* mesh : m_meshes)
+        {
+            mesh->UpdateArenaDrawcalls();
+        }
+    }
+
+    return moved;
+}
+
+void GeometryArena::RegisterMesh(Mesh& mesh)
+{
+    assert(std::find(m_meshes.begin(), m_meshes.end(), &mesh) == m_meshes.end());
+    m_meshes.push_back(&mesh);
+}
+
+void GeometryArena::UnregisterMesh(Mesh& mesh)
+{
+    auto itMesh = std::find(m_meshes.begin(), m_meshes.end(), &mesh);
+    assert(itMesh != m_meshes.end());
+    // The order doesn't matter, swap with the last one
+    *itMesh = m_meshes.back();
+    m_meshes.pop_back();
+}
+
+unsigned int GeometryArena::FindPool(const VertexFormat& vertexFormat, const std::vector<GLuint>& locations, size_t vertexCount)
+{
+    for (unsigned int poolIndex = 0; poolIndex < m_pools.size(); ++poolIndex)
+    {
+        const VertexPool& pool = m_pools[poolIndex];
+        if (pool.locations != locations || pool.vertexFormat.GetAttributeCount() != vertexFormat.GetAttributeCount()
+            || pool.allocator.GetLargestFreeSize() < vertexCount)
+        {
+            continue;
+        }
+
+        bool sameFormat = true;
+        for (int i = 0; i < vertexFormat.GetAttributeCount() && sameFormat; ++i)
+        {
+            VertexAttribute a = pool.vertexFormat.GetAttribute(i);
+            VertexAttribute b = vertexFormat.GetAttribute(i);
+            sameFormat = a.GetType() == b.GetType() && a.GetComponents() == b.GetComponents() && a.IsNormalized() == b.IsNormalized();
+        }
+        if (sameFormat)
+        {
+            return poolIndex;
+        }
+    }
+
+    // No pool found, create a new one with enough space
+    size_t vertexCapacity = std::max(m_poolSize / vertexFormat.GetSize(), vertexCount);
+    return CreatePool(vertexFormat, locations, vertexCapacity);
+}
+
+unsigned int GeometryArena::CreatePool(const VertexFormat& vertexFormat, const std::vector<GLuint>& locations, size_t vertexCapacity)
+{
+    unsigned int poolIndex = static_cast<unsigned int>(m_pools.size());
+    VertexPool& pool = m_pools.emplace_back(VertexPool{ vertexFormat, locations, VertexBufferObject(), VertexArrayObject(), RangeAllocator(vertexCapacity),
+        VertexBufferObject(), VertexArrayObject(), 0, 0 });
+
+    pool.vao.Bind();
+
+    pool.vbo.Bind();
+    pool.vbo.AllocateData(vertexCapacity * vertexFormat.GetSize());
+
+    // Interleaved attributes, each one in the resolved location
+    int attributeIndex = 0;
+    for (auto it = pool.vertexFormat.LayoutBegin(static_cast<int>(vertexCapacity), true); it != pool.vertexFormat.LayoutEnd(); it++, attributeIndex++)
+    {
+        pool.vao.SetAttribute(locations[attributeIndex], it->GetAttribute(), it->GetOffset(), it->GetStride());
+    }
+
+    // The EBO binding is stored in the VAO
+    m_ebo.Bind();
+
+    VertexArrayObject::Unbind();
+    VertexBufferObject::Unbind();
+    ElementBufferObject::Unbind();
+
+    return poolIndex;
+}
+
+void GeometryArena::CreatePositionStream(unsigned int poolIndex)
+{
+    VertexPool& pool = m_pools[poolIndex];
+    int positionIndex = pool.vertexFormat.FindAttribute(VertexAttribute::Semantic::Position);
+    assert(positionIndex >= 0);
+    VertexAttribute positionAttribute = pool.vertexFormat.GetAttribute(positionIndex);
+    pool.positionSize = positionAttribute.GetSize();
+    pool.positionOffset = pool.vertexFormat.GetAttributeOffset(positionIndex);
+
+    pool.positionVao.Bind();
+
+    pool.positionVbo.Bind();
+    pool.positionVbo.AllocateData(pool.allocator.GetCapacity() * pool.positionSize);
+
+    // Same location as in the full VAO, so the same shaders can read it
+    pool.positionVao.SetAttribute(pool.locations[positionIndex], positionAttribute, 0, static_cast<GLsizei>(pool.positionSize));
+
+    m_ebo.Bind();
+
+    VertexArrayObject::Unbind();
+    VertexBufferObject::Unbind();
+    ElementBufferObject::Unbind();
+
+    // Fill the positions of the allocations uploaded before the stream existed
+    size_t vertexSize = pool.vertexFormat.GetSize();
+    std::vector<std::byte> vertexData;
+    for (const Allocation& allocation : m_allocations)
+    {
+        if (allocation.vertexCount == 0 || allocation.poolIndex != poolIndex)
+        {
+            continue;
+        }
+
+        vertexData.resize(allocation.vertexCount * vertexSize);
+        pool.vbo.Bind();
+        const void* mappedData = pool.vbo.MapRange(allocation.baseVertex * vertexSize, vertexData.size(), BufferObject::MapRead);
+        if (mappedData)
+        {
+            std::copy_n(static_cast<const std::byte*>(mappedData), vertexData.size(), vertexData.data());
+        }
+        bool valid = mappedData && pool.vbo.Unmap();
+        VertexBufferObject::Unbind();
+        assert(valid);
+
+        if (valid)
+        {
+            CopyPositions(pool, vertexData, allocation.baseVertex);
+        }
+    }
+}
+
+void GeometryArena::CopyPositions(VertexPool& pool, std::span<const std::byte> vertexData, size_t baseVertex)
+{
+    size_t vertexSize = pool.vertexFormat.GetSize();
+    size_t vertexCount = vertexData.size() / vertexSize;
+    std::vector<std::byte> positionData(vertexCount * pool.positionSize);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        std::copy_n(vertexData.data() + i * vertexSize + pool.positionOffset, pool.positionSize, positionData.data() + i * pool.positionSize);
+    }
+
+    pool.positionVbo.Bind();
+    pool.positionVbo.UpdateData(positionData, baseVertex * pool.positionSize);
+    VertexBufferObject::Unbind();
+}
+
+void GeometryArena::GrowElementBuffer(size_t elementCapacity)
+{
+    size_t size = m_elementAllocator.GetCapacity() * sizeof(unsigned int);
+
+    // Keep a copy of the current elements while the buffer is reallocated. The handle doesn't change, so the VAOs remain valid
+    VertexBufferObject copyBuffer;
+    copyBuffer.Bind();
+    copyBuffer.AllocateData(size, BufferObject::StreamCopy);
+    VertexBufferObject::Unbind();
+    copyBuffer.CopyData(m_ebo, 0, 0, size);
+
+    VertexArrayObject::Unbind();
+    m_ebo.Bind();
+    m_ebo.AllocateData<unsigned int>(elementCapacity);
+    ElementBufferObject::Unbind();
+    m_ebo.CopyData(copyBuffer, 0, 0, size);
+
+    m_elementAllocator.Grow(elementCapacity);
+}
+
+void GeometryArena::RelocateBufferData(BufferObject& buffer, std::span<const RangeAllocator::Relocation> relocations, size_t unitSize)
+{
+    // Allocations that didn't move are all at the beginning, so only the range from the first relocation needs to be copied
+    size_t start = relocations.front().newOffset;
+    size_t end = relocations.back().newOffset + relocations.back().size;
+
+    VertexBufferObject copyBuffer;
+    copyBuffer.Bind();
+    copyBuffer.AllocateData((end - start) * unitSize, BufferObject::StreamCopy);
+    VertexBufferObject::Unbind();
+
+    for (const RangeAllocator::Relocation& relocation : relocations)
+    {
+        copyBuffer.CopyData(buffer, relocation.oldOffset * unitSize, (relocation.newOffset - start) * unitSize, relocation.size * unitSize);
+    }
+    buffer.CopyData(copyBuffer, 0, start * unitSize, (end - start) * unitSize);
+}
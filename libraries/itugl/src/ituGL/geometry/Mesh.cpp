@@ -1,9 +1,79 @@
 #include <ituGL/geometry/Mesh.h>
 
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
 Mesh::Mesh()
 {
 }
 
+Mesh::~Mesh()
+{
+    FreeArenaData();
+}
+
+Mesh::Mesh(Mesh&& mesh) noexcept
+    : m_vbos(std::move(mesh.m_vbos))
+    , m_ebos(std::move(mesh.m_ebos))
+    , m_vaos(std::move(mesh.m_vaos))
+    , m_submeshes(std::move(mesh.m_submeshes))
+    , m_geometryArena(std::move(mesh.m_geometryArena))
+    , m_arenaHandles(std::exchange(mesh.m_arenaHandles, {}))
+    , m_occluderPositions(std::move(mesh.m_occluderPositions))
+    , m_occluderIndices(std::move(mesh.m_occluderIndices))
+    , m_occluderError(mesh.m_occluderError)
+{
+    // The arena updates the mesh that owns the allocations now
+    if (!m_arenaHandles.empty())
+    {
+        m_geometryArena->UnregisterMesh(mesh);
+        m_geometryArena->RegisterMesh(*this);
+    }
+}
+
+Mesh& Mesh::operator = (Mesh&& mesh) noexcept
+{
+    if (this != &mesh)
+    {
+        // Free the allocations being replaced, before taking the ones of the other mesh
+        FreeArenaData();
+
+        m_vbos = std::move(mesh.m_vbos);
+        m_ebos = std::move(mesh.m_ebos);
+        m_vaos = std::move(mesh.m_vaos);
+        m_submeshes = std::move(mesh.m_submeshes);
+        m_geometryArena = std::move(mesh.m_geometryArena);
+        m_arenaHandles = std::exchange(mesh.m_arenaHandles, {});
+        m_occluderPositions = std::move(mesh.m_occluderPositions);
+        m_occluderIndices = std::move(mesh.m_occluderIndices);
+        m_occluderError = mesh.m_occluderError;
+
+        if (!m_arenaHandles.empty())
+        {
+            m_geometryArena->UnregisterMesh(mesh);
+            m_geometryArena->RegisterMesh(*this);
+        }
+    }
+    return *this;
+}
+
+void Mesh::FreeArenaData()
+{
+    if (m_arenaHandles.empty())
+    {
+        return;
+    }
+
+    // Release the space used in the geometry arena
+    for (GeometryArena::Handle handle : m_arenaHandles)
+    {
+        m_geometryArena->Free(handle);
+    }
+    m_arenaHandles.clear();
+    m_geometryArena->UnregisterMesh(*this);
+}
+
 unsigned int Mesh::AddVertexData(size_t size)
 {
     unsigned int vboIndex = GetVertexBufferCount();
@@ -25,10 +95,121 @@ unsigned int Mesh::AddSubmesh(unsigned int vaoIndex, const Drawcall& drawcall)
     unsigned int submeshIndex = GetSubmeshCount();
     Submesh& submesh = m_submeshes.emplace_back();
     submesh.vaoIndex = vaoIndex;
+    submesh.positionVaoIndex = -1;
     submesh.drawcall = drawcall;
+    submesh.transform = glm::mat4(1.0f);
+    submesh.boundingSphere = glm::vec4(0.0f);
+    submesh.arenaHandle = GeometryArena::InvalidHandle;
+    submesh.arenaFirstElement = 0;
+    submesh.arenaBaseVertex = 0;
     return submeshIndex;
 }
 
+unsigned int Mesh::AddSubmeshLod(unsigned int submeshIndex, const Drawcall& drawcall, float error)
+{
+    Submesh& submesh = GetSubmesh(submeshIndex);
+    SubmeshLod& lod = submesh.lods.emplace_back(SubmeshLod{ drawcall, error });
+    if (submesh.arenaHandle != GeometryArena::InvalidHandle)
+    {
+        lod.drawcall.SetFirst(lod.drawcall.GetFirst() + submesh.arenaFirstElement);
+        lod.drawcall.SetBaseVertex(submesh.arenaBaseVertex);
+    }
+    return static_cast<unsigned int>(submesh.lods.size());
+}
+
+void Mesh::AddOccluder(std::span<const glm::vec3> positions, std::span<const unsigned int> indices, float error)
+{
+    m_occluderError = std::max(m_occluderError, error);
+
+    unsigned int firstIndex = static_cast<unsigned int>(m_occluderPositions.size());
+    m_occluderPositions.insert(m_occluderPositions.end(), positions.begin(), positions.end());
+    for (unsigned int index : indices)
+    {
+        assert(index < positions.size());
+        m_occluderIndices.push_back(firstIndex + index);
+    }
+}
+
+void Mesh::SetGeometryArena(std::shared_ptr<GeometryArena> geometryArena)
+{
+    assert(m_arenaHandles.empty());
+    m_geometryArena = geometryArena;
+}
+
+GeometryArena::Handle Mesh::AddArenaData(const VertexFormat& vertexFormat, std::span<const std::byte> vertexData,
+    std::span<const unsigned int> elements, const SemanticMap& locations, std::span<const std::byte> positionData)
+{
+    assert(m_geometryArena);
+    GeometryArena::Handle handle = m_geometryArena->Allocate(vertexFormat, vertexData, elements, locations, positionData);
+    // Registered while the mesh owns allocations, so Defragment updates its drawcalls
+    if (m_arenaHandles.empty())
+    {
+        m_geometryArena->RegisterMesh(*this);
+    }
+    m_arenaHandles.push_back(handle);
+    return handle;
+}
+
+unsigned int Mesh::AddArenaSubmesh(GeometryArena::Handle handle, Drawcall::Primitive primitive, int firstElement, int elementCount)
+{
+    assert(m_geometryArena);
+    const GeometryArena::Allocation& allocation = m_geometryArena->GetAllocation(handle);
+    assert(firstElement + elementCount <= allocation.elementCount);
+
+    Drawcall drawcall(primitive, elementCount, m_geometryArena->GetElementType(), allocation.firstElement + firstElement, allocation.baseVertex);
+    unsigned int submeshIndex = AddSubmesh(0, drawcall);
+
+    Submesh& submesh = GetSubmesh(submeshIndex);
+    submesh.arenaHandle = handle;
+    submesh.arenaFirstElement = allocation.firstElement;
+    submesh.arenaBaseVertex = allocation.baseVertex;
+    return submeshIndex;
+}
+
+void Mesh::UpdateArenaDrawcalls()
+{
+    for (Submesh& submesh : m_submeshes)
+    {
+        if (submesh.arenaHandle == GeometryArena::InvalidHandle)
+        {
+            continue;
+        }
+
+        // Move the drawcalls by the same amount as the allocation
+        const GeometryArena::Allocation& allocation = m_geometryArena->GetAllocation(submesh.arenaHandle);
+        GLint firstElementOffset = allocation.firstElement - submesh.arenaFirstElement;
+        submesh.drawcall.SetFirst(submesh.drawcall.GetFirst() + firstElementOffset);
+        submesh.drawcall.SetBaseVertex(allocation.baseVertex);
+        for (SubmeshLod& lod : submesh.lods)
+        {
+            lod.drawcall.SetFirst(lod.drawcall.GetFirst() + firstElementOffset);
+            lod.drawcall.SetBaseVertex(allocation.baseVertex);
+        }
+        submesh.arenaFirstElement = allocation.firstElement;
+        submesh.arenaBaseVertex = allocation.baseVertex;
+    }
+}
+
+const VertexArrayObject& Mesh::GetSubmeshVertexArray(unsigned int submeshIndex) const
+{
+    const Submesh& submesh = GetSubmesh(submeshIndex);
+    if (submesh.arenaHandle != GeometryArena::InvalidHandle)
+    {
+        return m_geometryArena->GetVertexArray(m_geometryArena->GetAllocation(submesh.arenaHandle).poolIndex);
+    }
+    return m_vaos[submesh.vaoIndex];
+}
+
+const VertexArrayObject& Mesh::GetSubmeshPositionVertexArray(unsigned int submeshIndex) const
+{
+    const Submesh& submesh = GetSubmesh(submeshIndex);
+    if (submesh.arenaHandle != GeometryArena::InvalidHandle)
+    {
+        return m_geometryArena->GetPositionVertexArray(m_geometryArena->GetAllocation(submesh.arenaHandle).poolIndex);
+    }
+    return submesh.positionVaoIndex >= 0 ? m_vaos[submesh.positionVaoIndex] : m_vaos[submesh.vaoIndex];
+}
+
 unsigned int Mesh::AddSubmesh(unsigned int vaoIndex,
     Drawcall::Primitive primitive, GLint first, GLsizei count, Data::Type eboType)
 {
@@ -39,7 +220,7 @@ unsigned int Mesh::AddSubmesh(unsigned int vaoIndex,
 void Mesh::DrawSubmesh(int submeshIndex) const
 {
     const Submesh& submesh = GetSubmesh(submeshIndex);
-    const VertexArrayObject& vao = GetVertexArray(submesh.vaoIndex);
+    const VertexArrayObject& vao = GetSubmeshVertexArray(submeshIndex);
     vao.Bind();
     submesh.drawcall.Draw();
     //VertexArrayObject::Unbind(); // No need to unbind
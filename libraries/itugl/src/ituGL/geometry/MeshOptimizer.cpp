@@ -0,0 +1,350 @@
+#include <ituGL/geometry/MeshOptimizer.h>
+
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+namespace
+{
+    // FIFO cache simulation. A vertex is cached if less than cacheSize misses happened since it was loaded
+    class FifoCache
+    {
+    public:
+        FifoCache(unsigned int vertexCount, unsigned int cacheSize)
+            : m_loadTime(vertexCount, 0), m_missCount(cacheSize), m_cacheSize(cacheSize)
+        {
+        }
+
+        // Returns true if the vertex was not in the cache, and loads it
+        bool Access(unsigned int vertex)
+        {
+            if (m_missCount - m_loadTime[vertex] < m_cacheSize)
+            {
+                return false;
+            }
+            m_loadTime[vertex] = m_missCount++;
+            return true;
+        }
+
+        // Evict all the vertices
+        void Flush()
+        {
+            m_missCount += m_cacheSize;
+        }
+
+    private:
+        std::vector<unsigned int> m_loadTime;
+        unsigned int m_missCount;
+        unsigned int m_cacheSize;
+    };
+
+    unsigned int GetVertexCount(std::span<const unsigned int> indices)
+    {
+        return indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) + 1;
+    }
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const unsigned int> indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+
+    CacheStatistics statistics = { 0.0f, 0.0f };
+    if (indices.empty())
+    {
+        return statistics;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    unsigned int misses = 0;
+    unsigned int referencedCount = 0;
+    for (unsigned int index : indices)
+    {
+        assert(index < vertexCount);
+        if (cache.Access(index))
+        {
+            ++misses;
+        }
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            ++referencedCount;
+        }
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<unsigned int> indices, unsigned int vertexCount,
+    std::vector<unsigned int>& clusters, unsigned int cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+
+    clusters.clear();
+    unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Build the vertex-triangle adjacency, stored contiguously with an offset per vertex
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices)
+    {
+        assert(index < vertexCount);
+        ++liveTriangles[index];
+    }
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (unsigned int i = 0; i < indices.size(); ++i)
+    {
+        adjacency[adjacencyFill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEndStack;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int timeStamp = cacheSize + 1;
+    unsigned int cursor = 0;
+    const unsigned int invalidVertex = ~0u;
+
+    // Start a new cluster every time we jump to a vertex that is not connected to the last fan
+    unsigned int fanningVertex = 0;
+    clusters.push_back(0);
+    while (fanningVertex != invalidVertex)
+    {
+        // Emit all the remaining triangles around the fanning vertex
+        candidates.clear();
+        for (unsigned int i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; ++i)
+        {
+            unsigned int triangle = adjacency[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+
+            for (unsigned int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (timeStamp - cacheTime[vertex] > cacheSize)
+                {
+                    cacheTime[vertex] = timeStamp++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Pick the candidate that will still be in the cache after fanning around it, and is the oldest in the cache
+        unsigned int nextVertex = invalidVertex;
+        int bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+
+            int priority = 0;
+            if (timeStamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+            {
+                priority = timeStamp - cacheTime[vertex];
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        // Dead end: try the recently used vertices first, and then the next vertex in input order
+        if (nextVertex == invalidVertex)
+        {
+            while (!deadEndStack.empty() && nextVertex == invalidVertex)
+            {
+                unsigned int vertex = deadEndStack.back();
+                deadEndStack.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    nextVertex = vertex;
+                }
+            }
+            while (cursor < vertexCount && nextVertex == invalidVertex)
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    nextVertex = cursor;
+                }
+                else
+                {
+                    ++cursor;
+                }
+            }
+
+            unsigned int emittedTriangles = static_cast<unsigned int>(output.size() / 3);
+            if (nextVertex != invalidVertex && emittedTriangles > clusters.back())
+            {
+                clusters.push_back(emittedTriangles);
+            }
+        }
+
+        fanningVertex = nextVertex;
+    }
+
+    assert(output.size() == indices.size());
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<unsigned int> indices, std::span<const glm::vec3> positions,
+    std::span<const unsigned int> clusters, float threshold, unsigned int cacheSize)
+{
+    assert(indices.size() % 3 == 0);
+
+    unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (triangleCount == 0 || clusters.empty())
+    {
+        return;
+    }
+
+    std::vector<unsigned int> softClusters;
+    SplitClusters(indices, clusters, softClusters, threshold, cacheSize);
+    unsigned int clusterCount = static_cast<unsigned int>(softClusters.size());
+
+    // Accumulate the area weighted centroid and normal of each cluster, and of the whole mesh
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterAreas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (unsigned int cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        unsigned int end = cluster + 1 < clusterCount ? softClusters[cluster + 1] : triangleCount;
+        for (unsigned int triangle = softClusters[cluster]; triangle < end; ++triangle)
+        {
+            const glm::vec3& p0 = positions[indices[triangle * 3 + 0]];
+            const glm::vec3& p1 = positions[indices[triangle * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[triangle * 3 + 2]];
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (p0 + p1 + p2) * (area / 3.0f);
+
+            clusterCentroids[cluster] += centroid;
+            clusterNormals[cluster] += normal;
+            clusterAreas[cluster] += area;
+            meshCentroid += centroid;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters that are far out along their own normal are likely to occlude the rest of the mesh
+    std::vector<float> occlusionPotential(clusterCount, 0.0f);
+    for (unsigned int cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        float normalLength = glm::length(clusterNormals[cluster]);
+        if (clusterAreas[cluster] > 0.0f && normalLength > 0.0f)
+        {
+            glm::vec3 centroid = clusterCentroids[cluster] / clusterAreas[cluster];
+            occlusionPotential[cluster] = glm::dot(centroid - meshCentroid, clusterNormals[cluster] / normalLength);
+        }
+    }
+
+    std::vector<unsigned int> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+        [&](unsigned int a, unsigned int b) { return occlusionPotential[a] > occlusionPotential[b]; });
+
+    // Write the triangles of each cluster in the new order
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (unsigned int cluster : clusterOrder)
+    {
+        unsigned int end = cluster + 1 < clusterCount ? softClusters[cluster + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + softClusters[cluster] * 3, indices.begin() + end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+unsigned int MeshOptimizer::OptimizeVertexFetch(std::span<unsigned int> indices, std::vector<unsigned char>& vertexData, size_t vertexSize)
+{
+    assert(vertexSize > 0 && vertexData.size() % vertexSize == 0);
+
+    const unsigned int invalidVertex = ~0u;
+    std::vector<unsigned int> remap(vertexData.size() / vertexSize, invalidVertex);
+    std::vector<unsigned char> output;
+    output.reserve(vertexData.size());
+
+    unsigned int vertexCount = 0;
+    for (unsigned int& index : indices)
+    {
+        assert(index < remap.size());
+        if (remap[index] == invalidVertex)
+        {
+            remap[index] = vertexCount++;
+            output.insert(output.end(), vertexData.begin() + index * vertexSize, vertexData.begin() + (index + 1) * vertexSize);
+        }
+        index = remap[index];
+    }
+
+    vertexData.swap(output);
+    return vertexCount;
+}
+
+void MeshOptimizer::SplitClusters(std::span<const unsigned int> indices, std::span<const unsigned int> hardClusters,
+    std::vector<unsigned int>& softClusters, float threshold, unsigned int cacheSize)
+{
+    unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    FifoCache cache(GetVertexCount(indices), cacheSize);
+
+    softClusters.clear();
+    for (unsigned int cluster = 0; cluster < hardClusters.size(); ++cluster)
+    {
+        unsigned int start = hardClusters[cluster];
+        unsigned int end = cluster + 1 < hardClusters.size() ? hardClusters[cluster + 1] : triangleCount;
+
+        // Cache miss ratio of the full cluster, starting with a cold cache
+        cache.Flush();
+        unsigned int clusterMisses = 0;
+        for (unsigned int i = start * 3; i < end * 3; ++i)
+        {
+            clusterMisses += cache.Access(indices[i]) ? 1 : 0;
+        }
+        float maxAcmr = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        // Start a new cluster as soon as the current one is as efficient as the full one would be
+        cache.Flush();
+        softClusters.push_back(start);
+        unsigned int misses = 0;
+        for (unsigned int triangle = start; triangle < end; ++triangle)
+        {
+            for (unsigned int corner = 0; corner < 3; ++corner)
+            {
+                misses += cache.Access(indices[triangle * 3 + corner]) ? 1 : 0;
+            }
+
+            unsigned int triangles = triangle + 1 - softClusters.back();
+            if (triangle + 1 < end && static_cast<float>(misses) <= maxAcmr * static_cast<float>(triangles))
+            {
+                softClusters.push_back(triangle + 1);
+                cache.Flush();
+                misses = 0;
+            }
+        }
+    }
+}
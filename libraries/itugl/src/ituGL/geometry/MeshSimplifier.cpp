@@ -0,0 +1,456 @@
+#include <ituGL/geometry/MeshSimplifier.h>
+
+#include <glm/geometric.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+
+namespace
+{
+    // Symmetric 4x4 matrix that accumulates the squared distance to a set of planes
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double weight;
+
+        static Quadric FromPlane(const glm::vec3& normal, float distance, float weight)
+        {
+            double x = normal.x, y = normal.y, z = normal.z, d = distance;
+            return Quadric{ x * x * weight, x * y * weight, x * z * weight, y * y * weight, y * z * weight, z * z * weight,
+                x * d * weight, y * d * weight, z * d * weight, d * d * weight, weight };
+        }
+
+        Quadric& operator += (const Quadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Weighted squared distance from the point to all the planes
+        double Evaluate(const glm::vec3& point) const
+        {
+            double x = point.x, y = point.y, z = point.z;
+            double result =
+                a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+                a11 * y * y + 2.0 * a12 * y * z +
+                a22 * z * z +
+                2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::max(result, 0.0);
+        }
+    };
+
+    // Candidate collapse of vertex "from" into vertex "to"
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    struct PositionHash
+    {
+        size_t operator()(const glm::vec3& position) const
+        {
+            unsigned int bits[3];
+            std::memcpy(bits, &position, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    // How the vertices at a position can move
+    enum class VertexKind : unsigned char
+    {
+        // Inside the surface, with a single vertex. Can collapse into any neighbor
+        Manifold,
+        // On an attribute seam, with one vertex on each side. Collapses along the seam, moving the vertices of both sides
+        Seam,
+        // On an open border. Collapses along the border, to keep the outline
+        Border,
+        // Corners of several seams, seams on borders, and non-manifold edges. Never moved
+        Locked,
+    };
+
+    // Weight of the planes along borders and seams, relative to the triangle planes
+    constexpr float BoundaryWeight = 10.0f;
+
+    // Vertex "from" moving to vertex "to". Collapsing a seam moves the vertices of both sides
+    struct Move
+    {
+        unsigned int from;
+        unsigned int to;
+    };
+
+    // Check that moving the vertices does not flip or fold any of their triangles
+    bool CollapseFlipsTriangles(std::span<const Move> moves, unsigned int toWeld, std::span<const unsigned int> indices, std::span<const glm::vec3> positions,
+        std::span<const unsigned int> weld, const std::vector<unsigned int>& adjacencyOffsets, const std::vector<unsigned int>& adjacency)
+    {
+        for (const Move& move : moves)
+        {
+            const glm::vec3& newPosition = positions[move.to];
+            for (unsigned int i = adjacencyOffsets[move.from]; i < adjacencyOffsets[move.from + 1]; ++i)
+            {
+                const unsigned int* triangle = &indices[adjacency[i] * 3];
+
+                // Triangles that contain both positions are removed by the collapse
+                if (weld[triangle[0]] == toWeld || weld[triangle[1]] == toWeld || weld[triangle[2]] == toWeld)
+                {
+                    continue;
+                }
+
+                glm::vec3 p[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                glm::vec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    if (triangle[corner] == move.from)
+                    {
+                        p[corner] = newPosition;
+                    }
+                }
+                glm::vec3 newNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+                // Reject the collapse if the normal rotates more than ~75 degrees
+                if (glm::dot(oldNormal, newNormal) < 0.25f * glm::length(oldNormal) * glm::length(newNormal))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Find where each vertex at the position of "from" moves, when the position collapses into the one of "to"
+    // Each vertex moves to the vertex it shares an edge with, so the attributes stay continuous on both sides of a seam
+    // Returns false if the collapse is not allowed for the kind of the vertex
+    bool FindMoves(unsigned int from, unsigned int to, VertexKind kind, std::span<const unsigned int> indices, std::span<const unsigned int> weld,
+        std::span<const unsigned int> weldOffsets, std::span<const unsigned int> weldVertices,
+        const std::vector<unsigned int>& adjacencyOffsets, const std::vector<unsigned int>& adjacency, std::vector<Move>& moves)
+    {
+        moves.clear();
+        unsigned int fromWeld = weld[from];
+        unsigned int toWeld = weld[to];
+        unsigned int edgeTriangleCount = 0;
+        for (unsigned int w = weldOffsets[fromWeld]; w < weldOffsets[fromWeld + 1]; ++w)
+        {
+            unsigned int vertex = weldVertices[w];
+            unsigned int partner = ~0u;
+            for (unsigned int i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; ++i)
+            {
+                const unsigned int* triangle = &indices[adjacency[i] * 3];
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    if (weld[triangle[corner]] == toWeld)
+                    {
+                        // Two different vertices at the target: the edge crosses a seam of the target
+                        if (partner != ~0u && partner != triangle[corner])
+                        {
+                            return false;
+                        }
+                        partner = triangle[corner];
+                        ++edgeTriangleCount;
+                    }
+                }
+            }
+
+            // Vertices without triangles left don't move. The others need an edge to the target
+            if (adjacencyOffsets[vertex] == adjacencyOffsets[vertex + 1])
+            {
+                continue;
+            }
+            if (partner == ~0u)
+            {
+                return false;
+            }
+            moves.push_back(Move{ vertex, partner });
+        }
+
+        switch (kind)
+        {
+        case VertexKind::Manifold:
+            return !moves.empty();
+        case VertexKind::Seam:
+            // Along the seam, the edge is in one triangle on each side
+            return moves.size() == 2 && edgeTriangleCount == 2;
+        case VertexKind::Border:
+            // Along the border, the edge is in a single triangle
+            return moves.size() == 1 && edgeTriangleCount == 1;
+        default:
+            return false;
+        }
+    }
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(std::span<const unsigned int> indices, std::span<const glm::vec3> positions,
+    size_t targetIndexCount, float maxError, float& error)
+{
+    assert(indices.size() % 3 == 0);
+
+    std::vector<unsigned int> result(indices.begin(), indices.end());
+    error = 0.0f;
+
+    unsigned int vertexCount = static_cast<unsigned int>(positions.size());
+
+    // Find the vertices that share the same position, and use the first one as representative
+    std::vector<unsigned int> weld(vertexCount);
+    std::vector<unsigned int> weldCount(vertexCount, 0);
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> firstVertex;
+        for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            weld[vertex] = firstVertex.emplace(positions[vertex], vertex).first->second;
+            ++weldCount[weld[vertex]];
+        }
+    }
+
+    // Vertices of each position, to move them together
+    std::vector<unsigned int> weldOffsets(vertexCount + 1, 0);
+    std::vector<unsigned int> weldVertices(vertexCount);
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        ++weldOffsets[weld[vertex] + 1];
+    }
+    std::partial_sum(weldOffsets.begin(), weldOffsets.end(), weldOffsets.begin());
+    {
+        std::vector<unsigned int> weldFill(weldOffsets.begin(), weldOffsets.end() - 1);
+        for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            weldVertices[weldFill[weld[vertex]]++] = vertex;
+        }
+    }
+
+    // Count the triangles of each edge, between positions and between vertices
+    // Edges between positions with a single triangle are on open borders. Edges between vertices with a single triangle,
+    // but with two triangles between their positions, are on attribute seams
+    std::unordered_map<unsigned long long, unsigned int> weldEdgeCount;
+    std::unordered_map<unsigned long long, unsigned int> vertexEdgeCount;
+    auto edgeKey = [](unsigned long long a, unsigned long long b) { return a < b ? (a << 32) | b : (b << 32) | a; };
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            unsigned int a = result[i + corner];
+            unsigned int b = result[i + (corner + 1) % 3];
+            ++weldEdgeCount[edgeKey(weld[a], weld[b])];
+            ++vertexEdgeCount[edgeKey(a, b)];
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        unsigned int count = weldCount[weld[vertex]];
+        kinds[vertex] = count == 1 ? VertexKind::Manifold : count == 2 ? VertexKind::Seam : VertexKind::Locked;
+    }
+    for (const auto& edge : weldEdgeCount)
+    {
+        unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+        unsigned int b = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+        if (edge.second != 2)
+        {
+            // Border vertices with several copies are seams on a border. Non-manifold edges can't be collapsed safely
+            VertexKind kind = edge.second == 1 ? VertexKind::Border : VertexKind::Locked;
+            kinds[a] = kinds[a] == VertexKind::Manifold || kinds[a] == kind ? kind : VertexKind::Locked;
+            kinds[b] = kinds[b] == VertexKind::Manifold || kinds[b] == kind ? kind : VertexKind::Locked;
+        }
+    }
+    for (unsigned int vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        kinds[vertex] = kinds[weld[vertex]];
+    }
+
+    // Accumulate the area weighted plane of each triangle in its vertices (only on the representative of each position)
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3& p0 = positions[result[i + 0]];
+        const glm::vec3& p1 = positions[result[i + 1]];
+        const glm::vec3& p2 = positions[result[i + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if (area > 0.0f)
+        {
+            normal /= area;
+            Quadric quadric = Quadric::FromPlane(normal, -glm::dot(normal, p0), area);
+            quadrics[weld[result[i + 0]]] += quadric;
+            quadrics[weld[result[i + 1]]] += quadric;
+            quadrics[weld[result[i + 2]]] += quadric;
+        }
+    }
+
+    // Add the plane through each border and seam edge, perpendicular to its triangle, so they stay in place
+    // Collapses along a straight edge are free, and corners are kept
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3& p0 = positions[result[i + 0]];
+        glm::vec3 normal = glm::cross(positions[result[i + 1]] - p0, positions[result[i + 2]] - p0);
+        if (glm::dot(normal, normal) == 0.0f)
+        {
+            continue;
+        }
+        normal = glm::normalize(normal);
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            unsigned int a = result[i + corner];
+            unsigned int b = result[i + (corner + 1) % 3];
+            if (vertexEdgeCount[edgeKey(a, b)] != 1)
+            {
+                continue;
+            }
+
+            glm::vec3 edge = positions[b] - positions[a];
+            float length = glm::length(edge);
+            if (length == 0.0f)
+            {
+                continue;
+            }
+            glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+            Quadric quadric = Quadric::FromPlane(edgeNormal, -glm::dot(edgeNormal, positions[a]), length * length * BoundaryWeight);
+            quadrics[weld[a]] += quadric;
+            quadrics[weld[b]] += quadric;
+        }
+    }
+
+    double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+    double maxCollapseError = 0.0;
+
+    std::vector<Collapse> collapses;
+    std::vector<Move> moves;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+
+    // Each pass collapses a set of independent edges, in order of increasing cost
+    while (result.size() > targetIndexCount)
+    {
+        // Vertex-triangle adjacency of the current triangles, for the flip test
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int index : result)
+        {
+            ++adjacencyOffsets[index + 1];
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (unsigned int i = 0; i < result.size(); ++i)
+        {
+            adjacency[adjacencyFill[result[i]]++] = i / 3;
+        }
+
+        // Both directions of each edge are candidates, if the vertex that moves is not locked. The kind is checked when applied
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                unsigned int a = result[i + corner];
+                unsigned int b = result[i + (corner + 1) % 3];
+                if (weld[a] == weld[b])
+                {
+                    continue;
+                }
+                if (kinds[a] != VertexKind::Locked)
+                {
+                    Quadric quadric = quadrics[weld[a]];
+                    quadric += quadrics[weld[b]];
+                    collapses.push_back(Collapse{ a, b, quadric.Evaluate(positions[b]) / std::max(quadric.weight, 1e-12) });
+                }
+                if (kinds[b] != VertexKind::Locked)
+                {
+                    Quadric quadric = quadrics[weld[b]];
+                    quadric += quadrics[weld[a]];
+                    collapses.push_back(Collapse{ b, a, quadric.Evaluate(positions[a]) / std::max(quadric.weight, 1e-12) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Apply the cheapest collapses. The one-ring of a collapsed vertex can't change again in the same pass
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t removedIndices = 0;
+        size_t maxRemovedIndices = result.size() - targetIndexCount;
+        unsigned int collapseCount = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.cost > maxCost || removedIndices >= maxRemovedIndices)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+            if (!FindMoves(collapse.from, collapse.to, kinds[collapse.from], result, weld, weldOffsets, weldVertices, adjacencyOffsets, adjacency, moves))
+            {
+                continue;
+            }
+
+            // The other side of a seam can be in the one-ring of another collapse
+            bool moveTouched = false;
+            for (const Move& move : moves)
+            {
+                moveTouched = moveTouched || touched[move.from] || touched[move.to];
+            }
+            if (moveTouched)
+            {
+                continue;
+            }
+            if (CollapseFlipsTriangles(moves, weld[collapse.to], result, positions, weld, adjacencyOffsets, adjacency))
+            {
+                continue;
+            }
+
+            for (const Move& move : moves)
+            {
+                remap[move.from] = move.to;
+                for (unsigned int i = adjacencyOffsets[move.from]; i < adjacencyOffsets[move.from + 1]; ++i)
+                {
+                    const unsigned int* triangle = &result[adjacency[i] * 3];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                    if (weld[triangle[0]] == weld[collapse.to] || weld[triangle[1]] == weld[collapse.to] || weld[triangle[2]] == weld[collapse.to])
+                    {
+                        removedIndices += 3;
+                    }
+                }
+                touched[move.to] = true;
+            }
+
+            quadrics[weld[collapse.to]] += quadrics[weld[collapse.from]];
+            maxCollapseError = std::max(maxCollapseError, collapse.cost);
+            ++collapseCount;
+        }
+
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        // Rewrite the triangles, removing the ones that became degenerate
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i + 0]];
+            unsigned int b = remap[result[i + 1]];
+            unsigned int c = remap[result[i + 2]];
+            if (weld[a] != weld[b] && weld[b] != weld[c] && weld[c] != weld[a])
+            {
+                result[writeIndex++] = a;
+                result[writeIndex++] = b;
+                result[writeIndex++] = c;
+            }
+        }
+        result.resize(writeIndex);
+    }
+
+    error = static_cast<float>(std::sqrt(maxCollapseError));
+    return result;
+}
@@ -3,7 +3,7 @@
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/shader/Material.h>
 
-Model::Model(std::shared_ptr<Mesh> mesh) : m_mesh(mesh)
+Model::Model(std::shared_ptr<Mesh> mesh) : m_mesh(mesh), m_version(0)
 {
 }
 
@@ -22,6 +22,7 @@ void Model::SetMesh(std::shared_ptr<Mesh> mesh)
     // Clear the material list before changing the mesh
     assert(m_materials.empty());
     m_mesh = mesh;
+    ++m_version;
 }
 
 unsigned int Model::GetMaterialCount()
@@ -42,18 +43,21 @@ const Material& Model::GetMaterial(unsigned int index) const
 void Model::SetMaterial(unsigned int index, std::shared_ptr<Material> material)
 {
     m_materials[index] = material;
+    ++m_version;
 }
 
 unsigned int Model::AddMaterial(std::shared_ptr<Material> material)
 {
     unsigned int index = static_cast<unsigned int>(m_materials.size());
     m_materials.push_back(material);
+    ++m_version;
     return index;
 }
 
 void Model::ClearMaterials()
 {
     m_materials.clear();
+    ++m_version;
 }
 
 void Model::Draw()
@@ -1,5 +1,7 @@
 #include <ituGL/geometry/VertexAttribute.h>
 
+#include <cassert>
+
 VertexAttribute::VertexAttribute(Data::Type type, int components, Semantic semantic)
     : VertexAttribute(type, components, false, semantic)
 {
@@ -11,6 +13,8 @@ VertexAttribute::VertexAttribute(Data::Type type, int components, bool normalize
     , m_normalized(normalized)
     , m_semantic(semantic)
 {
+    // Packed types always have 4 components
+    assert(!Data::IsPackedType(type) || components == 4);
 }
 
 int VertexAttribute::GetLocationSize() const
@@ -4,6 +4,28 @@ VertexFormat::VertexFormat() : m_size(0u)
 {
 }
 
+int VertexFormat::FindAttribute(VertexAttribute::Semantic semantic) const
+{
+    for (int i = 0; i < GetAttributeCount(); ++i)
+    {
+        if (m_attributes[i].GetSemantic() == semantic)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t VertexFormat::GetAttributeOffset(int index) const
+{
+    size_t offset = 0;
+    for (int i = 0; i < index; ++i)
+    {
+        offset += m_attributes[i].GetSize();
+    }
+    return offset;
+}
+
 void VertexFormat::Clear()
 {
     m_attributes.clear();
@@ -12,6 +34,8 @@ void VertexFormat::Clear()
 
 void VertexFormat::AddVertexAttribute(Data::Type type, int components, bool normalized, VertexAttribute::Semantic semantic)
 {
+    // Only integer types (including packed ones) can be normalized
+    assert(!normalized || (type != Data::Type::Float && type != Data::Type::Double && type != Data::Type::Half));
     m_attributes.emplace_back(type, components, normalized, semantic);
     int attributeSize = m_attributes.back().GetSize();
     m_size += attributeSize;
@@ -11,6 +11,18 @@ Light::Type DirectionalLight::GetType() const
     return Light::Type::Directional;
 }
 
+void DirectionalLight::CopyTo(std::unique_ptr<Light>& copy) const
+{
+    if (copy && copy->GetType() == GetType())
+    {
+        *static_cast<DirectionalLight*>(copy.get()) = *this;
+    }
+    else
+    {
+        copy = std::make_unique<DirectionalLight>(*this);
+    }
+}
+
 glm::vec3 DirectionalLight::GetDirection(const glm::vec3& fallback) const
 {
     return m_direction;
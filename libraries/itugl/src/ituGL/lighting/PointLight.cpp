@@ -9,6 +9,18 @@ Light::Type PointLight::GetType() const
     return Light::Type::Point;
 }
 
+void PointLight::CopyTo(std::unique_ptr<Light>& copy) const
+{
+    if (copy && copy->GetType() == GetType())
+    {
+        *static_cast<PointLight*>(copy.get()) = *this;
+    }
+    else
+    {
+        copy = std::make_unique<PointLight>(*this);
+    }
+}
+
 glm::vec3 PointLight::GetPosition(const glm::vec3& fallback) const
 {
     return m_position;
@@ -11,6 +11,18 @@ Light::Type SpotLight::GetType() const
     return Light::Type::Spot;
 }
 
+void SpotLight::CopyTo(std::unique_ptr<Light>& copy) const
+{
+    if (copy && copy->GetType() == GetType())
+    {
+        *static_cast<SpotLight*>(copy.get()) = *this;
+    }
+    else
+    {
+        copy = std::make_unique<SpotLight>(*this);
+    }
+}
+
 glm::vec3 SpotLight::GetPosition(const glm::vec3& fallback) const
 {
     return m_position;
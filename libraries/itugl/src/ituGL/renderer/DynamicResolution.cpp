@@ -0,0 +1,88 @@
+#include <ituGL/renderer/DynamicResolution.h>
+
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+// Weight of each new measure in the average
+static constexpr float AverageWeight = 0.1f;
+
+// The scale goes up only if the time is below this fraction of the budget, leaving margin for the larger size
+static constexpr float LowerThreshold = 0.8f;
+
+// Consecutive frames required to change the scale. Going down reacts faster than going up
+static constexpr unsigned int OverBudgetFrameCount = 4;
+static constexpr unsigned int UnderBudgetFrameCount = 60;
+
+// Increment of the scale when going up
+static constexpr float ScaleUpStep = 0.05f;
+
+DynamicResolution::DynamicResolution(float targetTime)
+    : m_enabled(true)
+    , m_targetTime(targetTime)
+    , m_minScale(0.5f)
+    , m_maxScale(1.0f)
+    , m_scale(1.0f)
+    , m_averageTime(-1.0f)
+    , m_overBudgetFrames(0)
+    , m_underBudgetFrames(0)
+{
+}
+
+void DynamicResolution::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled)
+    {
+        m_scale = m_maxScale;
+    }
+    ResetHistory();
+}
+
+void DynamicResolution::SetScaleRange(float minScale, float maxScale)
+{
+    assert(minScale > 0.0f && minScale <= maxScale);
+    m_minScale = minScale;
+    m_maxScale = maxScale;
+    m_scale = glm::clamp(m_scale, m_minScale, m_maxScale);
+}
+
+void DynamicResolution::Update(float frameTime)
+{
+    m_averageTime = m_averageTime < 0.0f ? frameTime : glm::mix(m_averageTime, frameTime, AverageWeight);
+
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    float ratio = m_averageTime / m_targetTime;
+    m_overBudgetFrames = ratio > 1.0f ? m_overBudgetFrames + 1 : 0;
+    m_underBudgetFrames = ratio < LowerThreshold ? m_underBudgetFrames + 1 : 0;
+
+    if (m_overBudgetFrames >= OverBudgetFrameCount && m_scale > m_minScale)
+    {
+        // The time is roughly proportional to the number of pixels, the square of the scale
+        m_scale = std::max(m_scale * std::sqrt(1.0f / ratio), m_minScale);
+        ResetHistory();
+    }
+    else if (m_underBudgetFrames >= UnderBudgetFrameCount && m_scale < m_maxScale)
+    {
+        m_scale = std::min(m_scale + ScaleUpStep, m_maxScale);
+        ResetHistory();
+    }
+}
+
+void DynamicResolution::GetScaledSize(int width, int height, int& scaledWidth, int& scaledHeight) const
+{
+    scaledWidth = std::max(static_cast<int>(width * m_scale), 1);
+    scaledHeight = std::max(static_cast<int>(height * m_scale), 1);
+}
+
+void DynamicResolution::ResetHistory()
+{
+    m_averageTime = -1.0f;
+    m_overBudgetFrames = 0;
+    m_underBudgetFrames = 0;
+}
@@ -3,16 +3,50 @@
 #include <ituGL/camera/Camera.h>
 #include <ituGL/shader/Material.h>
 #include <ituGL/geometry/VertexArrayObject.h>
-#include <ituGL/renderer/Renderer.h>
+#include <ituGL/asset/ShaderLoader.h>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <limits>
+#include <cassert>
 
 ForwardRenderPass::ForwardRenderPass()
     : ForwardRenderPass(0)
 {
 }
 
-ForwardRenderPass::ForwardRenderPass(int drawcallCollectionIndex)
+ForwardRenderPass::ForwardRenderPass(int drawcallCollectionIndex, bool depthPrepass)
     : m_drawcallCollectionIndex(drawcallCollectionIndex)
+    , m_depthPrepass(false)
+    , m_worldMatrixLocation(-1)
+    , m_viewProjMatrixLocation(-1)
 {
+    SetDepthPrepassEnabled(depthPrepass);
+}
+
+void ForwardRenderPass::SetDepthPrepassEnabled(bool depthPrepass)
+{
+    // Load the depth shader the first time it is enabled
+    if (depthPrepass && m_worldMatrixLocation < 0)
+    {
+        ShaderLoader vertexLoader(Shader::VertexShader);
+        ShaderLoader fragmentLoader(Shader::FragmentShader);
+        vertexLoader.SetSpirvDirectory(m_spirvDirectory.c_str());
+        fragmentLoader.SetSpirvDirectory(m_spirvDirectory.c_str());
+        Shader vertexShader = vertexLoader.Load("shaders/renderer/depth.vert");
+        Shader fragmentShader = fragmentLoader.Load("shaders/renderer/depth.frag");
+        m_depthShaderProgram.Build(vertexShader, fragmentShader);
+
+        m_worldMatrixLocation = m_depthShaderProgram.GetUniformLocation("WorldMatrix"_u);
+        m_viewProjMatrixLocation = m_depthShaderProgram.GetUniformLocation("ViewProjMatrix"_u);
+    }
+    m_depthPrepass = depthPrepass;
+}
+
+void ForwardRenderPass::SetSpirvDirectory(const char* spirvDirectory)
+{
+    // The depth shader is not reloaded
+    assert(m_worldMatrixLocation < 0);
+    m_spirvDirectory = spirvDirectory;
 }
 
 void ForwardRenderPass::Render()
@@ -22,26 +56,112 @@ void ForwardRenderPass::Render()
     const auto& lights = renderer.GetLights();
     const auto& drawcallCollection = renderer.GetDrawcalls(m_drawcallCollectionIndex);
 
+    if (m_depthPrepass)
+    {
+        RenderDepthPrepass(drawcallCollection);
+    }
+
     // for all drawcalls
     for (const Renderer::DrawcallInfo& drawcallInfo : drawcallCollection)
     {
         // Prepare drawcall states
         renderer.PrepareDrawcall(drawcallInfo);
-
-        std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.material.GetShaderProgram();
+        bool prepassed = m_depthPrepass && IsInDepthPrepass(drawcallInfo);
 
         //for all lights
         bool first = true;
         unsigned int lightIndex = 0;
+
+        // The program can be a different variant for each light
+        std::shared_ptr<const ShaderProgram> shaderProgram = renderer.SelectLightVariant(drawcallInfo, lights, lightIndex);
         while (renderer.UpdateLights(shaderProgram, lights, lightIndex))
         {
             // Set the renderstates
             renderer.SetLightingRenderStates(first);
 
+            // After the pre-pass, only the fragments with the closest depth are shaded
+            // Drawcalls that were not in the pre-pass write their depth with the first light
+            if (m_depthPrepass && (prepassed || !first))
+            {
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+
             // Draw
             drawcallInfo.drawcall.Draw();
 
             first = false;
+            shaderProgram = renderer.SelectLightVariant(drawcallInfo, lights, lightIndex);
+        }
+    }
+
+    if (m_depthPrepass)
+    {
+        // Restore default values
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+bool ForwardRenderPass::IsInDepthPrepass(const Renderer::DrawcallInfo& drawcallInfo)
+{
+    const Material& material = drawcallInfo.material;
+    return drawcallInfo.lodFade == 0.0f && material.GetDepthPrepass() && material.GetDepthWrite()
+        && material.GetDepthTestFunction() == Material::TestFunction::Less
+        && material.GetBlendEquationColor() == Material::BlendEquation::None && material.GetBlendEquationAlpha() == Material::BlendEquation::None;
+}
+
+void ForwardRenderPass::RenderDepthPrepass(std::span<const Renderer::DrawcallInfo> drawcallCollection)
+{
+    Renderer& renderer = GetRenderer();
+    DeviceGL& device = renderer.GetDevice();
+
+    // Sort front to back by the center of the bounds, so the closest surfaces hide the rest early
+    glm::vec3 cameraPosition = renderer.GetCurrentCamera().ExtractTranslation();
+    m_depthOrder.clear();
+    for (unsigned int i = 0; i < drawcallCollection.size(); ++i)
+    {
+        const Renderer::DrawcallInfo& drawcallInfo = drawcallCollection[i];
+        if (IsInDepthPrepass(drawcallInfo))
+        {
+            // Drawcalls with empty bounds go last
+            float distance2 = std::numeric_limits<float>::max();
+            if (drawcallInfo.boundsMin.x <= drawcallInfo.boundsMax.x)
+            {
+                glm::vec3 offset = 0.5f * (drawcallInfo.boundsMin + drawcallInfo.boundsMax) - cameraPosition;
+                distance2 = glm::dot(offset, offset);
+            }
+            m_depthOrder.emplace_back(distance2, i);
         }
     }
+    std::sort(m_depthOrder.begin(), m_depthOrder.end());
+
+    // Only depth is written. The stencil is left for the shading
+    bool stencilTest = device.IsFeatureEnabled(GL_STENCIL_TEST);
+    device.DisableFeature(GL_STENCIL_TEST);
+    device.DisableFeature(GL_BLEND);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    m_depthShaderProgram.Use();
+    m_depthShaderProgram.SetUniform(m_viewProjMatrixLocation, renderer.GetCurrentCamera().GetViewProjectionMatrix());
+
+    const VertexArrayObject* currentVertexArray = nullptr;
+    for (const auto& depthOrder : m_depthOrder)
+    {
+        const Renderer::DrawcallInfo& drawcallInfo = drawcallCollection[depthOrder.second];
+        if (&drawcallInfo.positionVao != currentVertexArray)
+        {
+            drawcallInfo.positionVao.Bind();
+            currentVertexArray = &drawcallInfo.positionVao;
+        }
+        m_depthShaderProgram.SetUniform(m_worldMatrixLocation, renderer.GetWorldMatrix(drawcallInfo.worldMatrixIndex));
+        drawcallInfo.drawcall.Draw();
+    }
+
+    // Restore the states for the shading
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    device.SetFeatureEnabled(GL_STENCIL_TEST, stencilTest);
+    renderer.ResetCurrentState();
 }
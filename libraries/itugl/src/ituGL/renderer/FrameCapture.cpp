@@ -0,0 +1,449 @@
+#include <ituGL/renderer/FrameCapture.h>
+
+#include <ituGL/texture/FramebufferObject.h>
+#include <array>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+
+// Deflate blocks without compression can't be larger than this. PNG files are bigger, but encoding them is only a copy
+static constexpr size_t PngStoredBlockSize = 65535;
+
+// Table of the CRC-32 used by the PNG chunks
+static constexpr std::array<std::uint32_t, 256> s_crcTable = []()
+{
+    std::array<std::uint32_t, 256> table = {};
+    for (std::uint32_t i = 0; i < 256; ++i)
+    {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+FrameCapture::FrameCapture(unsigned int bufferCount)
+    : m_slots(bufferCount)
+    , m_captureSlot(0)
+    , m_readSlot(0)
+    , m_capturedFrameCount(0)
+    , m_stallCount(0)
+    , m_writeSlot(0)
+    , m_writtenFrameCount(0)
+    , m_stopping(false)
+{
+    assert(bufferCount > 0);
+    m_thread = std::thread(&FrameCapture::WorkerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    // Let the worker write the frames still in flight before it stops
+    Stop();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workCondition.notify_one();
+    m_thread.join();
+}
+
+void FrameCapture::Start(const std::string& path, Format format, int frameRate)
+{
+    Stop();
+
+    m_sequence = std::make_shared<Sequence>();
+    m_sequence->path = path;
+    m_sequence->format = format;
+    m_sequence->frameRate = frameRate;
+    m_capturedFrameCount = 0;
+}
+
+void FrameCapture::Stop()
+{
+    // Hand the frames still in the GPU to the worker, so the sequence is complete even if no more frames are captured
+    while (m_slots[m_readSlot].fence)
+    {
+        SubmitReadSlots(true);
+    }
+
+    // The frames in flight keep the sequence until they are written
+    m_sequence.reset();
+}
+
+void FrameCapture::Capture(const FramebufferObject& framebuffer, int x, int y, int width, int height)
+{
+    SubmitReadSlots(false);
+
+    if (!m_sequence || width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    WaitSlot(m_captureSlot);
+    Slot& slot = m_slots[m_captureSlot];
+
+    // Buffers only grow. The storage is immutable, so a bigger one replaces the old buffer
+    size_t size = static_cast<size_t>(width) * height * 4;
+    if (slot.capacity < size)
+    {
+        // Deleting the old buffer also unmaps it
+        slot.buffer = std::make_unique<BufferObjectBase<BufferObject::PixelPackBuffer>>();
+        slot.buffer->Bind();
+        slot.persistent = slot.buffer->AllocateStorage(size, BufferObject::MapReadStorage | BufferObject::MapPersistentStorage | BufferObject::MapCoherentStorage);
+        slot.mappedData = nullptr;
+        if (slot.persistent)
+        {
+            slot.mappedData = static_cast<const std::byte*>(slot.buffer->MapRange(0, size, BufferObject::MapRead | BufferObject::MapPersistent | BufferObject::MapCoherent));
+            assert(slot.mappedData);
+        }
+        slot.capacity = size;
+    }
+    else
+    {
+        slot.buffer->Bind();
+
+        // The previous frame of the slot is already written, the buffer can't be mapped while the GPU writes it
+        if (!slot.persistent && slot.mappedData)
+        {
+            slot.buffer->Unmap();
+            slot.mappedData = nullptr;
+        }
+    }
+
+    // With a pack buffer bound, the read is queued in the GPU and returns immediately
+    framebuffer.Bind(FramebufferObject::Target::Read);
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    FramebufferObject::Unbind(FramebufferObject::Target::Read);
+    BufferObjectBase<BufferObject::PixelPackBuffer>::Unbind();
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.sequence = m_sequence;
+    slot.frameIndex = m_capturedFrameCount++;
+    slot.width = width;
+    slot.height = height;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot.state = SlotState::Reading;
+    }
+
+    m_captureSlot = (m_captureSlot + 1) % m_slots.size();
+}
+
+void FrameCapture::SubmitReadSlots(bool waitOldest)
+{
+    // Only this thread sets the fences, so a slot with a fence is being read
+    while (m_slots[m_readSlot].fence)
+    {
+        Slot& slot = m_slots[m_readSlot];
+
+        GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (waitOldest && result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            break;
+        }
+        assert(result != GL_WAIT_FAILED);
+        waitOldest = false;
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        // The copy is done, so mapping doesn't wait. The worker reads the mapped pixels, and the slot is unmapped when it is reused
+        if (!slot.persistent)
+        {
+            slot.buffer->Bind();
+            slot.mappedData = static_cast<const std::byte*>(slot.buffer->MapRange(0, static_cast<size_t>(slot.width) * slot.height * 4, BufferObject::MapRead));
+            BufferObjectBase<BufferObject::PixelPackBuffer>::Unbind();
+            assert(slot.mappedData);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.state = SlotState::Writing;
+        }
+        m_workCondition.notify_one();
+
+        m_readSlot = (m_readSlot + 1) % m_slots.size();
+    }
+}
+
+void FrameCapture::WaitSlot(unsigned int slotIndex)
+{
+    Slot& slot = m_slots[slotIndex];
+    bool stalled = false;
+
+    // If the slot is still being read, all of them are, and it is the oldest
+    if (slot.fence)
+    {
+        assert(slotIndex == m_readSlot);
+        SubmitReadSlots(true);
+        stalled = true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (slot.state != SlotState::Free)
+    {
+        m_freeCondition.wait(lock, [&slot] { return slot.state == SlotState::Free; });
+        stalled = true;
+    }
+
+    if (stalled)
+    {
+        ++m_stallCount;
+    }
+}
+
+void FrameCapture::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        // When stopping, write the frames already handed before leaving
+        m_workCondition.wait(lock, [this] { return m_stopping || m_slots[m_writeSlot].state == SlotState::Writing; });
+        Slot& slot = m_slots[m_writeSlot];
+        if (slot.state != SlotState::Writing)
+        {
+            break;
+        }
+        lock.unlock();
+
+        WriteFrame(slot);
+
+        // The last frame of a sequence closes its stream
+        slot.sequence.reset();
+        m_writtenFrameCount.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+        slot.state = SlotState::Free;
+        m_writeSlot = (m_writeSlot + 1) % m_slots.size();
+        m_freeCondition.notify_one();
+    }
+}
+
+void FrameCapture::WriteFrame(Slot& slot)
+{
+    Sequence& sequence = *slot.sequence;
+    if (!slot.mappedData)
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::MAP_FAILED " << slot.frameIndex << std::endl;
+        return;
+    }
+
+    std::string path;
+    bool written = false;
+    switch (sequence.format)
+    {
+    case Format::Png:
+        path = GetFramePath(sequence, slot.frameIndex, "png");
+        written = WritePng(path, slot.mappedData, slot.width, slot.height);
+        break;
+    case Format::Raw:
+        path = GetFramePath(sequence, slot.frameIndex, "rgba");
+        written = WriteRaw(path, slot.mappedData, slot.width, slot.height);
+        break;
+    case Format::Y4m:
+        path = sequence.path + ".y4m";
+        written = WriteY4m(sequence, slot.mappedData, slot.width, slot.height);
+        break;
+    }
+
+    if (!written)
+    {
+        std::cout << "ERROR::FRAME_CAPTURE::WRITE_FAILED " << path << std::endl;
+    }
+}
+
+bool FrameCapture::WritePng(const std::string& path, const std::byte* pixels, int width, int height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    return EncodePng(file, pixels, width, height, m_encodeBuffer);
+}
+
+// Stored deflate blocks inside a zlib stream, with the rows flipped and the alpha removed
+bool FrameCapture::EncodePng(std::ostream& file, const std::byte* pixels, int width, int height, std::vector<std::byte>& rowBuffer)
+{
+    // Each row starts with the filter type, 0 for none
+    size_t rowSize = 1 + static_cast<size_t>(width) * 3;
+    size_t dataSize = rowSize * height;
+    rowBuffer.resize(dataSize);
+    for (int row = 0; row < height; ++row)
+    {
+        const std::byte* source = pixels + static_cast<size_t>(height - 1 - row) * width * 4;
+        std::byte* destination = rowBuffer.data() + row * rowSize;
+        *destination++ = std::byte(0);
+        for (int column = 0; column < width; ++column, source += 4, destination += 3)
+        {
+            destination[0] = source[0];
+            destination[1] = source[1];
+            destination[2] = source[2];
+        }
+    }
+
+    std::uint32_t crc = 0;
+    auto writeBytes = [&file, &crc](const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = s_crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        file.write(static_cast<const char*>(data), size);
+    };
+    auto writeBigEndian = [&writeBytes](std::uint32_t value)
+    {
+        unsigned char bytes[4] = { static_cast<unsigned char>(value >> 24), static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value) };
+        writeBytes(bytes, 4);
+    };
+    auto beginChunk = [&](const char* type, std::uint32_t size)
+    {
+        writeBigEndian(size);
+        crc = 0xFFFFFFFFu;
+        writeBytes(type, 4);
+    };
+    auto endChunk = [&]()
+    {
+        writeBigEndian(crc ^ 0xFFFFFFFFu);
+    };
+
+    static constexpr unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    // 8 bits per channel, RGB, no interlacing
+    beginChunk("IHDR", 13);
+    writeBigEndian(width);
+    writeBigEndian(height);
+    static constexpr unsigned char format[5] = { 8, 2, 0, 0, 0 };
+    writeBytes(format, sizeof(format));
+    endChunk();
+
+    size_t blockCount = std::max<size_t>((dataSize + PngStoredBlockSize - 1) / PngStoredBlockSize, 1);
+    beginChunk("IDAT", static_cast<std::uint32_t>(2 + blockCount * 5 + dataSize + 4));
+    static constexpr unsigned char zlibHeader[2] = { 0x78, 0x01 };
+    writeBytes(zlibHeader, sizeof(zlibHeader));
+    std::uint32_t adlerA = 1, adlerB = 0;
+    for (size_t offset = 0, block = 0; block < blockCount; ++block, offset += PngStoredBlockSize)
+    {
+        size_t blockSize = std::min(PngStoredBlockSize, dataSize - offset);
+        unsigned char blockHeader[5] = { static_cast<unsigned char>(block + 1 == blockCount ? 1 : 0),
+            static_cast<unsigned char>(blockSize), static_cast<unsigned char>(blockSize >> 8),
+            static_cast<unsigned char>(~blockSize), static_cast<unsigned char>(~blockSize >> 8) };
+        writeBytes(blockHeader, sizeof(blockHeader));
+
+        const unsigned char* blockData = reinterpret_cast<const unsigned char*>(rowBuffer.data()) + offset;
+        writeBytes(blockData, blockSize);
+        for (size_t i = 0; i < blockSize; ++i)
+        {
+            adlerA = (adlerA + blockData[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+    writeBigEndian((adlerB << 16) | adlerA);
+    endChunk();
+
+    beginChunk("IEND", 0);
+    endChunk();
+
+    return file.good();
+}
+
+bool FrameCapture::WriteRaw(const std::string& path, const std::byte* pixels, int width, int height)
+{
+    std::ofstream file(path, std::ios::binary);
+    size_t rowSize = static_cast<size_t>(width) * 4;
+    for (int row = height - 1; row >= 0 && file; --row)
+    {
+        file.write(reinterpret_cast<const char*>(pixels + row * rowSize), rowSize);
+    }
+    return file.good();
+}
+
+// Full range BT.601, as in JPEG. Chroma is the average of each 2x2 block
+bool FrameCapture::WriteY4m(Sequence& sequence, const std::byte* pixels, int width, int height)
+{
+    // The size of the stream is the size of its first frame
+    if (!sequence.stream.is_open())
+    {
+        sequence.stream.open(sequence.path + ".y4m", std::ios::binary);
+        sequence.stream << "YUV4MPEG2 W" << width << " H" << height << " F" << sequence.frameRate << ":1 Ip A1:1 C420jpeg\n";
+        sequence.streamWidth = width;
+        sequence.streamHeight = height;
+    }
+    if (width != sequence.streamWidth || height != sequence.streamHeight)
+    {
+        std::cout << "WARNING::FRAME_CAPTURE::Y4M_FRAME_SIZE_CHANGED" << std::endl;
+        return true;
+    }
+
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    size_t lumaSize = static_cast<size_t>(width) * height;
+    size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    m_encodeBuffer.resize(lumaSize + 2 * chromaSize);
+    std::byte* planeY = m_encodeBuffer.data();
+    std::byte* planeU = planeY + lumaSize;
+    std::byte* planeV = planeU + chromaSize;
+
+    // Rows are flipped, the first one in the stream is the top one
+    auto getPixel = [pixels, width, height](int column, int row)
+    {
+        return reinterpret_cast<const unsigned char*>(pixels) + (static_cast<size_t>(height - 1 - row) * width + column) * 4;
+    };
+    auto toByte = [](float value)
+    {
+        return static_cast<std::byte>(static_cast<unsigned char>(std::clamp(value + 0.5f, 0.0f, 255.0f)));
+    };
+
+    for (int row = 0; row < height; ++row)
+    {
+        for (int column = 0; column < width; ++column)
+        {
+            const unsigned char* pixel = getPixel(column, row);
+            float r = static_cast<float>(pixel[0]), g = static_cast<float>(pixel[1]), b = static_cast<float>(pixel[2]);
+            planeY[row * width + column] = toByte(0.299f * r + 0.587f * g + 0.114f * b);
+        }
+    }
+
+    for (int row = 0; row < chromaHeight; ++row)
+    {
+        for (int column = 0; column < chromaWidth; ++column)
+        {
+            // Blocks on the right and bottom edges repeat the last pixels
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int i = 0; i < 4; ++i)
+            {
+                const unsigned char* pixel = getPixel(std::min(column * 2 + (i & 1), width - 1), std::min(row * 2 + (i >> 1), height - 1));
+                r += static_cast<float>(pixel[0]);
+                g += static_cast<float>(pixel[1]);
+                b += static_cast<float>(pixel[2]);
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            planeU[row * chromaWidth + column] = toByte(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            planeV[row * chromaWidth + column] = toByte(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+
+    sequence.stream << "FRAME\n";
+    sequence.stream.write(reinterpret_cast<const char*>(m_encodeBuffer.data()), m_encodeBuffer.size());
+    return sequence.stream.good();
+}
+
+std::string FrameCapture::GetFramePath(const Sequence& sequence, unsigned int frameIndex, const char* extension)
+{
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%06u.%s", frameIndex, extension);
+    return sequence.path + suffix;
+}
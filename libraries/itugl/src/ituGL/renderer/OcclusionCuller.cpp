@@ -0,0 +1,537 @@
+#include <ituGL/renderer/OcclusionCuller.h>
+
+#include <ituGL/scene/PackedBounds.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSIONCULLER_SSE2
+#include <emmintrin.h>
+// The AVX2 rows are compiled for that target only, and selected at runtime if the CPU supports it
+#if defined(__GNUC__) || defined(__clang__)
+#define OCCLUSIONCULLER_AVX2
+#define OCCLUSIONCULLER_AVX2_FUNCTION __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define OCCLUSIONCULLER_AVX2
+#define OCCLUSIONCULLER_AVX2_FUNCTION
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+// Pixels rasterized at once in a row with AVX2. Rows start at a multiple of it
+static const int s_laneCount = 8;
+
+// Boxes and triangles with a smaller w are considered to cross the near plane
+static const float s_minW = 1e-5f;
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : m_width((std::max(width, 1) + s_laneCount - 1) / s_laneCount * s_laneCount)
+    , m_height(std::max(height, 1))
+    , m_viewProjMatrix(1.0f)
+    , m_eyePosition(0.0f, 0.0f, 0.0f, 1.0f)
+    , m_active(false)
+    , m_rasterizationTime(0.0f)
+    , m_triangleCount(0)
+    , m_frameRasterizationTime(0.0f)
+    , m_frameTriangleCount(0)
+    , m_nextOccluder(0)
+    , m_working(false)
+    , m_stopping(false)
+{
+    // Allocate the levels down to a single texel
+    glm::ivec2 size(m_width, m_height);
+    while (true)
+    {
+        m_levelSizes.push_back(size);
+        m_levels.emplace_back(static_cast<size_t>(size.x) * size.y, 1.0f);
+        if (size.x == 1 && size.y == 1)
+        {
+            break;
+        }
+        size = glm::max((size + 1) / 2, glm::ivec2(1));
+    }
+
+    m_thread = std::thread(&OcclusionCuller::WorkerLoop, this);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workCondition.notify_one();
+    m_thread.join();
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjMatrix)
+{
+    assert(!m_active);
+
+    // The worker is idle after End, so the depth buffer can be cleared here
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_occluders.clear();
+        m_nextOccluder = 0;
+        m_frameRasterizationTime = 0.0f;
+        m_frameTriangleCount = 0;
+    }
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+
+    m_viewProjMatrix = viewProjMatrix;
+
+    // The camera projects to (0, 0, z, 0) in clip space. For orthographic projections it is at infinity, and this gives the view direction
+    m_eyePosition = glm::inverse(viewProjMatrix) * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    if (std::abs(m_eyePosition.w) > std::numeric_limits<float>::epsilon())
+    {
+        m_eyePosition = glm::vec4(glm::vec3(m_eyePosition) / m_eyePosition.w, 1.0f);
+    }
+    else
+    {
+        m_eyePosition = glm::vec4(glm::normalize(glm::vec3(m_eyePosition)), 0.0f);
+    }
+
+    m_active = true;
+}
+
+void OcclusionCuller::AddOccluder(std::span<const glm::vec3> positions, std::span<const unsigned int> indices, const glm::mat4& worldMatrix, float depthBias)
+{
+    assert(m_active);
+    assert(depthBias >= 0.0f);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_occluders.push_back(Occluder{ positions, indices, worldMatrix, depthBias });
+    }
+    m_workCondition.notify_one();
+}
+
+void OcclusionCuller::End()
+{
+    assert(m_active);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] { return m_nextOccluder == m_occluders.size() && !m_working; });
+        m_rasterizationTime = m_frameRasterizationTime;
+        m_triangleCount = m_frameTriangleCount;
+    }
+
+    BuildHierarchy();
+    m_active = false;
+}
+
+bool OcclusionCuller::IsOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+{
+    assert(!m_active);
+
+    // Empty boxes have unknown bounds
+    if (boundsMin.x > boundsMax.x || boundsMin.y > boundsMax.y || boundsMin.z > boundsMax.z)
+    {
+        return false;
+    }
+
+    // Screen rectangle and closest depth of the box corners
+    glm::vec2 rectMin(std::numeric_limits<float>::max());
+    glm::vec2 rectMax(std::numeric_limits<float>::lowest());
+    float minDepth = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clipPosition = m_viewProjMatrix * glm::vec4(corner, 1.0f);
+        if (clipPosition.w < s_minW || clipPosition.z < -clipPosition.w)
+        {
+            return false;
+        }
+        glm::vec3 screenPosition = ToScreen(clipPosition);
+        rectMin = glm::min(rectMin, glm::vec2(screenPosition));
+        rectMax = glm::max(rectMax, glm::vec2(screenPosition));
+        minDepth = std::min(minDepth, screenPosition.z);
+    }
+
+    // Boxes outside of the view are left to the frustum culling
+    int x0 = std::max(static_cast<int>(std::floor(rectMin.x)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(rectMin.y)), 0);
+    int x1 = std::min(static_cast<int>(std::floor(rectMax.x)), m_width - 1);
+    int y1 = std::min(static_cast<int>(std::floor(rectMax.y)), m_height - 1);
+    if (x0 > x1 || y0 > y1)
+    {
+        return false;
+    }
+
+    // Pick the level where the rectangle covers at most 2 texels per side, plus the partially covered ones
+    unsigned int level = 0;
+    int size = std::max(x1 - x0, y1 - y0);
+    while (size > 2 && level + 1 < m_levels.size())
+    {
+        size >>= 1;
+        ++level;
+    }
+
+    // Occluded if the box is behind the farthest occluder depth of all the texels
+    const std::vector<float>& depths = m_levels[level];
+    int levelWidth = m_levelSizes[level].x;
+    for (int y = y0 >> level; y <= (y1 >> level); ++y)
+    {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x)
+        {
+            if (depths[static_cast<size_t>(y) * levelWidth + x] >= minDepth)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionCuller::TestOcclusion(const PackedBounds& bounds, std::vector<uint8_t>& visibilityMask) const
+{
+    assert(visibilityMask.size() * PackedBounds::BatchSize >= bounds.GetCount());
+
+    for (unsigned int batch = 0; batch < visibilityMask.size(); ++batch)
+    {
+        // Skip the batches culled by the frustum at once
+        unsigned int mask = visibilityMask[batch];
+        while (mask != 0)
+        {
+            unsigned int bit = 0;
+            while (((mask >> bit) & 1) == 0)
+            {
+                ++bit;
+            }
+            mask &= ~(1u << bit);
+
+            unsigned int index = batch * PackedBounds::BatchSize + bit;
+            float radius = bounds.GetRadius(index);
+            if (std::isinf(radius))
+            {
+                continue;
+            }
+            glm::vec3 extents = bounds.GetSize(index) + radius;
+            glm::vec3 center = bounds.GetCenter(index);
+            if (IsOccluded(center - extents, center + extents))
+            {
+                visibilityMask[batch] &= static_cast<uint8_t>(~(1u << bit));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_workCondition.wait(lock, [this] { return m_stopping || m_nextOccluder < m_occluders.size(); });
+        if (m_stopping)
+        {
+            break;
+        }
+
+        // Copy the occluder, the queue can grow while it is rasterized
+        Occluder occluder = m_occluders[m_nextOccluder++];
+        m_working = true;
+        lock.unlock();
+
+        auto startTime = std::chrono::steady_clock::now();
+        unsigned int triangleCount = RasterizeOccluder(occluder);
+        std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - startTime;
+
+        lock.lock();
+        m_frameRasterizationTime += duration.count();
+        m_frameTriangleCount += triangleCount;
+        m_working = false;
+        m_doneCondition.notify_all();
+    }
+}
+
+unsigned int OcclusionCuller::RasterizeOccluder(const Occluder& occluder)
+{
+    m_clipPositions.resize(occluder.positions.size());
+    if (occluder.depthBias > 0.0f)
+    {
+        // Push each vertex along the view ray, so the occluder stays behind the surface it replaces
+        for (size_t i = 0; i < occluder.positions.size(); ++i)
+        {
+            glm::vec3 worldPosition = occluder.worldMatrix * glm::vec4(occluder.positions[i], 1.0f);
+            glm::vec3 viewRay = m_eyePosition.w != 0.0f ? worldPosition - glm::vec3(m_eyePosition) : glm::vec3(m_eyePosition);
+            float viewRayLength = glm::length(viewRay);
+            if (viewRayLength > 0.0f)
+            {
+                worldPosition += viewRay * (occluder.depthBias / viewRayLength);
+            }
+            m_clipPositions[i] = m_viewProjMatrix * glm::vec4(worldPosition, 1.0f);
+        }
+    }
+    else
+    {
+        glm::mat4 matrix = m_viewProjMatrix * occluder.worldMatrix;
+        for (size_t i = 0; i < occluder.positions.size(); ++i)
+        {
+            m_clipPositions[i] = matrix * glm::vec4(occluder.positions[i], 1.0f);
+        }
+    }
+
+    unsigned int triangleCount = 0;
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+    {
+        glm::vec4 triangle[3] = {
+            m_clipPositions[occluder.indices[i]],
+            m_clipPositions[occluder.indices[i + 1]],
+            m_clipPositions[occluder.indices[i + 2]]
+        };
+
+        // Skip the triangles completely outside of one of the side or far planes
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; ++axis)
+        {
+            outside = (triangle[0][axis] > triangle[0].w && triangle[1][axis] > triangle[1].w && triangle[2][axis] > triangle[2].w)
+                || (axis < 2 && triangle[0][axis] < -triangle[0].w && triangle[1][axis] < -triangle[1].w && triangle[2][axis] < -triangle[2].w);
+        }
+        if (outside)
+        {
+            continue;
+        }
+
+        // Clip against the near plane, z = -w. The result is a polygon of up to 4 vertices
+        glm::vec4 polygon[4];
+        int polygonSize = 0;
+        for (int v = 0; v < 3; ++v)
+        {
+            const glm::vec4& current = triangle[v];
+            const glm::vec4& next = triangle[(v + 1) % 3];
+            float currentDistance = current.z + current.w;
+            float nextDistance = next.z + next.w;
+            if (currentDistance >= 0.0f)
+            {
+                polygon[polygonSize++] = current;
+            }
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            {
+                polygon[polygonSize++] = glm::mix(current, next, currentDistance / (currentDistance - nextDistance));
+            }
+        }
+        if (polygonSize < 3)
+        {
+            continue;
+        }
+
+        // Rasterize the polygon as a triangle fan
+        glm::vec3 screenPositions[4];
+        for (int v = 0; v < polygonSize; ++v)
+        {
+            screenPositions[v] = ToScreen(polygon[v]);
+        }
+        for (int v = 2; v < polygonSize; ++v)
+        {
+            RasterizeTriangle(screenPositions[0], screenPositions[v - 1], screenPositions[v]);
+            ++triangleCount;
+        }
+    }
+    return triangleCount;
+}
+
+// Edge functions e = a * x + b * y + c of a triangle, and its depth plane with the same form
+struct TriangleEdges
+{
+    float a01, b01, c01;
+    float a12, b12, c12;
+    float a20, b20, c20;
+    float az, bz, cz;
+};
+
+#ifndef OCCLUSIONCULLER_SSE2
+static void RasterizeRowsScalar(const TriangleEdges& t, float* depths, int width, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; ++y)
+    {
+        float py = static_cast<float>(y) + 0.5f;
+        float* row = depths + static_cast<size_t>(y) * width;
+        for (int x = x0; x < x1; ++x)
+        {
+            float px = static_cast<float>(x) + 0.5f;
+            if (t.a01 * px + t.b01 * py + t.c01 >= 0.0f && t.a12 * px + t.b12 * py + t.c12 >= 0.0f && t.a20 * px + t.b20 * py + t.c20 >= 0.0f)
+            {
+                row[x] = std::min(row[x], t.az * px + t.bz * py + t.cz);
+            }
+        }
+    }
+}
+#endif
+
+#ifdef OCCLUSIONCULLER_SSE2
+// x0 is aligned to the lane count, and the width is a multiple of it, so the last group of each row is inside the buffer
+static void RasterizeRowsSSE2(const TriangleEdges& t, float* depths, int width, int x0, int y0, int x1, int y1)
+{
+    __m128 zero = _mm_setzero_ps();
+    for (int y = y0; y < y1; ++y)
+    {
+        float py = static_cast<float>(y) + 0.5f;
+        float* row = depths + static_cast<size_t>(y) * width;
+        __m128 rowE01 = _mm_set1_ps(t.b01 * py + t.c01);
+        __m128 rowE12 = _mm_set1_ps(t.b12 * py + t.c12);
+        __m128 rowE20 = _mm_set1_ps(t.b20 * py + t.c20);
+        __m128 rowZ = _mm_set1_ps(t.bz * py + t.cz);
+        for (int x = x0; x < x1; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+            __m128 e01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a01), px), rowE01);
+            __m128 e12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a12), px), rowE12);
+            __m128 e20 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a20), px), rowE20);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e01, zero), _mm_cmpge_ps(e12, zero)), _mm_cmpge_ps(e20, zero));
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.az), px), rowZ);
+            __m128 depth = _mm_loadu_ps(row + x);
+            __m128 closest = _mm_min_ps(depth, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, depth)));
+        }
+    }
+}
+#endif
+
+#ifdef OCCLUSIONCULLER_AVX2
+OCCLUSIONCULLER_AVX2_FUNCTION
+static void RasterizeRowsAVX2(const TriangleEdges& t, float* depths, int width, int x0, int y0, int x1, int y1)
+{
+    __m256 zero = _mm256_setzero_ps();
+    for (int y = y0; y < y1; ++y)
+    {
+        float py = static_cast<float>(y) + 0.5f;
+        float* row = depths + static_cast<size_t>(y) * width;
+        __m256 rowE01 = _mm256_set1_ps(t.b01 * py + t.c01);
+        __m256 rowE12 = _mm256_set1_ps(t.b12 * py + t.c12);
+        __m256 rowE20 = _mm256_set1_ps(t.b20 * py + t.c20);
+        __m256 rowZ = _mm256_set1_ps(t.bz * py + t.cz);
+        for (int x = x0; x < x1; x += 8)
+        {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+            __m256 e01 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.a01), px), rowE01);
+            __m256 e12 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.a12), px), rowE12);
+            __m256 e20 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.a20), px), rowE20);
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e01, zero, _CMP_GE_OQ), _mm256_cmp_ps(e12, zero, _CMP_GE_OQ)), _mm256_cmp_ps(e20, zero, _CMP_GE_OQ));
+            if (_mm256_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.az), px), rowZ);
+            __m256 depth = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+        }
+    }
+}
+
+static bool IsAVX2Supported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // The OS must also save the AVX registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+#endif
+
+void OcclusionCuller::RasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+{
+    // Occluders are rasterized from both sides, so swap the clockwise triangles to have positive edge functions inside
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    // Pixel rectangle covering the triangle. Rows start aligned to the lane count
+    int x0 = std::max(static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))), 0) / s_laneCount * s_laneCount;
+    int y0 = std::max(static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))), m_width);
+    int y1 = std::min(static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))), m_height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    // Edge functions for the edges opposite to v2, v0 and v1
+    TriangleEdges t;
+    t.a01 = v0.y - v1.y; t.b01 = v1.x - v0.x; t.c01 = -(t.a01 * v0.x + t.b01 * v0.y);
+    t.a12 = v1.y - v2.y; t.b12 = v2.x - v1.x; t.c12 = -(t.a12 * v1.x + t.b12 * v1.y);
+    t.a20 = v2.y - v0.y; t.b20 = v0.x - v2.x; t.c20 = -(t.a20 * v2.x + t.b20 * v2.y);
+
+    // Depth is linear in screen space. The barycentric weights of v1 and v2 are e20 / area and e01 / area
+    float dz1 = (v1.z - v0.z) / area;
+    float dz2 = (v2.z - v0.z) / area;
+    t.az = t.a20 * dz1 + t.a01 * dz2;
+    t.bz = t.b20 * dz1 + t.b01 * dz2;
+    t.cz = t.c20 * dz1 + t.c01 * dz2 + v0.z;
+
+    float* depths = m_levels[0].data();
+#if defined(OCCLUSIONCULLER_AVX2)
+    static const bool avx2Supported = IsAVX2Supported();
+    if (avx2Supported)
+    {
+        RasterizeRowsAVX2(t, depths, m_width, x0, y0, x1, y1);
+        return;
+    }
+#endif
+#if defined(OCCLUSIONCULLER_SSE2)
+    RasterizeRowsSSE2(t, depths, m_width, x0, y0, x1, y1);
+#else
+    RasterizeRowsScalar(t, depths, m_width, x0, y0, x1, y1);
+#endif
+}
+
+glm::vec3 OcclusionCuller::ToScreen(const glm::vec4& clipPosition) const
+{
+    glm::vec3 ndc = glm::vec3(clipPosition) / clipPosition.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+}
+
+void OcclusionCuller::BuildHierarchy()
+{
+    for (size_t level = 1; level < m_levels.size(); ++level)
+    {
+        const std::vector<float>& source = m_levels[level - 1];
+        std::vector<float>& target = m_levels[level];
+        glm::ivec2 sourceSize = m_levelSizes[level - 1];
+        glm::ivec2 targetSize = m_levelSizes[level];
+        for (int y = 0; y < targetSize.y; ++y)
+        {
+            // Odd sizes clamp the last texel, so it is used twice
+            const float* row0 = source.data() + static_cast<size_t>(std::min(y * 2, sourceSize.y - 1)) * sourceSize.x;
+            const float* row1 = source.data() + static_cast<size_t>(std::min(y * 2 + 1, sourceSize.y - 1)) * sourceSize.x;
+            for (int x = 0; x < targetSize.x; ++x)
+            {
+                int sx0 = std::min(x * 2, sourceSize.x - 1);
+                int sx1 = std::min(x * 2 + 1, sourceSize.x - 1);
+                target[static_cast<size_t>(y) * targetSize.x + x] = std::max(std::max(row0[sx0], row0[sx1]), std::max(row1[sx0], row1[sx1]));
+            }
+        }
+    }
+}
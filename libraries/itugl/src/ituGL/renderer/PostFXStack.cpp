@@ -0,0 +1,300 @@
+#include <ituGL/renderer/PostFXStack.h>
+
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/geometry/Mesh.h>
+#include <ituGL/asset/ShaderLoader.h>
+#include <ituGL/shader/Shader.h>
+#include <ituGL/texture/Texture2DObject.h>
+#include <ituGL/texture/FramebufferObject.h>
+#include <glm/vec4.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+PostFXStack::PostFXStack(std::shared_ptr<Texture2DObject> sourceTexture, int width, int height, std::shared_ptr<const FramebufferObject> targetFramebuffer)
+    : RenderPass(targetFramebuffer ? targetFramebuffer : FramebufferObject::GetDefault())
+    , m_sourceTexture(sourceTexture)
+    , m_sourceScale(1.0f)
+    , m_width(width)
+    , m_height(height)
+    , m_passesDirty(true)
+{
+}
+
+PostFXStack::~PostFXStack()
+{
+}
+
+void PostFXStack::SetSourceTexture(std::shared_ptr<Texture2DObject> sourceTexture)
+{
+    m_sourceTexture = sourceTexture;
+}
+
+void PostFXStack::Resize(int width, int height)
+{
+    if (width != m_width || height != m_height)
+    {
+        m_width = width;
+        m_height = height;
+
+        // Release the intermediate targets, they are created again with the new size
+        for (auto& targets : m_targets)
+        {
+            targets.fill(Target());
+        }
+    }
+}
+
+int PostFXStack::AddEffect(std::shared_ptr<Material> material, Resolution resolution)
+{
+    assert(material);
+    int effectIndex = GetEffectCount();
+    m_effects.push_back(Effect{ material, resolution, std::string(), std::string(), nullptr, true });
+    m_passesDirty = true;
+    return effectIndex;
+}
+
+int PostFXStack::AddPerPixelEffect(const char* declarations, const char* code, Material::ShaderSetupFunction setupFunction)
+{
+    int effectIndex = GetEffectCount();
+    m_effects.push_back(Effect{ nullptr, Resolution::Full, declarations ? declarations : "", code ? code : "", setupFunction, true });
+    m_passesDirty = true;
+    return effectIndex;
+}
+
+void PostFXStack::SetEffectEnabled(int effectIndex, bool enabled)
+{
+    if (m_effects[effectIndex].enabled != enabled)
+    {
+        m_effects[effectIndex].enabled = enabled;
+        m_passesDirty = true;
+    }
+}
+
+void PostFXStack::Render()
+{
+    Renderer& renderer = GetRenderer();
+    DeviceGL& device = renderer.GetDevice();
+
+    assert(m_sourceTexture);
+
+    if (m_passesDirty)
+    {
+        BuildPasses();
+        m_passesDirty = false;
+    }
+
+    // Backup current viewport
+    glm::ivec4 currentViewport;
+    device.GetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+
+    // Fullscreen triangles don't need depth, stencil or blending
+    bool depthTest = device.IsFeatureEnabled(GL_DEPTH_TEST);
+    bool stencilTest = device.IsFeatureEnabled(GL_STENCIL_TEST);
+    device.DisableFeature(GL_DEPTH_TEST);
+    device.DisableFeature(GL_STENCIL_TEST);
+    device.DisableFeature(GL_BLEND);
+
+    const Mesh& fullscreenMesh = renderer.GetFullscreenMesh();
+    std::shared_ptr<Texture2DObject> inputTexture = m_sourceTexture;
+    for (size_t i = 0; i < m_passes.size(); ++i)
+    {
+        const Pass& pass = m_passes[i];
+        std::shared_ptr<Texture2DObject> passInputTexture = inputTexture;
+
+        // The last pass writes to the target framebuffer, and the others to the intermediate target with their resolution
+        if (i + 1 < m_passes.size())
+        {
+            const Target& target = GetTarget(pass.resolution, inputTexture);
+            inputTexture = target.texture;
+            int scale = static_cast<int>(pass.resolution);
+            renderer.SetCurrentFramebuffer(target.framebuffer);
+            device.SetViewport(0, 0, std::max(m_width / scale, 1), std::max(m_height / scale, 1));
+        }
+        else
+        {
+            renderer.SetCurrentFramebuffer(m_targetFramebuffer);
+            device.SetViewport(0, 0, m_width, m_height);
+        }
+
+        if (pass.sourceTextureLocation >= 0)
+        {
+            pass.material->SetUniformValue(pass.sourceTextureLocation, passInputTexture);
+        }
+        if (pass.sourceScaleLocation >= 0)
+        {
+            // Only the source can be partially covered, the intermediate targets are always filled
+            pass.material->SetUniformValue(pass.sourceScaleLocation, i == 0 ? m_sourceScale : glm::vec2(1.0f));
+        }
+
+        pass.material->Use(static_cast<Material::OverrideFlags>(Material::OverrideDepthTest | Material::OverrideStencilTest | Material::OverrideBlend));
+        fullscreenMesh.DrawSubmesh(0);
+    }
+
+    // Restore the states for the next frame
+    device.SetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
+    device.SetFeatureEnabled(GL_DEPTH_TEST, depthTest);
+    device.SetFeatureEnabled(GL_STENCIL_TEST, stencilTest);
+}
+
+void PostFXStack::BuildPasses()
+{
+    m_passes.clear();
+
+    auto it = m_effects.cbegin();
+    while (it != m_effects.cend())
+    {
+        if (!it->enabled)
+        {
+            ++it;
+        }
+        else if (it->material)
+        {
+            m_passes.push_back(CreatePass(it->material, it->resolution));
+            ++it;
+        }
+        else
+        {
+            // Merge with the next per pixel effects, skipping the disabled ones in between
+            auto last = it;
+            while (last != m_effects.cend() && !last->material)
+            {
+                ++last;
+            }
+            std::shared_ptr<Material> material = BuildMergedMaterial(it, last);
+            if (material)
+            {
+                m_passes.push_back(CreatePass(material, Resolution::Full));
+            }
+            it = last;
+        }
+    }
+
+    // Without effects, a pass without code copies the source to the target
+    if (m_passes.empty())
+    {
+        std::shared_ptr<Material> material = BuildMergedMaterial(m_effects.cend(), m_effects.cend());
+        if (material)
+        {
+            m_passes.push_back(CreatePass(material, Resolution::Full));
+        }
+    }
+}
+
+std::shared_ptr<Material> PostFXStack::BuildMergedMaterial(std::vector<Effect>::const_iterator first, std::vector<Effect>::const_iterator last)
+{
+    if (!m_vertexShader)
+    {
+        m_vertexShader = std::make_unique<Shader>(ShaderLoader(Shader::VertexShader).Load("shaders/renderer/postfx.vert"));
+    }
+
+    // Declarations of all the effects, then their code in order inside the same main
+    std::string source =
+        "#version 330 core\n"
+        "in vec2 TexCoord;\n"
+        "out vec4 FragColor;\n"
+        "uniform sampler2D SourceTexture;\n"
+        "uniform vec2 SourceScale;\n";
+    std::vector<Material::ShaderSetupFunction> setupFunctions;
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->enabled)
+        {
+            source += it->declarations;
+            source += "\n";
+        }
+    }
+    // Clamped half a texel inside the covered part of the source, so the bilinear filter doesn't read outside
+    source += "void main()\n{\n"
+        "\tvec2 sourceCoord = min(TexCoord * SourceScale, SourceScale - 0.5f / vec2(textureSize(SourceTexture, 0)));\n"
+        "\tvec3 color = texture(SourceTexture, sourceCoord).rgb;\n";
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->enabled)
+        {
+            source += "\t{\n";
+            source += it->code;
+            source += "\n\t}\n";
+            if (it->setupFunction)
+            {
+                setupFunctions.push_back(it->setupFunction);
+            }
+        }
+    }
+    source += "\tFragColor = vec4(color, 1.0f);\n}\n";
+
+    const char* sourcePtr = source.c_str();
+    Shader fragmentShader = ShaderLoader(Shader::FragmentShader).LoadSources(std::span(&sourcePtr, 1));
+
+    std::shared_ptr<ShaderProgram> shaderProgram = std::make_shared<ShaderProgram>();
+    if (!shaderProgram->Build(*m_vertexShader, fragmentShader))
+    {
+        std::cout << "ERROR::POSTFX::MERGED_PROGRAM_LINK_FAILED" << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<Material> material = std::make_shared<Material>(shaderProgram);
+    if (!setupFunctions.empty())
+    {
+        material->SetShaderSetupFunction([setupFunctions](ShaderProgram& shaderProgram)
+            {
+                for (const Material::ShaderSetupFunction& setupFunction : setupFunctions)
+                {
+                    setupFunction(shaderProgram);
+                }
+            });
+    }
+    return material;
+}
+
+const PostFXStack::Target& PostFXStack::GetTarget(Resolution resolution, const std::shared_ptr<Texture2DObject>& inputTexture)
+{
+    std::array<Target, 2>& targets = m_targets[GetResolutionIndex(resolution)];
+    Target& target = targets[0].texture && targets[0].texture == inputTexture ? targets[1] : targets[0];
+
+    if (!target.texture)
+    {
+        int scale = static_cast<int>(resolution);
+
+        // Half float, so effects before the tone mapping keep the range of the scene
+        target.texture = std::make_shared<Texture2DObject>();
+        target.texture->Bind();
+        target.texture->SetImage(0, std::max(m_width / scale, 1), std::max(m_height / scale, 1), TextureObject::FormatRGBA, TextureObject::InternalFormatRGBA16F);
+        target.texture->SetParameter(TextureObject::ParameterEnum::MinFilter, GL_LINEAR);
+        target.texture->SetParameter(TextureObject::ParameterEnum::MagFilter, GL_LINEAR);
+        target.texture->SetParameter(TextureObject::ParameterEnum::WrapS, GL_CLAMP_TO_EDGE);
+        target.texture->SetParameter(TextureObject::ParameterEnum::WrapT, GL_CLAMP_TO_EDGE);
+        Texture2DObject::Unbind();
+
+        target.framebuffer = std::make_shared<FramebufferObject>();
+        target.framebuffer->Bind();
+        target.framebuffer->SetTexture(FramebufferObject::Target::Draw, FramebufferObject::Attachment::Color0, *target.texture);
+        FramebufferObject::Unbind();
+
+        // The renderer assumes its current framebuffer is still bound
+        GetRenderer().GetCurrentFramebuffer()->Bind();
+    }
+
+    return target;
+}
+
+PostFXStack::Pass PostFXStack::CreatePass(std::shared_ptr<Material> material, Resolution resolution)
+{
+    return Pass{ material, resolution, material->GetUniformLocation("SourceTexture"), material->GetUniformLocation("SourceScale") };
+}
+
+int PostFXStack::GetResolutionIndex(Resolution resolution)
+{
+    switch (resolution)
+    {
+    case Resolution::Full:
+        return 0;
+    case Resolution::Half:
+        return 1;
+    case Resolution::Quarter:
+        return 2;
+    default:
+        assert(false);
+        return 0;
+    }
+}
@@ -1,25 +1,53 @@
 #include <ituGL/renderer/Renderer.h>
 
 #include <ituGL/shader/Material.h>
+#include <ituGL/shader/ProgramPipeline.h>
 #include <ituGL/geometry/VertexFormat.h>
 #include <ituGL/geometry/VertexArrayObject.h>
 #include <ituGL/geometry/Drawcall.h>
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/geometry/Model.h>
 #include <ituGL/lighting/Light.h>
+#include <ituGL/camera/Camera.h>
 #include <ituGL/texture/FramebufferObject.h>
 #include <ituGL/renderer/RenderPass.h>
+#include <ituGL/renderer/OcclusionCuller.h>
+#include <glm/geometric.hpp>
+#include <glm/vector_relational.hpp>
 #include <span>
 #include <algorithm>
+#include <limits>
+#include <bit>
+#include <cmath>
 #include <cassert>
 
 Renderer::Renderer(DeviceGL& device)
     : m_device(device)
     , m_currentCamera(nullptr)
+    , m_cameraGeneration(1)
+    , m_currentMaterial(nullptr)
+    , m_currentWorldMatrixIndex(0)
+    , m_currentVertexArray(nullptr)
     , m_defaultFramebuffer(FramebufferObject::GetDefault())
     , m_currentFramebuffer(m_defaultFramebuffer)
-    , m_drawcallCollections(2)
+    , m_lodViewMatrix(1.0f)
+    , m_lodProjMatrix(1.0f)
+    , m_lodThreshold(0.001f)
+    , m_lodFadeRange(0.5f)
+    , m_recordFrame(0)
+    , m_renderFrame(0)
+    , m_pipelined(false)
+    , m_lastSkippedDrawcallCount(0)
+    , m_occlusionCulledCollections(2, false)
+    , m_lodFadeCollections(2, false)
+    , m_lastOccludedDrawcallCount(0)
+    , m_lastFrustumCulledDrawcallCount(0)
 {
+    for (FrameData& frame : m_frames)
+    {
+        frame.drawcallCollections.resize(2);
+    }
+
     InitializeFullscreenMesh();
 
     device.EnableFeature(GL_FRAMEBUFFER_SRGB);
@@ -29,9 +57,22 @@ Renderer::Renderer(DeviceGL& device)
     device.SetVSyncEnabled(true);
 }
 
+Renderer::~Renderer()
+{
+}
+
 bool Renderer::HasCamera() const
 {
-    return m_currentCamera;
+    return m_frames[m_recordFrame].hasCamera;
+}
+
+void Renderer::AddCamera(const Camera& camera)
+{
+    FrameData& frame = m_frames[m_recordFrame];
+    frame.camera = camera;
+    frame.hasCamera = true;
+    m_lodViewMatrix = camera.GetViewMatrix();
+    m_lodProjMatrix = camera.GetProjectionMatrix();
 }
 
 const Camera& Renderer::GetCurrentCamera() const
@@ -42,6 +83,7 @@ const Camera& Renderer::GetCurrentCamera() const
 void Renderer::SetCurrentCamera(const Camera& camera)
 {
     m_currentCamera = &camera;
+    ++m_cameraGeneration;
 }
 
 std::shared_ptr<const FramebufferObject> Renderer::GetDefaultFramebuffer() const
@@ -69,29 +111,216 @@ const Mesh& Renderer::GetFullscreenMesh() const
     return m_fullscreenMesh;
 }
 
+void Renderer::SetPipelined(bool pipelined)
+{
+    if (pipelined == m_pipelined)
+    {
+        return;
+    }
+
+    m_pipelined = pipelined;
+    if (pipelined)
+    {
+        // Nothing is rendered until the first recorded frame is swapped
+        m_renderFrame = 1 - m_recordFrame;
+        Reset(m_frames[m_renderFrame]);
+    }
+    else
+    {
+        Reset(m_frames[m_renderFrame]);
+        m_renderFrame = m_recordFrame;
+    }
+}
+
+void Renderer::EndRecording()
+{
+    // The occluders were rasterized while the models were added. Without occluders, the depth buffer is from an older frame
+    if (m_occlusionCuller)
+    {
+        bool hasOccluders = m_occlusionCuller->IsActive();
+        if (hasOccluders)
+        {
+            m_occlusionCuller->End();
+        }
+        CullDrawcalls(m_frames[m_recordFrame], hasOccluders);
+    }
+}
+
+void Renderer::SwapFrames()
+{
+    if (!m_pipelined)
+    {
+        return;
+    }
+
+    EndRecording();
+
+    std::swap(m_recordFrame, m_renderFrame);
+    Reset(m_frames[m_recordFrame]);
+
+    RemoveIncompleteDrawcalls(m_frames[m_renderFrame]);
+}
+
 void Renderer::Render()
 {
-    assert(m_currentCamera);
+    FrameData& frame = m_frames[m_renderFrame];
+
+    // In pipelined mode, the first frame is rendered before any frame was recorded
+    if (!frame.hasCamera)
+    {
+        assert(m_pipelined);
+        return;
+    }
+
+    if (!m_pipelined)
+    {
+        EndRecording();
+    }
+
+    m_currentCamera = &frame.camera;
+
+    UploadLights(frame.lights);
 
     for (auto& pass : m_passes)
     {
+        // Passes can bind other programs and VAOs, so we can't assume the last ones are still in use
+        // They can also set the camera uniforms themselves, so the programs get the camera again
+        ResetCurrentState();
+        ++m_cameraGeneration;
+
         SetCurrentFramebuffer(pass->GetTargetFramebuffer());
         pass->Render();
     }
 
-    Reset();
+    m_currentCamera = nullptr;
+
+    // The light blocks can be overwritten when the passes of this frame are done with them
+    m_lightBuffer->EndFrame();
+
+    m_lastSkippedDrawcallCount = frame.skippedDrawcallCount;
+    m_lastOccludedDrawcallCount = frame.occludedDrawcallCount;
+    m_lastFrustumCulledDrawcallCount = frame.frustumCulledDrawcallCount;
+
+    // In pipelined mode, the frame is reset when it is recorded again
+    if (!m_pipelined)
+    {
+        Reset(frame);
+    }
 }
 
-void Renderer::Reset()
+void Renderer::Reset(FrameData& frame)
 {
-    m_lights.clear();
+    frame.hasCamera = false;
+
+    frame.lights.clear();
+    frame.sceneLights.clear();
+
+    frame.worldMatrices.clear();
 
-    for (auto& collection : m_drawcallCollections)
+    for (auto& collection : frame.drawcallCollections)
     {
         collection.clear();
     }
 
-    m_currentCamera = nullptr;
+    frame.skippedDrawcallCount = 0;
+    frame.occludedDrawcallCount = 0;
+    frame.frustumCulledDrawcallCount = 0;
+}
+
+bool Renderer::IsOcclusionCullingEnabled(unsigned int collectionIndex) const
+{
+    return m_occlusionCulledCollections.at(collectionIndex);
+}
+
+void Renderer::SetOcclusionCullingEnabled(unsigned int collectionIndex, bool enabled)
+{
+    m_occlusionCulledCollections.at(collectionIndex) = enabled;
+    if (enabled && !m_occlusionCuller)
+    {
+        m_occlusionCuller = std::make_unique<OcclusionCuller>();
+    }
+}
+
+bool Renderer::IsLodFadeEnabled(unsigned int collectionIndex) const
+{
+    return m_lodFadeCollections.at(collectionIndex);
+}
+
+void Renderer::SetLodFadeEnabled(unsigned int collectionIndex, bool enabled)
+{
+    m_lodFadeCollections.at(collectionIndex) = enabled;
+}
+
+void Renderer::CullDrawcalls(FrameData& frame, bool useOccluders)
+{
+    FrustumBounds frustum(m_lodProjMatrix * m_lodViewMatrix);
+    for (unsigned int collectionIndex = 0; collectionIndex < frame.drawcallCollections.size(); ++collectionIndex)
+    {
+        if (!m_occlusionCulledCollections[collectionIndex])
+        {
+            continue;
+        }
+
+        // Pack the boxes to test them against the frustum 8 at a time. Drawcalls without bounds are never culled
+        DrawcallCollection& collection = frame.drawcallCollections[collectionIndex];
+        m_drawcallBounds.Clear();
+        for (const DrawcallInfo& drawcallInfo : collection)
+        {
+            if (glm::all(glm::lessThanEqual(drawcallInfo.boundsMin, drawcallInfo.boundsMax)))
+            {
+                m_drawcallBounds.AddAabb(0.5f * (drawcallInfo.boundsMin + drawcallInfo.boundsMax), 0.5f * (drawcallInfo.boundsMax - drawcallInfo.boundsMin));
+            }
+            else
+            {
+                m_drawcallBounds.AddSphere(glm::vec3(0.0f), std::numeric_limits<float>::infinity());
+            }
+        }
+        m_drawcallBounds.TestFrustum(frustum, m_visibilityMask);
+
+        unsigned int frustumVisibleCount = 0;
+        for (uint8_t mask : m_visibilityMask)
+        {
+            frustumVisibleCount += std::popcount(mask);
+        }
+        frame.frustumCulledDrawcallCount += static_cast<unsigned int>(collection.size()) - frustumVisibleCount;
+
+        // Only the boxes inside the frustum are tested against the occluders
+        if (useOccluders)
+        {
+            m_occlusionCuller->TestOcclusion(m_drawcallBounds, m_visibilityMask);
+        }
+
+        m_visibleDrawcalls.clear();
+        for (unsigned int i = 0; i < collection.size(); ++i)
+        {
+            if (PackedBounds::IsVisible(m_visibilityMask, i))
+            {
+                m_visibleDrawcalls.push_back(collection[i]);
+            }
+        }
+        frame.occludedDrawcallCount += frustumVisibleCount - static_cast<unsigned int>(m_visibleDrawcalls.size());
+        collection.swap(m_visibleDrawcalls);
+    }
+}
+
+void Renderer::RemoveIncompleteDrawcalls(FrameData& frame)
+{
+    for (DrawcallCollection& collection : frame.drawcallCollections)
+    {
+        m_visibleDrawcalls.clear();
+        for (const DrawcallInfo& drawcallInfo : collection)
+        {
+            if (drawcallInfo.material.GetShaderProgram()->IsLinkComplete())
+            {
+                m_visibleDrawcalls.push_back(drawcallInfo);
+            }
+            else
+            {
+                ++frame.skippedDrawcallCount;
+            }
+        }
+        collection.swap(m_visibleDrawcalls);
+    }
 }
 
 int Renderer::AddRenderPass(std::unique_ptr<RenderPass> renderPass)
@@ -109,59 +338,145 @@ void Renderer::RegisterShaderProgram(std::shared_ptr<const ShaderProgram> shader
 {
     assert(shaderProgramPtr);
 
+    ShaderProgramInfo& shaderProgramInfo = m_shaderProgramInfos[shaderProgramPtr];
     if (updateTransformFunction)
     {
-        m_updateTransformsFunctions[shaderProgramPtr] = updateTransformFunction;
+        shaderProgramInfo.updateTransformsFunction = updateTransformFunction;
     }
 
     if (updateLightsFunction)
     {
-        m_updateLightsFunctions[shaderProgramPtr] = updateLightsFunction;
+        shaderProgramInfo.updateLightsFunction = updateLightsFunction;
+    }
+
+    shaderProgramInfo.lodFadeLocation = shaderProgramPtr->GetUniformLocation("LodFade"_u);
+}
+
+void Renderer::RegisterShaderVariants(std::shared_ptr<const ShaderProgram> shaderProgramPtr, ShaderProgramVariants& shaderProgramVariants)
+{
+    assert(shaderProgramPtr);
+
+    ShaderVariantInfo variantInfo;
+    variantInfo.variants = &shaderProgramVariants;
+    variantInfo.materialMask = 0;
+    bool isVariant = shaderProgramVariants.GetVariantMask(*shaderProgramPtr, variantInfo.materialMask);
+    assert(isVariant);
+
+    // Resolve the keywords once. Keywords not declared by the variants get an empty mask, and are never defined
+    variantInfo.directionalMask = shaderProgramVariants.GetKeywordMask(LightDirectionalKeyword);
+    variantInfo.pointMask = shaderProgramVariants.GetKeywordMask(LightPointKeyword);
+    variantInfo.spotMask = shaderProgramVariants.GetKeywordMask(LightSpotKeyword);
+    variantInfo.indirectMask = shaderProgramVariants.GetKeywordMask(LightIndirectKeyword);
+    variantInfo.lightKeywordsMask = variantInfo.directionalMask | variantInfo.pointMask | variantInfo.spotMask | variantInfo.indirectMask;
+    variantInfo.lodFadeMask = shaderProgramVariants.GetKeywordMask(LodFadeKeyword);
+
+    if (isVariant)
+    {
+        m_shaderVariants[shaderProgramPtr] = variantInfo;
+    }
+}
+
+void Renderer::UpdateTransforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged) const
+{
+    const glm::mat4& worldMatrix = m_frames[m_renderFrame].worldMatrices[worldMatrixIndex];
+    UpdateTransforms(shaderProgramPtr, worldMatrix, cameraChanged);
+}
+
+void Renderer::UpdateTransforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged) const
+{
+    const auto& itFind = m_shaderProgramInfos.find(shaderProgramPtr);
+    if (itFind != m_shaderProgramInfos.end() && itFind->second.updateTransformsFunction)
+    {
+        itFind->second.updateTransformsFunction(*shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
     }
 }
 
-void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, unsigned int worldMatrixIndex, bool cameraChanged) const
+void Renderer::UpdateDrawcallUniforms(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, const DrawcallInfo& drawcallInfo, bool updateTransforms) const
 {
-    const glm::mat4& worldMatrix = m_worldMatrices[worldMatrixIndex];
-    UpdateTransforms(shaderProgramPtr, worldMatrix);
+    const auto& itFind = m_shaderProgramInfos.find(shaderProgramPtr);
+    if (itFind == m_shaderProgramInfos.end())
+    {
+        return;
+    }
+
+    const ShaderProgramInfo& shaderProgramInfo = itFind->second;
+    if (updateTransforms && shaderProgramInfo.updateTransformsFunction)
+    {
+        // The camera is set the first time the program is used in the pass, and kept while the pass switches programs
+        bool cameraChanged = shaderProgramInfo.cameraGeneration != m_cameraGeneration;
+        shaderProgramInfo.cameraGeneration = m_cameraGeneration;
+
+        const glm::mat4& worldMatrix = m_frames[m_renderFrame].worldMatrices[drawcallInfo.worldMatrixIndex];
+        shaderProgramInfo.updateTransformsFunction(*shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
+    }
+    if (shaderProgramInfo.lodFadeLocation >= 0)
+    {
+        shaderProgramPtr->SetUniform(shaderProgramInfo.lodFadeLocation, drawcallInfo.lodFade);
+    }
 }
 
-void Renderer::UpdateTransforms(std::shared_ptr<const ShaderProgram> shaderProgramPtr, const glm::mat4& worldMatrix, bool cameraChanged) const
+bool Renderer::NeedsSharedStageCamera(const ShaderProgram& sharedStage) const
 {
-    const auto& itFind = m_updateTransformsFunctions.find(shaderProgramPtr);
-    if (itFind != m_updateTransformsFunctions.end())
+    auto itFind = std::find_if(m_sharedStageCameras.begin(), m_sharedStageCameras.end(),
+        [&sharedStage](const auto& sharedStageCamera) { return sharedStageCamera.first == &sharedStage; });
+    if (itFind == m_sharedStageCameras.end())
     {
-        itFind->second(*shaderProgramPtr, worldMatrix, *m_currentCamera, cameraChanged);
+        m_sharedStageCameras.emplace_back(&sharedStage, m_cameraGeneration);
+        return true;
     }
+
+    bool needsCamera = itFind->second != m_cameraGeneration;
+    itFind->second = m_cameraGeneration;
+    return needsCamera;
 }
 
 Renderer::UpdateLightsFunction Renderer::GetDefaultUpdateLightsFunction(const ShaderProgram& shaderProgram)
 {
     // Get lighting related uniform locations
-    ShaderProgram::Location lightIndirectLocation = shaderProgram.GetUniformLocation("LightIndirect");
-    ShaderProgram::Location lightColorLocation = shaderProgram.GetUniformLocation("LightColor");
-    ShaderProgram::Location lightPositionLocation = shaderProgram.GetUniformLocation("LightPosition");
-    ShaderProgram::Location lightDirectionLocation = shaderProgram.GetUniformLocation("LightDirection");
-    ShaderProgram::Location lightAttenuationLocation = shaderProgram.GetUniformLocation("LightAttenuation");
-    ShaderProgram::Location LightShadowEnabledLocation = shaderProgram.GetUniformLocation("LightShadowEnabled");
-    ShaderProgram::Location lightShadowMapLocation = shaderProgram.GetUniformLocation("LightShadowMap");
-    ShaderProgram::Location lightShadowMatrixLocation = shaderProgram.GetUniformLocation("LightShadowMatrix");
-    ShaderProgram::Location lightShadowBiasLocation = shaderProgram.GetUniformLocation("LightShadowBias");
-
-    return [=](const ShaderProgram& shaderProgram, std::span<const Light* const> lights, unsigned int& lightIndex) -> bool
+    ShaderProgram::Location lightIndirectLocation = shaderProgram.GetUniformLocation("LightIndirect"_u);
+    ShaderProgram::Location lightColorLocation = shaderProgram.GetUniformLocation("LightColor"_u);
+    ShaderProgram::Location lightPositionLocation = shaderProgram.GetUniformLocation("LightPosition"_u);
+    ShaderProgram::Location lightDirectionLocation = shaderProgram.GetUniformLocation("LightDirection"_u);
+    ShaderProgram::Location lightAttenuationLocation = shaderProgram.GetUniformLocation("LightAttenuation"_u);
+    ShaderProgram::Location LightShadowEnabledLocation = shaderProgram.GetUniformLocation("LightShadowEnabled"_u);
+    ShaderProgram::Location lightShadowMapLocation = shaderProgram.GetUniformLocation("LightShadowMap"_u);
+    ShaderProgram::Location lightShadowMatrixLocation = shaderProgram.GetUniformLocation("LightShadowMatrix"_u);
+    ShaderProgram::Location lightShadowBiasLocation = shaderProgram.GetUniformLocation("LightShadowBias"_u);
+
+    GLuint lightBlockIndex = shaderProgram.GetUniformBlockIndex("LightBlock"_u);
+    bool hasLightBlock = lightBlockIndex != GL_INVALID_INDEX;
+    if (hasLightBlock)
+    {
+        shaderProgram.SetUniformBlockBinding(lightBlockIndex, LightBlockBinding);
+    }
+
+    return [=, this](const ShaderProgram& shaderProgram, std::span<const Light* const> lights, unsigned int& lightIndex) -> bool
     {
         bool needsRender = lightIndex == 0;
 
-        shaderProgram.SetUniform(lightIndirectLocation, lightIndex == 0 ? 1 : 0);
+        if (hasLightBlock)
+        {
+            // The block of the light is already in the buffer, only its range is bound. The first one exists even without lights
+            if (lightIndex < m_lightBlockOffsets.size())
+            {
+                m_lightBuffer->BindRange(BufferObject::UniformBuffer, LightBlockBinding, m_lightBlockOffsets[lightIndex], sizeof(LightBlockData));
+            }
+        }
+        else
+        {
+            shaderProgram.SetUniform(lightIndirectLocation, lightIndex == 0 ? 1 : 0);
+        }
 
         if (lightIndex < lights.size())
         {
             const Light& light = *lights[lightIndex];
-            shaderProgram.SetUniform(lightColorLocation, light.GetColor() * light.GetIntensity());
-            shaderProgram.SetUniform(lightPositionLocation, light.GetPosition());
-            shaderProgram.SetUniform(lightDirectionLocation, light.GetDirection());
-            shaderProgram.SetUniform(lightAttenuationLocation, light.GetAttenuation());
-            shaderProgram.SetUniform(lightAttenuationLocation, light.GetAttenuation());
+            if (!hasLightBlock)
+            {
+                shaderProgram.SetUniform(lightColorLocation, light.GetColor() * light.GetIntensity());
+                shaderProgram.SetUniform(lightPositionLocation, light.GetPosition());
+                shaderProgram.SetUniform(lightDirectionLocation, light.GetDirection());
+                shaderProgram.SetUniform(lightAttenuationLocation, light.GetAttenuation());
+            }
 
             std::shared_ptr<const TextureObject> shadowMap = light.GetShadowMap();
             shaderProgram.SetUniform(LightShadowEnabledLocation, shadowMap ? 1 : 0);
@@ -173,7 +488,7 @@ Renderer::UpdateLightsFunction Renderer::GetDefaultUpdateLightsFunction(const Sh
             }
             needsRender = true;
         }
-        else
+        else if (!hasLightBlock)
         {
             // Disable light
             shaderProgram.SetUniform(lightColorLocation, glm::vec3(0.0f));
@@ -185,69 +500,474 @@ Renderer::UpdateLightsFunction Renderer::GetDefaultUpdateLightsFunction(const Sh
     };
 }
 
-bool Renderer::UpdateLights(std::shared_ptr<const ShaderProgram> shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const
+bool Renderer::UpdateLights(const std::shared_ptr<const ShaderProgram>& shaderProgramPtr, std::span<const Light* const> lights, unsigned int& lightIndex) const
 {
-    const auto& itFind = m_updateLightsFunctions.find(shaderProgramPtr);
-    if (itFind != m_updateLightsFunctions.end())
+    const auto& itFind = m_shaderProgramInfos.find(shaderProgramPtr);
+    if (itFind != m_shaderProgramInfos.end() && itFind->second.updateLightsFunction)
     {
-        return itFind->second(*shaderProgramPtr, lights, lightIndex);
+        return itFind->second.updateLightsFunction(*shaderProgramPtr, lights, lightIndex);
     }
     return false;
 }
 
+void Renderer::UploadLights(std::span<const Light* const> lights)
+{
+    // One block for each light, or one without color when there are none, to draw the indirect lighting
+    size_t blockCount = std::max<size_t>(lights.size(), 1);
+
+    // Offsets are aligned to at most 256 bytes, so reserve that much for each block
+    constexpr size_t maxBlockSize = 256;
+    static_assert(sizeof(LightBlockData) <= maxBlockSize);
+    if (!m_lightBuffer || m_lightBuffer->GetFrameSize() < blockCount * maxBlockSize)
+    {
+        size_t blockCapacity = std::max<size_t>(16, 2 * blockCount);
+        m_lightBuffer = std::make_unique<StreamingBuffer<BufferObject::UniformBuffer>>(blockCapacity * maxBlockSize);
+    }
+
+    m_lightBuffer->BeginFrame();
+    m_lightBlockOffsets.clear();
+    for (size_t i = 0; i < blockCount; ++i)
+    {
+        LightBlockData lightBlock = {};
+        lightBlock.indirect = i == 0 ? 1 : 0;
+        if (i < lights.size())
+        {
+            const Light& light = *lights[i];
+            lightBlock.color = light.GetColor() * light.GetIntensity();
+            lightBlock.position = light.GetPosition();
+            lightBlock.direction = light.GetDirection();
+            lightBlock.attenuation = light.GetAttenuation();
+        }
+        size_t offset = m_lightBuffer->Write(std::span<const LightBlockData>(&lightBlock, 1));
+        assert(offset != StreamingBuffer<BufferObject::UniformBuffer>::InvalidOffset);
+        m_lightBlockOffsets.push_back(offset);
+    }
+    m_lightBuffer->Flush();
+}
+
 std::span<const Light* const> Renderer::GetLights() const
 {
-    return m_lights;
+    return m_frames[m_renderFrame].lights;
 }
 
 void Renderer::AddLight(const Light& light)
 {
-    m_lights.push_back(&light);
+    FrameData& frame = m_frames[m_recordFrame];
+    if (m_pipelined)
+    {
+        size_t lightIndex = frame.lights.size();
+        if (lightIndex == frame.lightCopies.size())
+        {
+            frame.lightCopies.emplace_back();
+        }
+        std::unique_ptr<Light>& lightCopy = frame.lightCopies[lightIndex];
+        light.CopyTo(lightCopy);
+        frame.sceneLights.push_back(&light);
+        frame.lights.push_back(lightCopy.get());
+    }
+    else
+    {
+        frame.lights.push_back(&light);
+    }
+}
+
+Light& Renderer::GetRenderLight(Light& light)
+{
+    FrameData& frame = m_frames[m_renderFrame];
+    auto itFind = std::find(frame.sceneLights.begin(), frame.sceneLights.end(), &light);
+    return itFind != frame.sceneLights.end() ? *frame.lightCopies[itFind - frame.sceneLights.begin()] : light;
 }
 
 std::span<const Renderer::DrawcallInfo> Renderer::GetDrawcalls(unsigned int collectionIndex) const
 {
-    return m_drawcallCollections[collectionIndex];
+    return m_frames[m_renderFrame].drawcallCollections[collectionIndex];
 }
 
-void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix, const std::vector<int> drawCallCollectionIndeces)
+void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces)
 {
-    unsigned int worldMatrixIndex = static_cast<unsigned int>(m_worldMatrices.size());
-    m_worldMatrices.push_back(worldMatrix);
+    AddModel(model, worldMatrix, drawCallCollectionIndeces, {});
+}
+
+void Renderer::AddModel(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces, std::span<const glm::vec3> submeshBounds)
+{
+    FrameData& frame = m_frames[m_recordFrame];
+
+    unsigned int worldMatrixIndex = static_cast<unsigned int>(frame.worldMatrices.size());
+    frame.worldMatrices.push_back(worldMatrix);
 
     const Mesh& mesh = model.GetMesh();
+
+    // Occluders are rasterized in the background while the rest of the models are added
+    if (m_occlusionCuller && mesh.HasOccluder())
+    {
+        if (!m_occlusionCuller->IsActive())
+        {
+            m_occlusionCuller->Begin(m_lodProjMatrix * m_lodViewMatrix);
+        }
+        // The simplification error is pushed back in world space, scaled by the largest axis as in SelectLod
+        float worldScale = std::sqrt(std::max(glm::dot(worldMatrix[0], worldMatrix[0]), std::max(glm::dot(worldMatrix[1], worldMatrix[1]), glm::dot(worldMatrix[2], worldMatrix[2]))));
+        m_occlusionCuller->AddOccluder(mesh.GetOccluderPositions(), mesh.GetOccluderIndices(), worldMatrix, mesh.GetOccluderError() * worldScale);
+    }
+
+    const glm::mat4* lastSubmeshTransform = nullptr;
+    unsigned int lastSubmeshWorldMatrixIndex = worldMatrixIndex;
     for (unsigned int submeshIndex = 0; submeshIndex < mesh.GetSubmeshCount(); ++submeshIndex)
     {
-        DrawcallInfo drawcallInfo(model.GetMaterial(submeshIndex), worldMatrixIndex,
-            mesh.GetSubmeshVertexArray(submeshIndex), mesh.GetSubmeshDrawcall(submeshIndex));
+        // Programs still compiling in the background can't be used yet. Skip them instead of waiting
+        // In pipelined mode, this can be another thread, and they are removed when the frames are swapped
+        const Material& material = model.GetMaterial(submeshIndex);
+        if (!m_pipelined && !material.GetShaderProgram()->IsLinkComplete())
+        {
+            ++frame.skippedDrawcallCount;
+            continue;
+        }
+
+        // Submeshes with a local transform (quantized positions) need their own world matrix
+        unsigned int submeshWorldMatrixIndex = worldMatrixIndex;
+        if (mesh.HasSubmeshTransform(submeshIndex))
+        {
+            if (!lastSubmeshTransform || *lastSubmeshTransform != mesh.GetSubmeshTransform(submeshIndex))
+            {
+                lastSubmeshTransform = &mesh.GetSubmeshTransform(submeshIndex);
+                lastSubmeshWorldMatrixIndex = static_cast<unsigned int>(frame.worldMatrices.size());
+                frame.worldMatrices.push_back(worldMatrix * *lastSubmeshTransform);
+            }
+            submeshWorldMatrixIndex = lastSubmeshWorldMatrixIndex;
+        }
+
+        float lodFade = 0.0f;
+        unsigned int lod = SelectLod(mesh, submeshIndex, worldMatrix, lodFade);
 
-        /*for (DrawcallCollection& collection : m_drawcallCollections)
+        glm::vec3 boundsMin, boundsMax;
+        if (submeshBounds.empty())
+        {
+            ComputeSubmeshBounds(mesh, submeshIndex, worldMatrix, boundsMin, boundsMax);
+        }
+        else
+        {
+            boundsMin = submeshBounds[2 * submeshIndex];
+            boundsMax = submeshBounds[2 * submeshIndex + 1];
+        }
+
+        DrawcallInfo drawcallInfo(material, submeshWorldMatrixIndex,
+            mesh.GetSubmeshVertexArray(submeshIndex), mesh.GetSubmeshPositionVertexArray(submeshIndex), mesh.GetSubmeshDrawcall(submeshIndex, lod), boundsMin, boundsMax, lodFade);
+
+        // The next level of detail only exists while cross-fading
+        const Drawcall& fadeDrawcall = mesh.GetSubmeshDrawcall(submeshIndex, lodFade > 0.0f ? lod + 1 : lod);
+        AddSubmeshDrawcalls(frame.drawcallCollections, drawCallCollectionIndeces, m_lodFadeCollections, drawcallInfo, fadeDrawcall);
+    }
+}
+
+void Renderer::AddSubmeshDrawcalls(std::span<DrawcallCollection> collections, std::span<const int> collectionIndices,
+    const std::vector<bool>& lodFadeCollections, const DrawcallInfo& drawcallInfo, const Drawcall& fadeDrawcall)
+{
+    for (int i : collectionIndices)
+    {
+        DrawcallCollection& collection = collections[i];
+        if (drawcallInfo.lodFade > 0.0f && lodFadeCollections[i])
         {
+            // The next level of detail fills the pixels dithered out of the current one
             collection.push_back(drawcallInfo);
-        }*/
+            collection.emplace_back(drawcallInfo.material, drawcallInfo.worldMatrixIndex, drawcallInfo.vao, drawcallInfo.positionVao,
+                fadeDrawcall, drawcallInfo.boundsMin, drawcallInfo.boundsMax, -drawcallInfo.lodFade);
+        }
+        else
+        {
+            // Passes that don't set LodFade would draw both levels whole, so only the current one is drawn, without dithering
+            collection.emplace_back(drawcallInfo.material, drawcallInfo.worldMatrixIndex, drawcallInfo.vao, drawcallInfo.positionVao,
+                drawcallInfo.drawcall, drawcallInfo.boundsMin, drawcallInfo.boundsMax, 0.0f);
+        }
+    }
+}
+
+int Renderer::AddModelProxy(const Model& model, const glm::mat4& worldMatrix, std::span<const int> drawCallCollectionIndeces)
+{
+    int proxyIndex;
+    if (m_freeModelProxies.empty())
+    {
+        proxyIndex = static_cast<int>(m_modelProxies.size());
+        m_modelProxies.emplace_back();
+    }
+    else
+    {
+        proxyIndex = m_freeModelProxies.back();
+        m_freeModelProxies.pop_back();
+    }
+
+    ModelProxy& modelProxy = m_modelProxies[proxyIndex];
+    modelProxy.model = &model;
+    modelProxy.worldMatrix = worldMatrix;
+    modelProxy.drawCallCollectionIndeces.assign(drawCallCollectionIndeces.begin(), drawCallCollectionIndeces.end());
+    UpdateModelProxyBounds(modelProxy);
+    return proxyIndex;
+}
+
+void Renderer::UpdateModelProxy(int proxyIndex, const Model& model, const glm::mat4& worldMatrix)
+{
+    ModelProxy& modelProxy = m_modelProxies.at(proxyIndex);
+    assert(modelProxy.model);
+    modelProxy.model = &model;
+    modelProxy.worldMatrix = worldMatrix;
+    UpdateModelProxyBounds(modelProxy);
+}
+
+void Renderer::RemoveModelProxy(int proxyIndex)
+{
+    ModelProxy& modelProxy = m_modelProxies.at(proxyIndex);
+    assert(modelProxy.model);
+    modelProxy.model = nullptr;
+    m_freeModelProxies.push_back(proxyIndex);
+}
+
+int Renderer::AddLightProxy(const Light& light)
+{
+    int proxyIndex;
+    if (m_freeLightProxies.empty())
+    {
+        proxyIndex = static_cast<int>(m_lightProxies.size());
+        m_lightProxies.push_back(&light);
+    }
+    else
+    {
+        proxyIndex = m_freeLightProxies.back();
+        m_freeLightProxies.pop_back();
+        m_lightProxies[proxyIndex] = &light;
+    }
+    return proxyIndex;
+}
 
-        for (int i : drawCallCollectionIndeces)
+void Renderer::UpdateLightProxy(int proxyIndex, const Light& light)
+{
+    assert(m_lightProxies.at(proxyIndex));
+    m_lightProxies[proxyIndex] = &light;
+}
+
+void Renderer::RemoveLightProxy(int proxyIndex)
+{
+    assert(m_lightProxies.at(proxyIndex));
+    m_lightProxies[proxyIndex] = nullptr;
+    m_freeLightProxies.push_back(proxyIndex);
+}
+
+void Renderer::AddProxies()
+{
+    // Lights are recorded every frame, because their properties can change without notice. There are only a few of them
+    for (const Light* light : m_lightProxies)
+    {
+        if (light)
         {
-            m_drawcallCollections.at(i).push_back(drawcallInfo);
+            AddLight(*light);
         }
     }
+
+    // The levels of detail still depend on the camera, so they are selected again
+    for (const ModelProxy& modelProxy : m_modelProxies)
+    {
+        if (modelProxy.model)
+        {
+            AddModel(*modelProxy.model, modelProxy.worldMatrix, modelProxy.drawCallCollectionIndeces, modelProxy.submeshBounds);
+        }
+    }
+}
+
+void Renderer::UpdateModelProxyBounds(ModelProxy& modelProxy)
+{
+    const Mesh& mesh = modelProxy.model->GetMesh();
+    unsigned int submeshCount = mesh.GetSubmeshCount();
+    modelProxy.submeshBounds.resize(2 * submeshCount);
+    for (unsigned int submeshIndex = 0; submeshIndex < submeshCount; ++submeshIndex)
+    {
+        ComputeSubmeshBounds(mesh, submeshIndex, modelProxy.worldMatrix, modelProxy.submeshBounds[2 * submeshIndex], modelProxy.submeshBounds[2 * submeshIndex + 1]);
+    }
+}
+
+unsigned int Renderer::SelectLod(const Mesh& mesh, unsigned int submeshIndex, const glm::mat4& worldMatrix, float& lodFade) const
+{
+    lodFade = 0.0f;
+
+    unsigned int lodCount = mesh.GetSubmeshLodCount(submeshIndex);
+    if (lodCount == 1)
+    {
+        return 0;
+    }
+
+    // Bounding sphere in view space. The radius is scaled by the largest axis of the world matrix
+    const glm::vec4& boundingSphere = mesh.GetSubmeshBoundingSphere(submeshIndex);
+    glm::vec3 viewCenter = m_lodViewMatrix * worldMatrix * glm::vec4(glm::vec3(boundingSphere), 1.0f);
+    float worldScale = std::sqrt(std::max(glm::dot(worldMatrix[0], worldMatrix[0]), std::max(glm::dot(worldMatrix[1], worldMatrix[1]), glm::dot(worldMatrix[2], worldMatrix[2]))));
+    float worldRadius = boundingSphere.w * worldScale;
+
+    // Fraction of the viewport height covered by the bounding sphere radius, using the distance to its closest point
+    float projectedRadius = 0.5f * worldRadius * m_lodProjMatrix[1][1];
+    if (m_lodProjMatrix[3][3] == 0.0f)
+    {
+        float distance = glm::length(viewCenter) - worldRadius;
+        if (distance <= 0.0f)
+        {
+            return 0;
+        }
+        projectedRadius /= distance;
+    }
+
+    // Errors are relative to the bounding sphere radius, so they can be compared on screen
+    float errorScale = boundingSphere.w > 0.0f ? projectedRadius / boundingSphere.w : 0.0f;
+
+    // Pick the coarsest level of detail with an error below the threshold
+    unsigned int lod = 0;
+    while (lod + 1 < lodCount && mesh.GetSubmeshLodError(submeshIndex, lod + 1) * errorScale <= m_lodThreshold)
+    {
+        ++lod;
+    }
+
+    // Cross-fade with the next level while its error is close to the threshold
+    if (lod + 1 < lodCount && m_lodFadeRange > 0.0f)
+    {
+        float nextError = mesh.GetSubmeshLodError(submeshIndex, lod + 1) * errorScale;
+        float fade = 1.0f - (nextError - m_lodThreshold) / (m_lodThreshold * m_lodFadeRange);
+        lodFade = std::max(fade, 0.0f);
+    }
+
+    return lod;
+}
+
+void Renderer::ComputeSubmeshBounds(const Mesh& mesh, unsigned int submeshIndex, const glm::mat4& worldMatrix, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    // Submeshes without a bounding sphere get an empty box, that is never culled
+    const glm::vec4& boundingSphere = mesh.GetSubmeshBoundingSphere(submeshIndex);
+    if (boundingSphere.w <= 0.0f)
+    {
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        return;
+    }
+
+    // The radius is scaled by the largest axis of the world matrix, as in SelectLod
+    glm::vec3 worldCenter = worldMatrix * glm::vec4(glm::vec3(boundingSphere), 1.0f);
+    float worldScale = std::sqrt(std::max(glm::dot(worldMatrix[0], worldMatrix[0]), std::max(glm::dot(worldMatrix[1], worldMatrix[1]), glm::dot(worldMatrix[2], worldMatrix[2]))));
+    glm::vec3 worldExtents(boundingSphere.w * worldScale);
+    boundsMin = worldCenter - worldExtents;
+    boundsMax = worldCenter + worldExtents;
 }
 
 void Renderer::PrepareDrawcall(const DrawcallInfo& drawcallInfo)
 {
     std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.material.GetShaderProgram();
 
-    // TODO: Room for optimization here, caching current material, current worldMatrixIndex and current VAO
+    // Setup material. If it is still in use, only the render states need to be set again, as the pass can change them
+    bool sameProgram = shaderProgram == m_currentShaderProgram;
+    if (sameProgram && &drawcallInfo.material == m_currentMaterial)
+    {
+        drawcallInfo.material.UseRenderStates(Material::OverrideCulling);
+    }
+    else
+    {
+        drawcallInfo.material.Use(Material::OverrideCulling);
+        m_currentMaterial = &drawcallInfo.material;
+    }
 
-    // Setup material
-    drawcallInfo.material.Use(Material::OverrideCulling);
+    // Setup world matrix, camera and level of detail cross-fade. The transforms are kept if the world matrix didn't change
+    UpdateDrawcallUniforms(shaderProgram, drawcallInfo, !sameProgram || drawcallInfo.worldMatrixIndex != m_currentWorldMatrixIndex);
 
-    // Setup world matrix
-    // Setup camera
-    UpdateTransforms(shaderProgram, drawcallInfo.worldMatrixIndex);
+    m_currentShaderProgram = shaderProgram;
+    m_currentWorldMatrixIndex = drawcallInfo.worldMatrixIndex;
 
-    // Setup VAO
-    drawcallInfo.vao.Bind();
+    // Setup VAO, if it is not bound already
+    if (&drawcallInfo.vao != m_currentVertexArray)
+    {
+        drawcallInfo.vao.Bind();
+        m_currentVertexArray = &drawcallInfo.vao;
+    }
+}
+
+std::shared_ptr<const ShaderProgram> Renderer::SelectLightVariant(const DrawcallInfo& drawcallInfo, std::span<const Light* const> lights, unsigned int lightIndex)
+{
+    std::shared_ptr<const ShaderProgram> shaderProgram = drawcallInfo.material.GetShaderProgram();
+
+    // Past the last light there is nothing to draw, keep the current program to finish the loop
+    const auto& itVariants = m_shaderVariants.find(shaderProgram);
+    if (itVariants == m_shaderVariants.end() || (lightIndex > 0 && lightIndex >= lights.size()))
+    {
+        return m_currentShaderProgram;
+    }
+    const ShaderVariantInfo& variantInfo = itVariants->second;
+
+    // Replace the light keywords of the material variant with the ones of this light
+    ShaderProgramVariants::KeywordMask lightMask = lightIndex == 0 ? variantInfo.indirectMask : 0;
+    if (lightIndex < lights.size())
+    {
+        switch (lights[lightIndex]->GetType())
+        {
+        case Light::Type::Directional:
+            lightMask |= variantInfo.directionalMask;
+            break;
+        case Light::Type::Point:
+            lightMask |= variantInfo.pointMask;
+            break;
+        case Light::Type::Spot:
+            lightMask |= variantInfo.spotMask;
+            break;
+        }
+    }
+
+    // Only the drawcalls cross-fading their level of detail pay for the dithering
+    ShaderProgramVariants::KeywordMask baseMask = variantInfo.materialMask & ~(variantInfo.lightKeywordsMask | variantInfo.lodFadeMask);
+    if (drawcallInfo.lodFade != 0.0f)
+    {
+        baseMask |= variantInfo.lodFadeMask;
+    }
+    ShaderProgramVariants::KeywordMask variantMask = baseMask | lightMask;
+
+    // Variants are built in the background the first time they are needed, so compiling never stalls the pass
+    // Until then, use the variant without light keywords, that finds the light type at runtime, or the material program
+    // The material program has no LOD_FADE, so until the variant with it is ready both levels of detail are drawn whole
+    std::shared_ptr<const ShaderProgram> variant = variantInfo.variants->FindVariant(variantMask);
+    if (!variant)
+    {
+        variantMask = baseMask;
+        variant = variantInfo.variants->FindVariant(variantMask);
+        if (!variant)
+        {
+            variantMask = variantInfo.materialMask;
+            variant = shaderProgram;
+        }
+    }
+    if (variant == m_currentShaderProgram)
+    {
+        return variant;
+    }
+
+    // Set up the variant like PrepareDrawcall does with the material program. Separable variants are used in their pipeline
+    std::shared_ptr<const ProgramPipeline> pipeline = variant == shaderProgram
+        ? drawcallInfo.material.GetProgramPipeline() : variantInfo.variants->GetPipeline(variantMask);
+    if (pipeline)
+    {
+        pipeline->Use();
+    }
+    else
+    {
+        variant->Use();
+    }
+    if (variant == shaderProgram)
+    {
+        drawcallInfo.material.SetUniforms();
+    }
+    else
+    {
+        drawcallInfo.material.SetUniforms(*variant, variantInfo.variants->GetLocationMap(variantInfo.materialMask, variantMask));
+    }
+
+    UpdateDrawcallUniforms(variant, drawcallInfo);
+
+    m_currentShaderProgram = variant;
+    m_currentWorldMatrixIndex = drawcallInfo.worldMatrixIndex;
+    return variant;
+}
+
+void Renderer::ResetCurrentState()
+{
+    m_currentMaterial = nullptr;
+    m_currentShaderProgram = nullptr;
+    m_currentVertexArray = nullptr;
 }
 
 void Renderer::SetLightingRenderStates(bool firstPass)
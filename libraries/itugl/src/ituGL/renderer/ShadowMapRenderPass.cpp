@@ -61,17 +61,20 @@ void ShadowMapRenderPass::Render()
     // Backup current camera
     const Camera& currentCamera = renderer.GetCurrentCamera();
 
+    // In pipelined mode the scene light can change while the frame renders, use the copy recorded with the frame
+    Light& light = renderer.GetRenderLight(*m_light);
+
     // Set up light as the camera
     Camera lightCamera;
-    InitLightCamera(lightCamera);
+    InitLightCamera(light, lightCamera);
     renderer.SetCurrentCamera(lightCamera);
 
     // for all drawcalls
     bool first = true;
     for (const Renderer::DrawcallInfo& drawcallInfo : drawcallCollection)
     {
-        // Bind the vao
-        drawcallInfo.vao.Bind();
+        // Bind the vao with only the positions
+        drawcallInfo.positionVao.Bind();
 
         // Set up object matrix
         renderer.UpdateTransforms(shaderProgram, drawcallInfo.worldMatrixIndex, first);
@@ -82,7 +85,7 @@ void ShadowMapRenderPass::Render()
         first = false;
     }
 
-    m_light->SetShadowMatrix(lightCamera.GetViewProjectionMatrix());
+    light.SetShadowMatrix(lightCamera.GetViewProjectionMatrix());
 
     // Restore viewport
     renderer.GetDevice().SetViewport(currentViewport.x, currentViewport.y, currentViewport.z, currentViewport.w);
@@ -94,16 +97,16 @@ void ShadowMapRenderPass::Render()
     renderer.SetCurrentFramebuffer(renderer.GetDefaultFramebuffer());
 }
 
-void ShadowMapRenderPass::InitLightCamera(Camera& lightCamera) const
+void ShadowMapRenderPass::InitLightCamera(const Light& light, Camera& lightCamera) const
 {
     // View matrix
-    glm::vec3 position = m_light->GetPosition(m_volumeCenter);
-    glm::vec3 direction = m_light->GetDirection();
+    glm::vec3 position = light.GetPosition(m_volumeCenter);
+    glm::vec3 direction = light.GetDirection();
     lightCamera.SetViewMatrix(position, position + direction, std::abs(direction.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1));
 
     // Projection matrix
-    glm::vec4 attenuation = m_light->GetAttenuation();
-    switch (m_light->GetType())
+    glm::vec4 attenuation = light.GetAttenuation();
+    switch (light.GetType())
     {
     case Light::Type::Directional:
         lightCamera.SetOrthographicProjectionMatrix(-0.5f * m_volumeSize, 0.5f * m_volumeSize);
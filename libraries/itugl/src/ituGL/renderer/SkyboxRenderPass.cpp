@@ -18,9 +18,9 @@ SkyboxRenderPass::SkyboxRenderPass(std::shared_ptr<TextureCubemapObject> texture
     m_shaderProgram.Build(vertexShader, fragmentShader);
 
     // Get uniform locations
-    m_cameraPositionLocation = m_shaderProgram.GetUniformLocation("CameraPosition");
-    m_invViewProjMatrixLocation = m_shaderProgram.GetUniformLocation("InvViewProjMatrix");
-    m_skyboxTextureLocation = m_shaderProgram.GetUniformLocation("SkyboxTexture");
+    m_cameraPositionLocation = m_shaderProgram.GetUniformLocation("CameraPosition"_u);
+    m_invViewProjMatrixLocation = m_shaderProgram.GetUniformLocation("InvViewProjMatrix"_u);
+    m_skyboxTextureLocation = m_shaderProgram.GetUniformLocation("SkyboxTexture"_u);
 }
 
 std::shared_ptr<TextureCubemapObject> SkyboxRenderPass::GetTexture() const
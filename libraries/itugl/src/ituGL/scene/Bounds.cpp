@@ -1,5 +1,9 @@
 #include <ituGL/scene/Bounds.h>
 
+#include <glm/common.hpp>
+#include <glm/matrix.hpp>
+#include <cmath>
+
 SphereBounds::SphereBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m_radius(0.0f)
 {
     switch (bounds.GetType())
@@ -42,6 +46,35 @@ AabbBounds::AabbBounds(const Bounds& bounds) : Bounds(bounds.GetCenter()), m_siz
     }
 }
 
+FrustumBounds::FrustumBounds(const glm::mat4& viewProjMatrix) : RotatedBounds(glm::vec3(0.0f), glm::mat3(1.0f))
+{
+    // Planes are combinations of the rows of the matrix
+    glm::mat4 transposed = glm::transpose(viewProjMatrix);
+    m_planes[0] = transposed[3] + transposed[0];
+    m_planes[1] = transposed[3] - transposed[0];
+    m_planes[2] = transposed[3] + transposed[1];
+    m_planes[3] = transposed[3] - transposed[1];
+    m_planes[4] = transposed[3] + transposed[2];
+    m_planes[5] = transposed[3] - transposed[2];
+    for (glm::vec4& plane : m_planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    // Center in the middle of the corners, and axes pointing like the camera ones
+    glm::mat4 inverseMatrix = glm::inverse(viewProjMatrix);
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec4 corner = inverseMatrix * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        center += glm::vec3(corner) / corner.w;
+    }
+    m_center = center / 8.0f;
+    m_rotationMatrix[0] = glm::normalize(glm::vec3(m_planes[0]) - glm::vec3(m_planes[1]));
+    m_rotationMatrix[1] = glm::normalize(glm::vec3(m_planes[2]) - glm::vec3(m_planes[3]));
+    m_rotationMatrix[2] = glm::normalize(glm::vec3(m_planes[5]) - glm::vec3(m_planes[4]));
+}
+
 BoxBounds::BoxBounds(const Bounds& bounds) : RotatedBounds(bounds.GetCenter(), glm::mat3(1.0f)), m_size(0.0f)
 {
     switch (bounds.GetType())
@@ -135,21 +168,47 @@ bool Bounds::Intersects(const BoxBounds& boundsA, const BoxBounds& boundsB)
         && TestSeparationAxis(glm::cross(boundsA.GetZVector(), boundsB.GetZVector()), distance, mA, mB);
 }
 
+// The frustum tests reject the bounds completely outside of one of the planes. Bounds close to the corners can pass
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const SphereBounds& boundsB)
 {
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        if (boundsA.GetDistance(i, boundsB.GetCenter()) < -boundsB.GetRadius())
+        {
+            return false;
+        }
+    }
     return true;
 }
 
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const AabbBounds& boundsB)
 {
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        float radius = glm::dot(glm::abs(glm::vec3(boundsA.GetPlane(i))), boundsB.GetSize());
+        if (boundsA.GetDistance(i, boundsB.GetCenter()) < -radius)
+        {
+            return false;
+        }
+    }
     return true;
 }
 
 template<>
 bool Bounds::Intersects(const FrustumBounds& boundsA, const BoxBounds& boundsB)
 {
+    glm::mat3 scaledMatrix = boundsB.GetScaledMatrix();
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        glm::vec3 normal(boundsA.GetPlane(i));
+        float radius = std::abs(glm::dot(normal, scaledMatrix[0])) + std::abs(glm::dot(normal, scaledMatrix[1])) + std::abs(glm::dot(normal, scaledMatrix[2]));
+        if (boundsA.GetDistance(i, boundsB.GetCenter()) < -radius)
+        {
+            return false;
+        }
+    }
     return true;
 }
 
@@ -0,0 +1,185 @@
+#include <ituGL/scene/PackedBounds.h>
+
+#include <glm/common.hpp>
+#include <cmath>
+#include <cassert>
+
+#if defined(__AVX__)
+#define PACKEDBOUNDS_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PACKEDBOUNDS_SSE2
+#include <emmintrin.h>
+#endif
+
+PackedBounds::PackedBounds() : m_count(0)
+{
+}
+
+unsigned int PackedBounds::AddSphere(const glm::vec3& center, float radius)
+{
+    unsigned int index = m_count;
+    Resize(m_count + 1);
+    SetSphere(index, center, radius);
+    return index;
+}
+
+unsigned int PackedBounds::AddAabb(const glm::vec3& center, const glm::vec3& size)
+{
+    unsigned int index = m_count;
+    Resize(m_count + 1);
+    SetAabb(index, center, size);
+    return index;
+}
+
+unsigned int PackedBounds::Add(const Bounds& bounds)
+{
+    switch (bounds.GetType())
+    {
+    case Bounds::Type::Sphere:
+        return AddSphere(bounds.GetCenter(), static_cast<const SphereBounds&>(bounds).GetRadius());
+    case Bounds::Type::AABB:
+        return AddAabb(bounds.GetCenter(), static_cast<const AabbBounds&>(bounds).GetSize());
+    case Bounds::Type::Box:
+        {
+            AabbBounds aabb(bounds);
+            return AddAabb(aabb.GetCenter(), aabb.GetSize());
+        }
+    default:
+        assert(false);
+        return m_count;
+    }
+}
+
+void PackedBounds::SetSphere(unsigned int index, const glm::vec3& center, float radius)
+{
+    assert(index < m_count);
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_sizeX[index] = 0.0f;
+    m_sizeY[index] = 0.0f;
+    m_sizeZ[index] = 0.0f;
+    m_radius[index] = radius;
+}
+
+void PackedBounds::SetAabb(unsigned int index, const glm::vec3& center, const glm::vec3& size)
+{
+    assert(index < m_count);
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_sizeX[index] = size.x;
+    m_sizeY[index] = size.y;
+    m_sizeZ[index] = size.z;
+    m_radius[index] = 0.0f;
+}
+
+void PackedBounds::Clear()
+{
+    m_count = 0;
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_sizeX.clear();
+    m_sizeY.clear();
+    m_sizeZ.clear();
+    m_radius.clear();
+}
+
+void PackedBounds::Resize(unsigned int count)
+{
+    m_count = count;
+    size_t paddedCount = (count + BatchSize - 1) / BatchSize * BatchSize;
+    m_centerX.resize(paddedCount, 0.0f);
+    m_centerY.resize(paddedCount, 0.0f);
+    m_centerZ.resize(paddedCount, 0.0f);
+    m_sizeX.resize(paddedCount, 0.0f);
+    m_sizeY.resize(paddedCount, 0.0f);
+    m_sizeZ.resize(paddedCount, 0.0f);
+    m_radius.resize(paddedCount, 0.0f);
+}
+
+void PackedBounds::TestFrustum(const FrustumBounds& frustum, std::vector<uint8_t>& visibilityMask) const
+{
+    unsigned int batchCount = (m_count + BatchSize - 1) / BatchSize;
+    visibilityMask.resize(batchCount);
+
+    // Each element is outside if, for any plane, the distance from its center is below -(|normal| . size + radius)
+    const FrustumBounds::Planes& planes = frustum.GetPlanes();
+    for (unsigned int batch = 0; batch < batchCount; ++batch)
+    {
+        unsigned int first = batch * BatchSize;
+        unsigned int mask = 0;
+
+#if defined(PACKEDBOUNDS_AVX)
+        __m256 centerX = _mm256_loadu_ps(m_centerX.data() + first);
+        __m256 centerY = _mm256_loadu_ps(m_centerY.data() + first);
+        __m256 centerZ = _mm256_loadu_ps(m_centerZ.data() + first);
+        __m256 sizeX = _mm256_loadu_ps(m_sizeX.data() + first);
+        __m256 sizeY = _mm256_loadu_ps(m_sizeY.data() + first);
+        __m256 sizeZ = _mm256_loadu_ps(m_sizeZ.data() + first);
+        __m256 radius = _mm256_loadu_ps(m_radius.data() + first);
+        __m256 outside = _mm256_setzero_ps();
+        for (const glm::vec4& plane : planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_set1_ps(plane.w), radius);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.x), centerX));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), sizeX));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), sizeY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), sizeZ));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        mask = ~_mm256_movemask_ps(outside) & 0xFF;
+#elif defined(PACKEDBOUNDS_SSE2)
+        // Two halves of 4 elements
+        for (unsigned int half = 0; half < BatchSize; half += 4)
+        {
+            unsigned int offset = first + half;
+            __m128 centerX = _mm_loadu_ps(m_centerX.data() + offset);
+            __m128 centerY = _mm_loadu_ps(m_centerY.data() + offset);
+            __m128 centerZ = _mm_loadu_ps(m_centerZ.data() + offset);
+            __m128 sizeX = _mm_loadu_ps(m_sizeX.data() + offset);
+            __m128 sizeY = _mm_loadu_ps(m_sizeY.data() + offset);
+            __m128 sizeZ = _mm_loadu_ps(m_sizeZ.data() + offset);
+            __m128 radius = _mm_loadu_ps(m_radius.data() + offset);
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4& plane : planes)
+            {
+                __m128 distance = _mm_add_ps(_mm_set1_ps(plane.w), radius);
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.x), centerX));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), centerY));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), centerZ));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), sizeX));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), sizeY));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), sizeZ));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+            }
+            mask |= (~_mm_movemask_ps(outside) & 0xF) << half;
+        }
+#else
+        for (unsigned int i = 0; i < BatchSize; ++i)
+        {
+            unsigned int index = first + i;
+            bool visible = true;
+            for (const glm::vec4& plane : planes)
+            {
+                float distance = plane.x * m_centerX[index] + plane.y * m_centerY[index] + plane.z * m_centerZ[index] + plane.w
+                    + std::abs(plane.x) * m_sizeX[index] + std::abs(plane.y) * m_sizeY[index] + std::abs(plane.z) * m_sizeZ[index] + m_radius[index];
+                visible = visible && distance >= 0.0f;
+            }
+            mask |= (visible ? 1u : 0u) << i;
+        }
+#endif
+
+        visibilityMask[batch] = static_cast<uint8_t>(mask);
+    }
+
+    // Clear the bits of the padding elements
+    if (m_count % BatchSize != 0)
+    {
+        visibilityMask[batchCount - 1] &= static_cast<uint8_t>((1u << (m_count % BatchSize)) - 1);
+    }
+}
@@ -6,23 +6,35 @@
 #include <ituGL/scene/SceneModel.h>
 #include <ituGL/scene/Transform.h>
 
-RendererSceneVisitor::RendererSceneVisitor(Renderer& renderer) : m_renderer(renderer)
+RendererSceneVisitor::RendererSceneVisitor(Renderer& renderer, bool retained) : m_renderer(renderer), m_retained(retained)
 {
 }
 
 void RendererSceneVisitor::VisitCamera(SceneCamera& sceneCamera)
 {
     assert(!m_renderer.HasCamera()); // Currently, only one camera per scene supported
-    m_renderer.SetCurrentCamera(*sceneCamera.GetCamera());
+    m_renderer.AddCamera(*sceneCamera.GetCamera());
 }
 
 void RendererSceneVisitor::VisitLight(SceneLight& sceneLight)
 {
-    m_renderer.AddLight(*sceneLight.GetLight());
+    if (m_retained)
+    {
+        sceneLight.UpdateRendererProxy(m_renderer);
+    }
+    else
+    {
+        m_renderer.AddLight(*sceneLight.GetLight());
+    }
 }
 
 void RendererSceneVisitor::VisitModel(SceneModel& sceneModel)
 {
     assert(sceneModel.GetTransform());
+    if (m_retained)
+    {
+        sceneModel.UpdateRendererProxy(m_renderer);
+        return;
+    }
     m_renderer.AddModel(*sceneModel.GetModel(), sceneModel.GetTransform()->GetTransformMatrix(), sceneModel.GetDrawCallCollectionIndeces());
 }
@@ -1,71 +1,260 @@
 #include <ituGL/scene/Scene.h>
 
 #include <ituGL/scene/SceneNode.h>
+#include <ituGL/scene/SceneCamera.h>
+#include <ituGL/scene/SceneLight.h>
+#include <ituGL/scene/SceneModel.h>
 #include <ituGL/scene/SceneVisitor.h>
 #include <cassert>
 
-Scene::Scene()
+Scene::Scene() : m_firstFreeSlot(Handle::InvalidIndex)
 {
 }
 
 Scene::~Scene()
 {
-    for (auto& pair : m_nodes)
+    // Through the base class, where Scene is a friend
+    for (auto& node : m_cameras.nodes)
     {
-        pair.second->SetOwnerScene(nullptr);
+        static_cast<SceneNode&>(*node).SetOwnerScene(nullptr);
+    }
+    for (auto& node : m_lights.nodes)
+    {
+        static_cast<SceneNode&>(*node).SetOwnerScene(nullptr);
+    }
+    for (auto& node : m_models.nodes)
+    {
+        static_cast<SceneNode&>(*node).SetOwnerScene(nullptr);
+    }
+    for (auto& node : m_otherNodes.nodes)
+    {
+        node->SetOwnerScene(nullptr);
+    }
+}
+
+std::shared_ptr<SceneNode> Scene::GetSceneNode(Handle handle) const
+{
+    const Slot* slot = GetSlot(handle);
+    if (!slot)
+    {
+        return nullptr;
+    }
+
+    switch (slot->type)
+    {
+    case NodeType::Camera:
+        return GetDense(m_cameras, slot->denseIndex);
+    case NodeType::Light:
+        return GetDense(m_lights, slot->denseIndex);
+    case NodeType::Model:
+        return GetDense(m_models, slot->denseIndex);
+    default:
+        return GetDense(m_otherNodes, slot->denseIndex);
     }
 }
 
 std::shared_ptr<SceneNode> Scene::GetSceneNode(const std::string& name) const
 {
-    auto it = m_nodes.find(name);
-    if (it != m_nodes.end())
+    return GetSceneNode(GetHandle(name));
+}
+
+Scene::Handle Scene::GetHandle(const std::string& name) const
+{
+    auto it = m_nameIndex.find(name);
+    if (it != m_nameIndex.end())
     {
         return it->second;
     }
-    return nullptr;
+    return Handle();
 }
 
-bool Scene::AddSceneNode(std::shared_ptr<SceneNode> node)
+Scene::Handle Scene::AddSceneNode(std::shared_ptr<SceneNode> node)
 {
     assert(node);
-    m_nodes[node->GetName()] = node;
+
+    // Replace the node with the same name, if any
+    RemoveSceneNode(GetHandle(node->GetName()));
+
+    std::uint32_t slotIndex;
+    if (m_firstFreeSlot != Handle::InvalidIndex)
+    {
+        slotIndex = m_firstFreeSlot;
+        m_firstFreeSlot = m_slots[slotIndex].denseIndex;
+    }
+    else
+    {
+        slotIndex = static_cast<std::uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    // The type is only checked here, nodes are visited in the array of their type until they are removed
+    Slot& slot = m_slots[slotIndex];
+    if (std::shared_ptr<SceneCamera> camera = std::dynamic_pointer_cast<SceneCamera>(node))
+    {
+        slot.type = NodeType::Camera;
+        slot.denseIndex = AddDense(m_cameras, camera, slotIndex);
+    }
+    else if (std::shared_ptr<SceneLight> light = std::dynamic_pointer_cast<SceneLight>(node))
+    {
+        slot.type = NodeType::Light;
+        slot.denseIndex = AddDense(m_lights, light, slotIndex);
+    }
+    else if (std::shared_ptr<SceneModel> model = std::dynamic_pointer_cast<SceneModel>(node))
+    {
+        slot.type = NodeType::Model;
+        slot.denseIndex = AddDense(m_models, model, slotIndex);
+    }
+    else
+    {
+        slot.type = NodeType::Other;
+        slot.denseIndex = AddDense(m_otherNodes, node, slotIndex);
+    }
+
+    Handle handle{ slotIndex, slot.generation };
+    m_nameIndex[node->GetName()] = handle;
     node->SetOwnerScene(this);
+    return handle;
+}
+
+bool Scene::RemoveSceneNode(Handle handle)
+{
+    const Slot* constSlot = GetSlot(handle);
+    if (!constSlot)
+    {
+        return false;
+    }
+    Slot& slot = m_slots[handle.index];
+
+    std::shared_ptr<SceneNode> node;
+    switch (slot.type)
+    {
+    case NodeType::Camera:
+        node = RemoveDense(m_cameras, slot.denseIndex);
+        break;
+    case NodeType::Light:
+        node = RemoveDense(m_lights, slot.denseIndex);
+        break;
+    case NodeType::Model:
+        node = RemoveDense(m_models, slot.denseIndex);
+        break;
+    default:
+        node = RemoveDense(m_otherNodes, slot.denseIndex);
+        break;
+    }
+
+    // A new generation invalidates the handles to the removed node
+    ++slot.generation;
+    slot.denseIndex = m_firstFreeSlot;
+    m_firstFreeSlot = handle.index;
+
+    assert(node->GetOwnerScene() == this);
+    m_nameIndex.erase(node->GetName());
+    node->SetOwnerScene(nullptr);
     return true;
 }
 
 bool Scene::RemoveSceneNode(std::shared_ptr<SceneNode> node)
 {
-    assert(m_nodes.find(node->GetName()) == m_nodes.end() || m_nodes.find(node->GetName())->second == node);
+    assert(GetSceneNode(node->GetName()) == nullptr || GetSceneNode(node->GetName()) == node);
     return RemoveSceneNode(node->GetName());
 }
 
 bool Scene::RemoveSceneNode(const std::string& name)
 {
-    auto it = m_nodes.find(name);
-    if (it != m_nodes.end())
-    {
-        assert(it->second);
-        assert(it->second->GetOwnerScene() == this);
-        it->second->SetOwnerScene(nullptr);
-        m_nodes.erase(it);
-        return true;
-    }
-    return false;
+    return RemoveSceneNode(GetHandle(name));
 }
 
 void Scene::AcceptVisitor(SceneVisitor& visitor)
 {
-    for (auto& pair : m_nodes)
+    for (auto& node : m_cameras.nodes)
+    {
+        visitor.VisitCamera(*node);
+    }
+    for (auto& node : m_lights.nodes)
+    {
+        visitor.VisitLight(*node);
+    }
+    for (auto& node : m_models.nodes)
     {
-        pair.second->AcceptVisitor(visitor);
+        visitor.VisitModel(*node);
+    }
+    for (auto& node : m_otherNodes.nodes)
+    {
+        node->AcceptVisitor(visitor);
     }
 }
 
 void Scene::AcceptVisitor(SceneVisitor& visitor) const
 {
-    for (auto& pair : m_nodes)
+    for (auto& node : m_cameras.nodes)
+    {
+        visitor.VisitCamera(static_cast<const SceneCamera&>(*node));
+    }
+    for (auto& node : m_lights.nodes)
+    {
+        visitor.VisitLight(static_cast<const SceneLight&>(*node));
+    }
+    for (auto& node : m_models.nodes)
+    {
+        visitor.VisitModel(static_cast<const SceneModel&>(*node));
+    }
+    for (auto& node : m_otherNodes.nodes)
     {
-        pair.second->AcceptVisitor(visitor);
+        static_cast<const SceneNode&>(*node).AcceptVisitor(visitor);
     }
 }
+
+const Scene::Slot* Scene::GetSlot(Handle handle) const
+{
+    if (handle.index >= m_slots.size())
+    {
+        return nullptr;
+    }
+    const Slot& slot = m_slots[handle.index];
+    return slot.generation == handle.generation ? &slot : nullptr;
+}
+
+template<typename T>
+std::uint32_t Scene::AddDense(DenseArray<T>& denseArray, std::shared_ptr<T> node, std::uint32_t slotIndex)
+{
+    std::uint32_t denseIndex = static_cast<std::uint32_t>(denseArray.nodes.size());
+    denseArray.nodes.push_back(std::move(node));
+    denseArray.slots.push_back(slotIndex);
+    return denseIndex;
+}
+
+template<typename T>
+std::shared_ptr<SceneNode> Scene::RemoveDense(DenseArray<T>& denseArray, std::uint32_t denseIndex)
+{
+    std::shared_ptr<SceneNode> node = std::move(denseArray.nodes[denseIndex]);
+
+    // Move the last node to the gap, so the array stays dense
+    std::uint32_t lastIndex = static_cast<std::uint32_t>(denseArray.nodes.size()) - 1;
+    if (denseIndex != lastIndex)
+    {
+        denseArray.nodes[denseIndex] = std::move(denseArray.nodes[lastIndex]);
+        denseArray.slots[denseIndex] = denseArray.slots[lastIndex];
+        m_slots[denseArray.slots[denseIndex]].denseIndex = denseIndex;
+    }
+    denseArray.nodes.pop_back();
+    denseArray.slots.pop_back();
+    return node;
+}
+
+template<typename T>
+std::shared_ptr<SceneNode> Scene::GetDense(const DenseArray<T>& denseArray, std::uint32_t denseIndex) const
+{
+    return denseArray.nodes[denseIndex];
+}
+
+void Scene::RenameSceneNode(const std::string& oldName, const std::string& newName)
+{
+    auto it = m_nameIndex.find(oldName);
+    assert(it != m_nameIndex.end());
+    Handle handle = it->second;
+    m_nameIndex.erase(it);
+
+    // Replace the node with the new name, if any, as when it is added
+    RemoveSceneNode(GetHandle(newName));
+    m_nameIndex[newName] = handle;
+}
@@ -5,17 +5,25 @@
 #include <ituGL/lighting/SpotLight.h>
 #include <ituGL/scene/Transform.h>
 #include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/renderer/Renderer.h>
 
 SceneLight::SceneLight(const std::string& name, std::shared_ptr<Light> light) : SceneNode(name), m_light(light)
+    , m_proxyRenderer(nullptr), m_proxyIndex(-1), m_proxyLight(nullptr)
 {
     MatchTransformToLight();
 }
 
 SceneLight::SceneLight(const std::string& name, std::shared_ptr<Light> light, std::shared_ptr<Transform> transform) : SceneNode(name, transform), m_light(light)
+    , m_proxyRenderer(nullptr), m_proxyIndex(-1), m_proxyLight(nullptr)
 {
     MatchLightToTransform();
 }
 
+SceneLight::~SceneLight()
+{
+    RemoveRendererProxy();
+}
+
 std::shared_ptr<Light> SceneLight::GetLight() const
 {
     return m_light;
@@ -63,6 +71,47 @@ void SceneLight::MatchTransformToLight()
     }
 }
 
+void SceneLight::UpdateRendererProxy(Renderer& renderer)
+{
+    assert(m_proxyRenderer == nullptr || m_proxyRenderer == &renderer);
+
+    if (!m_light)
+    {
+        RemoveRendererProxy();
+    }
+    else if (m_proxyIndex < 0)
+    {
+        m_proxyRenderer = &renderer;
+        m_proxyIndex = renderer.AddLightProxy(*m_light);
+        m_proxyLight = m_light.get();
+    }
+    else if (m_proxyLight != m_light.get())
+    {
+        renderer.UpdateLightProxy(m_proxyIndex, *m_light);
+        m_proxyLight = m_light.get();
+    }
+}
+
+void SceneLight::RemoveRendererProxy()
+{
+    if (m_proxyIndex >= 0)
+    {
+        m_proxyRenderer->RemoveLightProxy(m_proxyIndex);
+        m_proxyRenderer = nullptr;
+        m_proxyIndex = -1;
+        m_proxyLight = nullptr;
+    }
+}
+
+void SceneLight::SetOwnerScene(Scene* scene)
+{
+    SceneNode::SetOwnerScene(scene);
+    if (!scene)
+    {
+        RemoveRendererProxy();
+    }
+}
+
 glm::vec3 SceneLight::GetRotationFromDirection(const glm::vec3& direction) const
 {
     glm::vec3 rotation(0);
@@ -4,16 +4,24 @@
 #include <ituGL/geometry/Mesh.h>
 #include <ituGL/scene/Transform.h>
 #include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/renderer/Renderer.h>
 #include <cassert>
 
 SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model, std::vector<int> drawCallCollectionIndeces) : SceneNode(name), m_model(model), m_drawCallCollectionIndeces(drawCallCollectionIndeces)
+    , m_proxyRenderer(nullptr), m_proxyIndex(-1), m_proxyModel(nullptr), m_proxyModelVersion(0), m_proxyTransformVersion(0)
 {
 }
 
 SceneModel::SceneModel(const std::string& name, std::shared_ptr<Model> model, std::shared_ptr<Transform> transform) : SceneNode(name, transform), m_model(model)
+    , m_proxyRenderer(nullptr), m_proxyIndex(-1), m_proxyModel(nullptr), m_proxyModelVersion(0), m_proxyTransformVersion(0)
 {
 }
 
+SceneModel::~SceneModel()
+{
+    RemoveRendererProxy();
+}
+
 std::shared_ptr<Model> SceneModel::GetModel() const
 {
     return m_model;
@@ -72,7 +80,58 @@ void SceneModel::AcceptVisitor(SceneVisitor& visitor) const
     //visitor.VisitRenderable(*this);
 }
 
-std::vector<int> SceneModel::GetDrawCallCollectionIndeces()
+const std::vector<int>& SceneModel::GetDrawCallCollectionIndeces() const
 {
     return m_drawCallCollectionIndeces;
 }
+
+void SceneModel::UpdateRendererProxy(Renderer& renderer)
+{
+    assert(m_transform);
+    assert(m_proxyRenderer == nullptr || m_proxyRenderer == &renderer);
+
+    if (!m_model)
+    {
+        RemoveRendererProxy();
+        return;
+    }
+
+    std::uint64_t transformVersion = m_transform->GetVersion();
+    if (m_proxyIndex < 0)
+    {
+        m_proxyRenderer = &renderer;
+        m_proxyIndex = renderer.AddModelProxy(*m_model, m_transform->GetTransformMatrix(), m_drawCallCollectionIndeces);
+    }
+    else if (m_proxyModel != m_model.get() || m_proxyModelVersion != m_model->GetVersion() || m_proxyTransformVersion != transformVersion)
+    {
+        renderer.UpdateModelProxy(m_proxyIndex, *m_model, m_transform->GetTransformMatrix());
+    }
+    else
+    {
+        return;
+    }
+
+    m_proxyModel = m_model.get();
+    m_proxyModelVersion = m_model->GetVersion();
+    m_proxyTransformVersion = transformVersion;
+}
+
+void SceneModel::RemoveRendererProxy()
+{
+    if (m_proxyIndex >= 0)
+    {
+        m_proxyRenderer->RemoveModelProxy(m_proxyIndex);
+        m_proxyRenderer = nullptr;
+        m_proxyIndex = -1;
+        m_proxyModel = nullptr;
+    }
+}
+
+void SceneModel::SetOwnerScene(Scene* scene)
+{
+    SceneNode::SetOwnerScene(scene);
+    if (!scene)
+    {
+        RemoveRendererProxy();
+    }
+}
@@ -22,17 +22,13 @@ const std::string& SceneNode::GetName() const
 
 void SceneNode::Rename(const std::string& name)
 {
-    std::shared_ptr<SceneNode> sceneNode;
-    if (m_scene)
-    {
-        sceneNode = m_scene->GetSceneNode(m_name);
-        assert(sceneNode.get() == this);
-        m_scene->RemoveSceneNode(m_name);
-    }
+    // The node keeps its handle, only the name index of the scene changes
+    std::string oldName = m_name;
     m_name = name;
     if (m_scene)
     {
-        m_scene->AddSceneNode(sceneNode);
+        assert(m_scene->GetSceneNode(oldName).get() == this);
+        m_scene->RenameSceneNode(oldName, m_name);
     }
 }
 
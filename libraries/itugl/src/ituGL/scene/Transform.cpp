@@ -1,8 +1,14 @@
 #include <ituGL/scene/Transform.h>
 
 #include <glm/ext/matrix_transform.hpp>
+#include <algorithm>
+#include <atomic>
+
+// Last version given to a transform. New transforms get their own too, so replacing a transform is also a change
+static std::atomic<std::uint64_t> s_lastVersion(0);
 
 Transform::Transform() : m_translation(0, 0, 0), m_rotation(0, 0, 0), m_scale(1, 1, 1), m_matrix(1.0f), m_dirty(false)
+    , m_version(s_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1)
 {
 }
 
@@ -43,3 +49,19 @@ bool Transform::IsDirty() const
 {
     return m_dirty || (m_parent && m_parent->IsDirty());
 }
+
+std::uint64_t Transform::GetVersion() const
+{
+    return m_parent ? std::max(m_version, m_parent->GetVersion()) : m_version;
+}
+
+std::uint64_t Transform::GetLastVersion()
+{
+    return s_lastVersion.load(std::memory_order_relaxed);
+}
+
+void Transform::Changed()
+{
+    m_dirty = true;
+    m_version = s_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
@@ -1,4 +1,5 @@
 #include <ituGL/shader/Material.h>
+#include <ituGL/shader/ProgramPipeline.h>
 #include <ituGL/core/DeviceGL.h>
 #include <cassert>
 
@@ -10,6 +11,7 @@ Material::Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet&
     : ShaderUniformCollection(shaderProgram, filteredUniforms)
     , m_depthTestFunction(TestFunction::Less)
     , m_depthWrite(true)
+    , m_depthPrepass(true)
     , m_stencilTestFunctions{ TestFunction::Never, TestFunction::Never }
     , m_stencilRefValues{ 0, 0 }
     , m_stencilMasks{ ~0u, ~0u }
@@ -24,7 +26,19 @@ Material::Material(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet&
 
 void Material::SetShaderSetupFunction(ShaderSetupFunction shaderSetupFunction)
 {
+    // Functions can't be compared, so setting one is always a change
     m_shaderSetupFunction = shaderSetupFunction;
+    Changed();
+}
+
+void Material::SetProgramPipeline(std::shared_ptr<ProgramPipeline> programPipeline)
+{
+    assert(!programPipeline || (m_shaderProgram && m_shaderProgram->IsSeparable()));
+    if (m_programPipeline != programPipeline)
+    {
+        m_programPipeline = programPipeline;
+        Changed();
+    }
 }
 
 Material::TestFunction Material::GetDepthTestFunction() const
@@ -34,7 +48,11 @@ Material::TestFunction Material::GetDepthTestFunction() const
 
 void Material::SetDepthTestFunction(TestFunction function)
 {
-    m_depthTestFunction = function;
+    if (m_depthTestFunction != function)
+    {
+        m_depthTestFunction = function;
+        Changed();
+    }
 }
 
 bool Material::GetDepthWrite() const
@@ -44,7 +62,25 @@ bool Material::GetDepthWrite() const
 
 void Material::SetDepthWrite(bool depthWrite)
 {
-    m_depthWrite = depthWrite;
+    if (m_depthWrite != depthWrite)
+    {
+        m_depthWrite = depthWrite;
+        Changed();
+    }
+}
+
+bool Material::GetDepthPrepass() const
+{
+    return m_depthPrepass;
+}
+
+void Material::SetDepthPrepass(bool depthPrepass)
+{
+    if (m_depthPrepass != depthPrepass)
+    {
+        m_depthPrepass = depthPrepass;
+        Changed();
+    }
 }
 
 void Material::SetStencilTestFunction(TestFunction function, int refValue, unsigned int mask)
@@ -62,9 +98,13 @@ Material::TestFunction Material::GetStencilFrontTestFunction(int &refValue, unsi
 
 void Material::SetStencilFrontTestFunction(TestFunction function, int refValue, unsigned int mask)
 {
-    m_stencilTestFunctions[0] = function;
-    m_stencilRefValues[0] = refValue;
-    m_stencilMasks[0] = mask;
+    if (m_stencilTestFunctions[0] != function || m_stencilRefValues[0] != refValue || m_stencilMasks[0] != mask)
+    {
+        m_stencilTestFunctions[0] = function;
+        m_stencilRefValues[0] = refValue;
+        m_stencilMasks[0] = mask;
+        Changed();
+    }
 }
 
 Material::TestFunction Material::GetStencilBackTestFunction(int& refValue, unsigned int& mask) const
@@ -76,9 +116,13 @@ Material::TestFunction Material::GetStencilBackTestFunction(int& refValue, unsig
 
 void Material::SetStencilBackTestFunction(TestFunction function, int refValue, unsigned int mask)
 {
-    m_stencilTestFunctions[1] = function;
-    m_stencilRefValues[1] = refValue;
-    m_stencilMasks[1] = mask;
+    if (m_stencilTestFunctions[1] != function || m_stencilRefValues[1] != refValue || m_stencilMasks[1] != mask)
+    {
+        m_stencilTestFunctions[1] = function;
+        m_stencilRefValues[1] = refValue;
+        m_stencilMasks[1] = mask;
+        Changed();
+    }
 }
 
 void Material::SetStencilOperations(StencilOperation stencilFail, StencilOperation depthFail, StencilOperation depthPass)
@@ -96,9 +140,13 @@ void Material::GetStencilFrontOperations(StencilOperation& stencilFail, StencilO
 
 void Material::SetStencilFrontOperations(StencilOperation stencilFail, StencilOperation depthFail, StencilOperation depthPass)
 {
-    m_stencilFail[0] = stencilFail;
-    m_stencilDepthFail[0] = depthFail;
-    m_stencilDepthPass[0] = depthPass;
+    if (m_stencilFail[0] != stencilFail || m_stencilDepthFail[0] != depthFail || m_stencilDepthPass[0] != depthPass)
+    {
+        m_stencilFail[0] = stencilFail;
+        m_stencilDepthFail[0] = depthFail;
+        m_stencilDepthPass[0] = depthPass;
+        Changed();
+    }
 }
 
 void Material::GetStencilBackOperations(StencilOperation& stencilFail, StencilOperation& depthFail, StencilOperation& depthPass) const
@@ -110,9 +158,13 @@ void Material::GetStencilBackOperations(StencilOperation& stencilFail, StencilOp
 
 void Material::SetStencilBackOperations(StencilOperation stencilFail, StencilOperation depthFail, StencilOperation depthPass)
 {
-    m_stencilFail[1] = stencilFail;
-    m_stencilDepthFail[1] = depthFail;
-    m_stencilDepthPass[1] = depthPass;
+    if (m_stencilFail[1] != stencilFail || m_stencilDepthFail[1] != depthFail || m_stencilDepthPass[1] != depthPass)
+    {
+        m_stencilFail[1] = stencilFail;
+        m_stencilDepthFail[1] = depthFail;
+        m_stencilDepthPass[1] = depthPass;
+        Changed();
+    }
 }
 
 Material::BlendEquation Material::GetBlendEquationColor() const
@@ -132,8 +184,12 @@ void Material::SetBlendEquation(BlendEquation blendEquation)
 
 void Material::SetBlendEquation(BlendEquation blendEquationColor, BlendEquation blendEquationAlpha)
 {
-    m_blendEquations[0] = blendEquationColor;
-    m_blendEquations[1] = blendEquationAlpha;
+    if (m_blendEquations[0] != blendEquationColor || m_blendEquations[1] != blendEquationAlpha)
+    {
+        m_blendEquations[0] = blendEquationColor;
+        m_blendEquations[1] = blendEquationAlpha;
+        Changed();
+    }
 }
 
 void Material::SetBlendParams(BlendParam source, BlendParam dest)
@@ -148,10 +204,12 @@ void Material::SetBlendParams(BlendParam source, BlendParam dest, Color blendCol
 
 void Material::SetBlendParams(BlendParam sourceColor, BlendParam destColor, BlendParam sourceAlpha, BlendParam destAlpha)
 {
-    m_blendParams[0] = sourceColor;
-    m_blendParams[1] = destColor;
-    m_blendParams[2] = sourceAlpha;
-    m_blendParams[3] = destAlpha;
+    std::array<BlendParam, 4> blendParams{ sourceColor, destColor, sourceAlpha, destAlpha };
+    if (m_blendParams != blendParams)
+    {
+        m_blendParams = blendParams;
+        Changed();
+    }
 }
 
 void Material::SetBlendParams(BlendParam sourceColor, BlendParam destColor, BlendParam sourceAlpha, BlendParam destAlpha, Color blendColor)
@@ -168,7 +226,11 @@ void Material::SetBlendColor(Color blendColor)
         || m_blendParams[2] == BlendParam::ConstantColor || m_blendParams[2] == BlendParam::ConstantAlpha
         || m_blendParams[3] == BlendParam::ConstantColor || m_blendParams[3] == BlendParam::ConstantAlpha);
 
-    m_blendColor = blendColor;
+    if (static_cast<glm::vec4>(m_blendColor) != static_cast<glm::vec4>(blendColor))
+    {
+        m_blendColor = blendColor;
+        Changed();
+    }
 }
 
 Material::CullMode Material::GetCullMode() const
@@ -178,15 +240,26 @@ Material::CullMode Material::GetCullMode() const
 
 void Material::SetCullMode(CullMode cullmode)
 {
-    m_cullMode = cullmode;
+    if (m_cullMode != cullmode)
+    {
+        m_cullMode = cullmode;
+        Changed();
+    }
 }
 
 void Material::Use(OverrideFlags overrideFlags) const
 {
     assert(m_shaderProgram);
 
-    // Set the shader program as the one currently in use
-    m_shaderProgram->Use();
+    // Set the shader program, or the pipeline with its stages, as the one currently in use
+    if (m_programPipeline)
+    {
+        m_programPipeline->Use();
+    }
+    else
+    {
+        m_shaderProgram->Use();
+    }
 
     // Set the value of all the uniforms stored as properties
     SetUniforms();
@@ -197,6 +270,11 @@ void Material::Use(OverrideFlags overrideFlags) const
         m_shaderSetupFunction(*m_shaderProgram);
     }
 
+    UseRenderStates(overrideFlags);
+}
+
+void Material::UseRenderStates(OverrideFlags overrideFlags) const
+{
     // If not skipped, set the depth settings
     if ((overrideFlags & OverrideFlags::OverrideDepthTest) == 0)
     {
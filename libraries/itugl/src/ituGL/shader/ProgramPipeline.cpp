@@ -0,0 +1,111 @@
+#include <ituGL/shader/ProgramPipeline.h>
+
+#include <ituGL/shader/ShaderProgram.h>
+#include <vector>
+#include <cassert>
+
+// Create the program pipeline handle
+ProgramPipeline::ProgramPipeline() : Object(NullHandle)
+{
+    Handle& handle = GetHandle();
+    glGenProgramPipelines(1, &handle);
+}
+
+// Get object handle and delete 1 program pipeline
+ProgramPipeline::~ProgramPipeline()
+{
+    Handle& handle = GetHandle();
+    glDeleteProgramPipelines(1, &handle);
+}
+
+ProgramPipeline::ProgramPipeline(ProgramPipeline&& programPipeline) noexcept : Object(std::move(programPipeline))
+{
+}
+
+ProgramPipeline& ProgramPipeline::operator = (ProgramPipeline&& programPipeline) noexcept
+{
+    Object::operator=(std::move(programPipeline));
+    return *this;
+}
+
+// Bind the program pipeline handle
+void ProgramPipeline::Bind() const
+{
+    glBindProgramPipeline(GetHandle());
+}
+
+// Bind the null handle
+void ProgramPipeline::Unbind()
+{
+    glBindProgramPipeline(NullHandle);
+}
+
+void ProgramPipeline::UseProgramStages(const ShaderProgram& shaderProgram, GLbitfield stages)
+{
+    assert(IsValid());
+    assert(shaderProgram.IsSeparable());
+    glUseProgramStages(GetHandle(), stages, shaderProgram.GetHandle());
+}
+
+// Find the stages linked in the program from its attached shaders
+void ProgramPipeline::UseProgramStages(const ShaderProgram& shaderProgram)
+{
+    GLbitfield stages = 0;
+
+    GLint shaderCount = 0;
+    glGetProgramiv(shaderProgram.GetHandle(), GL_ATTACHED_SHADERS, &shaderCount);
+    if (shaderCount > 0)
+    {
+        std::vector<GLuint> shaders(shaderCount);
+        glGetAttachedShaders(shaderProgram.GetHandle(), shaderCount, nullptr, shaders.data());
+        for (GLuint shader : shaders)
+        {
+            GLint type = 0;
+            glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+            switch (type)
+            {
+            case GL_VERTEX_SHADER:
+                stages |= GL_VERTEX_SHADER_BIT;
+                break;
+            case GL_TESS_CONTROL_SHADER:
+                stages |= GL_TESS_CONTROL_SHADER_BIT;
+                break;
+            case GL_TESS_EVALUATION_SHADER:
+                stages |= GL_TESS_EVALUATION_SHADER_BIT;
+                break;
+            case GL_GEOMETRY_SHADER:
+                stages |= GL_GEOMETRY_SHADER_BIT;
+                break;
+            case GL_FRAGMENT_SHADER:
+                stages |= GL_FRAGMENT_SHADER_BIT;
+                break;
+            }
+        }
+    }
+
+    // Programs loaded from a binary have no shaders attached. Use all the stages, missing ones are ignored
+    UseProgramStages(shaderProgram, stages ? stages : GL_ALL_SHADER_BITS);
+}
+
+void ProgramPipeline::Use() const
+{
+    assert(IsValid());
+    ShaderProgram::Unuse();
+    Bind();
+}
+
+bool ProgramPipeline::Validate() const
+{
+    assert(IsValid());
+    glValidateProgramPipeline(GetHandle());
+
+    GLint success;
+    glGetProgramPipelineiv(GetHandle(), GL_VALIDATE_STATUS, &success);
+    return success;
+}
+
+void ProgramPipeline::GetValidationErrors(std::span<char> errors) const
+{
+    assert(IsValid());
+    glGetProgramPipelineInfoLog(GetHandle(), static_cast<GLsizei>(errors.size()), nullptr, errors.data());
+}
@@ -1,5 +1,6 @@
 #include <ituGL/shader/Shader.h>
 
+#include <ituGL/core/DeviceGL.h>
 #include <cassert>
 
 Shader::Shader(Type type) : Object(NullHandle)
@@ -53,6 +54,26 @@ void Shader::SetSource(std::span<const char*> source)
     glShaderSource(GetHandle(), static_cast<int>(source.size()), source.data(), nullptr);
 }
 
+// Set the binary code of the shader
+void Shader::SetBinary(GLenum format, std::span<const std::byte> binary)
+{
+    assert(IsValid());
+
+    Handle handle = GetHandle();
+    glShaderBinary(1, &handle, format, binary.data(), static_cast<GLsizei>(binary.size()));
+}
+
+// Specialize the SPIR-V shader, only available if the device supports it
+bool Shader::Specialize(const char* entryPoint, std::span<const GLuint> constantIndices, std::span<const GLuint> constantValues)
+{
+    assert(IsValid());
+    assert(constantIndices.size() == constantValues.size());
+    assert(DeviceGL::GetInstance().IsSpirvSupported());
+
+    glSpecializeShader(GetHandle(), entryPoint, static_cast<GLuint>(constantIndices.size()), constantIndices.data(), constantValues.data());
+    return IsCompiled();
+}
+
 // Compile the shader source code
 bool Shader::Compile()
 {
@@ -62,6 +83,14 @@ bool Shader::Compile()
     return IsCompiled();
 }
 
+// Compile the shader source code, but don't check the status
+void Shader::CompileAsync()
+{
+    assert(IsValid());
+
+    glCompileShader(GetHandle());
+}
+
 // Check if the shader has been successfully compiled
 bool Shader::IsCompiled() const
 {
@@ -72,6 +101,20 @@ bool Shader::IsCompiled() const
     return success;
 }
 
+// Query the completion status only if the driver compiles in the background
+bool Shader::IsCompileComplete() const
+{
+    assert(IsValid());
+
+    GLint complete = GL_TRUE;
+    const DeviceGL* device = DeviceGL::GetInstancePointer();
+    if (device && device->IsParallelShaderCompileSupported())
+    {
+        glGetShaderiv(GetHandle(), GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    return complete;
+}
+
 // Get compilation error messages in case of a failure
 void Shader::GetCompilationErrors(std::span<char> errors) const
 {
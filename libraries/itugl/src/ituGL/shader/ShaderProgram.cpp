@@ -2,13 +2,18 @@
 
 #include <ituGL/shader/Shader.h>
 #include <ituGL/texture/TextureObject.h>
+#include <ituGL/core/DeviceGL.h>
+#include <algorithm>
+#include <array>
+#include <string_view>
 #include <cassert>
+#include <iostream>
 
 #ifndef NDEBUG
 ShaderProgram::Handle ShaderProgram::s_usedHandle = ShaderProgram::NullHandle;
 #endif
 
-ShaderProgram::ShaderProgram() : Object(NullHandle)
+ShaderProgram::ShaderProgram() : Object(NullHandle), m_separable(false), m_linkComplete(true), m_hasReflection(false)
 {
     Handle& handle = GetHandle();
     handle = glCreateProgram();
@@ -25,12 +30,27 @@ ShaderProgram::~ShaderProgram()
 }
 
 ShaderProgram::ShaderProgram(ShaderProgram&& shaderProgram) noexcept : Object(std::move(shaderProgram))
+    , m_separable(shaderProgram.m_separable)
+    , m_linkComplete(shaderProgram.m_linkComplete)
+    , m_hasReflection(shaderProgram.m_hasReflection)
+    , m_uniformTable(std::move(shaderProgram.m_uniformTable))
+    , m_uniformBlockTable(std::move(shaderProgram.m_uniformBlockTable))
+    , m_attributeTable(std::move(shaderProgram.m_attributeTable))
+    , m_collidingNames(std::move(shaderProgram.m_collidingNames))
 {
+    shaderProgram.m_hasReflection = false;
 }
 
 ShaderProgram& ShaderProgram::operator = (ShaderProgram&& shaderProgram) noexcept
 {
     Object::operator=(std::move(shaderProgram));
+    std::swap(m_separable, shaderProgram.m_separable);
+    std::swap(m_linkComplete, shaderProgram.m_linkComplete);
+    std::swap(m_hasReflection, shaderProgram.m_hasReflection);
+    std::swap(m_uniformTable, shaderProgram.m_uniformTable);
+    std::swap(m_uniformBlockTable, shaderProgram.m_uniformBlockTable);
+    std::swap(m_attributeTable, shaderProgram.m_attributeTable);
+    std::swap(m_collidingNames, shaderProgram.m_collidingNames);
     return *this;
 }
 
@@ -82,6 +102,28 @@ bool ShaderProgram::Build(const Shader& vertexShader, const Shader& fragmentShad
     return Link();
 }
 
+// Build (Attach and link) a separable program with a single stage, to be combined in a ProgramPipeline
+bool ShaderProgram::BuildSeparable(const Shader& shader)
+{
+    SetSeparable(true);
+    AttachShader(shader);
+    return Link();
+}
+
+// Attach the shaders without checking their compilation status, that would wait for them
+void ShaderProgram::BuildAsync(std::span<const Shader* const> shaders)
+{
+    assert(IsValid());
+    for (const Shader* shader : shaders)
+    {
+        assert(shader && shader->IsValid());
+        glAttachShader(GetHandle(), shader->GetHandle());
+    }
+    glLinkProgram(GetHandle());
+    m_linkComplete = false;
+    m_hasReflection = false;
+}
+
 // Attach a shader to be linked
 void ShaderProgram::AttachShader(const Shader& shader)
 {
@@ -97,7 +139,13 @@ bool ShaderProgram::Link()
 {
     assert(IsValid());
     glLinkProgram(GetHandle());
-    return IsLinked();
+    m_linkComplete = true;
+    bool linked = IsLinked();
+    if (linked)
+    {
+        BuildReflection();
+    }
+    return linked;
 }
 
 // Check if shaders have been linked to create a valid program
@@ -110,6 +158,70 @@ bool ShaderProgram::IsLinked() const
     return success;
 }
 
+// Query the completion status only if the driver compiles in the background, and until it is complete
+bool ShaderProgram::IsLinkComplete() const
+{
+    assert(IsValid());
+
+    if (!m_linkComplete)
+    {
+        GLint complete = GL_TRUE;
+        const DeviceGL* device = DeviceGL::GetInstancePointer();
+        if (device && device->IsParallelShaderCompileSupported())
+        {
+            glGetProgramiv(GetHandle(), GL_COMPLETION_STATUS_KHR, &complete);
+        }
+        m_linkComplete = complete == GL_TRUE;
+    }
+    return m_linkComplete;
+}
+
+// Set the parameter before linking, or before loading the binary
+void ShaderProgram::SetSeparable(bool separable)
+{
+    assert(IsValid());
+    glProgramParameteri(GetHandle(), GL_PROGRAM_SEPARABLE, separable ? GL_TRUE : GL_FALSE);
+    m_separable = separable;
+}
+
+// Set the hint before linking, so the driver keeps the binary
+void ShaderProgram::SetBinaryRetrievable(bool retrievable)
+{
+    assert(IsValid());
+    glProgramParameteri(GetHandle(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, retrievable ? GL_TRUE : GL_FALSE);
+}
+
+// Query the binary length and get the binary
+bool ShaderProgram::GetBinary(GLenum& format, std::vector<std::byte>& binary) const
+{
+    assert(IsValid());
+    assert(IsLinked());
+
+    GLint length = 0;
+    glGetProgramiv(GetHandle(), GL_PROGRAM_BINARY_LENGTH, &length);
+    binary.resize(length);
+    if (length > 0)
+    {
+        glGetProgramBinary(GetHandle(), length, &length, &format, binary.data());
+        binary.resize(length);
+    }
+    return length > 0;
+}
+
+// Load the binary and check that it got linked
+bool ShaderProgram::LoadBinary(GLenum format, std::span<const std::byte> binary)
+{
+    assert(IsValid());
+    glProgramBinary(GetHandle(), format, binary.data(), static_cast<GLsizei>(binary.size()));
+    m_linkComplete = true;
+    bool linked = IsLinked();
+    if (linked)
+    {
+        BuildReflection();
+    }
+    return linked;
+}
+
 // Get a string with linking error messages
 // The max length of the string returned is determined by the capacity of the span
 void ShaderProgram::GetLinkingErrors(std::span<char> errors) const
@@ -130,20 +242,199 @@ void ShaderProgram::Use() const
 #endif
 }
 
-// Find an attribute location by name
+// Set the null program as the active one
+void ShaderProgram::Unuse()
+{
+    glUseProgram(NullHandle);
+#ifndef NDEBUG
+    s_usedHandle = NullHandle;
+#endif
+}
+
+// Find an attribute location by name, in the reflection table first
 ShaderProgram::Location ShaderProgram::GetAttributeLocation(const char* name) const
 {
     assert(IsValid());
-    assert(IsLinked());
-    return glGetAttribLocation(GetHandle(), name);
+    const AttributeInfo* attribute = FindInTable(GetAttributeTable(), NameHash(name));
+    return attribute ? attribute->location : glGetAttribLocation(GetHandle(), name);
+}
+
+// Find an attribute location by name hash, in the reflection table
+ShaderProgram::Location ShaderProgram::GetAttributeLocation(NameHash name) const
+{
+    const AttributeInfo* attribute = FindInTable(GetAttributeTable(), name);
+    if (!attribute)
+    {
+        ReportCollision(name);
+    }
+    return attribute ? attribute->location : -1;
 }
 
-// Find a uniform location by name
+// Find a uniform location by name, in the reflection table first
 ShaderProgram::Location ShaderProgram::GetUniformLocation(const char* name) const
+{
+    assert(IsValid());
+    // Names that collide with another one are not in the table, and are compared as strings by the driver
+    const UniformInfo* uniform = FindInTable(GetUniformTable(), NameHash(name));
+    return uniform ? uniform->location : glGetUniformLocation(GetHandle(), name);
+}
+
+// Find a uniform location by name hash, in the reflection table
+ShaderProgram::Location ShaderProgram::GetUniformLocation(NameHash name) const
+{
+    const UniformInfo* uniform = FindInTable(GetUniformTable(), name);
+    if (!uniform)
+    {
+        ReportCollision(name);
+    }
+    return uniform ? uniform->location : -1;
+}
+
+// Find a uniform block index by name hash, in the reflection table
+GLuint ShaderProgram::GetUniformBlockIndex(NameHash name) const
+{
+    const UniformBlockInfo* uniformBlock = FindInTable(GetUniformBlockTable(), name);
+    if (!uniformBlock)
+    {
+        ReportCollision(name);
+    }
+    return uniformBlock ? uniformBlock->index : GL_INVALID_INDEX;
+}
+
+void ShaderProgram::SetUniformBlockBinding(GLuint uniformBlockIndex, GLuint binding) const
+{
+    assert(IsValid());
+    glUniformBlockBinding(GetHandle(), uniformBlockIndex, binding);
+}
+
+std::span<const ShaderProgram::UniformInfo> ShaderProgram::GetUniformTable() const
+{
+    if (!m_hasReflection)
+    {
+        BuildReflection();
+    }
+    return m_uniformTable;
+}
+
+std::span<const ShaderProgram::UniformBlockInfo> ShaderProgram::GetUniformBlockTable() const
+{
+    if (!m_hasReflection)
+    {
+        BuildReflection();
+    }
+    return m_uniformBlockTable;
+}
+
+std::span<const ShaderProgram::AttributeInfo> ShaderProgram::GetAttributeTable() const
+{
+    if (!m_hasReflection)
+    {
+        BuildReflection();
+    }
+    return m_attributeTable;
+}
+
+// Query all the active resources once, so later lookups don't need strings or OpenGL calls
+void ShaderProgram::BuildReflection() const
 {
     assert(IsValid());
     assert(IsLinked());
-    return glGetUniformLocation(GetHandle(), name);
+
+    Handle handle = GetHandle();
+    std::array<char, 256> name;
+    GLsizei length;
+
+    // Add the entry, and another one without the "[0]" suffix for arrays
+    auto addEntry = [&](auto& table, auto entry)
+    {
+        std::string_view nameView(name.data(), length);
+        entry.name = NameHash(nameView);
+        table.push_back(entry);
+        if (nameView.ends_with("[0]"))
+        {
+            entry.name = NameHash(nameView.substr(0, nameView.size() - 3));
+            table.push_back(entry);
+        }
+    };
+
+    m_uniformTable.clear();
+    GLint uniformCount = 0;
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &uniformCount);
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        UniformInfo uniform;
+        glGetActiveUniform(handle, i, static_cast<GLsizei>(name.size()), &length, &uniform.size, &uniform.glType, name.data());
+        uniform.location = glGetUniformLocation(handle, name.data());
+        // Uniforms in blocks don't have a location
+        if (uniform.location >= 0)
+        {
+            addEntry(m_uniformTable, uniform);
+        }
+    }
+
+    m_uniformBlockTable.clear();
+    GLint uniformBlockCount = 0;
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCKS, &uniformBlockCount);
+    for (GLint i = 0; i < uniformBlockCount; ++i)
+    {
+        UniformBlockInfo uniformBlock;
+        glGetActiveUniformBlockName(handle, i, static_cast<GLsizei>(name.size()), &length, name.data());
+        glGetActiveUniformBlockiv(handle, i, GL_UNIFORM_BLOCK_DATA_SIZE, &uniformBlock.dataSize);
+        uniformBlock.index = i;
+        addEntry(m_uniformBlockTable, uniformBlock);
+    }
+
+    m_attributeTable.clear();
+    GLint attributeCount = 0;
+    glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    for (GLint i = 0; i < attributeCount; ++i)
+    {
+        AttributeInfo attribute;
+        glGetActiveAttrib(handle, i, static_cast<GLsizei>(name.size()), &length, &attribute.size, &attribute.glType, name.data());
+        attribute.location = glGetAttribLocation(handle, name.data());
+        // Built-in attributes, like gl_VertexID, don't have a location
+        if (attribute.location >= 0)
+        {
+            addEntry(m_attributeTable, attribute);
+        }
+    }
+
+    // Sort by hash for the binary search. Different names with the same hash are removed, so they are never confused
+    // Lookups with the name string fall back to the driver for them, and lookups with the hash report the collision
+    m_collidingNames.clear();
+    auto sortTable = [&](auto& table)
+    {
+        std::sort(table.begin(), table.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+        auto itCollision = std::adjacent_find(table.begin(), table.end(), [](const auto& a, const auto& b) { return a.name == b.name; });
+        while (itCollision != table.end())
+        {
+            NameHash collidingName = itCollision->name;
+            m_collidingNames.push_back(collidingName);
+            auto itEnd = std::find_if(itCollision, table.end(), [=](const auto& entry) { return entry.name != collidingName; });
+            itCollision = table.erase(itCollision, itEnd);
+            itCollision = std::adjacent_find(itCollision, table.end(), [](const auto& a, const auto& b) { return a.name == b.name; });
+        }
+    };
+    sortTable(m_uniformTable);
+    sortTable(m_uniformBlockTable);
+    sortTable(m_attributeTable);
+
+    m_hasReflection = true;
+}
+
+void ShaderProgram::ReportCollision(NameHash name) const
+{
+    if (std::find(m_collidingNames.begin(), m_collidingNames.end(), name) != m_collidingNames.end())
+    {
+        std::cout << "ERROR::SHADER_PROGRAM::NAME_HASH_COLLISION " << name.GetValue() << " (look it up by name instead)" << std::endl;
+    }
+}
+
+template<typename T>
+const T* ShaderProgram::FindInTable(std::span<const T> table, NameHash name)
+{
+    auto it = std::lower_bound(table.begin(), table.end(), name, [](const T& entry, NameHash name) { return entry.name < name; });
+    return it != table.end() && it->name == name ? &*it : nullptr;
 }
 
 // Get how many uniforms exist in this shader program
@@ -197,206 +488,206 @@ template<>
 void ShaderProgram::SetUniforms<GLint, 1>(Location location, const GLint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform1iv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform1iv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLint, 2>(Location location, const GLint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform2iv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform2iv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLint, 3>(Location location, const GLint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform3iv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform3iv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLint, 4>(Location location, const GLint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform4iv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform4iv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLuint, 1>(Location location, const GLuint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform1uiv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform1uiv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLuint, 2>(Location location, const GLuint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform2uiv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform2uiv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLuint, 3>(Location location, const GLuint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform3uiv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform3uiv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLuint, 4>(Location location, const GLuint* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform4uiv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform4uiv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 1>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform1fv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform1fv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 2>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform2fv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform2fv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 3>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform3fv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform3fv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 4>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform4fv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform4fv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLdouble, 1>(Location location, const GLdouble* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform1dv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform1dv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLdouble, 2>(Location location, const GLdouble* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform2dv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform2dv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLdouble, 3>(Location location, const GLdouble* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform3dv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform3dv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLdouble, 4>(Location location, const GLdouble* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniform4dv(location, count, values);
+    assert(m_separable || IsUsed());
+    glProgramUniform4dv(GetHandle(), location, count, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 2, 2>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix2fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix2fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 2, 3>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix2x3fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix2x3fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 2, 4>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix2x4fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix2x4fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 3, 2>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix3x2fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix3x2fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 3, 3>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix3fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix3fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 3, 4>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix3x4fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix3x4fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 4, 2>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix4x2fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix4x2fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 4, 3>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix4x3fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix4x3fv(GetHandle(), location, count, false, values);
 }
 
 template<>
 void ShaderProgram::SetUniforms<GLfloat, 4, 4>(Location location, const GLfloat* values, GLsizei count) const
 {
     assert(IsValid());
-    assert(IsUsed());
-    glUniformMatrix4fv(location, count, false, values);
+    assert(m_separable || IsUsed());
+    glProgramUniformMatrix4fv(GetHandle(), location, count, false, values);
 }
 
 void ShaderProgram::SetTexture(Location location, GLint textureUnit, const TextureObject& texture) const
 {
     assert(IsValid());
-    assert(IsUsed());
+    assert(m_separable || IsUsed());
     TextureObject::SetActiveTexture(textureUnit);
     texture.Bind();
     SetUniform(location, textureUnit);
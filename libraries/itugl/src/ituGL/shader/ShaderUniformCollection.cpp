@@ -1,12 +1,19 @@
 #include <ituGL/shader/ShaderUniformCollection.h>
+#include <algorithm>
 #include <cassert>
 #include <array>
+#include <atomic>
+
+// Last version given to any collection. Collections can be changed in the worker thread, while the main thread reads it
+static std::atomic<std::uint64_t> s_lastVersion(0);
 
 ShaderUniformCollection::ShaderUniformCollection() : m_shaderProgram(nullptr)
+    , m_version(s_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1)
 {
 }
 
 ShaderUniformCollection::ShaderUniformCollection(std::shared_ptr<ShaderProgram> shaderProgram, const NameSet& filteredUniforms) : m_shaderProgram(shaderProgram)
+    , m_version(s_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1)
 {
     ExtractUniforms(filteredUniforms);
 }
@@ -26,6 +33,17 @@ void ShaderUniformCollection::ChangeShader(std::shared_ptr<ShaderProgram> shader
     Reset();
     m_shaderProgram = shaderProgram;
     ExtractUniforms(filteredUniforms);
+    Changed();
+}
+
+std::uint64_t ShaderUniformCollection::GetLastVersion()
+{
+    return s_lastVersion.load(std::memory_order_relaxed);
+}
+
+void ShaderUniformCollection::Changed()
+{
+    m_version = s_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 ShaderProgram::Location ShaderUniformCollection::GetAttributeLocation(const char* name) const
@@ -33,11 +51,21 @@ ShaderProgram::Location ShaderUniformCollection::GetAttributeLocation(const char
     return m_shaderProgram->GetAttributeLocation(name);
 }
 
+ShaderProgram::Location ShaderUniformCollection::GetAttributeLocation(NameHash name) const
+{
+    return m_shaderProgram->GetAttributeLocation(name);
+}
+
 ShaderProgram::Location ShaderUniformCollection::GetUniformLocation(const char* name) const
 {
     return m_shaderProgram->GetUniformLocation(name);
 }
 
+ShaderProgram::Location ShaderUniformCollection::GetUniformLocation(NameHash name) const
+{
+    return m_shaderProgram->GetUniformLocation(name);
+}
+
 ShaderUniformCollection::DataUniform& ShaderUniformCollection::GetDataUniform(ShaderProgram::Location location)
 {
     return const_cast<DataUniform&>(const_cast<const ShaderUniformCollection*>(this)->GetDataUniform(location));
@@ -45,10 +73,9 @@ ShaderUniformCollection::DataUniform& ShaderUniformCollection::GetDataUniform(Sh
 
 const ShaderUniformCollection::DataUniform& ShaderUniformCollection::GetDataUniform(ShaderProgram::Location location) const
 {
-    int uniformIndex = m_locationDataIndex.at(location);
-    const DataUniform& uniform = m_dataUniforms[uniformIndex];
-    assert(uniform.location == location);
-    return uniform;
+    auto itUniform = FindUniform(m_dataUniforms, location);
+    assert(itUniform != m_dataUniforms.end());
+    return *itUniform;
 }
 
 ShaderUniformCollection::TextureUniform& ShaderUniformCollection::GetTextureUniform(ShaderProgram::Location location)
@@ -58,10 +85,9 @@ ShaderUniformCollection::TextureUniform& ShaderUniformCollection::GetTextureUnif
 
 const ShaderUniformCollection::TextureUniform& ShaderUniformCollection::GetTextureUniform(ShaderProgram::Location location) const
 {
-    int uniformIndex = m_locationTextureIndex.at(location);
-    const TextureUniform& uniform = m_textureUniforms[uniformIndex];
-    assert(uniform.location == location);
-    return uniform;
+    auto itUniform = FindUniform(m_textureUniforms, location);
+    assert(itUniform != m_textureUniforms.end());
+    return *itUniform;
 }
 
 void ShaderUniformCollection::ExtractUniforms(const NameSet& filteredUniforms)
@@ -283,97 +309,122 @@ void ShaderUniformCollection::AddUniform(const DataUniform& uniform)
 
 void ShaderUniformCollection::AddUniform(const TextureUniform& uniform)
 {
-    m_locationTextureIndex.insert(std::make_pair(uniform.location, static_cast<int>(m_textureUniforms.size())));
-    m_textureUniforms.push_back(uniform);
+    InsertUniform(m_textureUniforms, uniform);
+}
+
+ShaderProgram::Location ShaderUniformCollection::MapLocation(const LocationMap& locations, ShaderProgram::Location location)
+{
+    auto itLocation = std::lower_bound(locations.begin(), locations.end(), location,
+        [](const LocationMap::value_type& entry, ShaderProgram::Location location) { return entry.first < location; });
+    return itLocation != locations.end() && itLocation->first == location ? itLocation->second : -1;
 }
 
 void ShaderUniformCollection::SetUniforms() const
 {
     for (const DataUniform& uniform : m_dataUniforms)
     {
-        UseUniform(uniform);
+        UseUniform(uniform, *m_shaderProgram, uniform.location);
+    }
+    for (const TextureUniform& uniform : m_textureUniforms)
+    {
+        UseUniform(uniform, *m_shaderProgram, uniform.location);
+    }
+}
+
+void ShaderUniformCollection::SetUniforms(const ShaderProgram& shaderProgram, const LocationMap& locations) const
+{
+    for (const DataUniform& uniform : m_dataUniforms)
+    {
+        ShaderProgram::Location location = MapLocation(locations, uniform.location);
+        if (location >= 0)
+        {
+            UseUniform(uniform, shaderProgram, location);
+        }
     }
     for (const TextureUniform& uniform : m_textureUniforms)
     {
-        UseUniform(uniform);
+        ShaderProgram::Location location = MapLocation(locations, uniform.location);
+        if (location >= 0)
+        {
+            UseUniform(uniform, shaderProgram, location);
+        }
     }
 }
 
-void ShaderUniformCollection::UseUniform(const DataUniform& uniform) const
+void ShaderUniformCollection::UseUniform(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const
 {
     switch (uniform.type)
     {
     case Data::Type::Int:
-        UseUniform<int>(uniform);
+        UseUniform<int>(uniform, shaderProgram, location);
         break;
     case Data::Type::UInt:
-        UseUniform<unsigned int>(uniform);
+        UseUniform<unsigned int>(uniform, shaderProgram, location);
         break;
     case Data::Type::Float:
-        UseUniform<float>(uniform);
+        UseUniform<float>(uniform, shaderProgram, location);
         break;
     case Data::Type::Double:
-        UseUniform<double>(uniform);
+        UseUniform<double>(uniform, shaderProgram, location);
         break;
     default:
         assert(false);
     }
 }
 
-void ShaderUniformCollection::UseUniform(const TextureUniform& uniform) const
+void ShaderUniformCollection::UseUniform(const TextureUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const
 {
     //TODO: default texture
     if (uniform.texture)
     {
         size_t textureIndex = &uniform - m_textureUniforms.data();
-        m_shaderProgram->SetTexture(uniform.location, static_cast<int>(textureIndex), *uniform.texture);
+        shaderProgram.SetTexture(location, static_cast<int>(textureIndex), *uniform.texture);
     }
 }
 
 template<>
-void ShaderUniformCollection::UseUniform<float>(const DataUniform& uniform) const
+void ShaderUniformCollection::UseUniform<float>(const DataUniform& uniform, const ShaderProgram& shaderProgram, ShaderProgram::Location location) const
 {
-    ShaderProgram::Location location = uniform.location;
     switch (uniform.dimension)
     {
     case UniformDimension::Scalar:
-        m_shaderProgram->SetUniforms<float>(location, GetDataValues<float>(location));
+        shaderProgram.SetUniforms<float>(location, GetDataValues<float>(uniform.location));
         break;
     case UniformDimension::Vector2:
-        m_shaderProgram->SetUniforms<float, 2>(location, GetDataValues<glm::vec<2,float>>(location));
+        shaderProgram.SetUniforms<float, 2>(location, GetDataValues<glm::vec<2,float>>(uniform.location));
         break;
     case UniformDimension::Vector3:
-        m_shaderProgram->SetUniforms<float, 3>(location, GetDataValues<glm::vec<3, float>>(location));
+        shaderProgram.SetUniforms<float, 3>(location, GetDataValues<glm::vec<3, float>>(uniform.location));
         break;
     case UniformDimension::Vector4:
-        m_shaderProgram->SetUniforms<float, 4>(location, GetDataValues<glm::vec<4, float>>(location));
+        shaderProgram.SetUniforms<float, 4>(location, GetDataValues<glm::vec<4, float>>(uniform.location));
         break;
     case UniformDimension::Matrix2x2:
-        m_shaderProgram->SetUniforms<float, 2, 2>(location, GetDataValues<glm::mat<2, 2, float>>(location));
+        shaderProgram.SetUniforms<float, 2, 2>(location, GetDataValues<glm::mat<2, 2, float>>(uniform.location));
         break;
     case UniformDimension::Matrix2x3:
-        m_shaderProgram->SetUniforms<float, 2, 3>(location, GetDataValues<glm::mat<2, 3, float>>(location));
+        shaderProgram.SetUniforms<float, 2, 3>(location, GetDataValues<glm::mat<2, 3, float>>(uniform.location));
         break;
     case UniformDimension::Matrix2x4:
-        m_shaderProgram->SetUniforms<float, 2, 4>(location, GetDataValues<glm::mat<2, 4, float>>(location));
+        shaderProgram.SetUniforms<float, 2, 4>(location, GetDataValues<glm::mat<2, 4, float>>(uniform.location));
         break;
     case UniformDimension::Matrix3x2:
-        m_shaderProgram->SetUniforms<float, 3, 2>(location, GetDataValues<glm::mat<3, 2, float>>(location));
+        shaderProgram.SetUniforms<float, 3, 2>(location, GetDataValues<glm::mat<3, 2, float>>(uniform.location));
         break;
     case UniformDimension::Matrix3x3:
-        m_shaderProgram->SetUniforms<float, 3, 3>(location, GetDataValues<glm::mat<3, 3, float>>(location));
+        shaderProgram.SetUniforms<float, 3, 3>(location, GetDataValues<glm::mat<3, 3, float>>(uniform.location));
         break;
     case UniformDimension::Matrix3x4:
-        m_shaderProgram->SetUniforms<float, 3, 4>(location, GetDataValues<glm::mat<3, 4, float>>(location));
+        shaderProgram.SetUniforms<float, 3, 4>(location, GetDataValues<glm::mat<3, 4, float>>(uniform.location));
         break;
     case UniformDimension::Matrix4x2:
-        m_shaderProgram->SetUniforms<float, 4, 2>(location, GetDataValues<glm::mat<4, 2, float>>(location));
+        shaderProgram.SetUniforms<float, 4, 2>(location, GetDataValues<glm::mat<4, 2, float>>(uniform.location));
         break;
     case UniformDimension::Matrix4x3:
-        m_shaderProgram->SetUniforms<float, 4, 3>(location, GetDataValues<glm::mat<4, 3, float>>(location));
+        shaderProgram.SetUniforms<float, 4, 3>(location, GetDataValues<glm::mat<4, 3, float>>(uniform.location));
         break;
     case UniformDimension::Matrix4x4:
-        m_shaderProgram->SetUniforms<float, 4, 4>(location, GetDataValues<glm::mat<4, 4, float>>(location));
+        shaderProgram.SetUniforms<float, 4, 4>(location, GetDataValues<glm::mat<4, 4, float>>(uniform.location));
         break;
     default:
         assert(false);
@@ -392,7 +443,11 @@ void ShaderUniformCollection::SetUniformValue(ShaderProgram::Location location,
 {
     TextureUniform& uniform = GetTextureUniform(location);
     assert(!value || uniform.target == value->GetTarget());
-    uniform.texture = value;
+    if (uniform.texture != value)
+    {
+        uniform.texture = value;
+        Changed();
+    }
 }
 
 int ShaderUniformCollection::GetDataUniformSize(const DataUniform& uniform) const
@@ -442,8 +497,6 @@ void ShaderUniformCollection::Reset()
     m_shaderProgram = nullptr;
     m_dataUniforms.clear();
     m_textureUniforms.clear();
-    m_locationDataIndex.clear();
-    m_locationTextureIndex.clear();
     m_intDataValues.clear();
     m_uintDataValues.clear();
     m_floatDataValues.clear();
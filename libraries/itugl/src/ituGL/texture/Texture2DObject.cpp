@@ -20,3 +20,10 @@ void Texture2DObject::SetImage(GLint level, GLsizei width, GLsizei height, Forma
 {
     SetImage<float>(level, width, height, format, internalFormat, std::span<float>());
 }
+
+void Texture2DObject::SetCompressedImage(GLint level, GLsizei width, GLsizei height, InternalFormat internalFormat, std::span<const std::byte> data)
+{
+    assert(IsBound());
+    assert(!data.empty());
+    glCompressedTexImage2D(GetTarget(), level, internalFormat, width, height, 0, static_cast<GLsizei>(data.size_bytes()), data.data());
+}
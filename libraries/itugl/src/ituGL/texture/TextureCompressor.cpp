@@ -0,0 +1,624 @@
+#include <ituGL/texture/TextureCompressor.h>
+
+#include <ituGL/core/JobSystem.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURECOMPRESSOR_SSE2
+#include <emmintrin.h>
+// The AVX2 functions are compiled for that target only, and selected at runtime if the CPU supports it
+#if defined(__GNUC__) || defined(__clang__)
+#define TEXTURECOMPRESSOR_AVX2
+#define TEXTURECOMPRESSOR_AVX2_FUNCTION __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define TEXTURECOMPRESSOR_AVX2
+#define TEXTURECOMPRESSOR_AVX2_FUNCTION
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+// Each block is stored as 16 RGBA pixels, 64 bytes
+static const int s_blockPixelCount = 16;
+
+// Copy a 4x4 block of pixels, expanded to RGBA. Pixels outside the image are clamped to the border
+static void LoadBlock(const unsigned char* data, int width, int height, int componentCount, int blockX, int blockY, unsigned char block[64])
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        int pixelY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x)
+        {
+            int pixelX = std::min(blockX * 4 + x, width - 1);
+            const unsigned char* src = data + (static_cast<size_t>(pixelY) * width + pixelX) * componentCount;
+            unsigned char* dst = block + (y * 4 + x) * 4;
+            switch (componentCount)
+            {
+            case 1:
+                dst[0] = src[0]; dst[1] = src[0]; dst[2] = src[0]; dst[3] = 255;
+                break;
+            case 2:
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = 0; dst[3] = 255;
+                break;
+            case 3:
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;
+                break;
+            default:
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+                break;
+            }
+        }
+    }
+}
+
+#ifdef TEXTURECOMPRESSOR_AVX2
+static bool IsAVX2Supported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // The OS must also save the AVX registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+// The whole block in 2 registers, 8 pixels each
+TEXTURECOMPRESSOR_AVX2_FUNCTION
+static void GetMinMaxColorsAVX2(const unsigned char block[64], unsigned char minColor[4], unsigned char maxColor[4])
+{
+    __m256i pixels0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 0));
+    __m256i pixels1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    __m256i minPixels8 = _mm256_min_epu8(pixels0, pixels1);
+    __m256i maxPixels8 = _mm256_max_epu8(pixels0, pixels1);
+
+    // Reduce the 8 pixels left in each register to 4, then to 1
+    __m128i minPixels = _mm_min_epu8(_mm256_castsi256_si128(minPixels8), _mm256_extracti128_si256(minPixels8, 1));
+    __m128i maxPixels = _mm_max_epu8(_mm256_castsi256_si128(maxPixels8), _mm256_extracti128_si256(maxPixels8, 1));
+    minPixels = _mm_min_epu8(minPixels, _mm_shuffle_epi32(minPixels, _MM_SHUFFLE(2, 3, 0, 1)));
+    minPixels = _mm_min_epu8(minPixels, _mm_shuffle_epi32(minPixels, _MM_SHUFFLE(1, 0, 3, 2)));
+    maxPixels = _mm_max_epu8(maxPixels, _mm_shuffle_epi32(maxPixels, _MM_SHUFFLE(2, 3, 0, 1)));
+    maxPixels = _mm_max_epu8(maxPixels, _mm_shuffle_epi32(maxPixels, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    int minValue = _mm_cvtsi128_si32(minPixels);
+    int maxValue = _mm_cvtsi128_si32(maxPixels);
+    std::memcpy(minColor, &minValue, 4);
+    std::memcpy(maxColor, &maxValue, 4);
+}
+
+// Palette steps of the pixels projected on the line between the endpoints, 8 pixels per iteration
+TEXTURECOMPRESSOR_AVX2_FUNCTION
+static void GetColorStepsAVX2(const unsigned char block[64], const int direction[3], int offset, float scale, int steps[16])
+{
+    const __m256i direction16 = _mm256_setr_epi16(
+        static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0,
+        static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0,
+        static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0,
+        static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0);
+    const __m256 offset8 = _mm256_set1_ps(static_cast<float>(offset));
+    const __m256 scale8 = _mm256_set1_ps(scale);
+    const __m256 min8 = _mm256_setzero_ps();
+    const __m256 max8 = _mm256_set1_ps(3.0f);
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+    for (int i = 0; i < s_blockPixelCount; i += 8)
+    {
+        // 2 groups of 4 pixels, widened to 16 bits
+        __m256i pixelsLow = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4)));
+        __m256i pixelsHigh = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4 + 16)));
+
+        // Partial dot products (r*dr + g*dg, b*db), added in pairs. Pixels end up in the order 0 1 4 5 2 3 6 7
+        __m256i dot = _mm256_hadd_epi32(_mm256_madd_epi16(pixelsLow, direction16), _mm256_madd_epi16(pixelsHigh, direction16));
+        dot = _mm256_permute4x64_epi64(dot, _MM_SHUFFLE(3, 1, 2, 0));
+
+        // Map to the [0, 3] range and round
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(dot), offset8), scale8);
+        t = _mm256_min_ps(_mm256_max_ps(t, min8), max8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(steps + i), _mm256_cvttps_epi32(_mm256_add_ps(t, half8)));
+    }
+}
+
+// Palette steps of the values of a channel, 8 values per iteration
+TEXTURECOMPRESSOR_AVX2_FUNCTION
+static void GetChannelStepsAVX2(const unsigned char values[16], int value1, float scale, int steps[16])
+{
+    const __m256 offset8 = _mm256_set1_ps(static_cast<float>(value1));
+    const __m256 scale8 = _mm256_set1_ps(scale);
+    const __m256 min8 = _mm256_setzero_ps();
+    const __m256 max8 = _mm256_set1_ps(7.0f);
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+    for (int i = 0; i < s_blockPixelCount; i += 8)
+    {
+        __m256i values32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i)));
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(values32), offset8), scale8);
+        t = _mm256_min_ps(_mm256_max_ps(t, min8), max8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(steps + i), _mm256_cvttps_epi32(_mm256_add_ps(t, half8)));
+    }
+}
+#endif
+
+// Get the minimum and maximum value of each channel in the block
+static void GetMinMaxColors(const unsigned char block[64], unsigned char minColor[4], unsigned char maxColor[4], bool useAVX2)
+{
+#ifdef TEXTURECOMPRESSOR_AVX2
+    if (useAVX2)
+    {
+        GetMinMaxColorsAVX2(block, minColor, maxColor);
+        return;
+    }
+#endif
+#ifdef TEXTURECOMPRESSOR_SSE2
+    __m128i pixels0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 0));
+    __m128i pixels1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+    __m128i pixels2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+    __m128i pixels3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+
+    __m128i minPixels = _mm_min_epu8(_mm_min_epu8(pixels0, pixels1), _mm_min_epu8(pixels2, pixels3));
+    __m128i maxPixels = _mm_max_epu8(_mm_max_epu8(pixels0, pixels1), _mm_max_epu8(pixels2, pixels3));
+
+    // Reduce the 4 pixels left in each register to 1
+    minPixels = _mm_min_epu8(minPixels, _mm_shuffle_epi32(minPixels, _MM_SHUFFLE(2, 3, 0, 1)));
+    minPixels = _mm_min_epu8(minPixels, _mm_shuffle_epi32(minPixels, _MM_SHUFFLE(1, 0, 3, 2)));
+    maxPixels = _mm_max_epu8(maxPixels, _mm_shuffle_epi32(maxPixels, _MM_SHUFFLE(2, 3, 0, 1)));
+    maxPixels = _mm_max_epu8(maxPixels, _mm_shuffle_epi32(maxPixels, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    int minValue = _mm_cvtsi128_si32(minPixels);
+    int maxValue = _mm_cvtsi128_si32(maxPixels);
+    std::memcpy(minColor, &minValue, 4);
+    std::memcpy(maxColor, &maxValue, 4);
+#else
+    std::memcpy(minColor, block, 4);
+    std::memcpy(maxColor, block, 4);
+    for (int i = 1; i < s_blockPixelCount; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+#endif
+}
+
+// Move the endpoints slightly towards each other, so the palette covers the block colors more evenly
+static void InsetColors(unsigned char minColor[4], unsigned char maxColor[4], int shift)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        int inset = (maxColor[c] - minColor[c]) >> shift;
+        minColor[c] = static_cast<unsigned char>(minColor[c] + inset);
+        maxColor[c] = static_cast<unsigned char>(maxColor[c] - inset);
+    }
+}
+
+// Choose the diagonal of the bounding box that follows the color distribution, swapping the G and B endpoints if needed
+static void SelectDiagonal(const unsigned char block[64], unsigned char minColor[4], unsigned char maxColor[4])
+{
+    int centerR = (minColor[0] + maxColor[0]) >> 1;
+    int centerG = (minColor[1] + maxColor[1]) >> 1;
+    int centerB = (minColor[2] + maxColor[2]) >> 1;
+
+    int covarianceRG = 0, covarianceRB = 0, covarianceGB = 0;
+    for (int i = 0; i < s_blockPixelCount; ++i)
+    {
+        int r = block[i * 4 + 0] - centerR;
+        int g = block[i * 4 + 1] - centerG;
+        int b = block[i * 4 + 2] - centerB;
+        covarianceRG += r * g;
+        covarianceRB += r * b;
+        covarianceGB += g * b;
+    }
+
+    // If red is constant, use green as the reference axis for blue
+    bool flipG = covarianceRG < 0;
+    bool flipB = minColor[0] == maxColor[0] ? covarianceGB < 0 : covarianceRB < 0;
+    if (flipG)
+    {
+        std::swap(minColor[1], maxColor[1]);
+    }
+    if (flipB)
+    {
+        std::swap(minColor[2], maxColor[2]);
+    }
+}
+
+// Convert color to 5:6:5 format
+static unsigned short ToRGB565(const unsigned char color[4])
+{
+    return static_cast<unsigned short>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+// Expand 5:6:5 color back to 8 bits per channel, the same way the hardware does
+static void FromRGB565(unsigned short value, int color[3])
+{
+    int r = (value >> 11) & 0x1F;
+    int g = (value >> 5) & 0x3F;
+    int b = value & 0x1F;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Compute the 2-bit palette index of each pixel, projecting the pixels on the line between the endpoints
+static unsigned int GetColorIndices(const unsigned char block[64], const int color0[3], const int color1[3], bool useAVX2)
+{
+    // Palette order is: color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+    static const unsigned int s_indexMap[4] = { 1, 3, 2, 0 };
+
+    int direction[3] = { color0[0] - color1[0], color0[1] - color1[1], color0[2] - color1[2] };
+    int lengthSquared = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+    int offset = color1[0] * direction[0] + color1[1] * direction[1] + color1[2] * direction[2];
+    float scale = 3.0f / static_cast<float>(lengthSquared);
+
+    int steps[s_blockPixelCount];
+#ifdef TEXTURECOMPRESSOR_AVX2
+    if (useAVX2)
+    {
+        GetColorStepsAVX2(block, direction, offset, scale, steps);
+    }
+    else
+#endif
+    {
+#ifdef TEXTURECOMPRESSOR_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i direction16 = _mm_setr_epi16(
+            static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0,
+            static_cast<short>(direction[0]), static_cast<short>(direction[1]), static_cast<short>(direction[2]), 0);
+        const __m128 offset4 = _mm_set1_ps(static_cast<float>(offset));
+        const __m128 scale4 = _mm_set1_ps(scale);
+        const __m128 min4 = _mm_setzero_ps();
+        const __m128 max4 = _mm_set1_ps(3.0f);
+        const __m128 half4 = _mm_set1_ps(0.5f);
+        for (int i = 0; i < s_blockPixelCount; i += 4)
+        {
+            // 4 pixels, widened to 16 bits, 2 pixels per register
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 4));
+            __m128i pixelsLow = _mm_unpacklo_epi8(pixels, zero);
+            __m128i pixelsHigh = _mm_unpackhi_epi8(pixels, zero);
+
+            // Partial dot products: (r*dr + g*dg, b*db) for each pixel
+            __m128i dotLow = _mm_madd_epi16(pixelsLow, direction16);
+            __m128i dotHigh = _mm_madd_epi16(pixelsHigh, direction16);
+
+            // Add the partial dot products to get one value per pixel
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(dotLow), _mm_castsi128_ps(dotHigh), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(dotLow), _mm_castsi128_ps(dotHigh), _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i dot = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+
+            // Map to the [0, 3] range and round
+            __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(dot), offset4), scale4);
+            t = _mm_min_ps(_mm_max_ps(t, min4), max4);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(steps + i), _mm_cvttps_epi32(_mm_add_ps(t, half4)));
+        }
+#else
+        for (int i = 0; i < s_blockPixelCount; ++i)
+        {
+            const unsigned char* pixel = block + i * 4;
+            int dot = pixel[0] * direction[0] + pixel[1] * direction[1] + pixel[2] * direction[2];
+            float t = std::clamp((dot - offset) * scale, 0.0f, 3.0f);
+            steps[i] = static_cast<int>(t + 0.5f);
+        }
+#endif
+    }
+
+    unsigned int indices = 0;
+    for (int i = 0; i < s_blockPixelCount; ++i)
+    {
+        indices |= s_indexMap[steps[i]] << (i * 2);
+    }
+    return indices;
+}
+
+// Encode the RGB channels of the block in BC1 format (8 bytes)
+static void EncodeColorBlock(const unsigned char block[64], const unsigned char blockMinColor[4], const unsigned char blockMaxColor[4], unsigned char* output, bool useAVX2)
+{
+    unsigned char minColor[4], maxColor[4];
+    std::memcpy(minColor, blockMinColor, 4);
+    std::memcpy(maxColor, blockMaxColor, 4);
+    InsetColors(minColor, maxColor, 4);
+    SelectDiagonal(block, minColor, maxColor);
+
+    unsigned short value0 = ToRGB565(maxColor);
+    unsigned short value1 = ToRGB565(minColor);
+
+    // Color0 must be greater than color1 to use the 4 color mode
+    if (value0 < value1)
+    {
+        std::swap(value0, value1);
+    }
+
+    unsigned int indices = 0;
+    if (value0 != value1)
+    {
+        int color0[3], color1[3];
+        FromRGB565(value0, color0);
+        FromRGB565(value1, color1);
+        indices = GetColorIndices(block, color0, color1, useAVX2);
+    }
+
+    output[0] = static_cast<unsigned char>(value0 & 0xFF);
+    output[1] = static_cast<unsigned char>(value0 >> 8);
+    output[2] = static_cast<unsigned char>(value1 & 0xFF);
+    output[3] = static_cast<unsigned char>(value1 >> 8);
+    output[4] = static_cast<unsigned char>(indices & 0xFF);
+    output[5] = static_cast<unsigned char>((indices >> 8) & 0xFF);
+    output[6] = static_cast<unsigned char>((indices >> 16) & 0xFF);
+    output[7] = static_cast<unsigned char>(indices >> 24);
+}
+
+// Encode one channel of the block in BC4 format (8 bytes). Also used for the alpha of BC3 and the channels of BC5
+static void EncodeChannelBlock(const unsigned char block[64], int channel, unsigned char minValue, unsigned char maxValue, unsigned char* output, bool useAVX2)
+{
+    // Palette order is: value0, value1, and 6 interpolated values from value0 to value1
+    static const unsigned int s_indexMap[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+    int inset = (maxValue - minValue) >> 5;
+    int value0 = maxValue - inset;
+    int value1 = minValue + inset;
+
+    unsigned long long indices = 0;
+    if (value0 != value1)
+    {
+        alignas(16) unsigned char values[s_blockPixelCount];
+        for (int i = 0; i < s_blockPixelCount; ++i)
+        {
+            values[i] = block[i * 4 + channel];
+        }
+
+        float scale = 7.0f / static_cast<float>(value0 - value1);
+        int steps[s_blockPixelCount];
+#ifdef TEXTURECOMPRESSOR_AVX2
+        if (useAVX2)
+        {
+            GetChannelStepsAVX2(values, value1, scale, steps);
+        }
+        else
+#endif
+        {
+#ifdef TEXTURECOMPRESSOR_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 offset4 = _mm_set1_ps(static_cast<float>(value1));
+            const __m128 scale4 = _mm_set1_ps(scale);
+            const __m128 min4 = _mm_setzero_ps();
+            const __m128 max4 = _mm_set1_ps(7.0f);
+            const __m128 half4 = _mm_set1_ps(0.5f);
+
+            __m128i values8 = _mm_load_si128(reinterpret_cast<const __m128i*>(values));
+            __m128i values16[2] = { _mm_unpacklo_epi8(values8, zero), _mm_unpackhi_epi8(values8, zero) };
+            for (int i = 0; i < 4; ++i)
+            {
+                __m128i values32 = (i & 1) ? _mm_unpackhi_epi16(values16[i >> 1], zero) : _mm_unpacklo_epi16(values16[i >> 1], zero);
+                __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(values32), offset4), scale4);
+                t = _mm_min_ps(_mm_max_ps(t, min4), max4);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(steps + i * 4), _mm_cvttps_epi32(_mm_add_ps(t, half4)));
+            }
+#else
+            for (int i = 0; i < s_blockPixelCount; ++i)
+            {
+                float t = std::clamp((values[i] - value1) * scale, 0.0f, 7.0f);
+                steps[i] = static_cast<int>(t + 0.5f);
+            }
+#endif
+        }
+
+        for (int i = 0; i < s_blockPixelCount; ++i)
+        {
+            indices |= static_cast<unsigned long long>(s_indexMap[steps[i]]) << (i * 3);
+        }
+    }
+
+    output[0] = static_cast<unsigned char>(value0);
+    output[1] = static_cast<unsigned char>(value1);
+    for (int i = 0; i < 6; ++i)
+    {
+        output[2 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xFF);
+    }
+}
+
+TextureObject::InternalFormat TextureCompressor::GetCompressedFormat(TextureObject::InternalFormat internalFormat)
+{
+    switch (internalFormat)
+    {
+    case TextureObject::InternalFormatR:
+    case TextureObject::InternalFormatR8:
+    case TextureObject::InternalFormatRCompressed:
+    case TextureObject::InternalFormatRBC4:
+        return TextureObject::InternalFormatRBC4;
+    case TextureObject::InternalFormatRG:
+    case TextureObject::InternalFormatRG8:
+    case TextureObject::InternalFormatRGCompressed:
+    case TextureObject::InternalFormatRGBC5:
+        return TextureObject::InternalFormatRGBC5;
+    case TextureObject::InternalFormatRGB:
+    case TextureObject::InternalFormatRGB8:
+    case TextureObject::InternalFormatRGBCompressed:
+    case TextureObject::InternalFormatRGBBC1:
+        return TextureObject::InternalFormatRGBBC1;
+    case TextureObject::InternalFormatSRGB8:
+    case TextureObject::InternalFormatSRGBCompressed:
+    case TextureObject::InternalFormatSRGBBC1:
+        return TextureObject::InternalFormatSRGBBC1;
+    case TextureObject::InternalFormatRGBA:
+    case TextureObject::InternalFormatRGBA8:
+    case TextureObject::InternalFormatRGBACompressed:
+    case TextureObject::InternalFormatRGBABC3:
+        return TextureObject::InternalFormatRGBABC3;
+    case TextureObject::InternalFormatSRGBA8:
+    case TextureObject::InternalFormatSRGBACompressed:
+    case TextureObject::InternalFormatSRGBABC3:
+        return TextureObject::InternalFormatSRGBABC3;
+    default:
+        // No block compressed equivalent
+        return TextureObject::InternalFormatInvalid;
+    }
+}
+
+bool TextureCompressor::IsCompressedFormat(TextureObject::InternalFormat internalFormat)
+{
+    return GetBlockSize(internalFormat) != 0;
+}
+
+bool TextureCompressor::IsS3TCFormat(TextureObject::InternalFormat compressedFormat)
+{
+    switch (compressedFormat)
+    {
+    case TextureObject::InternalFormatRGBBC1:
+    case TextureObject::InternalFormatSRGBBC1:
+    case TextureObject::InternalFormatRGBABC3:
+    case TextureObject::InternalFormatSRGBABC3:
+        return true;
+    default:
+        return false;
+    }
+}
+
+unsigned int TextureCompressor::GetBlockSize(TextureObject::InternalFormat compressedFormat)
+{
+    switch (compressedFormat)
+    {
+    case TextureObject::InternalFormatRBC4:
+    case TextureObject::InternalFormatRGBBC1:
+    case TextureObject::InternalFormatSRGBBC1:
+        return 8;
+    case TextureObject::InternalFormatRGBC5:
+    case TextureObject::InternalFormatRGBABC3:
+    case TextureObject::InternalFormatSRGBABC3:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+unsigned int TextureCompressor::GetCompressedSize(TextureObject::InternalFormat compressedFormat, int width, int height)
+{
+    unsigned int blockCountX = (width + 3) / 4;
+    unsigned int blockCountY = (height + 3) / 4;
+    return blockCountX * blockCountY * GetBlockSize(compressedFormat);
+}
+
+void TextureCompressor::Compress(TextureObject::InternalFormat compressedFormat, std::span<const std::byte> data,
+    int width, int height, int componentCount, std::span<std::byte> compressedData, unsigned int threadCount)
+{
+    assert(IsCompressedFormat(compressedFormat));
+    assert(componentCount >= 1 && componentCount <= 4);
+    assert(data.size_bytes() == static_cast<size_t>(width) * height * componentCount);
+    assert(compressedData.size_bytes() == GetCompressedSize(compressedFormat, width, height));
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+    unsigned char* dst = reinterpret_cast<unsigned char*>(compressedData.data());
+
+    int blockRowCount = (height + 3) / 4;
+
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threadCount = std::min(threadCount, static_cast<unsigned int>(blockRowCount));
+
+    if (threadCount <= 1)
+    {
+        CompressRows(compressedFormat, src, width, height, componentCount, dst, 0, blockRowCount);
+    }
+    else
+    {
+        // Split the rows of blocks evenly. The calling thread encodes the last range
+        int rowsPerThread = (blockRowCount + threadCount - 1) / threadCount;
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        int firstRow = 0;
+        for (unsigned int i = 0; i < threadCount - 1 && firstRow < blockRowCount; ++i, firstRow += rowsPerThread)
+        {
+            int lastRow = std::min(firstRow + rowsPerThread, blockRowCount);
+            threads.emplace_back(&TextureCompressor::CompressRows, compressedFormat, src, width, height, componentCount, dst, firstRow, lastRow);
+        }
+        if (firstRow < blockRowCount)
+        {
+            CompressRows(compressedFormat, src, width, height, componentCount, dst, firstRow, blockRowCount);
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+}
+
+void TextureCompressor::Compress(TextureObject::InternalFormat compressedFormat, std::span<const std::byte> data,
+    int width, int height, int componentCount, std::span<std::byte> compressedData, JobSystem& jobSystem)
+{
+    assert(IsCompressedFormat(compressedFormat));
+    assert(componentCount >= 1 && componentCount <= 4);
+    assert(data.size_bytes() == static_cast<size_t>(width) * height * componentCount);
+    assert(compressedData.size_bytes() == GetCompressedSize(compressedFormat, width, height));
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(data.data());
+    unsigned char* dst = reinterpret_cast<unsigned char*>(compressedData.data());
+
+    unsigned int blockRowCount = (height + 3) / 4;
+    jobSystem.ParallelFor(0, blockRowCount, [=](unsigned int firstRow, unsigned int lastRow)
+        {
+            CompressRows(compressedFormat, src, width, height, componentCount, dst, firstRow, lastRow);
+        });
+}
+
+void TextureCompressor::CompressRows(TextureObject::InternalFormat compressedFormat, const unsigned char* data,
+    int width, int height, int componentCount, unsigned char* compressedData, int firstRow, int lastRow)
+{
+    unsigned int blockSize = GetBlockSize(compressedFormat);
+    int blockCountX = (width + 3) / 4;
+
+#ifdef TEXTURECOMPRESSOR_AVX2
+    static const bool useAVX2 = IsAVX2Supported();
+#else
+    const bool useAVX2 = false;
+#endif
+
+    alignas(16) unsigned char block[s_blockPixelCount * 4];
+    unsigned char minColor[4], maxColor[4];
+    for (int blockY = firstRow; blockY < lastRow; ++blockY)
+    {
+        unsigned char* output = compressedData + static_cast<size_t>(blockY) * blockCountX * blockSize;
+        for (int blockX = 0; blockX < blockCountX; ++blockX, output += blockSize)
+        {
+            LoadBlock(data, width, height, componentCount, blockX, blockY, block);
+            GetMinMaxColors(block, minColor, maxColor, useAVX2);
+
+            switch (compressedFormat)
+            {
+            case TextureObject::InternalFormatRGBBC1:
+            case TextureObject::InternalFormatSRGBBC1:
+                EncodeColorBlock(block, minColor, maxColor, output, useAVX2);
+                break;
+            case TextureObject::InternalFormatRGBABC3:
+            case TextureObject::InternalFormatSRGBABC3:
+                EncodeChannelBlock(block, 3, minColor[3], maxColor[3], output, useAVX2);
+                EncodeColorBlock(block, minColor, maxColor, output + 8, useAVX2);
+                break;
+            case TextureObject::InternalFormatRBC4:
+                EncodeChannelBlock(block, 0, minColor[0], maxColor[0], output, useAVX2);
+                break;
+            case TextureObject::InternalFormatRGBC5:
+                EncodeChannelBlock(block, 0, minColor[0], maxColor[0], output, useAVX2);
+                EncodeChannelBlock(block, 1, minColor[1], maxColor[1], output + 8, useAVX2);
+                break;
+            default:
+                assert(false);
+                break;
+            }
+        }
+    }
+}
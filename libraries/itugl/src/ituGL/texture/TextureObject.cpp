@@ -119,6 +119,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatR16F:
     case InternalFormatR32F:
     case InternalFormatRCompressed:
+    case InternalFormatRBC4:
         return format == FormatR;
     case InternalFormatRG:
     case InternalFormatRG8:
@@ -128,6 +129,7 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatRG16F:
     case InternalFormatRG32F:
     case InternalFormatRGCompressed:
+    case InternalFormatRGBC5:
         return format == FormatRG;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -139,6 +141,8 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatSRGB8:
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
+    case InternalFormatRGBBC1:
+    case InternalFormatSRGBBC1:
     case InternalFormatR11G11B10:
         return format == FormatRGB || format == FormatBGR;
     case InternalFormatRGBA:
@@ -151,6 +155,8 @@ bool TextureObject::IsValidFormat(Format format, InternalFormat internalFormat)
     case InternalFormatSRGBA8:
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
+    case InternalFormatRGBABC3:
+    case InternalFormatSRGBABC3:
     case InternalFormatRGB10A2:
         return format == FormatRGBA || format == FormatBGRA;
     case InternalFormatDepth:
@@ -204,6 +210,7 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatR16F:
     case InternalFormatR32F:
     case InternalFormatRCompressed:
+    case InternalFormatRBC4:
     case InternalFormatR11G11B10:
     case InternalFormatRGB10A2:
     case InternalFormatDepth:
@@ -222,6 +229,7 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatRG16F:
     case InternalFormatRG32F:
     case InternalFormatRGCompressed:
+    case InternalFormatRGBC5:
         return 2;
     case InternalFormatRGB:
     case InternalFormatRGB8:
@@ -233,6 +241,8 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatSRGB8:
     case InternalFormatRGBCompressed:
     case InternalFormatSRGBCompressed:
+    case InternalFormatRGBBC1:
+    case InternalFormatSRGBBC1:
         return 3;
     case InternalFormatRGBA:
     case InternalFormatRGBA8:
@@ -244,6 +254,8 @@ int TextureObject::GetDataComponentCount(InternalFormat internalFormat)
     case InternalFormatSRGBA8:
     case InternalFormatRGBACompressed:
     case InternalFormatSRGBACompressed:
+    case InternalFormatRGBABC3:
+    case InternalFormatSRGBABC3:
         return 4;
     default:
         //Unknown format
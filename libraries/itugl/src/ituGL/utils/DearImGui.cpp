@@ -40,8 +40,18 @@ void DearImGui::BeginFrame()
 }
 
 void DearImGui::EndFrame()
+{
+    BuildFrame();
+    DrawFrame();
+}
+
+void DearImGui::BuildFrame()
 {
     ImGui::Render();
+}
+
+void DearImGui::DrawFrame()
+{
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -0,0 +1,142 @@
+#include "TestUtils.h"
+
+#include <ituGL/core/AllocationTracker.h>
+#include <ituGL/core/JobSystem.h>
+#include <ituGL/scene/PackedBounds.h>
+#include <ituGL/renderer/OcclusionCuller.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <vector>
+
+// Frames run before checking the allocations, so the containers reach their final capacity
+static const int WarmUpFrameCount = 4;
+
+// Stored through a volatile pointer, so the compiler can't remove the allocations of the test
+template<typename T>
+static void Keep(T* ptr)
+{
+    static T* volatile s_ptr;
+    s_ptr = ptr;
+}
+
+struct alignas(64) AlignedBlock
+{
+    float values[16];
+};
+
+// Allocations of each form of operator new are counted, and their frees too
+static void TestCounters()
+{
+    std::size_t allocationCount = AllocationTracker::GetAllocationCount();
+    std::size_t allocatedBytes = AllocationTracker::GetAllocatedBytes();
+    std::size_t freeCount = AllocationTracker::GetFreeCount();
+
+    int* value = new int(1);
+    Keep(value);
+    delete value;
+
+    int* values = new int[16];
+    Keep(values);
+    delete[] values;
+
+    AlignedBlock* block = new AlignedBlock();
+    Keep(block);
+    CHECK(reinterpret_cast<std::uintptr_t>(block) % alignof(AlignedBlock) == 0);
+    delete block;
+
+    AlignedBlock* blocks = new AlignedBlock[4];
+    Keep(blocks);
+    CHECK(reinterpret_cast<std::uintptr_t>(blocks) % alignof(AlignedBlock) == 0);
+    delete[] blocks;
+
+    CHECK(AllocationTracker::GetAllocationCount() - allocationCount == 4);
+    CHECK(AllocationTracker::GetAllocatedBytes() - allocatedBytes >= sizeof(int) * 17 + sizeof(AlignedBlock) * 5);
+    CHECK(AllocationTracker::GetFreeCount() - freeCount == 4);
+}
+
+// Run the frame several times, then check that the following frames don't allocate
+template<typename F>
+static void CheckSteadyState(const char* name, F&& frame)
+{
+    for (int i = 0; i < WarmUpFrameCount; ++i)
+    {
+        frame();
+    }
+
+    AllocationTracker::NextFrame();
+    for (int i = 0; i < WarmUpFrameCount; ++i)
+    {
+        frame();
+    }
+    AllocationTracker::NextFrame();
+
+    if (AllocationTracker::GetFrameAllocationCount() > 0)
+    {
+        std::cout << "ERROR::TEST::STEADY_STATE_ALLOCATION " << name << " "
+            << AllocationTracker::GetFrameAllocationCount() << " allocations" << std::endl;
+    }
+    CHECK(AllocationTracker::GetFrameAllocationCount() == 0);
+}
+
+// The per-frame work of the CPU systems reuses its storage, and the jobs come from the pools of the queues
+static void TestSteadyState()
+{
+    JobSystem jobSystem(2);
+    std::vector<float> results(4096);
+    CheckSteadyState("JobSystem", [&]()
+        {
+            JobSystem::Counter counter;
+            for (int i = 0; i < 256; ++i)
+            {
+                jobSystem.Spawn([&results, i]() { results[i] = static_cast<float>(i); }, &counter);
+            }
+            jobSystem.Wait(counter);
+
+            jobSystem.ParallelFor(0, static_cast<unsigned int>(results.size()), [&results](unsigned int begin, unsigned int end)
+                {
+                    for (unsigned int i = begin; i < end; ++i)
+                    {
+                        results[i] *= 2.0f;
+                    }
+                });
+        });
+
+    glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projMatrix = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 viewProjMatrix = projMatrix * viewMatrix;
+    FrustumBounds frustum(viewProjMatrix);
+
+    PackedBounds packedBounds;
+    std::vector<uint8_t> visibilityMask;
+    CheckSteadyState("PackedBounds", [&]()
+        {
+            packedBounds.Clear();
+            for (int i = 0; i < 1000; ++i)
+            {
+                packedBounds.AddAabb(glm::vec3(i % 10, i / 100, -(i % 100)), glm::vec3(1.0f));
+            }
+            packedBounds.TestFrustum(frustum, visibilityMask);
+        });
+
+    // A wall in front of the camera, hiding a box behind it
+    std::vector<glm::vec3> positions = { { -10.0f, -10.0f, -5.0f }, { 10.0f, -10.0f, -5.0f }, { -10.0f, 10.0f, -5.0f }, { 10.0f, 10.0f, -5.0f } };
+    std::vector<unsigned int> indices = { 0, 1, 2, 1, 3, 2 };
+    OcclusionCuller culler;
+    bool occluded = false;
+    CheckSteadyState("OcclusionCuller", [&]()
+        {
+            culler.Begin(viewProjMatrix);
+            culler.AddOccluder(positions, indices, glm::mat4(1.0f));
+            culler.End();
+            occluded = culler.IsOccluded(glm::vec3(-1.0f, -1.0f, -12.0f), glm::vec3(1.0f, 1.0f, -10.0f));
+        });
+    CHECK(occluded);
+}
+
+int main()
+{
+    TestCounters();
+    TestSteadyState();
+
+    return GetFailedCheckCount();
+}
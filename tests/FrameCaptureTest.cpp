@@ -0,0 +1,186 @@
+#include "TestUtils.h"
+
+#include <ituGL/renderer/FrameCapture.h>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Decodes the PNG files written by FrameCapture, checking the checksums with their own implementations
+// Only the subset it writes is supported: RGB with 8 bits, no interlacing, a zlib stream of stored deflate blocks and no filters
+
+static std::uint32_t ReadBigEndian(const unsigned char* bytes)
+{
+    return (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8) | std::uint32_t(bytes[3]);
+}
+
+// Bit by bit, instead of the table of the encoder
+static std::uint32_t ComputeCrc(const unsigned char* bytes, size_t size)
+{
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static std::uint32_t ComputeAdler(const std::vector<unsigned char>& bytes)
+{
+    std::uint64_t a = 1, b = 0;
+    for (unsigned char byte : bytes)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return static_cast<std::uint32_t>((b << 16) | a);
+}
+
+// Returns the RGB pixels, top row first, or an empty vector if the file is not valid
+static std::vector<unsigned char> DecodePng(const std::string& file, int& width, int& height)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.data());
+    size_t size = file.size();
+    width = height = 0;
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    CHECK(size >= 8 && std::memcmp(bytes, signature, 8) == 0);
+
+    std::vector<unsigned char> zlibData;
+    bool ended = false;
+    for (size_t offset = 8; offset < size && !ended;)
+    {
+        if (size - offset < 12)
+        {
+            CHECK(false);
+            return {};
+        }
+        std::uint32_t length = ReadBigEndian(bytes + offset);
+        if (size - offset - 12 < length)
+        {
+            CHECK(false);
+            return {};
+        }
+        std::string type(reinterpret_cast<const char*>(bytes + offset + 4), 4);
+        const unsigned char* data = bytes + offset + 8;
+        CHECK(ComputeCrc(bytes + offset + 4, length + 4) == ReadBigEndian(data + length));
+
+        if (type == "IHDR")
+        {
+            CHECK(length == 13);
+            width = static_cast<int>(ReadBigEndian(data));
+            height = static_cast<int>(ReadBigEndian(data + 4));
+            // 8 bits, RGB, deflate, no filters and no interlacing
+            CHECK(data[8] == 8 && data[9] == 2 && data[10] == 0 && data[11] == 0 && data[12] == 0);
+        }
+        else if (type == "IDAT")
+        {
+            zlibData.insert(zlibData.end(), data, data + length);
+        }
+        else if (type == "IEND")
+        {
+            CHECK(length == 0);
+            ended = true;
+        }
+        offset += 12 + length;
+    }
+    CHECK(ended);
+
+    // zlib header with deflate and a valid check, then the stored blocks and the Adler-32 of the data
+    if (zlibData.size() < 6)
+    {
+        CHECK(false);
+        return {};
+    }
+    CHECK((zlibData[0] & 0x0F) == 8);
+    CHECK(((zlibData[0] << 8) | zlibData[1]) % 31 == 0);
+
+    std::vector<unsigned char> rows;
+    size_t offset = 2;
+    bool lastBlock = false;
+    while (!lastBlock && offset + 5 <= zlibData.size())
+    {
+        // Stored blocks have the type 0 in the bits 1-2, and the length followed by its complement
+        lastBlock = (zlibData[offset] & 1) != 0;
+        CHECK((zlibData[offset] & 0x06) == 0);
+        unsigned int length = zlibData[offset + 1] | (zlibData[offset + 2] << 8);
+        unsigned int complement = zlibData[offset + 3] | (zlibData[offset + 4] << 8);
+        CHECK((length ^ 0xFFFF) == complement);
+        offset += 5;
+        if (zlibData.size() - offset < length)
+        {
+            CHECK(false);
+            return {};
+        }
+        rows.insert(rows.end(), zlibData.begin() + offset, zlibData.begin() + offset + length);
+        offset += length;
+    }
+    CHECK(lastBlock);
+    CHECK(offset + 4 == zlibData.size());
+    CHECK(offset + 4 <= zlibData.size() && ComputeAdler(rows) == ReadBigEndian(zlibData.data() + offset));
+
+    size_t rowSize = 1 + static_cast<size_t>(width) * 3;
+    if (rows.size() != rowSize * height)
+    {
+        CHECK(false);
+        return {};
+    }
+    std::vector<unsigned char> pixels;
+    for (int row = 0; row < height; ++row)
+    {
+        CHECK(rows[row * rowSize] == 0);
+        pixels.insert(pixels.end(), rows.begin() + row * rowSize + 1, rows.begin() + (row + 1) * rowSize);
+    }
+    return pixels;
+}
+
+// Encode an image with a different value in each channel of each pixel, and compare it after decoding
+static void TestPngRoundTrip(int width, int height)
+{
+    std::vector<std::byte> pixels(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<std::byte>((i * 7 + i / 4) & 0xFF);
+    }
+
+    std::ostringstream stream(std::ios::binary);
+    std::vector<std::byte> rowBuffer;
+    CHECK(FrameCapture::EncodePng(stream, pixels.data(), width, height, rowBuffer));
+
+    int decodedWidth, decodedHeight;
+    std::vector<unsigned char> decoded = DecodePng(stream.str(), decodedWidth, decodedHeight);
+    CHECK(decodedWidth == width && decodedHeight == height);
+    if (decoded.size() != static_cast<size_t>(width) * height * 3)
+    {
+        CHECK(false);
+        return;
+    }
+
+    // The PNG starts with the top row, the pixels of OpenGL with the bottom one. Alpha is dropped
+    unsigned int mismatchCount = 0;
+    for (int row = 0; row < height; ++row)
+    {
+        for (int column = 0; column < width; ++column)
+        {
+            const unsigned char* source = reinterpret_cast<const unsigned char*>(pixels.data()) + (static_cast<size_t>(height - 1 - row) * width + column) * 4;
+            const unsigned char* destination = decoded.data() + (static_cast<size_t>(row) * width + column) * 3;
+            mismatchCount += std::memcmp(source, destination, 3) != 0 ? 1 : 0;
+        }
+    }
+    CHECK(mismatchCount == 0);
+}
+
+int main()
+{
+    // A single pixel, a single stored block, and several blocks with the last one partially filled
+    TestPngRoundTrip(1, 1);
+    TestPngRoundTrip(64, 48);
+    TestPngRoundTrip(301, 217);
+
+    return GetFailedCheckCount();
+}
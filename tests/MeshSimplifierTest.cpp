@@ -0,0 +1,91 @@
+#include "TestUtils.h"
+
+#include <ituGL/geometry/MeshSimplifier.h>
+#include <map>
+#include <tuple>
+#include <limits>
+#include <vector>
+
+// Square grid of size x size quads, split in islands of islandSize x islandSize quads with their own vertices,
+// like a mesh with many texture coordinate seams
+static void CreateSeamGrid(int size, int islandSize, std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices)
+{
+    std::map<std::tuple<int, int, int>, unsigned int> vertices;
+    auto getVertex = [&](int x, int y, int island)
+    {
+        auto itVertex = vertices.try_emplace({ x, y, island }, static_cast<unsigned int>(positions.size())).first;
+        if (itVertex->second == positions.size())
+        {
+            positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+        }
+        return itVertex->second;
+    };
+
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            int island = (x / islandSize) * size + (y / islandSize);
+            unsigned int v00 = getVertex(x, y, island), v10 = getVertex(x + 1, y, island);
+            unsigned int v11 = getVertex(x + 1, y + 1, island), v01 = getVertex(x, y + 1, island);
+            indices.insert(indices.end(), { v00, v10, v11, v00, v11, v01 });
+        }
+    }
+}
+
+// Edges of the simplified triangles with a single triangle, between positions, must be on the outline of the grid
+// A seam that moved only one of its sides would open a crack inside
+static bool HasCracks(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, int size)
+{
+    // Edges by the coordinates of their ends, sorted
+    std::map<std::tuple<float, float, float, float>, int> edgeCount;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            glm::vec3 a = positions[indices[i + corner]], b = positions[indices[i + (corner + 1) % 3]];
+            if (std::make_pair(a.x, a.y) > std::make_pair(b.x, b.y))
+            {
+                std::swap(a, b);
+            }
+            ++edgeCount[{ a.x, a.y, b.x, b.y }];
+        }
+    }
+
+    float max = static_cast<float>(size);
+    for (const auto& [edge, count] : edgeCount)
+    {
+        auto [ax, ay, bx, by] = edge;
+        bool onOutline = (ax == 0.0f && bx == 0.0f) || (ax == max && bx == max) || (ay == 0.0f && by == 0.0f) || (ay == max && by == max);
+        if (count == 1 && !onOutline)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main()
+{
+    const int size = 40;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    CreateSeamGrid(size, 5, positions, indices);
+
+    // With seams every 5 quads, locking the seams would keep more than a third of the triangles
+    for (float reduction : { 0.5f, 0.25f, 0.1f })
+    {
+        size_t targetIndexCount = static_cast<size_t>(indices.size() * reduction) / 3 * 3;
+        float error;
+        std::vector<unsigned int> simplified = MeshSimplifier::Simplify(indices, positions, targetIndexCount, std::numeric_limits<float>::max(), error);
+
+        CHECK(simplified.size() <= targetIndexCount);
+        CHECK(!simplified.empty());
+        CHECK(!HasCracks(simplified, positions, size));
+
+        // The grid is flat, and its outline is straight
+        CHECK(error < 1e-3f);
+    }
+
+    return GetFailedCheckCount();
+}
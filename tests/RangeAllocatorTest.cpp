@@ -0,0 +1,102 @@
+#include "TestUtils.h"
+
+#include <ituGL/core/RangeAllocator.h>
+#include <vector>
+
+// First fit, and freed ranges merged with both neighbours so they can be allocated again as one
+static void TestAllocateFree()
+{
+    RangeAllocator allocator(100);
+    CHECK(allocator.GetCapacity() == 100);
+    CHECK(allocator.GetLargestFreeSize() == 100);
+
+    size_t a = allocator.Allocate(10);
+    size_t b = allocator.Allocate(20);
+    size_t c = allocator.Allocate(30);
+    CHECK(a == 0 && b == 10 && c == 30);
+    CHECK(allocator.GetAllocatedSize() == 60);
+    CHECK(allocator.GetAllocationCount() == 3);
+    CHECK(allocator.GetLargestFreeSize() == 40);
+
+    // No range is large enough
+    CHECK(allocator.Allocate(41) == RangeAllocator::InvalidOffset);
+
+    // The gap of the first range is reused by a smaller allocation, and the rest of it stays free
+    allocator.Free(a);
+    size_t d = allocator.Allocate(4);
+    CHECK(d == 0);
+    CHECK(allocator.Allocate(6) == 4);
+    allocator.Free(4);
+
+    // Freeing b merges it with the free range before it, and freeing c with the ranges on both sides
+    allocator.Free(b);
+    CHECK(allocator.GetLargestFreeSize() == 40);
+    CHECK(allocator.Allocate(26) == 4);
+    allocator.Free(4);
+    allocator.Free(c);
+    CHECK(allocator.GetAllocationCount() == 1);
+    CHECK(allocator.GetAllocatedSize() == 4);
+    CHECK(allocator.GetLargestFreeSize() == 96);
+
+    allocator.Free(d);
+    CHECK(allocator.GetAllocatedSize() == 0);
+    CHECK(allocator.GetLargestFreeSize() == 100);
+    CHECK(allocator.Allocate(100) == 0);
+}
+
+// Growing adds the space at the end, merged with the free range that ends there
+static void TestGrow()
+{
+    RangeAllocator allocator(10);
+    CHECK(allocator.Allocate(6) == 0);
+    allocator.Grow(20);
+    CHECK(allocator.GetCapacity() == 20);
+    CHECK(allocator.GetLargestFreeSize() == 14);
+    CHECK(allocator.Allocate(14) == 6);
+}
+
+// Compact moves the allocations after the gaps down, in order, and reports the ones that moved
+static void TestCompact()
+{
+    RangeAllocator allocator(100);
+    std::vector<size_t> offsets;
+    for (size_t size : { 10, 5, 15, 20, 8 })
+    {
+        offsets.push_back(allocator.Allocate(size));
+    }
+    CHECK(offsets == std::vector<size_t>({ 0, 10, 15, 30, 50 }));
+
+    // Nothing to move without gaps
+    CHECK(allocator.Compact().empty());
+
+    // Remove the second and the fourth ranges. The first one stays, the others move down
+    allocator.Free(offsets[1]);
+    allocator.Free(offsets[3]);
+    std::vector<RangeAllocator::Relocation> relocations = allocator.Compact();
+    CHECK(relocations.size() == 2);
+    if (relocations.size() == 2)
+    {
+        CHECK(relocations[0].oldOffset == 15 && relocations[0].newOffset == 10 && relocations[0].size == 15);
+        CHECK(relocations[1].oldOffset == 50 && relocations[1].newOffset == 25 && relocations[1].size == 8);
+    }
+
+    // All the free space is a single range at the end, and the allocations are found at their new offsets
+    CHECK(allocator.GetAllocatedSize() == 33);
+    CHECK(allocator.GetLargestFreeSize() == 67);
+    CHECK(allocator.Allocate(67) == 33);
+    allocator.Free(33);
+    allocator.Free(25);
+    allocator.Free(10);
+    allocator.Free(0);
+    CHECK(allocator.GetAllocationCount() == 0);
+    CHECK(allocator.GetLargestFreeSize() == 100);
+}
+
+int main()
+{
+    TestAllocateFree();
+    TestGrow();
+    TestCompact();
+
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,72 @@
+#include "TestUtils.h"
+
+#include <ituGL/renderer/Renderer.h>
+#include <ituGL/shader/Material.h>
+#include <ituGL/shader/ShaderProgram.h>
+#include <ituGL/geometry/VertexArrayObject.h>
+#include <ituGL/geometry/Drawcall.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// There is no OpenGL context. The objects referenced by the drawcalls are only compared by address,
+// so the functions called to create and delete them are replaced with stubs that do nothing
+// The debug build of glad checks glGetError after each call, so it is replaced too
+static void StubObjectFunctions()
+{
+    glad_glGetError = []() -> GLenum { return GL_NO_ERROR; };
+    glad_glCreateProgram = []() -> GLuint { return 1; };
+    glad_glDeleteProgram = [](GLuint) {};
+    glad_glGetProgramiv = [](GLuint, GLenum, GLint* params) { *params = 0; };
+    glad_glGenVertexArrays = [](GLsizei count, GLuint* arrays) { std::fill(arrays, arrays + count, 1); };
+    glad_glDeleteVertexArrays = [](GLsizei, const GLuint*) {};
+}
+
+// A model in the forward collection, that cross-fades, and in a collection drawn by a pass without LodFade
+static void TestLodFadeCollections()
+{
+    Material material(std::make_shared<ShaderProgram>());
+    VertexArrayObject vao;
+    Drawcall drawcall(Drawcall::Primitive::Triangles, 36, Data::Type::UInt);
+    Drawcall fadeDrawcall(Drawcall::Primitive::Triangles, 12, Data::Type::UInt, 36);
+
+    std::vector<Renderer::DrawcallCollection> collections(3);
+    std::array<int, 2> collectionIndices = { 0, 1 };
+    std::vector<bool> lodFadeCollections = { true, false, true };
+
+    // While cross-fading, the next level of detail is only added where LodFade is set, and the other collection draws the current one whole
+    Renderer::DrawcallInfo fadingDrawcallInfo(material, 0, vao, vao, drawcall, glm::vec3(-1.0f), glm::vec3(1.0f), 0.25f);
+    Renderer::AddSubmeshDrawcalls(collections, collectionIndices, lodFadeCollections, fadingDrawcallInfo, fadeDrawcall);
+
+    CHECK(collections[0].size() == 2);
+    CHECK(collections[1].size() == 1);
+    CHECK(collections[2].empty());
+    if (collections[0].size() == 2 && collections[1].size() == 1)
+    {
+        CHECK(&collections[0][0].drawcall == &drawcall && collections[0][0].lodFade == 0.25f);
+        CHECK(&collections[0][1].drawcall == &fadeDrawcall && collections[0][1].lodFade == -0.25f);
+        CHECK(&collections[0][1].material == &material && collections[0][1].boundsMax == glm::vec3(1.0f));
+        CHECK(&collections[1][0].drawcall == &drawcall && collections[1][0].lodFade == 0.0f);
+    }
+
+    // Without cross-fading, every collection gets the drawcall once
+    Renderer::DrawcallInfo drawcallInfo(material, 1, vao, vao, drawcall, glm::vec3(-1.0f), glm::vec3(1.0f));
+    Renderer::AddSubmeshDrawcalls(collections, collectionIndices, lodFadeCollections, drawcallInfo, drawcall);
+
+    CHECK(collections[0].size() == 3);
+    CHECK(collections[1].size() == 2);
+    if (collections[0].size() == 3 && collections[1].size() == 2)
+    {
+        CHECK(collections[0][2].worldMatrixIndex == 1 && collections[0][2].lodFade == 0.0f);
+        CHECK(collections[1][1].worldMatrixIndex == 1 && collections[1][1].lodFade == 0.0f);
+    }
+}
+
+int main()
+{
+    StubObjectFunctions();
+
+    TestLodFadeCollections();
+
+    return GetFailedCheckCount();
+}
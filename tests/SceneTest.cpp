@@ -0,0 +1,122 @@
+#include "TestUtils.h"
+
+#include <ituGL/scene/Scene.h>
+#include <ituGL/scene/SceneModel.h>
+#include <ituGL/scene/SceneVisitor.h>
+#include <ituGL/scene/Transform.h>
+#include <string>
+#include <vector>
+
+// Counts the visits of each model, identified by the x coordinate of its translation
+class CountingVisitor : public SceneVisitor
+{
+public:
+    CountingVisitor(unsigned int nodeCount) : m_visitCounts(nodeCount, 0)
+    {
+    }
+
+    void VisitModel(SceneModel& sceneModel) override
+    {
+        unsigned int index = static_cast<unsigned int>(sceneModel.GetTransform()->GetTranslation().x);
+        ++m_visitCounts[index];
+    }
+
+    const std::vector<unsigned int>& GetVisitCounts() const { return m_visitCounts; }
+
+private:
+    std::vector<unsigned int> m_visitCounts;
+};
+
+static std::shared_ptr<SceneModel> CreateModel(const std::string& name, unsigned int index)
+{
+    std::shared_ptr<Transform> transform = std::make_shared<Transform>();
+    transform->SetTranslation(glm::vec3(static_cast<float>(index), 0.0f, 0.0f));
+    return std::make_shared<SceneModel>(name, nullptr, transform);
+}
+
+// Handles keep resolving to their node while other nodes are removed, and stop resolving when their node is removed
+static void TestHandles()
+{
+    Scene scene;
+    std::shared_ptr<SceneNode> nodeA = std::make_shared<SceneNode>("a");
+    std::shared_ptr<SceneModel> modelB = CreateModel("b", 0);
+    std::shared_ptr<SceneModel> modelC = CreateModel("c", 1);
+    Scene::Handle handleA = scene.AddSceneNode(nodeA);
+    Scene::Handle handleB = scene.AddSceneNode(modelB);
+    Scene::Handle handleC = scene.AddSceneNode(modelC);
+
+    CHECK(handleA && handleB && handleC);
+    CHECK(scene.GetSceneNode(handleA) == nodeA);
+    CHECK(scene.GetSceneNode(handleB) == modelB);
+    CHECK(scene.GetHandle("c") == handleC);
+    CHECK(!scene.GetSceneNode(Scene::Handle()));
+
+    // The last model fills the gap of the removed one
+    CHECK(scene.RemoveSceneNode(handleB));
+    CHECK(!scene.GetSceneNode(handleB));
+    CHECK(!scene.GetSceneNode("b"));
+    CHECK(scene.GetSceneNode(handleC) == modelC);
+    CHECK(!scene.RemoveSceneNode(handleB));
+
+    // The slot is reused with a new generation, so the old handle doesn't resolve to the new node
+    std::shared_ptr<SceneModel> modelD = CreateModel("d", 2);
+    Scene::Handle handleD = scene.AddSceneNode(modelD);
+    CHECK(handleD.index == handleB.index);
+    CHECK(handleD.generation != handleB.generation);
+    CHECK(!scene.GetSceneNode(handleB));
+    CHECK(scene.GetSceneNode(handleD) == modelD);
+
+    // Renaming keeps the handle
+    modelD->Rename("e");
+    CHECK(scene.GetHandle("e") == handleD);
+    CHECK(!scene.GetHandle("d"));
+
+    // Adding a node with an existing name replaces it
+    std::shared_ptr<SceneModel> modelC2 = CreateModel("c", 3);
+    Scene::Handle handleC2 = scene.AddSceneNode(modelC2);
+    CHECK(!scene.GetSceneNode(handleC));
+    CHECK(scene.GetSceneNode("c") == modelC2);
+    CHECK(scene.GetSceneNode(handleC2) == modelC2);
+}
+
+// Every node is visited once, after adding many nodes and removing a part of them
+static void TestVisitLargeScene()
+{
+    const unsigned int nodeCount = 100000;
+
+    Scene scene;
+    std::vector<Scene::Handle> handles;
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        handles.push_back(scene.AddSceneNode(CreateModel("model" + std::to_string(i), i)));
+    }
+
+    // Remove every third node, so the removed nodes are replaced by the ones at the end
+    for (unsigned int i = 0; i < nodeCount; i += 3)
+    {
+        CHECK(scene.RemoveSceneNode(handles[i]));
+    }
+
+    CountingVisitor visitor(nodeCount);
+    scene.AcceptVisitor(visitor);
+
+    unsigned int wrongCount = 0;
+    for (unsigned int i = 0; i < nodeCount; ++i)
+    {
+        unsigned int expectedCount = i % 3 == 0 ? 0 : 1;
+        wrongCount += visitor.GetVisitCounts()[i] != expectedCount ? 1 : 0;
+
+        std::shared_ptr<SceneNode> node = scene.GetSceneNode(handles[i]);
+        wrongCount += (node != nullptr) != (expectedCount == 1) ? 1 : 0;
+        wrongCount += node && node->GetTransform()->GetTranslation().x != static_cast<float>(i) ? 1 : 0;
+    }
+    CHECK(wrongCount == 0);
+}
+
+int main()
+{
+    TestHandles();
+    TestVisitLargeScene();
+
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+
+// Number of failed checks in the test. main returns it, so ctest reports the test as failed
+inline int& GetFailedCheckCount()
+{
+    static int s_failedCheckCount = 0;
+    return s_failedCheckCount;
+}
+
+// Unlike assert, the checks are also evaluated in release builds, and the test continues after a failure
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cout << "ERROR::TEST::CHECK_FAILED " << __FILE__ << ":" << __LINE__ << " " << #condition << std::endl; \
+            ++GetFailedCheckCount(); \
+        } \
+    } while (false)